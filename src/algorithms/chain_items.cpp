@@ -8,6 +8,8 @@
 
 #include <handlegraph/algorithms/dijkstra.hpp>
 
+#include <simde/x86/sse4.1.h>
+
 //#define debug_chaining
 
 namespace vg {
@@ -46,6 +48,58 @@ TracedScore TracedScore::add_points(int adjustment) const {
     return {this->score + adjustment, this->source};
 }
 
+/// How many predecessor transitions we bound at once, in SIMD lanes
+static constexpr size_t TRANSITION_LANES = 4;
+
+/**
+ * Work out the read distances and score bounds for transitions from a window
+ * of up to TRANSITION_LANES predecessors, in 32-bit SIMD lanes.
+ *
+ * read_ends and source_scores hold the read end positions and best chain
+ * scores of the predecessors. Fills in read_distances with the read distance
+ * for each lane, or std::numeric_limits<size_t>::max() if the predecessor
+ * overlaps read_start. Fills in skippable with whether each lane can't affect
+ * the DP: it overlaps, or even a free transition from it would score below
+ * score_to_beat (and at or below 0, unless positive bounds are also allowed
+ * to be pruned). If prune is false, only overlapping lanes are skippable.
+ */
+static void bound_transition_window(const int32_t* read_ends, const int32_t* source_scores,
+                                    int32_t read_start, int32_t item_points, int32_t score_to_beat,
+                                    bool prune, bool prune_positive,
+                                    size_t* read_distances, bool* skippable) {
+    
+    simde__m128i ends = simde_mm_loadu_si128((const simde__m128i*) read_ends);
+    simde__m128i scores = simde_mm_loadu_si128((const simde__m128i*) source_scores);
+    simde__m128i starts = simde_mm_set1_epi32(read_start);
+    
+    // Items that end after here starts overlap in the read.
+    simde__m128i overlapping = simde_mm_cmpgt_epi32(ends, starts);
+    simde__m128i distances = simde_mm_sub_epi32(starts, ends);
+    
+    // Transitions can only cost points, so the best we could do is the
+    // source's score plus our own points.
+    simde__m128i bounds = simde_mm_add_epi32(scores, simde_mm_set1_epi32(item_points));
+    simde__m128i beaten = simde_mm_setzero_si128();
+    if (prune) {
+        beaten = simde_mm_cmplt_epi32(bounds, simde_mm_set1_epi32(score_to_beat));
+        if (!prune_positive) {
+            beaten = simde_mm_and_si128(beaten, simde_mm_cmplt_epi32(bounds, simde_mm_set1_epi32(1)));
+        }
+    }
+    simde__m128i skip = simde_mm_or_si128(overlapping, beaten);
+    
+    int32_t lane_distances[TRANSITION_LANES];
+    int32_t lane_overlapping[TRANSITION_LANES];
+    int32_t lane_skip[TRANSITION_LANES];
+    simde_mm_storeu_si128((simde__m128i*) lane_distances, distances);
+    simde_mm_storeu_si128((simde__m128i*) lane_overlapping, overlapping);
+    simde_mm_storeu_si128((simde__m128i*) lane_skip, skip);
+    for (size_t lane = 0; lane < TRANSITION_LANES; lane++) {
+        read_distances[lane] = lane_overlapping[lane] ? std::numeric_limits<size_t>::max() : (size_t) lane_distances[lane];
+        skippable[lane] = lane_skip[lane];
+    }
+}
+
 void sort_and_shadow(const std::vector<Anchor>& items, std::vector<size_t>& indexes) {
     
     // Sort the indexes by read start ascending, and read end descending
@@ -131,7 +185,8 @@ TracedScore chain_items_dp(vector<TracedScore>& best_chain_score,
                            double lookback_scale_factor,
                            double min_good_transition_score_per_base,
                            int item_bonus,
-                           size_t max_indel_bases) {
+                           size_t max_indel_bases,
+                           DistanceCache* distance_cache) {
     
     DiagramExplainer diagram;
     diagram.add_globals({{"rankdir", "LR"}});
@@ -156,6 +211,14 @@ TracedScore chain_items_dp(vector<TracedScore>& best_chain_score,
     // just initialize first overlapping at the beginning and be right.
     auto first_overlapping_it = read_end_order.begin();
     
+    // Keep the read ends in read end order where we can load them into SIMD
+    // lanes. Read coordinates fit in 32 bits.
+    vector<int32_t> ordered_read_ends(read_end_order.size());
+    for (size_t rank = 0; rank < read_end_order.size(); rank++) {
+        assert(to_chain[read_end_order[rank]].read_end() <= (size_t) std::numeric_limits<int32_t>::max());
+        ordered_read_ends[rank] = to_chain[read_end_order[rank]].read_end();
+    }
+    
     // Make our DP table big enough
     best_chain_score.resize(to_chain.size(), TracedScore::unset());
     
@@ -206,125 +269,175 @@ TracedScore chain_items_dp(vector<TracedScore>& best_chain_score,
         // the best one we have seen so far in case the standard goes below it. 
         int best_transition_found = std::numeric_limits<int>::min();
         
-        // Start considering predecessors for this item.
-        auto predecessor_index_it = first_overlapping_it;
-        while (predecessor_index_it != read_end_order.begin()) {
-            --predecessor_index_it;
-            
-            // How many items have we considered before this one?
-            size_t item_number = items_considered++;
-            
-            // For each source that ended before here started, in reverse order by end position...
-            auto& source = to_chain[*predecessor_index_it];
+        // A transition that can't beat the score we already have for here,
+        // and can't change when we stop looking back, doesn't need a distance
+        // query. Transitions can't score above 0, so once we have seen a free
+        // one, other transitions can't change the best transition we've seen.
+        // We don't do this when explaining, because the explanation wants to
+        // see every transition that would have scored positive.
+        auto can_prune = [&]() {
+            return !Explainer::save_explanations && best_transition_found >= 0;
+        };
+        auto can_skip_transition = [&](int64_t bound) {
+            return can_prune() && bound < best_chain_score[i].score && (good_score_found || bound <= 0);
+        };
+        
+        // Start considering predecessors for this item, a window of them at a
+        // time, from the last one that ends before here starts.
+        size_t predecessor_rank = first_overlapping_it - read_end_order.begin();
+        bool lookback_done = false;
+        while (predecessor_rank != 0 && !lookback_done) {
+            // Gather up the window. Lanes we don't fill are made to overlap, so
+            // they are skippable.
+            size_t window_size = std::min(predecessor_rank, TRANSITION_LANES);
+            int32_t window_read_ends[TRANSITION_LANES];
+            int32_t window_scores[TRANSITION_LANES];
+            for (size_t lane = 0; lane < TRANSITION_LANES; lane++) {
+                if (lane < window_size) {
+                    size_t rank = predecessor_rank - 1 - lane;
+                    window_read_ends[lane] = ordered_read_ends[rank];
+                    window_scores[lane] = best_chain_score[read_end_order[rank]].score;
+                } else {
+                    window_read_ends[lane] = here.read_start() + 1;
+                    window_scores[lane] = 0;
+                }
+            }
+            size_t window_read_distances[TRANSITION_LANES];
+            bool window_skippable[TRANSITION_LANES];
+            bound_transition_window(window_read_ends, window_scores, here.read_start(), item_points,
+                                    best_chain_score[i].score, can_prune(), good_score_found,
+                                    window_read_distances, window_skippable);
             
+            for (size_t lane = 0; lane < window_size; lane++) {
+                auto predecessor_index_it = read_end_order.begin() + (--predecessor_rank);
+                
+                // How many items have we considered before this one?
+                size_t item_number = items_considered++;
+                
+                // For each source that ended before here started, in reverse order by end position...
+                auto& source = to_chain[*predecessor_index_it];
+                
 #ifdef debug_chaining
-            cerr << "\tConsider transition from #" << *predecessor_index_it << ": " << source << endl;
+                cerr << "\tConsider transition from #" << *predecessor_index_it << ": " << source << endl;
 #endif
 
-            // How far do we go in the read?
-            size_t read_distance = get_read_distance(source, here);
-            
-            if (item_number > lookback_item_hard_cap) {
-                // This would be too many
+                // How far do we go in the read?
+                size_t read_distance = window_read_distances[lane];
+                
+                if (item_number > lookback_item_hard_cap) {
+                    // This would be too many
 #ifdef debug_chaining
-                cerr << "\t\tDisregard due to hitting lookback item hard cap" << endl;
+                    cerr << "\t\tDisregard due to hitting lookback item hard cap" << endl;
 #endif
-                break;
-            }
-            if (item_number >= min_lookback_items) {
-                // We have looked at enough predecessors that we might consider stopping.
-                // See if we should look back this far.
-                if (read_distance > max_lookback_bases) {
-                    // This is further in the read than the real hard limit.
-                    break;
-                } else if (read_distance > lookback_threshold && good_score_found) {
-                    // We already found something good enough.
+                    lookback_done = true;
                     break;
                 }
-            }
-            if (read_distance > lookback_threshold && !good_score_found) {
-                // We still haven't found anything good, so raise the threshold.
-                lookback_threshold *= lookback_scale_factor;
-            }
-            
-            // Now it's safe to make a distance query
+                if (item_number >= min_lookback_items) {
+                    // We have looked at enough predecessors that we might consider stopping.
+                    // See if we should look back this far.
+                    if (read_distance > max_lookback_bases) {
+                        // This is further in the read than the real hard limit.
+                        lookback_done = true;
+                        break;
+                    } else if (read_distance > lookback_threshold && good_score_found) {
+                        // We already found something good enough.
+                        lookback_done = true;
+                        break;
+                    }
+                }
+                if (read_distance > lookback_threshold && !good_score_found) {
+                    // We still haven't found anything good, so raise the threshold.
+                    lookback_threshold *= lookback_scale_factor;
+                }
+                
+                // Now it's safe to make a distance query
 #ifdef debug_chaining
-            cerr << "\t\tCome from score " << best_chain_score[*predecessor_index_it]
-                << " across " << source << " to " << here << endl;
+                cerr << "\t\tCome from score " << best_chain_score[*predecessor_index_it]
+                    << " across " << source << " to " << here << endl;
 #endif
-            
-            // We will actually evaluate the source.
-            
-            // How far do we go in the graph?
-            size_t graph_distance = get_graph_distance(source, here, distance_index, graph);
-            
-            // How much does it pay (+) or cost (-) to make the jump from there
-            // to here?
-            // Don't allow the transition if it seems like we're going the long
-            // way around an inversion and needing a huge indel.
-            int jump_points;
-            
-            if (read_distance == numeric_limits<size_t>::max()) {
-                // Overlap in read, so not allowed.
-                jump_points = std::numeric_limits<int>::min();
-            } else if (graph_distance == numeric_limits<size_t>::max()) {
-                // No graph connection
-                jump_points = std::numeric_limits<int>::min();
-            } else {
-                // Decide how much length changed
-                size_t indel_length = (read_distance > graph_distance) ? read_distance - graph_distance : graph_distance - read_distance;
                 
-                if (indel_length > max_indel_bases) {
-                    // Don't allow an indel this long
+                if (window_skippable[lane] ||
+                    can_skip_transition((int64_t) best_chain_score[*predecessor_index_it].score + item_points)) {
+                    // The bounds say this transition can't matter, so don't go to the distance index.
+#ifdef debug_chaining
+                    cerr << "\t\tTransition can't beat " << best_chain_score[i] << endl;
+#endif
+                    continue;
+                }
+                
+                // We will actually evaluate the source.
+                
+                // How far do we go in the graph?
+                size_t graph_distance = get_graph_distance(source, here, distance_index, graph, distance_cache);
+                
+                // How much does it pay (+) or cost (-) to make the jump from there
+                // to here?
+                // Don't allow the transition if it seems like we're going the long
+                // way around an inversion and needing a huge indel.
+                int jump_points;
+                
+                if (read_distance == numeric_limits<size_t>::max()) {
+                    // Overlap in read, so not allowed.
+                    jump_points = std::numeric_limits<int>::min();
+                } else if (graph_distance == numeric_limits<size_t>::max()) {
+                    // No graph connection
                     jump_points = std::numeric_limits<int>::min();
                 } else {
-                    // Then charge for that indel
-                    jump_points = score_gap(indel_length, gap_open, gap_extension);
+                    // Decide how much length changed
+                    size_t indel_length = (read_distance > graph_distance) ? read_distance - graph_distance : graph_distance - read_distance;
+                
+                    if (indel_length > max_indel_bases) {
+                        // Don't allow an indel this long
+                        jump_points = std::numeric_limits<int>::min();
+                    } else {
+                        // Then charge for that indel
+                        jump_points = score_gap(indel_length, gap_open, gap_extension);
+                    }
                 }
-            }
-            
-            // And how much do we end up with overall coming from there.
-            int achieved_score;
-            
-            if (jump_points != numeric_limits<int>::min()) {
-                // Get the score we are coming from
-                TracedScore source_score = TracedScore::score_from(best_chain_score, *predecessor_index_it);
                 
-                // And the score with the transition and the points from the item
-                TracedScore from_source_score = source_score.add_points(jump_points + item_points);
+                // And how much do we end up with overall coming from there.
+                int achieved_score;
+                
+                if (jump_points != numeric_limits<int>::min()) {
+                    // Get the score we are coming from
+                    TracedScore source_score = TracedScore::score_from(best_chain_score, *predecessor_index_it);
                 
-                // Remember that we could make this jump
-                best_chain_score[i] = std::max(best_chain_score[i],
-                                               from_source_score);
+                    // And the score with the transition and the points from the item
+                    TracedScore from_source_score = source_score.add_points(jump_points + item_points);
+                
+                    // Remember that we could make this jump
+                    best_chain_score[i] = std::max(best_chain_score[i],
+                                                   from_source_score);
                                                
 #ifdef debug_chaining
-                cerr << "\t\tWe can reach #" << i << " with " << source_score << " + " << jump_points << " from transition + " << item_points << " from item = " << from_source_score << endl;
+                    cerr << "\t\tWe can reach #" << i << " with " << source_score << " + " << jump_points << " from transition + " << item_points << " from item = " << from_source_score << endl;
 #endif
-                if (from_source_score.score > 0) {
-                    // Only explain edges that were actual candidates since we
-                    // won't let local score go negative
+                    if (from_source_score.score > 0) {
+                        // Only explain edges that were actual candidates since we
+                        // won't let local score go negative
                     
-                    std::string source_gvnode = "i" + std::to_string(*predecessor_index_it);
-                    // Suggest that we have an edge, where the edges that are the best routes here are the most likely to actually show up.
-                    diagram.suggest_edge(source_gvnode, here_gvnode, here_gvnode, from_source_score.score, {
-                        {"label", std::to_string(jump_points)},
-                        {"weight", std::to_string(std::max<int>(1, from_source_score.score))}
-                    });
-                }
+                        std::string source_gvnode = "i" + std::to_string(*predecessor_index_it);
+                        // Suggest that we have an edge, where the edges that are the best routes here are the most likely to actually show up.
+                        diagram.suggest_edge(source_gvnode, here_gvnode, here_gvnode, from_source_score.score, {
+                            {"label", std::to_string(jump_points)},
+                            {"weight", std::to_string(std::max<int>(1, from_source_score.score))}
+                        });
+                    }
                 
-                achieved_score = from_source_score.score;
-            } else {
+                    achieved_score = from_source_score.score;
+                } else {
 #ifdef debug_chaining
-                cerr << "\t\tTransition is impossible." << endl;
+                    cerr << "\t\tTransition is impossible." << endl;
 #endif
-                achieved_score = std::numeric_limits<size_t>::min();
-            }
-            
-            // Note that we checked out this transition and saw the observed scores and distances.
-            best_transition_found = std::max(best_transition_found, jump_points);
-            if (achieved_score > 0 && best_transition_found >= min_good_transition_score_per_base * std::max(read_distance, graph_distance)) {
-                // We found a jump that looks plausible given how far we have searched, so we can stop searching way past here.
-                good_score_found = true;
+                    achieved_score = std::numeric_limits<size_t>::min();
+                }
+                
+                // Note that we checked out this transition and saw the observed scores and distances.
+                best_transition_found = std::max(best_transition_found, jump_points);
+                if (achieved_score > 0 && best_transition_found >= min_good_transition_score_per_base * std::max(read_distance, graph_distance)) {
+                    // We found a jump that looks plausible given how far we have searched, so we can stop searching way past here.
+                    good_score_found = true;
+                }
             }
         }
         
@@ -416,7 +529,8 @@ pair<int, vector<size_t>> find_best_chain(const VectorView<Anchor>& to_chain,
                                           double lookback_scale_factor,
                                           double min_good_transition_score_per_base,
                                           int item_bonus,
-                                          size_t max_indel_bases) {
+                                          size_t max_indel_bases,
+                                          DistanceCache* distance_cache) {
                                                                  
     if (to_chain.empty()) {
         return std::make_pair(0, vector<size_t>());
@@ -437,7 +551,8 @@ pair<int, vector<size_t>> find_best_chain(const VectorView<Anchor>& to_chain,
                                                                  lookback_scale_factor,
                                                                  min_good_transition_score_per_base,
                                                                  item_bonus,
-                                                                 max_indel_bases);
+                                                                 max_indel_bases,
+                                                                 distance_cache);
         // Then do the traceback and pair it up with the score.
         return std::make_pair(
             best_past_ending_score_ever.score,
@@ -457,13 +572,18 @@ int score_best_chain(const VectorView<Anchor>& to_chain, const SnarlDistanceInde
     }
 }
 
-size_t get_graph_distance(const Anchor& from, const Anchor& to, const SnarlDistanceIndex& distance_index, const HandleGraph& graph) {
+size_t get_graph_distance(const Anchor& from, const Anchor& to, const SnarlDistanceIndex& distance_index, const HandleGraph& graph,
+                          DistanceCache* distance_cache) {
     // TODO: hide something in the Anchors so we can use the minimizer cache information
     // For now just measure between the graph positions.
     
     auto from_pos = from.graph_end();
     auto& to_pos = to.graph_start();
     
+    if (distance_cache) {
+        return distance_cache->minimum_distance(distance_index, from_pos, to_pos, false, &graph);
+    }
+    
     return distance_index.minimum_distance(
         id(from_pos), is_rev(from_pos), offset(from_pos),
         id(to_pos), is_rev(to_pos), offset(to_pos),
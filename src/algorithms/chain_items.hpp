@@ -29,6 +29,7 @@
 #include "../snarl_seed_clusterer.hpp"
 #include "../handle.hpp"
 #include "../explainer.hpp"
+#include "../distance_cache.hpp"
 #include "../utility.hpp"
 
 #include <bdsg/hash_graph.hpp>
@@ -214,6 +215,9 @@ void sort_and_shadow(std::vector<Anchor>& items);
  *
  * Limits transitions to those involving indels of the given size or less, to
  * avoid very bad transitions.
+ *
+ * If a DistanceCache is given, graph distances are looked up in and saved to
+ * it.
  */
 TracedScore chain_items_dp(vector<TracedScore>& best_chain_score,
                            const VectorView<Anchor>& to_chain,
@@ -228,7 +232,8 @@ TracedScore chain_items_dp(vector<TracedScore>& best_chain_score,
                            double lookback_scale_factor = 2.0,
                            double min_good_transition_score_per_base = -0.1,
                            int item_bonus = 0,
-                           size_t max_indel_bases = 100);
+                           size_t max_indel_bases = 100,
+                           DistanceCache* distance_cache = nullptr);
 
 /**
  * Trace back through in the given DP table from the best chain score.
@@ -245,6 +250,9 @@ vector<size_t> chain_items_traceback(const vector<TracedScore>& best_chain_score
  *
  * Returns the score and the list of indexes of items visited to achieve
  * that score, in order.
+ *
+ * If a DistanceCache is given, graph distances are looked up in and saved to
+ * it.
  */
 pair<int, vector<size_t>> find_best_chain(const VectorView<Anchor>& to_chain,
                                           const SnarlDistanceIndex& distance_index,
@@ -258,7 +266,8 @@ pair<int, vector<size_t>> find_best_chain(const VectorView<Anchor>& to_chain,
                                           double lookback_scale_factor = 2.0,
                                           double min_good_transition_score_per_base = -0.1,
                                           int item_bonus = 0,
-                                          size_t max_indel_bases = 100);
+                                          size_t max_indel_bases = 100,
+                                          DistanceCache* distance_cache = nullptr);
 
 /**
  * Score the given group of items. Determines the best score that can be
@@ -269,7 +278,9 @@ pair<int, vector<size_t>> find_best_chain(const VectorView<Anchor>& to_chain,
 int score_best_chain(const VectorView<Anchor>& to_chain, const SnarlDistanceIndex& distance_index, const HandleGraph& graph, int gap_open, int gap_extension);
 
 /// Get distance in the graph, or std::numeric_limits<size_t>::max() if unreachable.
-size_t get_graph_distance(const Anchor& from, const Anchor& to, const SnarlDistanceIndex& distance_index, const HandleGraph& graph);
+/// If a DistanceCache is given, the distance is looked up in and saved to it.
+size_t get_graph_distance(const Anchor& from, const Anchor& to, const SnarlDistanceIndex& distance_index, const HandleGraph& graph,
+                          DistanceCache* distance_cache = nullptr);
 
 /// Get distance in the read, or std::numeric_limits<size_t>::max() if unreachable.
 size_t get_read_distance(const Anchor& from, const Anchor& to);
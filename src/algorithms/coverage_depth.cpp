@@ -10,14 +10,19 @@ namespace algorithms {
 void packed_depths(const Packer& packer, const string& path_name, size_t min_coverage, ostream& out_stream) {
     const PathHandleGraph& graph = dynamic_cast<const PathHandleGraph&>(*packer.get_graph());
     path_handle_t path_handle = graph.get_path_handle(path_name);
-    step_handle_t start_step = graph.path_begin(path_handle);
-    step_handle_t end_step = graph.path_end(path_handle);
-    Position cur_pos;
     subrange_t subrange;
     string base_name = Paths::strip_subrange(path_name, &subrange);
     size_t path_offset = subrange == PathMetadata::NO_SUBRANGE ? 1 : 1 + subrange.first;
+    packed_depths(packer, graph.path_begin(path_handle), graph.path_end(path_handle), base_name, path_offset,
+                  min_coverage, out_stream);
+}
+
+void packed_depths(const Packer& packer, step_handle_t start_step, step_handle_t end_plus_one_step,
+                   const string& base_name, size_t path_offset, size_t min_coverage, ostream& out_stream) {
+    const PathHandleGraph& graph = dynamic_cast<const PathHandleGraph&>(*packer.get_graph());
+    Position cur_pos;
     
-    for (step_handle_t cur_step = start_step; cur_step != end_step; cur_step = graph.get_next_step(cur_step)) {
+    for (step_handle_t cur_step = start_step; cur_step != end_plus_one_step; cur_step = graph.get_next_step(cur_step)) {
         handle_t cur_handle = graph.get_handle_of_step(cur_step);
         nid_t cur_id = graph.get_id(cur_handle);
         size_t cur_len = graph.get_length(cur_handle);
@@ -34,6 +39,28 @@ void packed_depths(const Packer& packer, const string& path_name, size_t min_cov
     }
 }
 
+vector<tuple<size_t, step_handle_t, step_handle_t>> path_step_ranges(const PathHandleGraph& graph, const string& path_name,
+                                                                     size_t range_size) {
+    path_handle_t path_handle = graph.get_path_handle(path_name);
+    step_handle_t end_step = graph.path_end(path_handle);
+    vector<tuple<size_t, step_handle_t, step_handle_t>> ranges;
+    size_t offset = 0;
+    size_t cur_range_size = range_size;
+    for (step_handle_t cur_step = graph.path_begin(path_handle); cur_step != end_step; cur_step = graph.get_next_step(cur_step)) {
+        if (cur_range_size >= range_size) {
+            if (!ranges.empty()) {
+                get<2>(ranges.back()) = cur_step;
+            }
+            ranges.emplace_back(offset, cur_step, end_step);
+            cur_range_size = 0;
+        }
+        size_t node_len = graph.get_length(graph.get_handle_of_step(cur_step));
+        offset += node_len;
+        cur_range_size += node_len;
+    }
+    return ranges;
+}
+
 pair<double, double> packed_depth_of_bin(const Packer& packer,
                                          step_handle_t start_step, step_handle_t end_plus_one_step,
                                          size_t min_coverage, bool include_deletions) {
@@ -295,6 +322,28 @@ pair<double, double> sample_gam_depth(const HandleGraph& graph, const vector<Ali
     return combine_and_average_node_coverages(graph, node_coverages, min_coverage);
 }
 
+/// Get the number of (unique, unless count_cycles is set) other paths that step on the given step's node
+static size_t path_depth_of_step(const PathHandleGraph& graph, step_handle_t step_handle, bool count_cycles,
+                                 unordered_map<path_handle_t, string>& path_to_name) {
+    unordered_set<string> path_set;
+    size_t step_count = 0;            
+    graph.for_each_step_on_handle(graph.get_handle_of_step(step_handle), [&](step_handle_t step_handle_2) {
+            if (count_cycles) {
+                ++step_count;
+            } else {
+                path_handle_t step_path_handle = graph.get_path_handle_of_step(step_handle_2);
+                auto it = path_to_name.find(step_path_handle);
+                if (it == path_to_name.end()) {
+                    string step_path_name = graph.get_path_name(step_path_handle);
+                    // disregard subpath tags when counting
+                    it = path_to_name.insert(make_pair(step_path_handle, Paths::strip_subrange(step_path_name))).first;
+                }
+                path_set.insert(it->second);
+            }
+        });
+    return (count_cycles ? step_count : path_set.size()) - 1;
+}
+
 void path_depths(const PathHandleGraph& graph, const string& path_name, size_t min_coverage, bool count_cycles, ostream& out_stream) {
     assert(graph.has_path(path_name));
 
@@ -307,36 +356,35 @@ void path_depths(const PathHandleGraph& graph, const string& path_name, size_t m
     size_t offset = subrange == PathMetadata::NO_SUBRANGE ? 1 : 1 + subrange.first;
 
     graph.for_each_step_in_path(path_handle, [&](step_handle_t step_handle) {
-            unordered_set<string> path_set;
-            size_t step_count = 0;            
-            handle_t handle = graph.get_handle_of_step(step_handle);
-            graph.for_each_step_on_handle(handle, [&](step_handle_t step_handle_2) {
-                    if (count_cycles) {
-                        ++step_count;
-                    } else {
-                        path_handle_t step_path_handle = graph.get_path_handle_of_step(step_handle_2);
-                        auto it = path_to_name.find(step_path_handle);
-                        if (it == path_to_name.end()) {
-                            string step_path_name = graph.get_path_name(step_path_handle);
-                            // disregard subpath tags when counting
-                            it = path_to_name.insert(make_pair(step_path_handle, Paths::strip_subrange(step_path_name))).first;
-                        }
-                        path_set.insert(it->second);
-                    }
-                });
-            size_t coverage = (count_cycles ? step_count : path_set.size()) - 1;
-            size_t node_len = graph.get_length(handle);
+            size_t coverage = path_depth_of_step(graph, step_handle, count_cycles, path_to_name);
+            size_t node_len = graph.get_length(graph.get_handle_of_step(step_handle));
             if (coverage >= min_coverage) {
                 for (size_t i = 0; i < node_len; ++i) {
-                    if (coverage >= min_coverage) {
-                        out_stream << base_name << "\t" << (offset + i) << "\t" << coverage << "\n";
-                    }
+                    out_stream << base_name << "\t" << (offset + i) << "\t" << coverage << "\n";
                 }
             }
             offset += node_len;            
         });
 }
 
+void path_depths(const PathHandleGraph& graph, step_handle_t start_step, step_handle_t end_plus_one_step,
+                 const string& base_name, size_t path_offset, size_t min_coverage, bool count_cycles, ostream& out_stream) {
+
+    // big speedup
+    unordered_map<path_handle_t, string> path_to_name;
+
+    for (step_handle_t cur_step = start_step; cur_step != end_plus_one_step; cur_step = graph.get_next_step(cur_step)) {
+        size_t coverage = path_depth_of_step(graph, cur_step, count_cycles, path_to_name);
+        size_t node_len = graph.get_length(graph.get_handle_of_step(cur_step));
+        if (coverage >= min_coverage) {
+            for (size_t i = 0; i < node_len; ++i) {
+                out_stream << base_name << "\t" << (path_offset + i) << "\t" << coverage << "\n";
+            }
+        }
+        path_offset += node_len;
+    }
+}
+
 pair<double, double> path_depth_of_bin(const PathHandleGraph& graph,
                                        step_handle_t start_step, step_handle_t end_plus_one_step,
                                        size_t min_coverage, bool count_cycles) {
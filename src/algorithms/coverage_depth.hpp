@@ -21,6 +21,17 @@ using namespace std;
 /// ignoring things below min_coverage.  offsets are 1-based in output stream
 void packed_depths(const Packer& packer, const string& path_name, size_t min_coverage, ostream& out_stream);
 
+/// like packed_depths (above), but only for the steps in [start_step, end_plus_one_step), which are printed under
+/// base_name with the first base at the given 1-based path_offset
+void packed_depths(const Packer& packer, step_handle_t start_step, step_handle_t end_plus_one_step,
+                   const string& base_name, size_t path_offset, size_t min_coverage, ostream& out_stream);
+
+/// Split a path into ranges of whole steps that cover about range_size bases each, so they can be processed in parallel.
+/// Each element is a range's 0-based start offset in the path, its first step, and its end-plus-one step.
+/// The path must not be circular.
+vector<tuple<size_t, step_handle_t, step_handle_t>> path_step_ranges(const PathHandleGraph& graph, const string& path_name,
+                                                                     size_t range_size);
+
 /// Estimate the coverage along a given reference path interval [start_step, end_plus_one_step)
 /// Coverage is obtained only from positions along the path, and variation is not counted
 /// Except if "include_deletions" is true, then reference path positions covered by a deletion edge
@@ -69,6 +80,10 @@ pair<double, double> sample_mapping_depth(const HandleGraph& graph, const vector
 /// coverage here is the number of steps from (unique) other paths
 void path_depths(const PathHandleGraph& graph, const string& path_name, size_t min_coverage, bool count_cycles, ostream& out_stream);
 
+/// like path_depths (above), but only for the steps in [start_step, end_plus_one_step), as in the ranged packed_depths
+void path_depths(const PathHandleGraph& graph, step_handle_t start_step, step_handle_t end_plus_one_step,
+                 const string& base_name, size_t path_offset, size_t min_coverage, bool count_cycles, ostream& out_stream);
+
 /// like packed_depth_of_bin (above), but use paths (as in path_depths) for measuring coverage
 pair<double, double> path_depth_of_bin(const PathHandleGraph& graph, step_handle_t start_step, step_handle_t end_plus_one_step,
                                        size_t min_coverage, bool count_cycles);
@@ -3,6 +3,8 @@
 
 #include <gbwtgraph/utils.h>
 
+#include <exception>
+
 namespace vg {
 namespace algorithms {
 
@@ -843,6 +845,57 @@ nid_t GFAParser::assign_new_sequence_id(const string& str, GFAIDMapInfo& id_map_
     return node_id;
 }
 
+/**
+ * Holds the fields of a GFA line, parsed ahead of time so that a batch of
+ * lines can be parsed in parallel and then handled in order.
+ */
+struct PreparsedGFALine {
+    unique_ptr<tuple<GFAParser::tag_list_t>> h;
+    unique_ptr<tuple<string, GFAParser::chars_t, GFAParser::tag_list_t>> s;
+    unique_ptr<tuple<string, bool, string, bool, GFAParser::chars_t, GFAParser::tag_list_t>> l;
+    unique_ptr<tuple<string, GFAParser::chars_t, GFAParser::chars_t, GFAParser::tag_list_t>> p;
+    unique_ptr<tuple<string, size_t, string, pair<int64_t, int64_t>, GFAParser::chars_t, GFAParser::tag_list_t>> w;
+    /// If parsing failed, this is what to throw when the line is handled.
+    std::exception_ptr error;
+    
+    /// Parse the given line, which must outlive the parsed fields.
+    void parse(const string& line) {
+        h.reset();
+        s.reset();
+        l.reset();
+        p.reset();
+        w.reset();
+        error = nullptr;
+        if (line.empty()) {
+            return;
+        }
+        try {
+            switch (line[0]) {
+            case 'H':
+                h = make_unique<tuple<GFAParser::tag_list_t>>(GFAParser::parse_h(line));
+                break;
+            case 'S':
+                s = make_unique<tuple<string, GFAParser::chars_t, GFAParser::tag_list_t>>(GFAParser::parse_s(line));
+                break;
+            case 'L':
+                l = make_unique<tuple<string, bool, string, bool, GFAParser::chars_t, GFAParser::tag_list_t>>(GFAParser::parse_l(line));
+                break;
+            case 'P':
+                p = make_unique<tuple<string, GFAParser::chars_t, GFAParser::chars_t, GFAParser::tag_list_t>>(GFAParser::parse_p(line));
+                break;
+            case 'W':
+                w = make_unique<tuple<string, size_t, string, pair<int64_t, int64_t>, GFAParser::chars_t, GFAParser::tag_list_t>>(GFAParser::parse_w(line));
+                break;
+            default:
+                // Other line types get warned about when they are handled
+                break;
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+};
+
 nid_t GFAParser::find_existing_sequence_id(const string& str, GFAIDMapInfo& id_map_info) {
     auto found = id_map_info.name_to_id->find(str);
     if (found != id_map_info.name_to_id->end()) {
@@ -885,7 +938,19 @@ void GFAParser::parse(istream& in) {
 #endif
     
     bool has_rgfa_tags = false;
-    string line_buffer; // can be quite big
+    
+    // We read lines in batches and parse them in parallel before handling
+    // them. Line strings are reused between batches, since they can be quite
+    // big.
+    vector<string> line_batch;
+    // This holds where each line in the batch starts, if the stream is seekable.
+    vector<std::streampos> line_batch_positions;
+    // And this holds the parsed fields for each line in the batch.
+    vector<PreparsedGFALine> preparsed_batch;
+    
+    // This points at the line we are currently handling, and its parsed fields.
+    const string* line_buffer = nullptr;
+    PreparsedGFALine* preparsed_line = nullptr;
     
     // We should be able to parse in 2 passes. One to make all the nodes, and
     // one to make all the things that reference nodes we hadn't seen yet.
@@ -921,9 +986,9 @@ void GFAParser::parse(istream& in) {
             e.file_name = buffer_name;
         }
         e.line_number = line_number;
-        if (e.has_position) {
+        if (e.has_position && line_buffer) {
             // We can find the column we were at within the line.
-            e.column_number = 1 + (e.position - line_buffer.begin());
+            e.column_number = 1 + (e.position - line_buffer->begin());
         }
     };
     
@@ -951,7 +1016,7 @@ void GFAParser::parse(istream& in) {
             }
             
             // Store the line into it so we can move on to the next line
-            buffer_out_stream << line_buffer << "\n";
+            buffer_out_stream << *line_buffer << "\n";
         }
     };
     
@@ -991,16 +1056,20 @@ void GFAParser::parse(istream& in) {
     // buffer it if it can't. Return false if we are not ready for the line right
     // now and we saved it, and true otherwise.
     auto handle_line_if_ready = [&]() {
-        if (line_buffer.empty()) {
+        if (line_buffer->empty()) {
             // No line to handle.
             return true;
         }
         try {
-            switch(line_buffer[0]) {
+            if (preparsed_line->error) {
+                // We couldn't parse this line.
+                std::rethrow_exception(preparsed_line->error);
+            }
+            switch((*line_buffer)[0]) {
             case 'H':
                 // Header lines need tags examoned
                 {
-                    tuple<tag_list_t> h_parse = GFAParser::parse_h(line_buffer);
+                    tuple<tag_list_t>& h_parse = *preparsed_line->h;
                     auto& tags = get<0>(h_parse);
                     for (auto& listener : this->header_listeners) {
                         // Tell all the listener functions
@@ -1012,7 +1081,7 @@ void GFAParser::parse(istream& in) {
             case 'S':
                 // Sequence lines can always be handled right now
                 {
-                    tuple<string, GFAParser::chars_t, tag_list_t> s_parse = GFAParser::parse_s(line_buffer);
+                    tuple<string, GFAParser::chars_t, tag_list_t>& s_parse = *preparsed_line->s;
                     auto& node_name = get<0>(s_parse);
                     auto& sequence_range = get<1>(s_parse);
                     auto& tags = get<2>(s_parse);
@@ -1080,7 +1149,7 @@ void GFAParser::parse(istream& in) {
             case 'L':
                 // Edges can be handled if their nodes exist already
                 {
-                    tuple<string, bool, string, bool, chars_t, tag_list_t> l_parse = GFAParser::parse_l(line_buffer);
+                    tuple<string, bool, string, bool, chars_t, tag_list_t>& l_parse = *preparsed_line->l;
                     
                     // We only get these IDs if they have been seen already as nodes
                     nid_t n1 = GFAParser::find_existing_sequence_id(get<0>(l_parse), this->id_map());
@@ -1115,7 +1184,7 @@ void GFAParser::parse(istream& in) {
                     // Listeners might.
                     
                     // Parse out the path pieces: name, visits, overlaps, tags
-                    tuple<string, chars_t, chars_t, tag_list_t> p_parse = GFAParser::parse_p(line_buffer);
+                    tuple<string, chars_t, chars_t, tag_list_t>& p_parse = *preparsed_line->p;
                     auto& path_name = get<0>(p_parse);
                     auto& visits = get<1>(p_parse);
                     auto& overlaps = get<2>(p_parse);
@@ -1172,7 +1241,7 @@ void GFAParser::parse(istream& in) {
                     string missing_name;
                     
                     // Fins the pieces of the walk line
-                    tuple<string, size_t, string, pair<int64_t, int64_t>, chars_t, tag_list_t> w_parse = GFAParser::parse_w(line_buffer);
+                    tuple<string, size_t, string, pair<int64_t, int64_t>, chars_t, tag_list_t>& w_parse = *preparsed_line->w;
                     auto& sample_name = get<0>(w_parse);
                     auto& haplotype = get<1>(w_parse);
                     auto& contig_name = get<2>(w_parse);
@@ -1211,10 +1280,10 @@ void GFAParser::parse(istream& in) {
                 }
                 break;
             default:
-                if (!warned_line_types.count(line_buffer[0])) {
+                if (!warned_line_types.count((*line_buffer)[0])) {
                     // Warn once about this weird line type.
-                    warned_line_types.insert(line_buffer[0]);
-                    cerr << "warning:[GFAParser] Ignoring unrecognized " << line_buffer[0] << " line type" << endl;
+                    warned_line_types.insert((*line_buffer)[0]);
+                    cerr << "warning:[GFAParser] Ignoring unrecognized " << (*line_buffer)[0] << " line type" << endl;
                 }
             }
         } catch (GFADuplicatePathError& e) {
@@ -1231,7 +1300,7 @@ void GFAParser::parse(istream& in) {
                 
                 // And report it as a warning.
                 #pragma omp critical (cerr)
-                std::cerr << "warning:[GFAParser] Skipping GFA " << line_buffer[0]
+                std::cerr << "warning:[GFAParser] Skipping GFA " << (*line_buffer)[0]
                     << " line: " << e.what() << std::endl;
             }
         }
@@ -1245,27 +1314,65 @@ void GFAParser::parse(istream& in) {
             // Keep our position in the input stream up to date.
             in_pos = in_stream.tellg();
         }
-        while ((!stream_is_seekable || in_pos < max_offset) && getline(in_stream, line_buffer)) {
-            // For each line in the input file, before the max offset
-            if (!line_buffer.empty()) {
-                // Handle all lines in the stream that we can handle now.
-                if (handle_line_if_ready()) {
-                    // If we handled the line, we need to mark the end of any unhandled range that might be running.
-                    if (pass_number== 1 && stream_is_seekable && !unprocessed_ranges.empty() &&
-                        get<1>(unprocessed_ranges.back()) == eof_pos) {
-                        // the unprocessed range ends where this line started.
-                        get<1>(unprocessed_ranges.back()) = in_pos;
+        while (true) {
+            // Read in a batch of lines, before the max offset
+            size_t batch_lines = 0;
+            size_t batch_bytes = 0;
+            while (batch_lines < max<size_t>(parse_batch_lines, 1) && batch_bytes < parse_batch_bytes &&
+                   (!stream_is_seekable || in_pos < max_offset)) {
+                if (batch_lines == line_batch.size()) {
+                    line_batch.emplace_back();
+                    line_batch_positions.emplace_back();
+                    preparsed_batch.emplace_back();
+                }
+                if (!getline(in_stream, line_batch[batch_lines])) {
+                    break;
+                }
+                line_batch_positions[batch_lines] = in_pos;
+                batch_bytes += line_batch[batch_lines].size();
+                batch_lines++;
+                if (stream_is_seekable) {
+                    // Keep our position in the original input stream up to date.
+                    in_pos = in_stream.tellg();
+                }
+            }
+            if (batch_lines == 0) {
+                break;
+            }
+            // Remember where the batch ended
+            std::streampos batch_end_pos = in_pos;
+            
+            // Parse all the lines at once. This doesn't depend on anything
+            // that handling earlier lines could change.
+            #pragma omp parallel for schedule(dynamic, 64)
+            for (size_t i = 0; i < batch_lines; i++) {
+                preparsed_batch[i].parse(line_batch[i]);
+            }
+            
+            for (size_t i = 0; i < batch_lines; i++) {
+                // Then handle each line in order
+                line_buffer = &line_batch[i];
+                preparsed_line = &preparsed_batch[i];
+                if (stream_is_seekable) {
+                    in_pos = line_batch_positions[i];
+                }
+                if (!line_buffer->empty()) {
+                    // Handle all lines in the stream that we can handle now.
+                    if (handle_line_if_ready()) {
+                        // If we handled the line, we need to mark the end of any unhandled range that might be running.
+                        if (pass_number== 1 && stream_is_seekable && !unprocessed_ranges.empty() &&
+                            get<1>(unprocessed_ranges.back()) == eof_pos) {
+                            // the unprocessed range ends where this line started.
+                            get<1>(unprocessed_ranges.back()) = in_pos;
 #ifdef debug
-                        std::cerr << "Ended unprocessed range at " << in_pos << std::endl;
+                            std::cerr << "Ended unprocessed range at " << in_pos << std::endl;
 #endif
+                        }
                     }
                 }
+                line_number++;
             }
-            if (stream_is_seekable) {
-                // Keep our position in the original input stream up to date.
-                in_pos = in_stream.tellg();
-            }
-            line_number++;
+            in_pos = batch_end_pos;
         }
 #ifdef debug
         std::cerr << "Stop processing run at " << in_pos << "/" << max_offset << std::endl;
@@ -278,6 +278,13 @@ public:
     /// files, like the first HPRC graph releases, include duplicate paths.
     bool stop_on_duplicate_paths = false;
     
+    /// Read up to this many lines at a time and parse their fields on all
+    /// available OpenMP threads. Listeners are still called one line at a
+    /// time, in file order, so results don't depend on the batch size.
+    size_t parse_batch_lines = 65536;
+    /// Stop adding to a batch once it holds at least this many bytes of lines.
+    size_t parse_batch_bytes = 64 * 1024 * 1024;
+    
     /**
      * Parse GFA from the given stream.
      */
@@ -1446,7 +1446,8 @@ void Aligner::align_global_banded(Alignment& alignment, const HandleGraph& g,
                                                g,
                                                band_padding,
                                                permissive_banding,
-                                               false);
+                                               false,
+                                               reuse_banded_workspace);
         
         band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
     } else if (best_score <= numeric_limits<int16_t>::max() && worst_score >= numeric_limits<int16_t>::min()) {
@@ -1455,7 +1456,8 @@ void Aligner::align_global_banded(Alignment& alignment, const HandleGraph& g,
                                                 g,
                                                 band_padding,
                                                 permissive_banding,
-                                                false);
+                                                false,
+                                                reuse_banded_workspace);
         
         band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
     } else if (best_score <= numeric_limits<int32_t>::max() && worst_score >= numeric_limits<int32_t>::min()) {
@@ -1464,7 +1466,8 @@ void Aligner::align_global_banded(Alignment& alignment, const HandleGraph& g,
                                                 g,
                                                 band_padding,
                                                 permissive_banding,
-                                                false);
+                                                false,
+                                                reuse_banded_workspace);
         
         band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
     } else {
@@ -1473,7 +1476,8 @@ void Aligner::align_global_banded(Alignment& alignment, const HandleGraph& g,
                                                 g,
                                                 band_padding,
                                                 permissive_banding,
-                                                false);
+                                                false,
+                                                reuse_banded_workspace);
         
         band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
     }
@@ -1505,7 +1509,8 @@ void Aligner::align_global_banded_multi(Alignment& alignment, vector<Alignment>&
                                                max_alt_alns,
                                                band_padding,
                                                permissive_banding,
-                                               false);
+                                               false,
+                                               reuse_banded_workspace);
         
         band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
     } else if (best_score <= numeric_limits<int16_t>::max() && worst_score >= numeric_limits<int16_t>::min()) {
@@ -1516,7 +1521,8 @@ void Aligner::align_global_banded_multi(Alignment& alignment, vector<Alignment>&
                                                 max_alt_alns,
                                                 band_padding,
                                                 permissive_banding,
-                                                false);
+                                                false,
+                                                reuse_banded_workspace);
         
         band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
     } else if (best_score <= numeric_limits<int32_t>::max() && worst_score >= numeric_limits<int32_t>::min()) {
@@ -1527,7 +1533,8 @@ void Aligner::align_global_banded_multi(Alignment& alignment, vector<Alignment>&
                                                 max_alt_alns,
                                                 band_padding,
                                                 permissive_banding,
-                                                false);
+                                                false,
+                                                reuse_banded_workspace);
         
         band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
     } else {
@@ -1538,7 +1545,8 @@ void Aligner::align_global_banded_multi(Alignment& alignment, vector<Alignment>&
                                                 max_alt_alns,
                                                 band_padding,
                                                 permissive_banding,
-                                                false);
+                                                false,
+                                                reuse_banded_workspace);
         
         band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
     }
@@ -2118,7 +2126,8 @@ void QualAdjAligner::align_global_banded(Alignment& alignment, const HandleGraph
                                                g,
                                                band_padding,
                                                permissive_banding,
-                                               true);
+                                               true,
+                                               reuse_banded_workspace);
         
         band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
     } else if (best_score <= numeric_limits<int16_t>::max() && worst_score >= numeric_limits<int16_t>::min()) {
@@ -2127,7 +2136,8 @@ void QualAdjAligner::align_global_banded(Alignment& alignment, const HandleGraph
                                                 g,
                                                 band_padding,
                                                 permissive_banding,
-                                                true);
+                                                true,
+                                                reuse_banded_workspace);
         
         band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
     } else if (best_score <= numeric_limits<int32_t>::max() && worst_score >= numeric_limits<int32_t>::min()) {
@@ -2136,7 +2146,8 @@ void QualAdjAligner::align_global_banded(Alignment& alignment, const HandleGraph
                                                 g,
                                                 band_padding,
                                                 permissive_banding,
-                                                true);
+                                                true,
+                                                reuse_banded_workspace);
         
         band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
     } else {
@@ -2145,7 +2156,8 @@ void QualAdjAligner::align_global_banded(Alignment& alignment, const HandleGraph
                                                 g,
                                                 band_padding,
                                                 permissive_banding,
-                                                true);
+                                                true,
+                                                reuse_banded_workspace);
         
         band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
     }
@@ -2177,7 +2189,8 @@ void QualAdjAligner::align_global_banded_multi(Alignment& alignment, vector<Alig
                                                max_alt_alns,
                                                band_padding,
                                                permissive_banding,
-                                               true);
+                                               true,
+                                               reuse_banded_workspace);
         
         band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
     } else if (best_score <= numeric_limits<int16_t>::max() && worst_score >= numeric_limits<int16_t>::min()) {
@@ -2188,7 +2201,8 @@ void QualAdjAligner::align_global_banded_multi(Alignment& alignment, vector<Alig
                                                 max_alt_alns,
                                                 band_padding,
                                                 permissive_banding,
-                                                true);
+                                                true,
+                                                reuse_banded_workspace);
         
         band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
     } else if (best_score <= numeric_limits<int32_t>::max() && worst_score >= numeric_limits<int32_t>::min()) {
@@ -2199,7 +2213,8 @@ void QualAdjAligner::align_global_banded_multi(Alignment& alignment, vector<Alig
                                                 max_alt_alns,
                                                 band_padding,
                                                 permissive_banding,
-                                                true);
+                                                true,
+                                                reuse_banded_workspace);
         
         band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
     } else {
@@ -2210,7 +2225,8 @@ void QualAdjAligner::align_global_banded_multi(Alignment& alignment, vector<Alig
                                                 max_alt_alns,
                                                 band_padding,
                                                 permissive_banding,
-                                                true);
+                                                true,
+                                                reuse_banded_workspace);
         
         band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
     }
@@ -2439,9 +2455,21 @@ void AlignerClient::set_alignment_scores(const int8_t* score_matrix, int8_t gap_
                                                                      full_length_bonus, gc_content_estimate));
     regular_aligner = unique_ptr<Aligner>(new Aligner(score_matrix, gap_open, gap_extend,
                                                       full_length_bonus, gc_content_estimate));
+    qual_adj_aligner->reuse_banded_workspace = reuse_banded_workspace;
+    regular_aligner->reuse_banded_workspace = reuse_banded_workspace;
     
 }
 
+void AlignerClient::set_banded_workspace_reuse(bool reuse) {
+    reuse_banded_workspace = reuse;
+    if (qual_adj_aligner) {
+        qual_adj_aligner->reuse_banded_workspace = reuse;
+    }
+    if (regular_aligner) {
+        regular_aligner->reuse_banded_workspace = reuse;
+    }
+}
+
 void AlignerClient::set_alignment_scores(std::istream& matrix_stream, int8_t gap_open, int8_t gap_extend, int8_t full_length_bonus) {
     int8_t* score_matrix = parse_matrix(matrix_stream);
     this->set_alignment_scores(score_matrix, gap_open, gap_extend, full_length_bonus);
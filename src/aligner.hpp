@@ -308,6 +308,12 @@ namespace vg {
         
         // log of the base of the logarithm underlying the log-odds interpretation of the scores
         double log_base = 0.0;
+        
+    public:
+        
+        /// Should banded global alignment take its DP matrices from a reusable
+        /// per-thread arena instead of allocating them fresh each time?
+        bool reuse_banded_workspace = false;
     };
     
     /**
@@ -519,6 +525,10 @@ namespace vg {
         static int8_t* parse_matrix(std::istream& matrix_stream);
         
         bool adjust_alignments_for_base_quality = false; // use base quality adjusted alignments
+        
+        /// Set whether the aligners should reuse per-thread memory for banded
+        /// global alignment, now and after any later change of scores.
+        void set_banded_workspace_reuse(bool reuse);
 
     private:
         
@@ -528,6 +538,9 @@ namespace vg {
         
         // GC content estimate that we need for building the aligners.
         double gc_content_estimate;
+        
+        // Should the aligners reuse banded alignment memory?
+        bool reuse_banded_workspace = false;
     };
     
 } // end namespace vg
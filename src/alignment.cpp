@@ -1,6 +1,7 @@
 #include "alignment.hpp"
 #include "vg/io/gafkluge.hpp"
 #include "annotation.hpp"
+#include "fastq_reader.hpp"
 #include <vg/io/stream.hpp>
 
 #include <sstream>
@@ -233,25 +234,14 @@ bool get_next_alignment_pair_from_fastqs(gzFile fp1, gzFile fp2, char* buffer, s
 
 size_t fastq_unpaired_for_each_parallel(const string& filename, function<void(Alignment&)> lambda, bool comment_as_tags, uint64_t batch_size) {
     
-    gzFile fp = (filename != "-") ? gzopen(filename.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp) {
-        cerr << "[vg::alignment.cpp] couldn't open " << filename << endl; exit(1);
-    }
-    
-    size_t len = 2 << 22; // 4M
-    char* buf = new char[len];
+    // Decompress with all the threads, while the reading thread parses
+    FastqReader reader(filename, get_thread_count());
     
     function<bool(Alignment&)> get_read = [&](Alignment& aln) {
-        return get_next_alignment_from_fastq(fp, buf, len, aln, comment_as_tags);
+        return reader.get_next_alignment(aln, comment_as_tags);
     };
     
-    
-    size_t nLines = unpaired_for_each_parallel(get_read, lambda, batch_size);
-    
-    delete[] buf;
-    gzclose(fp);
-    return nLines;
-    
+    return unpaired_for_each_parallel(get_read, lambda, batch_size);
 }
 
 size_t fastq_paired_interleaved_for_each_parallel(const string& filename, function<void(Alignment&, Alignment&)> lambda, bool comment_as_tags, uint64_t batch_size) {
@@ -268,23 +258,13 @@ size_t fastq_paired_interleaved_for_each_parallel_after_wait(const string& filen
                                                              bool comment_as_tags,
                                                              uint64_t batch_size) {
     
-    gzFile fp = (filename != "-") ? gzopen(filename.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp) {
-        cerr << "[vg::alignment.cpp] couldn't open " << filename << endl; exit(1);
-    }
-    
-    size_t len = 1 << 18; // 256k
-    char* buf = new char[len];
+    FastqReader reader(filename, get_thread_count());
     
     function<bool(Alignment&, Alignment&)> get_pair = [&](Alignment& mate1, Alignment& mate2) {
-        return get_next_interleaved_alignment_pair_from_fastq(fp, buf, len, mate1, mate2, comment_as_tags);
+        return reader.get_next_interleaved_pair(mate1, mate2, comment_as_tags);
     };
     
-    size_t nLines = paired_for_each_parallel_after_wait(get_pair, lambda, single_threaded_until_true, batch_size);
-    
-    delete[] buf;
-    gzclose(fp);
-    return nLines;
+    return paired_for_each_parallel_after_wait(get_pair, lambda, single_threaded_until_true, batch_size);
 }
     
 size_t fastq_paired_two_files_for_each_parallel_after_wait(const string& file1, const string& file2,
@@ -293,28 +273,24 @@ size_t fastq_paired_two_files_for_each_parallel_after_wait(const string& file1,
                                                            bool comment_as_tags,
                                                            uint64_t batch_size) {
     
-    gzFile fp1 = (file1 != "-") ? gzopen(file1.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp1) {
-        cerr << "[vg::alignment.cpp] couldn't open " << file1 << endl; exit(1);
-    }
-    gzFile fp2 = (file2 != "-") ? gzopen(file2.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp2) {
-        cerr << "[vg::alignment.cpp] couldn't open " << file2 << endl; exit(1);
-    }
-    
-    size_t len = 1 << 18; // 256k
-    char* buf = new char[len];
+    // Split the decompression threads between the files
+    size_t decode_threads = max(get_thread_count() / 2, 1);
+    FastqReader reader1(file1, decode_threads);
+    FastqReader reader2(file2, decode_threads);
     
     function<bool(Alignment&, Alignment&)> get_pair = [&](Alignment& mate1, Alignment& mate2) {
-        return get_next_alignment_pair_from_fastqs(fp1, fp2, buf, len, mate1, mate2, comment_as_tags);
+        bool have_mate1 = reader1.get_next_alignment(mate1, comment_as_tags);
+        // Always read from both, so we notice if one file is longer
+        bool have_mate2 = reader2.get_next_alignment(mate2, comment_as_tags);
+        if (have_mate1 != have_mate2) {
+            cerr << "[vg::alignment.cpp] " << (have_mate1 ? file1 : file2) << " has more reads than "
+                 << (have_mate1 ? file2 : file1) << endl;
+            exit(1);
+        }
+        return have_mate1;
     };
     
-    size_t nLines = paired_for_each_parallel_after_wait(get_pair, lambda, single_threaded_until_true, batch_size);
-    
-    delete[] buf;
-    gzclose(fp1);
-    gzclose(fp2);
-    return nLines;
+    return paired_for_each_parallel_after_wait(get_pair, lambda, single_threaded_until_true, batch_size);
 }
 
 size_t fastq_unpaired_for_each(const string& filename, function<void(Alignment&)> lambda, bool comment_as_tags) {
@@ -23,6 +23,99 @@
 
 namespace vg {
 
+const size_t BandedAlignmentArena::DEFAULT_MAX_RETAINED_BYTES = 128 * 1024 * 1024;
+
+BandedAlignmentArena::BandedAlignmentArena(size_t max_retained_bytes) : max_retained_bytes(max_retained_bytes) {
+    // nothing to do
+}
+
+BandedAlignmentArena::~BandedAlignmentArena() {
+    for (auto& block : blocks) {
+        free(block.first);
+    }
+}
+
+BandedAlignmentArena& BandedAlignmentArena::for_this_thread() {
+    thread_local BandedAlignmentArena arena;
+    return arena;
+}
+
+void BandedAlignmentArena::acquire() {
+    users++;
+}
+
+void BandedAlignmentArena::release() {
+    assert(users > 0);
+    users--;
+    if (users != 0) {
+        return;
+    }
+    
+    current_block = 0;
+    current_used = 0;
+    
+    if (blocks.size() == 1 && blocks.front().second <= max_retained_bytes) {
+        // the common case, we already have one block that fits everything
+        return;
+    }
+    
+    // consolidate what we needed this time into one block, so the next
+    // alignment of the same size gets all of its memory from one place
+    size_t total = 0;
+    for (auto& block : blocks) {
+        total += block.second;
+        free(block.first);
+    }
+    blocks.clear();
+    if (total <= max_retained_bytes) {
+        char* consolidated = (char*) malloc(total);
+        if (consolidated) {
+            blocks.emplace_back(consolidated, total);
+        }
+    }
+}
+
+void* BandedAlignmentArena::allocate(size_t bytes) {
+    // keep every allocation aligned for the widest integer type
+    bytes = ((bytes + 15) / 16) * 16;
+    
+    while (current_block < blocks.size()) {
+        auto& block = blocks[current_block];
+        if (block.second - current_used >= bytes) {
+            void* allocated = block.first + current_used;
+            current_used += bytes;
+            return allocated;
+        }
+        // this block can't fit it, move on to the next
+        current_block++;
+        current_used = 0;
+    }
+    
+    // we need a new block, grow geometrically so that we don't need many of them
+    size_t block_size = blocks.empty() ? bytes : max(bytes, 2 * blocks.back().second);
+    char* block = (char*) malloc(block_size);
+    if (!block && block_size != bytes) {
+        // fall back on getting just what we need
+        block_size = bytes;
+        block = (char*) malloc(block_size);
+    }
+    if (!block) {
+        return nullptr;
+    }
+    blocks.emplace_back(block, block_size);
+    current_block = blocks.size() - 1;
+    current_used = bytes;
+    return block;
+}
+
+size_t BandedAlignmentArena::capacity() const {
+    size_t total = 0;
+    for (auto& block : blocks) {
+        total += block.second;
+    }
+    return total;
+}
+
 template<class IntType>
 BandedGlobalAligner<IntType>::BABuilder::BABuilder(Alignment& alignment) :
                                                    alignment(alignment),
@@ -233,9 +326,11 @@ BandedGlobalAligner<IntType>::BAMatrix::~BAMatrix() {
 #ifdef debug_banded_aligner_objects
     cerr << "[BAMatrix::~BAMatrix] destructing matrix for handle " << handlegraph::as_integer(node) << endl;
 #endif
-    free(match);
-    free(insert_row);
-    free(insert_col);
+    if (!arena) {
+        free(match);
+        free(insert_row);
+        free(insert_col);
+    }
 }
 
 template <class IntType>
@@ -259,9 +354,16 @@ void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& grap
     const string& read = alignment.sequence();
     const string& base_quality = alignment.quality();
     
-    match = (IntType*) malloc(sizeof(IntType) * band_size);
-    insert_col = (IntType*) malloc(sizeof(IntType) * band_size);
-    insert_row = (IntType*) malloc(sizeof(IntType) * band_size);
+    if (arena) {
+        match = (IntType*) arena->allocate(sizeof(IntType) * band_size);
+        insert_col = (IntType*) arena->allocate(sizeof(IntType) * band_size);
+        insert_row = (IntType*) arena->allocate(sizeof(IntType) * band_size);
+    }
+    else {
+        match = (IntType*) malloc(sizeof(IntType) * band_size);
+        insert_col = (IntType*) malloc(sizeof(IntType) * band_size);
+        insert_row = (IntType*) malloc(sizeof(IntType) * band_size);
+    }
     if (!match || !insert_col || !insert_row) {
         // An allocation has failed.
         // We may have run out of virtual memory.
@@ -272,6 +374,12 @@ void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& grap
 #endif
         
         // Free up what we are holding, and also report how much usable mamoey jemalloc gave us for anything that passed.
+        if (arena) {
+            // the arena gets its memory back when the aligner releases it
+            match = nullptr;
+            insert_col = nullptr;
+            insert_row = nullptr;
+        }
         if (match) {
 #ifdef debug_jemalloc
             usable_size[0] = malloc_usable_size(match);
@@ -290,6 +398,9 @@ void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& grap
 #endif
             free(insert_row);
         }
+        match = nullptr;
+        insert_col = nullptr;
+        insert_row = nullptr;
         
         cerr << "[BAMatrix::fill_matrix]: failed to allocate matrices of height " << band_height << " and width " << ncols << " for a total cell count of " << band_size << endl;
 #ifdef debug_jemalloc
@@ -1911,12 +2022,13 @@ void BandedGlobalAligner<IntType>::BAMatrix::print_band(const HandleGraph& graph
 template <class IntType>
 BandedGlobalAligner<IntType>::BandedGlobalAligner(Alignment& alignment, const HandleGraph& g,
                                                   int64_t band_padding, bool permissive_banding,
-                                                  bool adjust_for_base_quality) :
+                                                  bool adjust_for_base_quality, bool reuse_workspace) :
                                                   BandedGlobalAligner(alignment, g,
                                                                       nullptr, 1,
                                                                       band_padding,
                                                                       permissive_banding,
-                                                                      adjust_for_base_quality)
+                                                                      adjust_for_base_quality,
+                                                                      reuse_workspace)
 {
     // nothing to do, just funnel into internal constructor
 }
@@ -1926,13 +2038,15 @@ BandedGlobalAligner<IntType>::BandedGlobalAligner(Alignment& alignment, const Ha
                                                   vector<Alignment>& alt_alignments,
                                                   int64_t max_multi_alns, int64_t band_padding,
                                                   bool permissive_banding,
-                                                  bool adjust_for_base_quality) :
+                                                  bool adjust_for_base_quality,
+                                                  bool reuse_workspace) :
                                                   BandedGlobalAligner(alignment, g,
                                                                       &alt_alignments,
                                                                       max_multi_alns,
                                                                       band_padding,
                                                                       permissive_banding,
-                                                                      adjust_for_base_quality)
+                                                                      adjust_for_base_quality,
+                                                                      reuse_workspace)
 {
     // check data integrity and funnel into internal constructor
     if (!alt_alignments.empty()) {
@@ -1947,12 +2061,14 @@ BandedGlobalAligner<IntType>::BandedGlobalAligner(Alignment& alignment, const Ha
                                                   int64_t max_multi_alns,
                                                   int64_t band_padding,
                                                   bool permissive_banding,
-                                                  bool adjust_for_base_quality) :
+                                                  bool adjust_for_base_quality,
+                                                  bool reuse_workspace) :
                                                   graph(g),
                                                   alignment(alignment),
                                                   alt_alignments(alt_alignments),
                                                   max_multi_alns(max_multi_alns),
                                                   adjust_for_base_quality(adjust_for_base_quality),
+                                                  reuse_workspace(reuse_workspace),
                                                   // compute some graph features we will be frequently reusing
                                                   topological_order(handlealgs::lazier_topological_order(&g)),
                                                   source_nodes(handlealgs::head_nodes(&g)),
@@ -2068,6 +2184,10 @@ BandedGlobalAligner<IntType>::~BandedGlobalAligner() {
             delete banded_matrix;
         }
     }
+    if (arena) {
+        // the matrices are gone, so the arena can hand out their memory again
+        arena->release();
+    }
 }
 
 template <class IntType>
@@ -2254,6 +2374,16 @@ void BandedGlobalAligner<IntType>::align(int8_t* score_mat, int8_t* nt_table, in
     }
     IntType min_inf = numeric_limits<IntType>::min() + max<IntType>((IntType) -max_mismatch, max<IntType>(gap_open, gap_extend));
     
+    if (reuse_workspace && !arena) {
+        // hold on to this thread's arena until the matrices are destroyed
+        arena = &BandedAlignmentArena::for_this_thread();
+        arena->acquire();
+        for (BAMatrix* band_matrix : banded_matrices) {
+            if (band_matrix != nullptr) {
+                band_matrix->arena = arena;
+            }
+        }
+    }
     
     // fill each nodes matrix in topological order
     for (int64_t i = 0; i < banded_matrices.size(); i++) {
@@ -34,6 +34,56 @@ namespace vg {
         int get_count();
     };
     
+    /**
+     * A pool of memory that BandedGlobalAligner can carve its DP matrices out
+     * of, so that alignments done one after another on the same thread reuse
+     * the same memory instead of going back to the allocator every time.
+     *
+     * Memory is handed out in order and is all given back at once when the
+     * last user releases the arena. Between uses the arena keeps its memory,
+     * up to a cap, consolidated into a single block.
+     */
+    class BandedAlignmentArena {
+    public:
+        /// Most memory that an arena holds on to between alignments
+        static const size_t DEFAULT_MAX_RETAINED_BYTES;
+        
+        BandedAlignmentArena(size_t max_retained_bytes = DEFAULT_MAX_RETAINED_BYTES);
+        ~BandedAlignmentArena();
+        
+        /// Get the arena for the calling thread
+        static BandedAlignmentArena& for_this_thread();
+        
+        /// Start using the arena. Memory handed out stays valid until every
+        /// acquire() has been matched by a release().
+        void acquire();
+        
+        /// Stop using the arena. When no users are left, all memory is
+        /// available to be handed out again.
+        void release();
+        
+        /// Get uninitialized memory of the given size, aligned for any integer
+        /// type. Returns null if the memory cannot be allocated.
+        void* allocate(size_t bytes);
+        
+        /// Get the total number of bytes the arena is holding
+        size_t capacity() const;
+        
+    private:
+        /// Blocks of memory and their sizes, in the order we fill them
+        vector<pair<char*, size_t>> blocks;
+        /// The block we are currently handing out memory from
+        size_t current_block = 0;
+        /// How many bytes of the current block have been handed out
+        size_t current_used = 0;
+        /// How many aligners are currently using the arena
+        size_t users = 0;
+        size_t max_retained_bytes;
+        
+        BandedAlignmentArena(const BandedAlignmentArena& other) = delete;
+        BandedAlignmentArena& operator=(const BandedAlignmentArena& other) = delete;
+    };
+    
     /**
      * The outward-facing interface for banded global graph alignment. It computes optimal alignment
      * of a DNA sequence to a DAG with POA. The alignment will start at any source node in the graph and
@@ -57,10 +107,11 @@ namespace vg {
         ///  band_padding                width to expand band by
         ///  permissive_banding          expand band, not necessarily symmetrically, to allow all node paths
         ///  adjust_for_base_quality     perform base quality adjusted alignment (see QualAdjAligner)
+        ///  reuse_workspace             allocate DP matrices from this thread's BandedAlignmentArena
         ///
         BandedGlobalAligner(Alignment& alignment, const HandleGraph& g,
                             int64_t band_padding, bool permissive_banding = false,
-                            bool adjust_for_base_quality = false);
+                            bool adjust_for_base_quality = false, bool reuse_workspace = false);
         
         
         /// Initializes banded multi-alignment, which computes the top scoring alternate alignments in addition
@@ -75,10 +126,11 @@ namespace vg {
         ///  band_padding                width to expand band by
         ///  permissive_banding          expand band, not necessarily symmetrically, to allow all node paths
         ///  adjust_for_base_quality     perform base quality adjusted alignment (see QualAdjAligner)
+        ///  reuse_workspace             allocate DP matrices from this thread's BandedAlignmentArena
         BandedGlobalAligner(Alignment& alignment, const HandleGraph& g,
                             vector<Alignment>& alt_alignments, int64_t max_multi_alns,
                             int64_t band_padding, bool permissive_banding = false,
-                            bool adjust_for_base_quality = false);
+                            bool adjust_for_base_quality = false, bool reuse_workspace = false);
         
         ~BandedGlobalAligner();
         
@@ -116,6 +168,10 @@ namespace vg {
         int64_t max_multi_alns;
         /// Use base quality adjusted scoring for alignments?
         bool adjust_for_base_quality;
+        /// Take DP matrix memory from the thread's arena?
+        bool reuse_workspace;
+        /// The arena we acquired for this alignment, if any
+        BandedAlignmentArena* arena = nullptr;
         
         /// Dynamic programming matrices for each node
         vector<BAMatrix*> banded_matrices;
@@ -133,7 +189,7 @@ namespace vg {
         BandedGlobalAligner(Alignment& alignment, const HandleGraph& g,
                             vector<Alignment>* alt_alignments, int64_t max_multi_alns,
                             int64_t band_padding, bool permissive_banding = false,
-                            bool adjust_for_base_quality = false);
+                            bool adjust_for_base_quality = false, bool reuse_workspace = false);
         
         /// Traceback through dynamic programming matrices to compute alignment
         void traceback(int8_t* score_mat, int8_t* nt_table, int8_t gap_open, int8_t gap_extend, IntType min_inf);
@@ -203,6 +259,9 @@ namespace vg {
         /// DP matrix
         IntType* insert_row;
         
+        /// Arena the DP matrices came from, or null if they were allocated on their own
+        BandedAlignmentArena* arena = nullptr;
+        
         /// Debugging function
         void print_matrix(const HandleGraph& graph, matrix_t which_mat);
         /// Debugging function
@@ -5,6 +5,7 @@
 #include <numeric>
 #include <cmath>
 #include <iomanip>
+#include <sstream>
 
 /**
  * \file benchmark.hpp: implementations of benchmarking functions
@@ -53,7 +54,7 @@ ostream& operator<<(ostream& out, const BenchmarkResult& result) {
     auto initial_flags = out.flags();
     
     // Set up formatting
-    cout << setprecision(2) << scientific;
+    out << setprecision(2) << scientific;
     
     out << result.runs;
     out << "\t";
@@ -67,12 +68,14 @@ ostream& operator<<(ostream& out, const BenchmarkResult& result) {
     out << "\t";
     
     // Scores get different formatting
-    cout << fixed;
+    out << fixed;
     
     out << result.score();
     out << "\t";
     out << result.score_error();
     out << "\t";
+    out << result.key;
+    out << "\t";
     out << result.name;
     
     out.precision(initial_precision);
@@ -81,6 +84,89 @@ ostream& operator<<(ostream& out, const BenchmarkResult& result) {
     return out;
 }
 
+void write_benchmark_json(ostream& out, const string& version, const vector<BenchmarkResult>& results) {
+    // We want to report times in fractional us, like in the TSV
+    using frac_secs = chrono::duration<double, std::micro>;
+    
+    // Quote a string for JSON. Names and versions shouldn't have anything
+    // fancier than quotes in them.
+    auto quote = [](const string& text) {
+        stringstream quoted;
+        quoted << "\"";
+        for (auto& c : text) {
+            if (c == '"' || c == '\\') {
+                quoted << '\\';
+            }
+            quoted << c;
+        }
+        quoted << "\"";
+        return quoted.str();
+    };
+    
+    out << "{\"version\": " << quote(version) << ", \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        auto& result = results[i];
+        out << (i == 0 ? "" : ",") << endl;
+        out << "  {\"key\": " << quote(result.key)
+            << ", \"name\": " << quote(result.name)
+            << ", \"runs\": " << result.runs
+            << ", \"test_us\": " << chrono::duration_cast<frac_secs>(result.test_mean).count()
+            << ", \"test_stddev_us\": " << chrono::duration_cast<frac_secs>(result.test_stddev).count()
+            << ", \"control_us\": " << chrono::duration_cast<frac_secs>(result.control_mean).count()
+            << ", \"control_stddev_us\": " << chrono::duration_cast<frac_secs>(result.control_stddev).count()
+            << ", \"score\": " << result.score()
+            << ", \"score_error\": " << result.score_error() << "}";
+    }
+    out << endl << "]}" << endl;
+}
+
+vector<BenchmarkResult> read_benchmark_tsv(istream& in) {
+    vector<BenchmarkResult> results;
+    
+    // Times are stored in fractional us
+    auto parse_time = [](const string& field) {
+        return benchtime((benchtime::rep) (stod(field) * 1000));
+    };
+    
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        vector<string> fields;
+        stringstream line_stream(line);
+        string field;
+        while (fields.size() < 8 && getline(line_stream, field, '\t')) {
+            fields.push_back(field);
+        }
+        // The name is everything else
+        if (getline(line_stream, field)) {
+            fields.push_back(field);
+        }
+        if (fields.size() != 9) {
+            throw runtime_error("Benchmark result line has too few fields: " + line);
+        }
+        
+        results.emplace_back();
+        auto& result = results.back();
+        result.runs = stoull(fields[0]);
+        result.test_mean = parse_time(fields[1]);
+        result.test_stddev = parse_time(fields[2]);
+        result.control_mean = parse_time(fields[3]);
+        result.control_stddev = parse_time(fields[4]);
+        // Score and error are computed from the times
+        result.key = fields[7];
+        result.name = fields[8];
+    }
+    
+    return results;
+}
+
+bool is_regression(const BenchmarkResult& result, const BenchmarkResult& baseline, double max_regression) {
+    double lost = baseline.score() - result.score();
+    return lost > baseline.score() * max_regression && lost > baseline.score_error() + result.score_error();
+}
+
 void benchmark_control() {
     // We need to do something that takes time.
     
@@ -5,6 +5,7 @@
 #include <functional>
 #include <iostream>
 #include <string>
+#include <vector>
 
 /** 
  * \file benchmark.hpp
@@ -36,6 +37,9 @@ struct BenchmarkResult {
     benchtime control_stddev;
     /// What was the name of the test being run
     string name;
+    /// Stable key to match the result against a baseline by. Unlike the name,
+    /// this doesn't mention anything computed from the benchmark's inputs.
+    string key;
     /// How many control-standardized "points" do we score?
     double score() const;
     /// What is the uncertainty on the score?
@@ -43,10 +47,30 @@ struct BenchmarkResult {
 };
 
 /**
- * Benchmark results can be output to streams
+ * Benchmark results can be output to streams, as a TSV line ending with the
+ * key and the name
  */
 ostream& operator<<(ostream& out, const BenchmarkResult& result);
 
+/**
+ * Write the given benchmark results as a JSON object, labeled with the given
+ * vg version.
+ */
+void write_benchmark_json(ostream& out, const string& version, const vector<BenchmarkResult>& results);
+
+/**
+ * Read back benchmark results from a TSV report, with one result per line
+ * formatted as by operator<<. Lines starting with # are skipped.
+ */
+vector<BenchmarkResult> read_benchmark_tsv(istream& in);
+
+/**
+ * Determine if the given result has a lower score than the baseline result,
+ * by more than the given fraction of the baseline score and by more than the
+ * uncertainty on the two scores.
+ */
+bool is_regression(const BenchmarkResult& result, const BenchmarkResult& baseline, double max_regression);
+
 /**
  * The benchmark control function, designed to take some amount of time that might vary with CPU load.
  */
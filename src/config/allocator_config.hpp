@@ -7,6 +7,8 @@
  * allocator_config_jemalloc.cpp or allocator_config_system.cpp as appropriate
  * for the build.
  */
+
+#include <cstdint>
  
 namespace vg {
 
@@ -15,6 +17,12 @@ namespace vg {
  */
 void configure_memory_allocator();
 
+/**
+ * Get the total number of bytes the calling thread has allocated so far, if
+ * the memory allocator keeps count. Otherwise, returns 0.
+ */
+uint64_t get_thread_allocated_bytes();
+
 }
  
 #endif
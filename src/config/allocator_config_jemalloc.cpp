@@ -108,5 +108,22 @@ void configure_memory_allocator() {
     }
 }
 
+uint64_t get_thread_allocated_bytes() {
+    // jemalloc keeps a running total for each thread, and can give us a
+    // pointer to it so we don't have to go through mallctl() every time.
+    // Each thread asks only once, and remembers if jemalloc can't tell it.
+    thread_local uint64_t* allocated = nullptr;
+    thread_local bool asked = false;
+    if (!asked) {
+        asked = true;
+        size_t pointer_size = sizeof(allocated);
+        if (mallctl("thread.allocatedp", (void*) &allocated, &pointer_size, nullptr, 0) != 0) {
+            // Stats may not be compiled in
+            allocated = nullptr;
+        }
+    }
+    return allocated == nullptr ? 0 : *allocated;
+}
+
 }
  
@@ -14,6 +14,11 @@ void configure_memory_allocator() {
     // system, but it isn't really configurable in any meaningful way.
 }
 
+uint64_t get_thread_allocated_bytes() {
+    // The system allocator doesn't count for us.
+    return 0;
+}
+
 }
  
 
@@ -16,6 +16,8 @@
 #include <list>
 #include <algorithm>
 #include <memory>
+#include <deque>
+#include <future>
 
 //#define debug
 
@@ -2165,6 +2167,47 @@ namespace vg {
             callback(chunk.graph);
         };
 
+        // Chunks can be built in parallel, but they have to be wired up and
+        // emitted in order. So we queue up the chunks being built, along with
+        // where they end.
+        deque<pair<future<ConstructedChunk>, size_t>> chunks_in_progress;
+
+        // Wire up and emit the oldest chunks being built, until no more than
+        // the given number are left.
+        auto finish_chunks = [&](size_t max_in_progress) {
+            while (chunks_in_progress.size() > max_in_progress) {
+                ConstructedChunk result = chunks_in_progress.front().first.get();
+                size_t finished_end = chunks_in_progress.front().second;
+                chunks_in_progress.pop_front();
+
+                // Wire up and emit the chunk graph
+                wire_and_emit(result);
+
+                // Say we've completed the chunk
+                update_progress(finished_end - leading_offset);
+            }
+        };
+
+        // Build a chunk of the given reference sequence with the given
+        // variants, in the background if we can use multiple threads.
+        auto submit_chunk = [&](string chunk_ref, vector<vcflib::Variant> variants, size_t start, size_t end) {
+            if (chunk_threads <= 1) {
+                // Call the construction
+                auto result = construct_chunk(std::move(chunk_ref), reference_contig, std::move(variants), start);
+
+                // Wire up and emit the chunk graph
+                wire_and_emit(result);
+
+                // Say we've completed the chunk
+                update_progress(end - leading_offset);
+            } else {
+                chunks_in_progress.emplace_back(async(launch::async, &Constructor::construct_chunk, this, std::move(chunk_ref),
+                                                      reference_contig, std::move(variants), start), end);
+                // Don't get too far ahead of the chunks we have emitted.
+                finish_chunks(chunk_threads);
+            }
+        };
+
         bool do_external_insertions = false;
         FastaReference* insertion_fasta;
 
@@ -2365,14 +2408,8 @@ namespace vg {
                 // Get the ref sequence we need
                 auto chunk_ref = reference.getSubSequence(reference_contig, chunk_start, chunk_end - chunk_start);
 
-                // Call the construction
-                auto result = construct_chunk(chunk_ref, reference_contig, chunk_variants, chunk_start);
-
-                // Wire up and emit the chunk graph
-                wire_and_emit(result);
-
-                // Say we've completed the chunk
-                update_progress(chunk_end - leading_offset);
+                // Build the chunk, and wire up and emit it when it is its turn
+                submit_chunk(std::move(chunk_ref), std::move(chunk_variants), chunk_start, chunk_end);
 
                 // Set up a new chunk
                 chunk_start = chunk_end;
@@ -2401,14 +2438,8 @@ namespace vg {
             // Get the ref sequence we need
             auto chunk_ref = reference.getSubSequence(reference_contig, chunk_start, chunk_end - chunk_start);
 
-            // Call the construction
-            auto result = construct_chunk(chunk_ref, reference_contig, chunk_variants, chunk_start);
-
-            // Wire up and emit the chunk graph
-            wire_and_emit(result);
-
-            // Say we've completed the chunk
-            update_progress(chunk_end - leading_offset);
+            // Build the chunk, and wire up and emit it when it is its turn
+            submit_chunk(std::move(chunk_ref), std::move(chunk_variants), chunk_start, chunk_end);
 
             // Set up a new chunk
             chunk_start = chunk_end;
@@ -2416,6 +2447,9 @@ namespace vg {
             chunk_variants.clear();
         }
 
+        // Wait for the chunks still being built.
+        finish_chunks(0);
+
         // All the chunks have been wired and emitted.
         
         if (last_node_buffer.id() != 0) {
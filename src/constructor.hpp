@@ -128,6 +128,10 @@ public:
     // How many bases do we want to have per chunk? We don't necessarily want to
     // load all of chr1 into an std::string, even if we have no variants on it.
     size_t bases_per_chunk = 1024 * 1024;
+
+    // How many chunks of a contig can we build at once? Chunks are still wired
+    // together and passed to the callback in order, from the calling thread.
+    size_t chunk_threads = 1;
     
     // This set contains the set of VCF sequence names we want to build the
     // graph for. If empty, we will build the graph for all sequences in the
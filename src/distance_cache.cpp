@@ -0,0 +1,78 @@
+/**
+ * \file distance_cache.cpp
+ * Implementations for DistanceCache.
+ */
+
+#include "distance_cache.hpp"
+
+namespace vg {
+
+using namespace std;
+
+DistanceCache::DistanceCache(size_t max_entries) : max_entries(max_entries) {
+    // Nothing to do!
+}
+
+size_t DistanceCache::minimum_distance(const SnarlDistanceIndex& distance_index, const pos_t& from, const pos_t& to,
+                                       bool unoriented_distance, const HandleGraph* graph) {
+    return get_or_compute(from, to, unoriented_distance ? UNORIENTED : ORIENTED, [&]() {
+        return distance_index.minimum_distance(id(from), is_rev(from), offset(from),
+                                               id(to), is_rev(to), offset(to),
+                                               unoriented_distance, graph);
+    });
+}
+
+size_t DistanceCache::get_or_compute(const pos_t& from, const pos_t& to, query_kind_t kind, const function<size_t()>& compute) {
+    key_t key {{from, to}, (uint8_t) kind};
+    auto found = distances.find(key);
+    if (found != distances.end()) {
+        hit_count++;
+        return found->second;
+    }
+    
+    miss_count++;
+    size_t distance = compute();
+    make_room();
+    distances.emplace(key, distance);
+    return distance;
+}
+
+size_t DistanceCache::distance_in_parent(const SnarlDistanceIndex& distance_index, const net_handle_t& parent,
+                                         const net_handle_t& child1, const net_handle_t& child2,
+                                         const HandleGraph* graph, size_t distance_limit) {
+    net_key_t key {handlegraph::as_integer(parent), handlegraph::as_integer(child1),
+                   handlegraph::as_integer(child2), distance_limit, graph};
+    auto found = net_distances.find(key);
+    if (found != net_distances.end()) {
+        hit_count++;
+        return found->second;
+    }
+    
+    miss_count++;
+    size_t distance = distance_index.distance_in_parent(parent, child1, child2, graph, distance_limit);
+    make_room();
+    net_distances.emplace(key, distance);
+    return distance;
+}
+
+void DistanceCache::make_room() {
+    if (distances.size() + net_distances.size() >= max_entries) {
+        // Start over rather than growing without bound.
+        clear();
+    }
+}
+
+void DistanceCache::clear() {
+    distances.clear();
+    net_distances.clear();
+}
+
+size_t DistanceCache::hits() const {
+    return hit_count;
+}
+
+size_t DistanceCache::misses() const {
+    return miss_count;
+}
+
+}
@@ -0,0 +1,88 @@
+#ifndef VG_DISTANCE_CACHE_HPP_INCLUDED
+#define VG_DISTANCE_CACHE_HPP_INCLUDED
+
+/**
+ * \file distance_cache.hpp
+ * Memoization for distance index queries that get repeated while mapping a read.
+ */
+
+#include "snarl_distance_index.hpp"
+#include "hash_map.hpp"
+#include "position.hpp"
+
+#include <functional>
+#include <limits>
+#include <tuple>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * Remembers the results of distance queries between pairs of graph positions,
+ * and between pairs of children of snarl tree nodes, so that asking the same
+ * question again doesn't need to climb the snarl tree again. Repetitive reads
+ * tend to produce the same pairs over and over.
+ *
+ * Keeps at most a fixed number of entries; when it fills up it starts over.
+ *
+ * Not thread safe; make one per read or per thread.
+ */
+class DistanceCache {
+public:
+    
+    /// Make a cache that keeps up to the given number of distances.
+    DistanceCache(size_t max_entries = 65536);
+    
+    /// Different kinds of queries that can be cached between the same pair
+    /// of positions, which may give different answers.
+    enum query_kind_t : uint8_t {
+        ORIENTED = 0,
+        UNORIENTED = 1
+    };
+    
+    /// Get the minimum distance between two positions, as
+    /// SnarlDistanceIndex::minimum_distance() would compute it, using a
+    /// remembered answer if there is one.
+    size_t minimum_distance(const SnarlDistanceIndex& distance_index, const pos_t& from, const pos_t& to,
+                            bool unoriented_distance = false, const HandleGraph* graph = nullptr);
+    
+    /// Get the remembered answer to the given kind of query between the given
+    /// positions, or compute it with the given function and remember it.
+    size_t get_or_compute(const pos_t& from, const pos_t& to, query_kind_t kind, const function<size_t()>& compute);
+    
+    /// Get the distance between two children of a snarl tree node, as
+    /// SnarlDistanceIndex::distance_in_parent() would compute it, using a
+    /// remembered answer if there is one.
+    size_t distance_in_parent(const SnarlDistanceIndex& distance_index, const net_handle_t& parent,
+                              const net_handle_t& child1, const net_handle_t& child2,
+                              const HandleGraph* graph = nullptr,
+                              size_t distance_limit = std::numeric_limits<size_t>::max());
+    
+    /// Forget all remembered distances. Hit and miss counts are kept.
+    void clear();
+    
+    /// Get the number of queries answered from the cache.
+    size_t hits() const;
+    
+    /// Get the number of queries that had to be computed.
+    size_t misses() const;
+    
+protected:
+    using key_t = pair<pair<pos_t, pos_t>, uint8_t>;
+    /// Parent, both children, the distance limit, and the graph
+    using net_key_t = tuple<int64_t, int64_t, int64_t, size_t, const HandleGraph*>;
+    
+    /// Make room for one more entry, by starting over if we are full.
+    void make_room();
+    
+    size_t max_entries;
+    unordered_map<key_t, size_t> distances;
+    unordered_map<net_key_t, size_t> net_distances;
+    size_t hit_count = 0;
+    size_t miss_count = 0;
+};
+
+}
+
+#endif
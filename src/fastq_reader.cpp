@@ -0,0 +1,374 @@
+/**
+ * \file fastq_reader.cpp
+ * Implementations for FastqReader.
+ */
+
+#include "fastq_reader.hpp"
+#include "annotation.hpp"
+#include "utility.hpp"
+
+#include <libdeflate.h>
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+namespace vg {
+
+using namespace std;
+
+/// Size of the fixed part of a BGZF block header
+static const size_t BGZF_HEADER_SIZE = 18;
+
+/// Read a little-endian unsigned integer of the given number of bytes
+static size_t unpack_le(const char* data, size_t bytes) {
+    size_t value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        value |= ((size_t) (unsigned char) data[i]) << (8 * i);
+    }
+    return value;
+}
+
+/// Determine if the given bytes start a BGZF block, which is a gzip member
+/// with a "BC" extra field holding the block size.
+static bool is_bgzf_header(const char* data, size_t bytes) {
+    return bytes >= BGZF_HEADER_SIZE &&
+        (unsigned char) data[0] == 0x1f && (unsigned char) data[1] == 0x8b &&
+        data[2] == 8 && (data[3] & 4) &&
+        data[12] == 'B' && data[13] == 'C' && unpack_le(data + 14, 2) == 2;
+}
+
+FastqReader::FastqReader(const string& filename, size_t decode_threads) :
+    filename(filename), decode_threads(max<size_t>(decode_threads, 1)), text(new vector<char>()) {
+
+    file = (filename != "-") ? fopen(filename.c_str(), "rb") : stdin;
+    if (!file) {
+        cerr << "[vg::alignment.cpp] couldn't open " << filename << endl; exit(1);
+    }
+
+    // Look at the start of the file to see what we have
+    raw_prefix.resize(BGZF_HEADER_SIZE);
+    raw_prefix.resize(fread(&raw_prefix[0], 1, BGZF_HEADER_SIZE, file));
+
+    if (is_bgzf_header(raw_prefix.data(), raw_prefix.size())) {
+        format = BGZF;
+    } else if (raw_prefix.size() >= 2 && (unsigned char) raw_prefix[0] == 0x1f && (unsigned char) raw_prefix[1] == 0x8b) {
+        format = GZIP;
+        memset(&gzip_stream, 0, sizeof(gzip_stream));
+        // Let zlib handle the gzip header itself
+        if (inflateInit2(&gzip_stream, 15 + 32) != Z_OK) {
+            throw runtime_error("[vg::alignment.cpp] couldn't set up decompression for " + filename);
+        }
+        gzip_stream_open = true;
+        gzip_input.resize(1 << 16);
+    } else {
+        format = PLAIN;
+    }
+}
+
+FastqReader::~FastqReader() {
+    if (next_text.valid()) {
+        // Let the background decompression finish before we close its file
+        try {
+            next_text.get();
+        } catch (...) {
+            // We're going away anyway
+        }
+    }
+    if (gzip_stream_open) {
+        inflateEnd(&gzip_stream);
+    }
+    if (file && file != stdin) {
+        fclose(file);
+    }
+}
+
+size_t FastqReader::read_raw(char* dest, size_t bytes) {
+    size_t from_prefix = min(bytes, raw_prefix.size() - raw_prefix_used);
+    memcpy(dest, raw_prefix.data() + raw_prefix_used, from_prefix);
+    raw_prefix_used += from_prefix;
+    if (from_prefix == bytes) {
+        return bytes;
+    }
+    return from_prefix + fread(dest + from_prefix, 1, bytes - from_prefix, file);
+}
+
+unique_ptr<vector<char>> FastqReader::decompress_bgzf_batch() {
+
+    // Collect the compressed blocks, and where each one's text goes
+    vector<char> compressed;
+    vector<size_t> block_starts;
+    vector<size_t> text_starts;
+    size_t text_size = 0;
+
+    char header[BGZF_HEADER_SIZE];
+    while (block_starts.size() < blocks_per_batch) {
+        size_t header_bytes = read_raw(header, BGZF_HEADER_SIZE);
+        if (header_bytes == 0) {
+            input_done = true;
+            break;
+        }
+        if (!is_bgzf_header(header, header_bytes)) {
+            throw runtime_error("[vg::alignment.cpp] truncated or invalid BGZF block in " + filename);
+        }
+        size_t block_size = unpack_le(header + 16, 2) + 1;
+        if (block_size < BGZF_HEADER_SIZE + 8) {
+            throw runtime_error("[vg::alignment.cpp] invalid BGZF block size in " + filename);
+        }
+
+        size_t block_start = compressed.size();
+        compressed.resize(block_start + block_size);
+        memcpy(compressed.data() + block_start, header, BGZF_HEADER_SIZE);
+        size_t rest = block_size - BGZF_HEADER_SIZE;
+        if (read_raw(compressed.data() + block_start + BGZF_HEADER_SIZE, rest) != rest) {
+            throw runtime_error("[vg::alignment.cpp] truncated BGZF block in " + filename);
+        }
+
+        block_starts.push_back(block_start);
+        text_starts.push_back(text_size);
+        // The uncompressed size is stored at the end of the block.
+        text_size += unpack_le(compressed.data() + block_start + block_size - 4, 4);
+    }
+    block_starts.push_back(compressed.size());
+    text_starts.push_back(text_size);
+
+    unique_ptr<vector<char>> batch_text(new vector<char>(text_size));
+    size_t block_count = block_starts.size() - 1;
+    atomic<bool> failed(false);
+
+    auto decompress_blocks = [&](size_t first_block, size_t stride) {
+        libdeflate_decompressor* decompressor = libdeflate_alloc_decompressor();
+        if (!decompressor) {
+            failed = true;
+            return;
+        }
+        for (size_t i = first_block; i < block_count && !failed; i += stride) {
+            size_t expected = text_starts[i + 1] - text_starts[i];
+            size_t actual = 0;
+            auto result = libdeflate_gzip_decompress(decompressor,
+                                                     compressed.data() + block_starts[i],
+                                                     block_starts[i + 1] - block_starts[i],
+                                                     batch_text->data() + text_starts[i],
+                                                     expected, &actual);
+            if (result != LIBDEFLATE_SUCCESS || actual != expected) {
+                failed = true;
+            }
+        }
+        libdeflate_free_decompressor(decompressor);
+    };
+
+    size_t thread_count = min(decode_threads, block_count);
+    if (thread_count <= 1) {
+        decompress_blocks(0, 1);
+    } else {
+        vector<thread> threads;
+        threads.reserve(thread_count);
+        for (size_t i = 0; i < thread_count; i++) {
+            threads.emplace_back(decompress_blocks, i, thread_count);
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    if (failed) {
+        throw runtime_error("[vg::alignment.cpp] couldn't decompress BGZF block in " + filename);
+    }
+
+    return batch_text;
+}
+
+bool FastqReader::decompress_gzip_chunk() {
+    text->resize(gzip_chunk_size);
+    text_used = 0;
+    gzip_stream.next_out = (Bytef*) text->data();
+    gzip_stream.avail_out = text->size();
+
+    while (gzip_stream.avail_out > 0) {
+        if (gzip_stream.avail_in == 0) {
+            size_t got = read_raw(gzip_input.data(), gzip_input.size());
+            if (got == 0) {
+                input_done = true;
+                break;
+            }
+            gzip_stream.next_in = (Bytef*) gzip_input.data();
+            gzip_stream.avail_in = got;
+        }
+        int result = inflate(&gzip_stream, Z_NO_FLUSH);
+        if (result == Z_STREAM_END) {
+            // There may be another gzip member after this one
+            inflateReset(&gzip_stream);
+            gzip_between_members = true;
+        } else if (result != Z_OK && gzip_between_members) {
+            // Ignore trailing junk after the last member, like gzread() does
+            input_done = true;
+            break;
+        } else if (result != Z_OK) {
+            throw runtime_error("[vg::alignment.cpp] couldn't decompress " + filename);
+        } else {
+            gzip_between_members = false;
+        }
+    }
+
+    text->resize(text->size() - gzip_stream.avail_out);
+    return !text->empty();
+}
+
+bool FastqReader::next_chunk() {
+    switch (format) {
+    case PLAIN:
+        text->resize(gzip_chunk_size);
+        text->resize(read_raw(text->data(), text->size()));
+        text_used = 0;
+        return !text->empty();
+    case GZIP:
+        if (input_done) {
+            return false;
+        }
+        return decompress_gzip_chunk();
+    case BGZF:
+        while (true) {
+            if (!next_text.valid()) {
+                if (input_done) {
+                    return false;
+                }
+                next_text = async(launch::async, &FastqReader::decompress_bgzf_batch, this);
+            }
+            text = next_text.get();
+            text_used = 0;
+            if (!input_done) {
+                // Start on the next batch while this one is parsed
+                next_text = async(launch::async, &FastqReader::decompress_bgzf_batch, this);
+            }
+            if (!text->empty()) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool FastqReader::get_line(const char*& line, size_t& length) {
+    bool spanning = false;
+    while (true) {
+        while (text_used >= text->size()) {
+            if (!next_chunk()) {
+                if (spanning) {
+                    // The last line had no newline
+                    line = line_buffer.data();
+                    length = line_buffer.size();
+                    return true;
+                }
+                return false;
+            }
+        }
+
+        const char* start = text->data() + text_used;
+        size_t available = text->size() - text_used;
+        const char* newline = (const char*) memchr(start, '\n', available);
+        if (newline) {
+            size_t line_length = newline - start;
+            text_used += line_length + 1;
+            if (!spanning) {
+                // The whole line is in this chunk, so use it where it is
+                line = start;
+                length = line_length;
+            } else {
+                line_buffer.append(start, line_length);
+                line = line_buffer.data();
+                length = line_buffer.size();
+            }
+            return true;
+        }
+
+        // The line continues into the next chunk.
+        if (!spanning) {
+            line_buffer.clear();
+            spanning = true;
+        }
+        line_buffer.append(start, available);
+        text_used = text->size();
+    }
+}
+
+int FastqReader::peek() {
+    while (text_used >= text->size()) {
+        if (!next_chunk()) {
+            return -1;
+        }
+    }
+    return (unsigned char) (*text)[text_used];
+}
+
+bool FastqReader::get_next_alignment(Alignment& alignment, bool comment_as_tags) {
+
+    alignment.Clear();
+
+    // handle name
+    const char* line;
+    size_t length;
+    if (!get_line(line, length)) {
+        // no more to get
+        return false;
+    }
+    bool is_fasta = false;
+    if (length > 0 && line[0] == '@') {
+        is_fasta = false;
+    } else if (length > 0 && line[0] == '>') {
+        is_fasta = true;
+    } else {
+        throw runtime_error("Found unexpected delimiter " + string(line, min<size_t>(length, 1)) + " in fastq/fasta input");
+    }
+    // trim off leading @ and things after the first whitespace, keep trailing /1 /2
+    size_t div = 1;
+    while (div < length && whitespace.find(line[div]) == string::npos) {
+        ++div;
+    }
+    alignment.set_name(line + 1, div - 1);
+    if (comment_as_tags && div < length) {
+        // interpret comments as SAM-style tags
+        set_annotation(alignment, "tags", string(line + div + 1, length - div - 1));
+    }
+
+    // handle sequence
+    if (!get_line(line, length)) {
+        // there was no sequence
+        throw runtime_error("[vg::alignment.cpp] incomplete fastq/fasta record " + alignment.name());
+    }
+    if (!is_fasta) {
+        // we assume FASTQ sequences only take one line
+        alignment.set_sequence(line, length);
+    } else {
+        // FASTA sequences go until the next record
+        record_buffer.assign(line, length);
+        while (peek() >= 0 && peek() != '>' && get_line(line, length)) {
+            record_buffer.append(line, length);
+        }
+        alignment.set_sequence(record_buffer);
+        return true;
+    }
+
+    // handle "+" sep
+    if (!get_line(line, length)) {
+        cerr << "[vg::alignment.cpp] error: incomplete fastq record " << alignment.name() << endl; exit(1);
+    }
+    // handle quality
+    if (!get_line(line, length)) {
+        cerr << "[vg::alignment.cpp] error: fastq record missing base quality " <<  alignment.name() << endl; exit(1);
+    }
+    // convert from Phred+33 like string_quality_char_to_short, but without a new string
+    record_buffer.resize(length);
+    for (size_t i = 0; i < length; i++) {
+        record_buffer[i] = (char) ((int) line[i] - 33);
+    }
+    alignment.set_quality(record_buffer);
+
+    return true;
+}
+
+bool FastqReader::get_next_interleaved_pair(Alignment& mate1, Alignment& mate2, bool comment_as_tags) {
+    return get_next_alignment(mate1, comment_as_tags) && get_next_alignment(mate2, comment_as_tags);
+}
+
+}
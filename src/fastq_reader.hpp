@@ -0,0 +1,123 @@
+#ifndef VG_FASTQ_READER_HPP_INCLUDED
+#define VG_FASTQ_READER_HPP_INCLUDED
+
+/**
+ * \file fastq_reader.hpp
+ * Fast reader for FASTQ and FASTA files, plain, gzipped, or BGZF-compressed.
+ */
+
+#include <cstdio>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include <vg/vg.pb.h>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * Reads Alignments from a FASTQ or FASTA file.
+ *
+ * BGZF input is decompressed a batch of blocks at a time, with the blocks of
+ * a batch decompressed in parallel using libdeflate, and the next batch is
+ * decompressed in the background while records are parsed out of the
+ * current one. Other gzip input is decompressed as a stream with zlib, and
+ * uncompressed input is read directly.
+ *
+ * Records are parsed directly out of the decompressed text, so no strings
+ * are allocated per read beyond what goes into the Alignment.
+ *
+ * Not thread safe; one thread should pull reads from a reader.
+ */
+class FastqReader {
+public:
+    /// Open the given file, or standard input for "-". Decompress BGZF input
+    /// with up to the given number of threads. Exits with an error if the file
+    /// can't be opened.
+    FastqReader(const string& filename, size_t decode_threads = 1);
+
+    ~FastqReader();
+
+    /// Read the next record into the given Alignment, optionally interpreting
+    /// the comment as SAM-style tags. Returns false if there are no more
+    /// records.
+    bool get_next_alignment(Alignment& alignment, bool comment_as_tags = false);
+
+    /// Read the next pair of records from an interleaved file.
+    bool get_next_interleaved_pair(Alignment& mate1, Alignment& mate2, bool comment_as_tags = false);
+
+    /// How many BGZF blocks should we decompress in each batch?
+    size_t blocks_per_batch = 64;
+
+    /// How much should we decompress at once from non-BGZF gzip input?
+    size_t gzip_chunk_size = 1 << 20; // 1M
+
+protected:
+
+    /// Kinds of input we can read
+    enum input_format_t {
+        PLAIN,
+        GZIP,
+        BGZF
+    };
+
+    /// Get the next line, without its newline. The line is valid until the
+    /// next call. Returns false at the end of the input.
+    bool get_line(const char*& line, size_t& length);
+
+    /// Get the next character without consuming it, or -1 at the end of the input.
+    int peek();
+
+    /// Replace the current text with the next decompressed text. Returns false
+    /// at the end of the input.
+    bool next_chunk();
+
+    /// Read raw bytes from the file, starting with any bytes we already
+    /// looked at to detect the format. Returns the number of bytes read.
+    size_t read_raw(char* dest, size_t bytes);
+
+    /// Read the next batch of BGZF blocks and decompress them in parallel.
+    /// Runs in the background.
+    unique_ptr<vector<char>> decompress_bgzf_batch();
+
+    /// Decompress the next chunk of non-BGZF gzip input into text.
+    bool decompress_gzip_chunk();
+
+    string filename;
+    FILE* file = nullptr;
+    input_format_t format = PLAIN;
+    size_t decode_threads;
+
+    /// Bytes we read while detecting the format, that still need to be used.
+    string raw_prefix;
+    size_t raw_prefix_used = 0;
+
+    /// The decompressed text we are parsing
+    unique_ptr<vector<char>> text;
+    /// How far into the text we have parsed
+    size_t text_used = 0;
+    /// The next batch of BGZF text, being decompressed in the background
+    future<unique_ptr<vector<char>>> next_text;
+    /// Set when we have seen the end of the input
+    bool input_done = false;
+
+    /// Holds lines that span chunks of text
+    string line_buffer;
+    /// Holds multi-line FASTA sequences and converted qualities
+    string record_buffer;
+
+    /// zlib state for non-BGZF gzip input
+    z_stream gzip_stream;
+    vector<char> gzip_input;
+    bool gzip_stream_open = false;
+    /// Set when we have finished a gzip member and not yet started another
+    bool gzip_between_members = false;
+};
+
+}
+
+#endif
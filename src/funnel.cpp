@@ -1,7 +1,17 @@
 #include "funnel.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <omp.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 /**
  * \file funnel.hpp: implementation of the Funnel class
@@ -10,6 +20,35 @@
 namespace vg {
 using namespace std;
 
+bool Funnel::profile_stages = false;
+uint64_t (*Funnel::thread_allocated_bytes)() = nullptr;
+
+/// Get the number of CPU instructions the calling thread has executed since
+/// it first asked, or 0 if instructions can't be counted.
+static uint64_t thread_instructions() {
+#ifdef __linux__
+    // Each thread opens its own counter the first time it asks.
+    // -2 means we haven't tried yet, and -1 means perf events are unavailable.
+    thread_local int perf_fd = -2;
+    if (perf_fd == -2) {
+        // See <https://stackoverflow.com/a/64863392/402891>
+        struct perf_event_attr perf_config;
+        memset(&perf_config, 0, sizeof(struct perf_event_attr));
+        perf_config.type = PERF_TYPE_HARDWARE;
+        perf_config.size = sizeof(struct perf_event_attr);
+        perf_config.config = PERF_COUNT_HW_INSTRUCTIONS;
+        perf_config.exclude_kernel = 1;
+        perf_config.exclude_hv = 1;
+        perf_fd = syscall(__NR_perf_event_open, &perf_config, 0, -1, -1, 0);
+    }
+    uint64_t instructions;
+    if (perf_fd >= 0 && read(perf_fd, &instructions, sizeof(instructions)) == sizeof(instructions)) {
+        return instructions;
+    }
+#endif
+    return 0;
+}
+
 void Funnel::PaintableSpace::paint(size_t start, size_t length) {
     // Find the last interval starting strictly before start
     auto predecessor = regions.lower_bound(start);
@@ -96,6 +135,9 @@ void Funnel::start(const string& name) {
     stage_name.clear();
     substage_name.clear();
     stages.clear();
+    counters.clear();
+    
+    profiling = profile_stages;
 }
 
 void Funnel::stop() {
@@ -105,6 +147,10 @@ void Funnel::stop() {
     stop_time = clock::now();
 }
 
+const string& Funnel::name() const {
+    return funnel_name;
+}
+
 void Funnel::stage(const string& name) {
     assert(!funnel_name.empty());
     assert(!name.empty());
@@ -121,6 +167,12 @@ void Funnel::stage(const string& name) {
     
     // Record the start time
     stage_start_time = clock::now();
+    
+    if (profiling) {
+        // And the starting resource counts
+        stage_start_instructions = thread_instructions();
+        stage_start_allocated_bytes = thread_allocated_bytes ? thread_allocated_bytes() : 0;
+    }
 }
 
 void Funnel::stage_stop() {
@@ -139,6 +191,14 @@ void Funnel::stage_stop() {
         // Record the duration in seconds
         auto stage_stop_time = clock::now();
         stages.back().duration = chrono::duration_cast<chrono::duration<double>>(stage_stop_time - stage_start_time).count();
+        
+        if (profiling) {
+            // Record the resources used
+            stages.back().instructions = thread_instructions() - stage_start_instructions;
+            if (thread_allocated_bytes) {
+                stages.back().allocated_bytes = thread_allocated_bytes() - stage_start_allocated_bytes;
+            }
+        }
     }
 }
 
@@ -380,6 +440,12 @@ void Funnel::for_each_stage(const function<void(const string&, const vector<size
     }
 }
 
+void Funnel::for_each_stage_profile(const function<void(const string&, double, uint64_t, uint64_t)>& callback) const {
+    for (auto& stage : stages) {
+        callback(stage.name, stage.duration, stage.instructions, stage.allocated_bytes);
+    }
+}
+
 void Funnel::for_each_filter(const function<void(const string&, const string&,
     const FilterPerformance&, const FilterPerformance&, const vector<double>&, const vector<double>&)>& callback) const {
     
@@ -586,6 +652,16 @@ void Funnel::to_dot(ostream& out) const {
 
     out << "}" << endl;
 }
+void Funnel::count(const string& counter, size_t amount) {
+    counters[counter] += amount;
+}
+
+void Funnel::for_each_counter(const function<void(const string&, size_t)>& callback) const {
+    for (auto& kv : counters) {
+        callback(kv.first, kv.second);
+    }
+}
+
 void Funnel::annotate_mapped_alignment(Alignment& aln, bool annotate_correctness) const {
     // Save the total duration in the field set asside for it
     aln.set_time_used(chrono::duration_cast<chrono::duration<double>>(stop_time - start_time).count());
@@ -597,6 +673,19 @@ void Funnel::annotate_mapped_alignment(Alignment& aln, bool annotate_correctness
         set_annotation(aln, "stage_" + stage + "_time", duration);
     });
     
+    if (profiling) {
+        for_each_stage_profile([&](const string& stage, double duration, uint64_t instructions, uint64_t allocated_bytes) {
+            // Save the per-stage resource use
+            set_annotation(aln, "stage_" + stage + "_instructions", (double) instructions);
+            set_annotation(aln, "stage_" + stage + "_allocated_bytes", (double) allocated_bytes);
+        });
+    }
+    
+    for_each_counter([&](const string& counter, size_t value) {
+        // Save the event counts
+        set_annotation(aln, "counter_" + counter, (double) value);
+    });
+    
     set_annotation(aln, "last_placed_stage", last_tagged_stage(State::PLACED));
     for (size_t i = 0; i < aln.sequence().size(); i += 500) {
         // For each 500 bp window, annotate with the last stage that had something placed in or spanning the window.
@@ -689,6 +778,75 @@ size_t Funnel::create_item() {
 
 
 
+FunnelProfileSummary::FunnelProfileSummary(ostream* per_read_out) : thread_totals(omp_get_max_threads()), per_read_out(per_read_out) {
+    if (per_read_out) {
+        *per_read_out << "#read\tstage\tseconds\tinstructions\tallocated_bytes" << endl;
+    }
+}
+
+void FunnelProfileSummary::add(const Funnel& funnel) {
+    auto& totals = thread_totals.at(omp_get_thread_num());
+    stringstream lines;
+    funnel.for_each_stage_profile([&](const string& stage, double seconds, uint64_t instructions, uint64_t allocated_bytes) {
+        // Find the stage's totals, which are usually in the same place
+        // for every read.
+        auto found = find_if(totals.begin(), totals.end(), [&](const pair<string, StageTotals>& entry) {
+            return entry.first == stage;
+        });
+        if (found == totals.end()) {
+            totals.emplace_back(stage, StageTotals());
+            found = totals.end() - 1;
+        }
+        found->second.count++;
+        found->second.seconds += seconds;
+        found->second.instructions += instructions;
+        found->second.allocated_bytes += allocated_bytes;
+        
+        if (per_read_out) {
+            lines << funnel.name() << "\t" << stage << "\t" << seconds << "\t" << instructions << "\t" << allocated_bytes << "\n";
+        }
+    });
+    
+    if (per_read_out) {
+        lock_guard<mutex> lock(per_read_mutex);
+        *per_read_out << lines.str();
+    }
+}
+
+void FunnelProfileSummary::write_table(ostream& out) const {
+    // Combine the threads' totals, keeping stages in the order we first see them.
+    vector<pair<string, StageTotals>> combined;
+    for (auto& totals : thread_totals) {
+        for (auto& entry : totals) {
+            auto found = find_if(combined.begin(), combined.end(), [&](const pair<string, StageTotals>& other) {
+                return other.first == entry.first;
+            });
+            if (found == combined.end()) {
+                combined.push_back(entry);
+            } else {
+                found->second.count += entry.second.count;
+                found->second.seconds += entry.second.seconds;
+                found->second.instructions += entry.second.instructions;
+                found->second.allocated_bytes += entry.second.allocated_bytes;
+            }
+        }
+    }
+    
+    double total_seconds = 0;
+    for (auto& entry : combined) {
+        total_seconds += entry.second.seconds;
+    }
+    
+    out << "stage\tcount\tseconds\tpercent\tinstructions\tinstructions/count\tallocated_bytes\tbytes/count" << endl;
+    for (auto& entry : combined) {
+        auto& totals = entry.second;
+        out << entry.first << "\t" << totals.count << "\t" << totals.seconds << "\t"
+            << fixed << setprecision(2) << (total_seconds > 0 ? totals.seconds / total_seconds * 100 : 0.0) << defaultfloat << setprecision(6) << "\t"
+            << totals.instructions << "\t" << totals.instructions / totals.count << "\t"
+            << totals.allocated_bytes << "\t" << totals.allocated_bytes / totals.count << endl;
+    }
+}
+
 }
 
 
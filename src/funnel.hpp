@@ -7,9 +7,12 @@
 #include <cassert>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <limits>
+#include <map>
+#include <mutex>
 #include <vg/vg.pb.h>
 #include "annotation.hpp"
 
@@ -42,6 +45,16 @@ using namespace std;
 class Funnel {
 
 public:
+    /// Should funnels also measure the CPU instructions executed and the bytes
+    /// allocated by their thread during each stage? Takes effect when a funnel
+    /// is start()-ed.
+    static bool profile_stages;
+    
+    /// Function to get the number of bytes the calling thread has allocated
+    /// so far, for profiling stages. The memory allocator is configured
+    /// outside the library, so whoever turns on profiling should provide this.
+    static uint64_t (*thread_allocated_bytes)();
+
     /// Start processing the given named input.
     /// Name must not be empty.
     /// No stage or substage will be active.
@@ -51,6 +64,9 @@ public:
     /// All stages and substages are stopped.
     void stop();
     
+    /// Get the name of the input being processed, or last processed.
+    const string& name() const;
+    
     /// Start the given stage, and end all previous stages and substages.
     /// Name must not be empty.
     /// Multiple stages with the same name will be coalesced.
@@ -205,10 +221,24 @@ public:
     /// Get the index of the most recent item created in the current stage.
     size_t latest() const;
     
+    /// Add to the named counter, for events that aren't items, like cache
+    /// hits. Counters are reset when the funnel is start()-ed.
+    void count(const string& counter, size_t amount = 1);
+    
+    /// Call the given callback with the name and value of each counter, in
+    /// name order.
+    void for_each_counter(const function<void(const string&, size_t)>& callback) const;
+    
     /// Call the given callback with stage name, and vector of result item
     /// sizes at that stage, and a duration in seconds, for each stage.
     void for_each_stage(const function<void(const string&, const vector<size_t>&, const double&)>& callback) const;
     
+    /// Call the given callback with stage name, duration in seconds,
+    /// instructions executed, and bytes allocated, for each stage.
+    /// Instructions and bytes are 0 if stages were not being profiled, or if
+    /// they can't be measured here.
+    void for_each_stage_profile(const function<void(const string&, double, uint64_t, uint64_t)>& callback) const;
+    
     /// Represents the performance of a filter, for either item counts or total item sizes.
     /// Note that passing_correct and failing_correct will always be 0 if nothing is tagged correct.
     struct FilterPerformance {
@@ -263,6 +293,15 @@ protected:
     /// What's the name of the current substage? Will be empty if no substage is running.
     string substage_name;
     
+    /// Are we measuring instructions and allocations for this input?
+    bool profiling = false;
+    
+    /// How many instructions had this thread executed when the stage started?
+    uint64_t stage_start_instructions = 0;
+    
+    /// How many bytes had this thread allocated when the stage started?
+    uint64_t stage_start_allocated_bytes = 0;
+    
     /// What's the current prev-stage input we are processing?
     /// Will be numeric_limits<size_t>::max() if none.
     size_t input_in_progress = numeric_limits<size_t>::max();
@@ -271,6 +310,9 @@ protected:
     /// Will be numeric_limits<size_t>::max() if none.
     size_t output_in_progress = numeric_limits<size_t>::max();
     
+    /// Values of named event counters
+    std::map<string, size_t> counters;
+    
     // Now members we need for provenance tracking
     
     /// Represents a flag vector over positions via a sorted interval list.
@@ -316,6 +358,10 @@ protected:
         vector<Item> items;
         /// How long did the stage last, in seconds?
         float duration;
+        /// How many CPU instructions did the stage take, if profiling?
+        uint64_t instructions = 0;
+        /// How many bytes did the stage allocate, if profiling?
+        uint64_t allocated_bytes = 0;
         /// How many of the items were actually projected?
         /// Needed because items may need to expand to hold information for items that have not been projected yet.
         size_t projected_count = 0;
@@ -340,6 +386,44 @@ protected:
     vector<Stage> stages;
 };
 
+/**
+ * Adds up the per-stage profiles of many stopped Funnels, from any number of
+ * threads, into a summary table. Can also log each funnel's stages as lines
+ * of TSV.
+ */
+class FunnelProfileSummary {
+public:
+    /// Make a summary. If per_read_out is set, write a line to it for each
+    /// stage of each funnel added.
+    FunnelProfileSummary(ostream* per_read_out = nullptr);
+    
+    /// Add in the stages of the given stopped funnel. Thread safe.
+    void add(const Funnel& funnel);
+    
+    /// Write a table of the totals for each stage, in the order the stages
+    /// were first seen.
+    void write_table(ostream& out) const;
+    
+protected:
+    /// Running totals for a stage
+    struct StageTotals {
+        size_t count = 0;
+        double seconds = 0;
+        uint64_t instructions = 0;
+        uint64_t allocated_bytes = 0;
+    };
+    
+    /// Totals for each stage by name, in the order they were first seen,
+    /// kept separately for each thread
+    vector<vector<pair<string, StageTotals>>> thread_totals;
+    
+    /// Where we log each funnel's stages, if anywhere
+    ostream* per_read_out;
+    
+    /// Lock for writing to per_read_out
+    mutex per_read_mutex;
+};
+
 inline std::ostream& operator<<(std::ostream& out, const Funnel::State& state) {
     switch (state) {
         case Funnel::State::NONE:
@@ -2,6 +2,12 @@
 #include "algorithms/expand_context.hpp"
 #include "annotation.hpp"
 
+#include <fstream>
+#include <queue>
+
+#include <htslib/bgzf.h>
+#include <htslib/tbx.h>
+
 //#define debug
 
 namespace vg {
@@ -207,9 +213,16 @@ vector<Chain> GraphCaller::break_chain(const HandleGraph& graph, const Chain& ch
 VCFOutputCaller::VCFOutputCaller(const string& sample_name) : sample_name(sample_name), translation(nullptr), include_nested(false)
 {
     output_variants.resize(get_thread_count());
+    output_variant_bytes.resize(get_thread_count(), 0);
+    spill_files.resize(get_thread_count());
 }
 
 VCFOutputCaller::~VCFOutputCaller() {
+    for (auto& thread_spill_files : spill_files) {
+        for (auto& spill_file : thread_spill_files) {
+            temp_file::remove(spill_file);
+        }
+    }
 }
 
 string VCFOutputCaller::vcf_header(const PathHandleGraph& graph, const vector<string>& contigs,
@@ -238,6 +251,81 @@ string VCFOutputCaller::vcf_header(const PathHandleGraph& graph, const vector<st
     return ss.str();
 }
 
+/// Order buffered variants by contig name then position
+static bool variant_record_less(const pair<pair<string, size_t>, string>& v1,
+                                const pair<pair<string, size_t>, string>& v2) {
+    return v1.first.first < v2.first.first || (v1.first.first == v2.first.first && v1.first.second < v2.first.second);
+}
+
+/// Write a buffered variant to a spill file
+static void write_variant_record(ostream& out, const pair<pair<string, size_t>, string>& record) {
+    uint64_t name_length = record.first.first.size();
+    uint64_t position = record.first.second;
+    uint64_t data_length = record.second.size();
+    out.write((const char*) &name_length, sizeof(name_length));
+    out.write(record.first.first.data(), name_length);
+    out.write((const char*) &position, sizeof(position));
+    out.write((const char*) &data_length, sizeof(data_length));
+    out.write(record.second.data(), data_length);
+}
+
+/// Read a buffered variant back from a spill file. Returns false at the end of the file.
+static bool read_variant_record(istream& in, pair<pair<string, size_t>, string>& record) {
+    uint64_t name_length;
+    if (!in.read((char*) &name_length, sizeof(name_length))) {
+        return false;
+    }
+    uint64_t position;
+    uint64_t data_length;
+    record.first.first.resize(name_length);
+    in.read(&record.first.first[0], name_length);
+    in.read((char*) &position, sizeof(position));
+    in.read((char*) &data_length, sizeof(data_length));
+    record.first.second = position;
+    record.second.resize(data_length);
+    in.read(&record.second[0], data_length);
+    if (!in) {
+        throw runtime_error("error:[VCFOutputCaller] truncated variant spill file");
+    }
+    return true;
+}
+
+/// Merge sorted spill files, calling the callback with each variant in order
+static void merge_variant_runs(const vector<string>& run_files,
+                               const function<void(const pair<pair<string, size_t>, string>&)>& callback) {
+    vector<unique_ptr<ifstream>> runs;
+    for (const auto& run_file : run_files) {
+        runs.emplace_back(new ifstream(run_file, ios::binary));
+        if (!*runs.back()) {
+            cerr << "error:[VCFOutputCaller] could not read variants from temporary file " << run_file << endl;
+            exit(1);
+        }
+    }
+    vector<pair<pair<string, size_t>, string>> heads(runs.size());
+    // min-heap of run indexes, by their current variants
+    auto run_greater = [&](size_t i, size_t j) {
+        return variant_record_less(heads[j], heads[i]);
+    };
+    priority_queue<size_t, vector<size_t>, decltype(run_greater)> queue(run_greater);
+    for (size_t i = 0; i < runs.size(); ++i) {
+        if (read_variant_record(*runs[i], heads[i])) {
+            queue.push(i);
+        }
+    }
+    while (!queue.empty()) {
+        size_t i = queue.top();
+        queue.pop();
+        callback(heads[i]);
+        if (read_variant_record(*runs[i], heads[i])) {
+            queue.push(i);
+        }
+    }
+}
+
+void VCFOutputCaller::set_spill_budget(size_t max_buffered_bytes) {
+    spill_bytes_per_thread = max_buffered_bytes == 0 ? 0 : max<size_t>(max_buffered_bytes / output_variants.size(), 1);
+}
+
 bool VCFOutputCaller::add_variant(vcflib::Variant& var) const {
     var.setVariantCallFile(output_vcf);
     stringstream ss;
@@ -250,29 +338,146 @@ bool VCFOutputCaller::add_variant(vcflib::Variant& var) const {
     assert(ret == 0);
     // the Variant object is too big to keep in memory when there are many genotypes, so we
     // store it in a zstd-compressed string
-    output_variants[omp_get_thread_num()].push_back(make_pair(make_pair(var.sequenceName, var.position), dest));
+    size_t thread_number = omp_get_thread_num();
+    output_variant_bytes[thread_number] += dest.size() + var.sequenceName.size() + sizeof(pair<pair<string, size_t>, string>);
+    output_variants[thread_number].push_back(make_pair(make_pair(var.sequenceName, var.position), dest));
+    if (spill_bytes_per_thread != 0 && output_variant_bytes[thread_number] >= spill_bytes_per_thread) {
+        spill_variants(thread_number);
+    }
     return true;
 }
 
-void VCFOutputCaller::write_variants(ostream& out_stream, const SnarlManager* snarl_manager) {
+void VCFOutputCaller::spill_variants(size_t thread_number) const {
+    auto& buf = output_variants[thread_number];
+    if (buf.empty()) {
+        return;
+    }
+    std::sort(buf.begin(), buf.end(), variant_record_less);
+    string spill_file = temp_file::create("vcf-spill");
+    ofstream out(spill_file, ios::binary);
+    for (const auto& record : buf) {
+        write_variant_record(out, record);
+    }
+    out.close();
+    if (!out) {
+        cerr << "error:[VCFOutputCaller] could not write variants to temporary file " << spill_file << endl;
+        exit(1);
+    }
+    spill_files[thread_number].push_back(spill_file);
+    // actually give back the memory
+    vector<pair<pair<string, size_t>, string>>().swap(buf);
+    output_variant_bytes[thread_number] = 0;
+}
+
+void VCFOutputCaller::for_each_sorted_variant(const SnarlManager* snarl_manager,
+                                              const function<void(const string&)>& callback) {
     assert(include_nested == false || snarl_manager != nullptr);
+    function<void(string&)> add_nesting_tags;
     if (include_nested) {
-        update_nesting_info_tags(snarl_manager);
+        add_nesting_tags = get_nesting_info_tagger(snarl_manager);
     }
-    vector<pair<pair<string, size_t>, string>> all_variants;
-    for (const auto& buf : output_variants) {
-        all_variants.reserve(all_variants.size() + buf.size());
-        std::move(buf.begin(), buf.end(), std::back_inserter(all_variants));
-    }
-    std::sort(all_variants.begin(), all_variants.end(), [](const pair<pair<string, size_t>, string>& v1,
-                                                           const pair<pair<string, size_t>, string>& v2) {
-            return v1.first.first < v2.first.first || (v1.first.first == v2.first.first && v1.first.second < v2.first.second);
-        });
-    for (auto v : all_variants) {
+    auto emit = [&](const pair<pair<string, size_t>, string>& record) {
         string dest;
-        int ret = zstdutil::DecompressString(v.second, dest);
+        int ret = zstdutil::DecompressString(record.second, dest);
         assert(ret == 0);
-        out_stream << dest << endl;
+        if (add_nesting_tags) {
+            add_nesting_tags(dest);
+        }
+        callback(dest);
+    };
+
+    bool spilled = false;
+    for (const auto& thread_spill_files : spill_files) {
+        spilled = spilled || !thread_spill_files.empty();
+    }
+
+    if (!spilled) {
+        // everything is in memory, so just sort it
+        vector<pair<pair<string, size_t>, string>> all_variants;
+        for (const auto& buf : output_variants) {
+            all_variants.reserve(all_variants.size() + buf.size());
+            std::move(buf.begin(), buf.end(), std::back_inserter(all_variants));
+        }
+        std::sort(all_variants.begin(), all_variants.end(), variant_record_less);
+        for (const auto& v : all_variants) {
+            emit(v);
+        }
+        return;
+    }
+
+    // spill what's left so that everything is in sorted runs, then merge the runs
+#pragma omp parallel for
+    for (size_t i = 0; i < output_variants.size(); ++i) {
+        spill_variants(i);
+    }
+    vector<string> runs;
+    for (auto& thread_spill_files : spill_files) {
+        std::move(thread_spill_files.begin(), thread_spill_files.end(), std::back_inserter(runs));
+        thread_spill_files.clear();
+    }
+
+    // don't open more runs at once than we can have files open, so merge
+    // groups of runs into longer runs until few enough are left
+    while (runs.size() > max_merge_fan_in) {
+        vector<string> merged_runs;
+        for (size_t start = 0; start < runs.size(); start += max_merge_fan_in) {
+            vector<string> group(runs.begin() + start, runs.begin() + min(start + max_merge_fan_in, runs.size()));
+            string merged_file = temp_file::create("vcf-spill");
+            ofstream out(merged_file, ios::binary);
+            merge_variant_runs(group, [&](const pair<pair<string, size_t>, string>& record) {
+                write_variant_record(out, record);
+            });
+            out.close();
+            if (!out) {
+                cerr << "error:[VCFOutputCaller] could not write variants to temporary file " << merged_file << endl;
+                exit(1);
+            }
+            for (auto& run_file : group) {
+                temp_file::remove(run_file);
+            }
+            merged_runs.push_back(merged_file);
+        }
+        runs = std::move(merged_runs);
+    }
+    // keep track of the runs so they get cleaned up
+    spill_files[0] = runs;
+
+    merge_variant_runs(runs, emit);
+}
+
+void VCFOutputCaller::write_variants(ostream& out_stream, const SnarlManager* snarl_manager) {
+    for_each_sorted_variant(snarl_manager, [&](const string& line) {
+        out_stream << line << endl;
+    });
+}
+
+void VCFOutputCaller::write_variants(const string& header, const string& bgzf_filename, const SnarlManager* snarl_manager) {
+    BGZF* out = bgzf_open(bgzf_filename.c_str(), "w");
+    if (out == nullptr) {
+        cerr << "error:[VCFOutputCaller] could not open " << bgzf_filename << " for writing" << endl;
+        exit(1);
+    }
+    auto write_text = [&](const string& text) {
+        if (bgzf_write(out, text.data(), text.size()) != (ssize_t) text.size()) {
+            cerr << "error:[VCFOutputCaller] could not write to " << bgzf_filename << endl;
+            exit(1);
+        }
+    };
+    write_text(header);
+    for_each_sorted_variant(snarl_manager, [&](const string& line) {
+        write_text(line);
+        write_text("\n");
+    });
+    if (bgzf_close(out) != 0) {
+        cerr << "error:[VCFOutputCaller] could not finish writing " << bgzf_filename << endl;
+        exit(1);
+    }
+
+    // parameters inferred from tabix main's sourcecode
+    int min_shift = 0;
+    tbx_conf_t conf = tbx_conf_vcf;
+    if (tbx_index_build(bgzf_filename.c_str(), min_shift, &conf) != 0) {
+        cerr << "warning:[VCFOutputCaller] could not tabix index VCF " << bgzf_filename << endl;
     }
 }
 
@@ -1007,44 +1212,60 @@ SnarlTraversal GAFOutputCaller::pad_traversal(const PathHandleGraph& graph, cons
     return out_trav;
 }
 
-void VCFOutputCaller::update_nesting_info_tags(const SnarlManager* snarl_manager) {
+function<void(string&)> VCFOutputCaller::get_nesting_info_tagger(const SnarlManager* snarl_manager) const {
 
     // index the snarl tree by name
-    unordered_map<string, const Snarl*> name_to_snarl;
+    auto name_to_snarl = make_shared<unordered_map<string, const Snarl*>>();
     Snarl flipped_snarl;
     snarl_manager->for_each_snarl_preorder([&](const Snarl* snarl) {
-            name_to_snarl[print_snarl(*snarl)] = snarl;
+            (*name_to_snarl)[print_snarl(*snarl)] = snarl;
             // also add a map from the flipped snarl (as call sometimes messes with orientation)
             flipped_snarl.mutable_start()->set_node_id(snarl->end().node_id());
             flipped_snarl.mutable_start()->set_backward(!snarl->end().backward());
             flipped_snarl.mutable_end()->set_node_id(snarl->start().node_id());
             flipped_snarl.mutable_end()->set_backward(!snarl->start().backward());
-            name_to_snarl[print_snarl(flipped_snarl)] = snarl;
+            (*name_to_snarl)[print_snarl(flipped_snarl)] = snarl;
         });
 
-    // pass 1) index sites in vcf
+    // pass 1) index sites in vcf, both in memory and spilled to disk
     // (todo: this could be done more quickly upstream)
-    unordered_set<string> names_in_vcf;
+    auto names_in_vcf = make_shared<unordered_set<string>>();
+    auto index_name = [&](const pair<pair<string, size_t>, string>& output_variant_record) {
+        string output_variant_string;
+        int ret = zstdutil::DecompressString(output_variant_record.second, output_variant_string);
+        assert(ret == 0);
+        vector<string> toks = split_delims(output_variant_string, "\t", 4);
+        names_in_vcf->insert(toks[2]);
+    };
     for (auto& thread_buf : output_variants) {
         for (auto& output_variant_record : thread_buf) {
-            string output_variant_string;
-            int ret = zstdutil::DecompressString(output_variant_record.second, output_variant_string);
-            assert(ret == 0);
-            vector<string> toks = split_delims(output_variant_string, "\t", 4);
-            names_in_vcf.insert(toks[2]);
+            index_name(output_variant_record);
+        }
+    }
+    for (auto& thread_spill_files : spill_files) {
+        for (auto& spill_file : thread_spill_files) {
+            ifstream in(spill_file, ios::binary);
+            pair<pair<string, size_t>, string> output_variant_record;
+            while (read_variant_record(in, output_variant_record)) {
+                index_name(output_variant_record);
+            }
         }
     }
 
-    // determine the tags from the index
-    function<pair<size_t, string>(const string&)> get_lv_ps_tags = [&](const string& name) {
+    // pass 2) add the LV and PS tags to each line as it is written
+    return [this, snarl_manager, name_to_snarl, names_in_vcf](string& output_variant_string) {
+        vector<string> toks = split_delims(output_variant_string, "\t", 9);
+        const string& name = toks[2];
+
+        // determine the tags from the index
         string parent_name;
         size_t ancestor_count = 0;
-        const Snarl* snarl = name_to_snarl.at(name);
+        const Snarl* snarl = name_to_snarl->at(name);
         assert(snarl != nullptr);
         // walk up the snarl tree
         while (snarl = snarl_manager->parent_of(snarl)) {
             string cur_name = print_snarl(*snarl);
-            if (names_in_vcf.count(cur_name)) {
+            if (names_in_vcf->count(cur_name)) {
                 // only count snarls that are in the vcf
                 ++ancestor_count;
                 if (parent_name.empty()) {
@@ -1053,44 +1274,24 @@ void VCFOutputCaller::update_nesting_info_tags(const SnarlManager* snarl_manager
                 }
             }
         }
-        return make_pair(ancestor_count, parent_name);
-    };
-    
-    // pass 2) add the LV and PS tags
-#pragma omp parallel for
-    for (uint64_t i = 0; i < output_variants.size(); ++i) {
-        auto& thread_buf = output_variants[i];
-        for (auto& output_variant_record : thread_buf) {
-            string output_variant_string;
-            int ret = zstdutil::DecompressString(output_variant_record.second, output_variant_string);
-            assert(ret == 0);
-            //string& output_variant_string = output_variant_record.second;
-            vector<string> toks = split_delims(output_variant_string, "\t", 9);
-            const string& name = toks[2];
-            
-            pair<size_t, string> lv_ps = get_lv_ps_tags(name);
-            string nesting_tags = ";LV=" + std::to_string(lv_ps.first);
-            if (lv_ps.first != 0) {
-                assert(!lv_ps.second.empty());
-                nesting_tags += ";PS=" + lv_ps.second;
-            }
+        string nesting_tags = ";LV=" + std::to_string(ancestor_count);
+        if (ancestor_count != 0) {
+            assert(!parent_name.empty());
+            nesting_tags += ";PS=" + parent_name;
+        }
 
-            // rewrite the output string using the updated info toks
-            output_variant_string.clear();
-            for (size_t i = 0; i < toks.size(); ++i) {
-                output_variant_string += toks[i];
-                if (i == 7) {
-                    output_variant_string += nesting_tags;
-                }
-                if (i != toks.size() - 1) {
-                    output_variant_string += "\t";
-                }
+        // rewrite the output string using the updated info toks
+        output_variant_string.clear();
+        for (size_t i = 0; i < toks.size(); ++i) {
+            output_variant_string += toks[i];
+            if (i == 7) {
+                output_variant_string += nesting_tags;
+            }
+            if (i != toks.size() - 1) {
+                output_variant_string += "\t";
             }
-            output_variant_record.second.clear();
-            ret = zstdutil::CompressString(output_variant_string, output_variant_record.second);
-            assert(ret == 0);
         }
-    }
+    };
 }
 
 VCFGenotyper::VCFGenotyper(const PathHandleGraph& graph,
@@ -92,6 +92,17 @@ public:
     /// snarl_manager needed if include_nested is true
     void write_variants(ostream& out_stream, const SnarlManager* snarl_manager = nullptr);
 
+    /// Write the header and then the sorted variants to the given file as
+    /// BGZF, and build a tabix index for it
+    /// snarl_manager needed if include_nested is true
+    void write_variants(const string& header, const string& bgzf_filename, const SnarlManager* snarl_manager = nullptr);
+
+    /// Keep at most about this many bytes of (compressed) variants in memory,
+    /// spilling sorted runs to temporary files when the buffers fill up and
+    /// merging them when writing. 0 means keep everything in memory.
+    /// Must be called before any variants are added.
+    void set_spill_budget(size_t max_buffered_bytes);
+
     /// Run vcffixup from vcflib
     void vcf_fixup(vcflib::Variant& var) const;
 
@@ -147,8 +158,17 @@ protected:
     /// The parameters are to be treated as unions:  A sequence fragment if non-empty, otherwise a snarl
     void scan_snarl(const string& allele_string, function<void(const string&, Snarl&)> callback) const;
 
-    // update the PS and LV tags in the output buffer (called in write_variants if include_nested is true)
-    void update_nesting_info_tags(const SnarlManager* snarl_manager);
+    /// Make a function that adds the LV and PS tags to an output VCF line
+    /// (used in write_variants if include_nested is true). Must see all the
+    /// variants, so must be called after they have all been added.
+    function<void(string&)> get_nesting_info_tagger(const SnarlManager* snarl_manager) const;
+
+    /// Call the callback with each buffered VCF line, in sorted order,
+    /// merging in any spilled runs
+    void for_each_sorted_variant(const SnarlManager* snarl_manager, const function<void(const string&)>& callback);
+
+    /// Sort the given thread's output buffer and move it to a temporary file
+    void spill_variants(size_t thread_number) const;
     
     /// output vcf
     mutable vcflib::VariantCallFile output_vcf;
@@ -160,6 +180,18 @@ protected:
     /// variants stored as strings (and position key pairs) because vcflib::Variant in-memory struct so huge
     mutable vector<vector<pair<pair<string, size_t>, string>>> output_variants;
 
+    /// approximate bytes held in each output buffer
+    mutable vector<size_t> output_variant_bytes;
+
+    /// spill a thread's buffer to disk once it holds this many bytes (0 = never)
+    size_t spill_bytes_per_thread = 0;
+
+    /// sorted runs of variants spilled to temporary files (1 list/thread)
+    mutable vector<vector<string>> spill_files;
+
+    /// merge at most this many spilled runs at once, to stay under the open file limit
+    static const size_t max_merge_fan_in = 256;
+
     /// print up to this many uncalled alleles when doing ref-genotpes in -a mode
     size_t max_uncalled_alleles = 5;
 
@@ -12,6 +12,10 @@
 #include "algorithms/find_translation.hpp"
 #include <vg/io/hfile_cppstream.hpp>
 #include <vg/io/stream.hpp>
+#include <htslib/thread_pool.h>
+
+#include <functional>
+#include <queue>
 
 #include <sstream>
 
@@ -22,7 +26,8 @@ using namespace std;
 
 unique_ptr<AlignmentEmitter> get_alignment_emitter(const string& filename, const string& format,
                                                    const vector<tuple<path_handle_t, size_t, size_t>>& paths, size_t max_threads,
-                                                   const HandleGraph* graph, int flags) {
+                                                   const HandleGraph* graph, int flags, const HTSOutputOptions& options,
+                                                   Watchdog* watchdog) {
 
     
     unique_ptr<AlignmentEmitter> emitter;
@@ -46,10 +51,10 @@ unique_ptr<AlignmentEmitter> get_alignment_emitter(const string& filename, const
     
         if (flags & ALIGNMENT_EMITTER_FLAG_HTS_SPLICED) {
             // Use a splicing emitter as the final emitter
-            emitter = make_unique<SplicedHTSAlignmentEmitter>(filename, format, path_names_and_lengths, subpath_to_length, *path_graph, max_threads);
+            emitter = make_unique<SplicedHTSAlignmentEmitter>(filename, format, path_names_and_lengths, subpath_to_length, *path_graph, max_threads, options);
         } else {
             // Use a normal emitter
-            emitter = make_unique<HTSAlignmentEmitter>(filename, format, path_names_and_lengths, subpath_to_length, max_threads);
+            emitter = make_unique<HTSAlignmentEmitter>(filename, format, path_names_and_lengths, subpath_to_length, max_threads, options);
         }
         
         if (!(flags & ALIGNMENT_EMITTER_FLAG_HTS_RAW)) {
@@ -61,8 +66,10 @@ unique_ptr<AlignmentEmitter> get_alignment_emitter(const string& filename, const
                 target_paths.insert(get<0>(path_info));
             }
             // Interpose a surjecting AlignmentEmitter
-            emitter = make_unique<SurjectingAlignmentEmitter>(path_graph, target_paths, std::move(emitter),
+            auto surjecting_emitter = make_unique<SurjectingAlignmentEmitter>(path_graph, target_paths, std::move(emitter),
                 flags & ALIGNMENT_EMITTER_FLAG_HTS_PRUNE_SUSPICIOUS_ANCHORS);
+            surjecting_emitter->watchdog = watchdog;
+            emitter = std::move(surjecting_emitter);
         }
     
     } else {
@@ -443,16 +450,26 @@ vector<tuple<path_handle_t, size_t, size_t>> get_sequence_dictionary(const strin
 // Give the footer length for rewriting BGZF EOF markers.
 const size_t HTSWriter::BGZF_FOOTER_LENGTH = 28;
 
+// This is about what the multiplexer would let through between breakpoints,
+// before compression.
+const size_t HTSWriter::POOLED_BREAKPOINT_BYTES = 16 * 1024 * 1024;
+
+// Keep well under the usual limit of 1024 open files
+const size_t HTSWriter::MAX_MERGE_RUNS = 256;
+
 HTSWriter::HTSWriter(const string& filename, const string& format,
     const vector<pair<string, int64_t>>& path_order_and_length,
     const unordered_map<string, int64_t>& subpath_to_length,
-    size_t max_threads) :
+    size_t max_threads, const HTSOutputOptions& options) :
     out_file(filename == "-" ? nullptr : new ofstream(filename)),
     multiplexer(out_file.get() != nullptr ? *out_file : cout, max_threads),
     format(format), path_order_and_length(path_order_and_length), subpath_to_length(subpath_to_length),
     backing_files(max_threads, nullptr), sam_files(max_threads, nullptr),
     atomic_header(nullptr), sam_header(), header_mutex(), output_is_bgzf(format != "SAM"),
-    hts_mode() {
+    hts_mode(), compression_pool{nullptr, 0}, bytes_since_breakpoint(max_threads, 0),
+    sort_output(options.sorted), sort_buffer_bytes(max<size_t>(options.sort_memory / max_threads, 1)),
+    index_filename(), index_min_shift(0), sort_buffers(max_threads), sort_buffer_used(max_threads, 0),
+    sort_runs(max_threads) {
     
     // We can't work with no streams to multiplex, because we need to be able
     // to write BGZF EOF blocks throught he multiplexer at destruction.
@@ -480,14 +497,42 @@ HTSWriter::HTSWriter(const string& filename, const string& format,
         out_format = "";
     }
     strcat(out_mode, out_format.c_str());
-    int compress_level = 9; // TODO: support other compression levels
-    if (compress_level >= 0) {
+    if (options.level < -1 || options.level > 9) {
+        cerr << "[vg::HTSWriter] compression level " << options.level << " is not between 0 and 9" << endl;
+        exit(1);
+    }
+    if (options.level >= 0) {
         char tmp[2];
-        tmp[0] = compress_level + '0'; tmp[1] = '\0';
+        tmp[0] = options.level + '0'; tmp[1] = '\0';
         strcat(out_mode, tmp);
     }
     // Save to a C++ string that we will use later.
     hts_mode = out_mode;
+    
+    if (options.threads > 0 && format == "BAM") {
+        // Compress BGZF blocks in a pool of our own instead of on the threads
+        // doing the writing. Each samFile* gets a bounded queue into the pool.
+        // CRAM output doesn't use the pool; it compresses on the writing
+        // threads.
+        compression_pool.pool = hts_tpool_init(options.threads);
+        if (compression_pool.pool == nullptr) {
+            cerr << "[vg::HTSWriter] failed to start " << options.threads << " compression threads" << endl;
+            exit(1);
+        }
+    }
+
+    if (sort_output && format == "BAM" && filename != "-") {
+        // We can index sorted BAM as we write it. BAI can't describe
+        // positions past 2^29, so we need CSI if any reference is that long.
+        index_filename = filename + ".bai";
+        for (const auto& pl : path_order_and_length) {
+            if (pl.second >= ((int64_t) 1 << 29)) {
+                index_filename = filename + ".csi";
+                index_min_shift = 14;
+                break;
+            }
+        }
+    }
 
     if (this->subpath_to_length.empty()) {
         // no subpath support: just use lengths from path_order_and_length
@@ -502,6 +547,15 @@ HTSWriter::HTSWriter(const string& filename, const string& format,
 HTSWriter::~HTSWriter() {
     // Note that the destructor runs in only one thread, and only when
     // destruction is safe. No need to lock the header.
+    
+    // If we were sorting, this is when we actually write a whole, finished
+    // file, with its own EOF marker.
+    bool wrote_sorted = false;
+    if (sort_output && atomic_header.load() != nullptr) {
+        write_sorted(atomic_header.load());
+        wrote_sorted = true;
+    }
+    
     if (atomic_header.load() != nullptr) {
         // Delete the header
         bam_hdr_destroy(atomic_header.load());
@@ -526,7 +580,12 @@ HTSWriter::~HTSWriter() {
         }
     }
     
-    if (output_is_bgzf) {
+    if (compression_pool.pool != nullptr) {
+        // All the samFile*s are closed, so nothing is using the pool anymore.
+        hts_tpool_destroy(compression_pool.pool);
+    }
+    
+    if (output_is_bgzf && !wrote_sorted) {
         // Now put one BGZF EOF marker in thread 0's stream.
         // It will be the last thing, after all the barriers, and close the file.
         vg::io::finish(multiplexer.get_thread_stream(0), true);
@@ -560,6 +619,17 @@ bam_hdr_t* HTSWriter::ensure_header(const string& read_group,
             // Make the header
             header = hts_string_header(sam_header, path_order_and_length, rg_sample);
             
+            if (sort_output) {
+                // We will write the file all at once at the end, so all we
+                // need now is the header.
+                if (sam_hdr_update_hd(header, "SO", "coordinate") != 0) {
+                    cerr << "[vg::HTSWriter] error: failed to mark the SAM header as sorted" << endl;
+                    exit(1);
+                }
+                atomic_header.store(header);
+                return header;
+            }
+            
             // Initialize the SAM file for this thread and actually keep the header
             // we write, since we are the first thread.
             initialize_sam_file(header, thread_number, true);
@@ -576,7 +646,7 @@ bam_hdr_t* HTSWriter::ensure_header(const string& read_group,
     // Otherwise, someone else beat us to creating the header.
     // Header is ready. We just need to create the samFile* for this thread with it if it doesn't exist.
     
-    if (sam_files[thread_number] == nullptr) {
+    if (!sort_output && sam_files[thread_number] == nullptr) {
         // The header has been created and written, but hasn't been used to initialize our samFile* yet.
         initialize_sam_file(header, thread_number);
     }
@@ -588,7 +658,23 @@ bam_hdr_t* HTSWriter::ensure_header(const string& read_group,
 void HTSWriter::save_records(bam_hdr_t* header, vector<bam1_t*>& records, size_t thread_number) {
     // We need a header and an extant samFile*
     assert(header != nullptr);
-    assert(sam_files[thread_number] != nullptr);
+    assert(sort_output || sam_files[thread_number] != nullptr);
+    
+    if (sort_output) {
+        // Hold on to the records until we can write them all in order.
+        auto& buffer = sort_buffers[thread_number];
+        for (auto& b : records) {
+            buffer.push_back(b);
+            sort_buffer_used[thread_number] += sizeof(bam1_t) + b->m_data;
+        }
+        records.clear();
+        
+        if (sort_buffer_used[thread_number] >= sort_buffer_bytes) {
+            // We're holding too much, so put a sorted run on disk.
+            spill_sort_buffer(header, thread_number);
+        }
+        return;
+    }
     
     for (auto& b : records) {
         // Emit each record
@@ -597,6 +683,7 @@ void HTSWriter::save_records(bam_hdr_t* header, vector<bam1_t*>& records, size_t
             cerr << "[vg::HTSWriter] error: writing to output file failed" << endl;
             exit(1);
         }
+        bytes_since_breakpoint[thread_number] += b->l_data;
     }
     
     for (auto& b : records) {
@@ -604,7 +691,10 @@ void HTSWriter::save_records(bam_hdr_t* header, vector<bam1_t*>& records, size_t
         bam_destroy1(b);
     }
     
-    if (multiplexer.want_breakpoint(thread_number)) {
+    bool want_breakpoint = (compression_pool.pool != nullptr) ?
+        bytes_since_breakpoint[thread_number] >= POOLED_BREAKPOINT_BYTES :
+        multiplexer.want_breakpoint(thread_number);
+    if (want_breakpoint) {
         // We have written enough that we ought to give the multiplexer a chance to multiplex soon.
         // There's no way to do this without closing and re-opening the HTS file.
         // So just tear down and reamke the samFile* for this thread.
@@ -643,6 +733,16 @@ void HTSWriter::initialize_sam_file(bam_hdr_t* header, size_t thread_number, boo
         cerr << "[vg::HTSWriter] failed to open internal stream for writing " << format << " output" << endl;
         exit(1);
     }
+    bytes_since_breakpoint[thread_number] = 0;
+    
+    if (compression_pool.pool != nullptr) {
+        // Send our BGZF blocks to the shared pool to be compressed. Flushes
+        // (like after the header) still wait for the pool to finish with us.
+        if (hts_set_opt(sam_files[thread_number], HTS_OPT_THREAD_POOL, &compression_pool) != 0) {
+            cerr << "[vg::HTSWriter] failed to attach compression threads to " << format << " output" << endl;
+            exit(1);
+        }
+    }
     
     // Write the header again, which is the only way to re-initialize htslib's internals.
     // Remember that sam_hdr_write flushes the BGZF to the hFILE*, but does not flush the hFILE*.
@@ -667,11 +767,244 @@ void HTSWriter::initialize_sam_file(bam_hdr_t* header, size_t thread_number, boo
     }
 }
 
+bool HTSWriter::record_less(const bam1_t* a, const bam1_t* b) {
+    // Unplaced records have a tid of -1, which we want to sort last.
+    uint32_t a_tid = a->core.tid;
+    uint32_t b_tid = b->core.tid;
+    if (a_tid != b_tid) {
+        return a_tid < b_tid;
+    }
+    if (a->core.pos != b->core.pos) {
+        return a->core.pos < b->core.pos;
+    }
+    return bam_is_rev(a) < bam_is_rev(b);
+}
+
+void HTSWriter::spill_sort_buffer(bam_hdr_t* header, size_t thread_number) {
+    auto& buffer = sort_buffers[thread_number];
+    std::sort(buffer.begin(), buffer.end(), record_less);
+    
+    // We are the only ones who will read the run, so compress it as fast as
+    // we can while still keeping it small.
+    string run_filename = temp_file::create("vg-hts-sort-");
+    samFile* run_file = sam_open(run_filename.c_str(), "wb1");
+    if (run_file == nullptr || sam_hdr_write(run_file, header) != 0) {
+        cerr << "[vg::HTSWriter] error: failed to write sorted run to " << run_filename << endl;
+        exit(1);
+    }
+    for (auto& b : buffer) {
+        if (sam_write1(run_file, header, b) < 0) {
+            cerr << "[vg::HTSWriter] error: failed to write sorted run to " << run_filename << endl;
+            exit(1);
+        }
+        bam_destroy1(b);
+    }
+    if (sam_close(run_file) != 0) {
+        cerr << "[vg::HTSWriter] error: failed to finish sorted run " << run_filename << endl;
+        exit(1);
+    }
+    
+    buffer.clear();
+    sort_buffer_used[thread_number] = 0;
+    sort_runs[thread_number].push_back(run_filename);
+}
+
+/// Reads sorted BAM records back from a set of run files, holding them all
+/// open.
+class SortRunReader {
+public:
+    SortRunReader(const vector<string>& run_filenames, bam_hdr_t* header) : header(header) {
+        for (auto& run_filename : run_filenames) {
+            samFile* run_file = sam_open(run_filename.c_str(), "r");
+            bam_hdr_t* run_header = run_file != nullptr ? sam_hdr_read(run_file) : nullptr;
+            if (run_header == nullptr) {
+                cerr << "[vg::HTSWriter] error: failed to read back sorted run " << run_filename << endl;
+                exit(1);
+            }
+            // Every run has the same header as the output.
+            bam_hdr_destroy(run_header);
+            run_files.push_back(run_file);
+        }
+    }
+    
+    ~SortRunReader() {
+        for (auto& run_file : run_files) {
+            sam_close(run_file);
+        }
+    }
+    
+    /// Get the next record from the given run, or null if it is used up.
+    bam1_t* next_record(size_t run) {
+        bam1_t* b = bam_init1();
+        int result = sam_read1(run_files[run], header, b);
+        if (result < -1) {
+            cerr << "[vg::HTSWriter] error: failed to read back sorted run" << endl;
+            exit(1);
+        }
+        if (result == -1) {
+            bam_destroy1(b);
+            return nullptr;
+        }
+        return b;
+    }
+    
+    size_t size() const {
+        return run_files.size();
+    }
+    
+private:
+    bam_hdr_t* header;
+    vector<samFile*> run_files;
+};
+
+/// Merge records from the given sources, each of which gives records in
+/// order and then null, and pass each record to the callback in order. The
+/// callback takes ownership of the records.
+static void merge_records(size_t source_count, const function<bam1_t*(size_t)>& next_record,
+                          const function<void(bam1_t*)>& callback) {
+    auto record_greater = [](const pair<bam1_t*, size_t>& a, const pair<bam1_t*, size_t>& b) {
+        return HTSWriter::record_less(b.first, a.first);
+    };
+    priority_queue<pair<bam1_t*, size_t>, vector<pair<bam1_t*, size_t>>, decltype(record_greater)> merge_queue(record_greater);
+    for (size_t source = 0; source < source_count; source++) {
+        bam1_t* b = next_record(source);
+        if (b != nullptr) {
+            merge_queue.emplace(b, source);
+        }
+    }
+    while (!merge_queue.empty()) {
+        auto next = merge_queue.top();
+        merge_queue.pop();
+        callback(next.first);
+        bam1_t* b = next_record(next.second);
+        if (b != nullptr) {
+            merge_queue.emplace(b, next.second);
+        }
+    }
+}
+
+string HTSWriter::merge_sort_runs(bam_hdr_t* header, const vector<string>& run_filenames) {
+    string merged_filename = temp_file::create("vg-hts-sort-");
+    samFile* merged_file = sam_open(merged_filename.c_str(), "wb1");
+    if (merged_file == nullptr || sam_hdr_write(merged_file, header) != 0) {
+        cerr << "[vg::HTSWriter] error: failed to write sorted run to " << merged_filename << endl;
+        exit(1);
+    }
+    {
+        SortRunReader runs(run_filenames, header);
+        merge_records(runs.size(), [&](size_t run) {
+            return runs.next_record(run);
+        }, [&](bam1_t* b) {
+            if (sam_write1(merged_file, header, b) < 0) {
+                cerr << "[vg::HTSWriter] error: failed to write sorted run to " << merged_filename << endl;
+                exit(1);
+            }
+            bam_destroy1(b);
+        });
+    }
+    if (sam_close(merged_file) != 0) {
+        cerr << "[vg::HTSWriter] error: failed to finish sorted run " << merged_filename << endl;
+        exit(1);
+    }
+    for (auto& run_filename : run_filenames) {
+        temp_file::remove(run_filename);
+    }
+    return merged_filename;
+}
+
+void HTSWriter::write_sorted(bam_hdr_t* header) {
+    // Sort what each thread is still holding, so it can be merged with the
+    // runs that were spilled.
+    for (auto& buffer : sort_buffers) {
+        std::sort(buffer.begin(), buffer.end(), record_less);
+    }
+    
+    // Collect all the spilled runs
+    vector<string> run_filenames;
+    for (auto& thread_runs : sort_runs) {
+        run_filenames.insert(run_filenames.end(), thread_runs.begin(), thread_runs.end());
+        thread_runs.clear();
+    }
+    
+    // We can't have too many runs open at once, so merge groups of runs into
+    // longer runs until there are few enough left.
+    while (run_filenames.size() > MAX_MERGE_RUNS) {
+        vector<string> merged_filenames;
+        for (size_t start = 0; start < run_filenames.size(); start += MAX_MERGE_RUNS) {
+            vector<string> group(run_filenames.begin() + start,
+                                 run_filenames.begin() + min(start + MAX_MERGE_RUNS, run_filenames.size()));
+            merged_filenames.push_back(merge_sort_runs(header, group));
+        }
+        run_filenames = std::move(merged_filenames);
+    }
+    
+    // Nothing has gone through the multiplexer, and only this thread is
+    // writing now, so write the whole file straight to the real output
+    // instead of buffering it in a thread stream.
+    ostream& final_out = out_file.get() != nullptr ? *out_file : cout;
+    hFILE* backing_file = vg::io::hfile_wrap(final_out);
+    samFile* out = hts_hopen(backing_file, "-", hts_mode.c_str());
+    if (out == nullptr) {
+        cerr << "[vg::HTSWriter] failed to open output stream for writing " << format << " output" << endl;
+        exit(1);
+    }
+    if (compression_pool.pool != nullptr && hts_set_opt(out, HTS_OPT_THREAD_POOL, &compression_pool) != 0) {
+        cerr << "[vg::HTSWriter] failed to attach compression threads to " << format << " output" << endl;
+        exit(1);
+    }
+    if (sam_hdr_write(out, header) != 0) {
+        cerr << "[vg::HTSWriter] error: failed to write the SAM header" << endl;
+        exit(1);
+    }
+    if (!index_filename.empty() && sam_idx_init(out, header, index_min_shift, index_filename.c_str()) != 0) {
+        cerr << "[vg::HTSWriter] error: failed to start index " << index_filename << endl;
+        exit(1);
+    }
+    
+    {
+        // Sources up to sort_buffers.size() are the threads' buffers, and the
+        // rest are the runs.
+        SortRunReader runs(run_filenames, header);
+        vector<size_t> buffer_cursors(sort_buffers.size(), 0);
+        merge_records(sort_buffers.size() + runs.size(), [&](size_t source) -> bam1_t* {
+            if (source < sort_buffers.size()) {
+                size_t& cursor = buffer_cursors[source];
+                return cursor < sort_buffers[source].size() ? sort_buffers[source][cursor++] : nullptr;
+            }
+            return runs.next_record(source - sort_buffers.size());
+        }, [&](bam1_t* b) {
+            if (sam_write1(out, header, b) < 0) {
+                cerr << "[vg::HTSWriter] error: writing to output file failed" << endl;
+                exit(1);
+            }
+            bam_destroy1(b);
+        });
+    }
+    
+    if (!index_filename.empty() && sam_idx_save(out) != 0) {
+        cerr << "[vg::HTSWriter] error: failed to save index " << index_filename << endl;
+        exit(1);
+    }
+    if (sam_close(out) != 0) {
+        cerr << "[vg::HTSWriter] error: failed to finish sorted output" << endl;
+        exit(1);
+    }
+    final_out.flush();
+    
+    // Clean up the runs. All the buffered records have been destroyed.
+    for (auto& run_filename : run_filenames) {
+        temp_file::remove(run_filename);
+    }
+    for (auto& buffer : sort_buffers) {
+        buffer.clear();
+    }
+}
+
 HTSAlignmentEmitter::HTSAlignmentEmitter(const string& filename, const string& format,
                                          const vector<pair<string, int64_t>>& path_order_and_length,
                                          const unordered_map<string, int64_t>& subpath_to_length,
-                                         size_t max_threads)
-    : HTSWriter(filename, format, path_order_and_length, subpath_to_length, max_threads)
+                                         size_t max_threads, const HTSOutputOptions& options)
+    : HTSWriter(filename, format, path_order_and_length, subpath_to_length, max_threads, options)
 {
     // nothing else to do
 }
@@ -768,7 +1101,7 @@ void HTSAlignmentEmitter::emit_singles(vector<Alignment>&& aln_batch) {
     bam_hdr_t* header = ensure_header(aln_batch.front().read_group(),
                                       aln_batch.front().sample_name(), thread_number);
     assert(header != nullptr);
-    assert(sam_files[thread_number] != nullptr);
+    assert(sort_output || sam_files[thread_number] != nullptr);
     
     vector<bam1_t*> records;
     records.reserve(aln_batch.size());
@@ -807,7 +1140,7 @@ void HTSAlignmentEmitter::emit_mapped_singles(vector<vector<Alignment>>&& alns_b
     bam_hdr_t* header = ensure_header(sniff->read_group(), sniff->sample_name(),
                                       thread_number);
     assert(header != nullptr);
-    assert(sam_files[thread_number] != nullptr);
+    assert(sort_output || sam_files[thread_number] != nullptr);
     
     vector<bam1_t*> records;
     records.reserve(count);
@@ -844,7 +1177,7 @@ void HTSAlignmentEmitter::emit_pairs(vector<Alignment>&& aln1_batch,
     bam_hdr_t* header = ensure_header(aln1_batch.front().read_group(),
                                       aln1_batch.front().sample_name(), thread_number);
     assert(header != nullptr);
-    assert(sam_files[thread_number] != nullptr);
+    assert(sort_output || sam_files[thread_number] != nullptr);
     
     vector<bam1_t*> records;
     records.reserve(aln1_batch.size() * 2);
@@ -895,7 +1228,7 @@ void HTSAlignmentEmitter::emit_mapped_pairs(vector<vector<Alignment>>&& alns1_ba
     bam_hdr_t* header = ensure_header(sniff->read_group(), sniff->sample_name(),
                                       thread_number);
     assert(header != nullptr);
-    assert(sam_files[thread_number] != nullptr);
+    assert(sort_output || sam_files[thread_number] != nullptr);
     
     vector<bam1_t*> records;
     records.reserve(count);
@@ -915,8 +1248,8 @@ SplicedHTSAlignmentEmitter::SplicedHTSAlignmentEmitter(const string& filename, c
                                                        const vector<pair<string, int64_t>>& path_order_and_length,
                                                        const unordered_map<string, int64_t>& subpath_to_length,
                                                        const PathPositionHandleGraph& graph,
-                                                       size_t max_threads) :
-    HTSAlignmentEmitter(filename, format, path_order_and_length, subpath_to_length, max_threads), graph(graph) {
+                                                       size_t max_threads, const HTSOutputOptions& options) :
+    HTSAlignmentEmitter(filename, format, path_order_and_length, subpath_to_length, max_threads, options), graph(graph) {
     
     // nothing else to do
 }
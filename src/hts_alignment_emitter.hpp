@@ -27,6 +27,8 @@ using namespace std;
 
 using namespace vg::io;
 
+class Watchdog;
+
 /**
  * Flag enum for controlling the behavior of alignment emitters behind get_alignment_emitter().
  */
@@ -47,6 +49,25 @@ enum alignment_emitter_flags_t {
     ALIGNMENT_EMITTER_FLAG_VG_USE_SEGMENT_NAMES = 8
 };
 
+/**
+ * Settings for compressing and ordering HTSlib output.
+ */
+struct HTSOutputOptions {
+    /// BGZF compression level from 0 (store only) to 9 (smallest), or -1 for
+    /// the HTSlib default.
+    int level = 9;
+    /// Number of threads to dedicate to compressing BAM output, shared
+    /// between all the threads writing records. If 0, each thread compresses
+    /// its own output as it writes it.
+    size_t threads = 0;
+    /// If set, buffer all the records and write them out sorted by
+    /// coordinate, with an index next to the file if writing BAM to a file.
+    bool sorted = false;
+    /// When sorting, how many bytes of records should we hold in memory,
+    /// over all threads, before spilling sorted runs to temporary files?
+    size_t sort_memory = 768 * 1024 * 1024;
+};
+
 /// Get an AlignmentEmitter that can emit to the given file (or "-") in the
 /// given format. When writing HTSlib formats (SAM, BAM, CRAM), paths should
 /// contain the paths in the linear reference in sequence dictionary order (see
@@ -56,11 +77,18 @@ enum alignment_emitter_flags_t {
 ///
 /// flags is an ORed together set of flags from alignment_emitter_flags_t.
 ///
+/// options controls how HTSlib formats are compressed and ordered.
+///
+/// If alignments are surjected and watchdog is set, the time to surject each
+/// alignment is reported to it.
+///
 /// Automatically applies per-thread buffering, but needs to know how many OMP
 /// threads will be in use.
 unique_ptr<AlignmentEmitter> get_alignment_emitter(const string& filename, const string& format, 
                                                    const vector<tuple<path_handle_t, size_t, size_t>>& paths, size_t max_threads,
-                                                   const HandleGraph* graph = nullptr, int flags = ALIGNMENT_EMITTER_FLAG_NONE);
+                                                   const HandleGraph* graph = nullptr, int flags = ALIGNMENT_EMITTER_FLAG_NONE,
+                                                   const HTSOutputOptions& options = HTSOutputOptions(),
+                                                   Watchdog* watchdog = nullptr);
 
 /**
  * Produce a list of path handles in a fixed order, suitable for use with
@@ -108,13 +136,19 @@ public:
     /// contig name and length to include in the header. Sample names and read
     /// groups for the header will be guessed from the first reads. HTSlib
     /// positions will be read from the alignments' refpos, and the alignments
-    /// must be surjected.
+    /// must be surjected. If options asks for sorted output, all records are
+    /// written when the HTSWriter is destroyed.
     HTSWriter(const string& filename, const string& format, const vector<pair<string, int64_t>>& path_order_and_length,
-              const unordered_map<string, int64_t>& subpath_to_length, size_t max_threads);
+              const unordered_map<string, int64_t>& subpath_to_length, size_t max_threads,
+              const HTSOutputOptions& options = HTSOutputOptions());
     
     /// Tear down an HTSWriter and destroy HTSlib structures.
     ~HTSWriter();
     
+    /// Order BAM records by reference, then position, then strand, with
+    /// unplaced records last.
+    static bool record_less(const bam1_t* a, const bam1_t* b);
+    
     // Not copyable or movable
     HTSWriter(const HTSWriter& other) = delete;
     HTSWriter& operator=(const HTSWriter& other) = delete;
@@ -126,6 +160,14 @@ protected:
     /// We hack about with htslib's BGZF EOF footers, so we need to know how long they are.
     static const size_t BGZF_FOOTER_LENGTH;
     
+    /// When compressing in a thread pool, how many bytes of records should a
+    /// thread write before making a breakpoint?
+    static const size_t POOLED_BREAKPOINT_BYTES;
+    
+    /// How many sorted runs should we merge at once? More runs than this are
+    /// merged in several passes.
+    static const size_t MAX_MERGE_RUNS;
+    
     /// If we are doing output to a file, this will hold the open file. Otherwise (for stdout) it will be empty.
     unique_ptr<ofstream> out_file;
     /// This holds a StreamMultiplexer on the output stream, for sharing it
@@ -172,12 +214,51 @@ protected:
     /// Remember the HTSlib mode string we need to open our files.
     string hts_mode;
     
+    /// Pool of threads for compressing output, shared by all our samFile*s.
+    /// If we compress on the writing threads instead, the pool is null.
+    htsThreadPool compression_pool;
+    
+    /// When compressing in the pool, the pool writes to the multiplexer's
+    /// thread streams in the background, so we can't ask the multiplexer
+    /// whether they want a breakpoint. Instead we count the bytes of records
+    /// each thread has written since its last breakpoint.
+    vector<size_t> bytes_since_breakpoint;
+    
+    /// Are we holding records back to write them sorted?
+    bool sort_output;
+    /// How many bytes of records can each thread hold before spilling?
+    size_t sort_buffer_bytes;
+    /// Where should the index go for sorted output? Empty if we can't or
+    /// shouldn't index.
+    string index_filename;
+    /// The min_shift for the index: 0 for BAI, or 14 for CSI.
+    int index_min_shift;
+    /// The records each thread is holding, unsorted.
+    vector<vector<bam1_t*>> sort_buffers;
+    /// How many bytes of records each thread is holding.
+    vector<size_t> sort_buffer_used;
+    /// The temporary files holding each thread's sorted runs of records.
+    vector<vector<string>> sort_runs;
+    
+    /// Sort a thread's held records and write them to a new temporary file.
+    void spill_sort_buffer(bam_hdr_t* header, size_t thread_number);
+    
+    /// Merge the given sorted runs into one new run, and remove them.
+    /// Returns the new run's filename.
+    string merge_sort_runs(bam_hdr_t* header, const vector<string>& run_filenames);
+    
+    /// Merge all the held and spilled records and write them to the output
+    /// in order, along with the index if we are making one.
+    void write_sorted(bam_hdr_t* header);
+    
     /// Write and deallocate a bunch of BAM records. Takes care of locking the
-    /// file. Header must have been written already.
+    /// file. Header must have been written already. If sorting, holds the
+    /// records to be written later instead.
     void save_records(bam_hdr_t* header, vector<bam1_t*>& records, size_t thread_number);
     
     /// Make sure that the HTS header has been written, and the samFile* in
-    /// sam_files has been created for the given thread.
+    /// sam_files has been created for the given thread. If sorting, only
+    /// makes sure the header exists.
     ///
     /// If the header has not been written, blocks until it has been written.
     ///
@@ -210,7 +291,8 @@ public:
     /// the alignments must be surjected.
     HTSAlignmentEmitter(const string& filename, const string& format,
                         const vector<pair<string, int64_t>>& path_order_and_length,
-                        const unordered_map<string, int64_t>& subpath_to_length, size_t max_threads);
+                        const unordered_map<string, int64_t>& subpath_to_length, size_t max_threads,
+                        const HTSOutputOptions& options = HTSOutputOptions());
     
     /// Tear down an HTSAlignmentEmitter and destroy HTSlib structures.
     ~HTSAlignmentEmitter() = default;
@@ -261,7 +343,8 @@ public:
                                const vector<pair<string, int64_t>>& path_order_and_length,
                                const unordered_map<string, int64_t>& subpath_to_length,
                                const PathPositionHandleGraph& graph,
-                               size_t max_threads);
+                               size_t max_threads,
+                               const HTSOutputOptions& options = HTSOutputOptions());
     
     ~SplicedHTSAlignmentEmitter() = default;
     
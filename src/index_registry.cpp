@@ -46,6 +46,7 @@
 #include "gbwt_helper.hpp"
 #include "gbwtgraph_helper.hpp"
 #include "gcsa_helper.hpp"
+#include "mem_accelerator.hpp"
 #include "flat_file_back_translation.hpp"
 #include "kmer.hpp"
 #include "transcriptome.hpp"
@@ -98,6 +99,7 @@ double IndexingParameters::pruning_max_node_degree_decrease_factor = 0.75;
 int IndexingParameters::gcsa_initial_kmer_length = gcsa::Key::MAX_LENGTH;
 int IndexingParameters::gcsa_doubling_steps = gcsa::ConstructionParameters::DOUBLING_STEPS;
 int64_t IndexingParameters::gcsa_size_limit = 2ll * 1024ll * 1024ll * 1024ll * 1024ll;
+int IndexingParameters::mem_accelerator_length = 12;
 int64_t IndexingParameters::gbwt_insert_batch_size = gbwt::DynamicGBWT::INSERT_BATCH_SIZE;
 int IndexingParameters::gbwt_insert_batch_size_increase_factor = 10;
 int IndexingParameters::gbwt_sampling_interval = gbwt::DynamicGBWT::SAMPLE_INTERVAL;
@@ -527,6 +529,8 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
     registry.register_index("LCP", "gcsa.lcp");
     registry.register_index("Spliced GCSA", "spliced.gcsa");
     registry.register_index("Spliced LCP", "spliced.gcsa.lcp");
+    registry.register_index("MEM Accelerator", "gcsa.accel");
+    registry.register_index("Spliced MEM Accelerator", "spliced.gcsa.accel");
     
     registry.register_index("GBWT", "gbwt");
     registry.register_index("Spliced GBWT", "spliced.gbwt");
@@ -3719,6 +3723,70 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
         return construct_gcsa(inputs, plan, constructing);
     });
     
+    ////////////////////////////////////
+    // MEM Accelerator Recipes
+    ////////////////////////////////////
+    
+    // meta-recipe to memoize GCSA2 queries for mpmap
+    auto construct_mem_accelerator = [](const vector<const IndexFile*>& inputs,
+                                        const IndexingPlan* plan,
+                                        const IndexGroup& constructing) {
+        
+        if (IndexingParameters::verbosity != IndexingParameters::None) {
+            cerr << "[IndexRegistry]: Memoizing GCSA2 queries." << endl;
+        }
+        
+        assert(inputs.size() == 2);
+        auto gcsa_filenames = inputs[0]->get_filenames();
+        auto xg_filenames = inputs[1]->get_filenames();
+        assert(gcsa_filenames.size() == 1);
+        assert(xg_filenames.size() == 1);
+        
+        assert(constructing.size() == 1);
+        vector<vector<string>> all_outputs(constructing.size());
+        auto accelerator_output = *constructing.begin();
+        auto& output_names = all_outputs[0];
+        
+        ifstream infile_gcsa, infile_xg;
+        init_in(infile_gcsa, gcsa_filenames.front());
+        init_in(infile_xg, xg_filenames.front());
+        
+        string output_name = plan->output_filepath(accelerator_output);
+        ofstream outfile_accelerator;
+        init_out(outfile_accelerator, output_name);
+        
+        auto gcsa_index = vg::io::VPKG::load_one<gcsa::GCSA>(infile_gcsa);
+        auto xg_index = vg::io::VPKG::load_one<xg::XG>(infile_xg);
+        
+        // don't make a huge table for a small graph, matching what mpmap
+        // would build for itself
+        int64_t length = min<int64_t>(IndexingParameters::mem_accelerator_length,
+                                      round(log(xg_index->get_total_length()) / log(4.0)));
+        xg_index.reset();
+        
+        MEMAccelerator accelerator(*gcsa_index, length, get_thread_count());
+        accelerator.serialize(outfile_accelerator);
+        
+        output_names.push_back(output_name);
+        return all_outputs;
+    };
+    
+    registry.register_recipe({"MEM Accelerator"}, {"GCSA", "XG"},
+                             [construct_mem_accelerator](const vector<const IndexFile*>& inputs,
+                                                         const IndexingPlan* plan,
+                                                         AliasGraph& alias_graph,
+                                                         const IndexGroup& constructing) {
+        return construct_mem_accelerator(inputs, plan, constructing);
+    });
+    
+    registry.register_recipe({"Spliced MEM Accelerator"}, {"Spliced GCSA", "Spliced XG"},
+                             [construct_mem_accelerator](const vector<const IndexFile*>& inputs,
+                                                         const IndexingPlan* plan,
+                                                         AliasGraph& alias_graph,
+                                                         const IndexGroup& constructing) {
+        return construct_mem_accelerator(inputs, plan, constructing);
+    });
+    
     ////////////////////////////////////
     // Snarls Recipes
     ////////////////////////////////////
@@ -3822,7 +3890,8 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
         
         SnarlDistanceIndex distance_index;
         IntegratedSnarlFinder snarl_finder(graph);
-        fill_in_distance_index(&distance_index, &graph, &snarl_finder);
+        fill_in_distance_index(&distance_index, &graph, &snarl_finder, 50000, false, true,
+                               get_thread_count());
         distance_index.serialize(output_name);
         
         output_names.push_back(output_name);
@@ -4134,7 +4203,8 @@ vector<IndexName> VGIndexes::get_default_mpmap_indexes() {
         "Spliced XG",
         "Spliced Distance Index",
         "Spliced GCSA",
-        "Spliced LCP"
+        "Spliced LCP",
+        "Spliced MEM Accelerator"
     };
     return indexes;
 }
@@ -82,6 +82,8 @@ struct IndexingParameters {
     static int gcsa_doubling_steps;
     // disk limit for temporary files in bytes [2TB]
     static int64_t gcsa_size_limit;
+    // length of the k-mers whose GCSA2 ranges are memoized for mpmap, at most [12]
+    static int mem_accelerator_length;
     // number of gbwt nodes inserted at a time in dynamic gbwt [100M]
     static int64_t gbwt_insert_batch_size;
     // factor by which the batch size is increased if construction fails [10]
@@ -13,6 +13,7 @@
 #include "register_loader_saver_gbzgraph.hpp"
 #include "register_loader_saver_gcsa.hpp"
 #include "register_loader_saver_lcp.hpp"
+#include "register_loader_saver_mem_accelerator.hpp"
 #include "register_loader_saver_minimizer.hpp"
 #include "register_loader_saver_snarl_manager.hpp"
 #include "register_loader_saver_vg.hpp"
@@ -40,6 +41,7 @@ bool register_libvg_io() {
     register_loader_saver_gbzgraph();
     register_loader_saver_gcsa();
     register_loader_saver_lcp();
+    register_loader_saver_mem_accelerator();
     register_loader_saver_minimizer();
     register_loader_saver_snarl_manager();
     register_loader_saver_vg();
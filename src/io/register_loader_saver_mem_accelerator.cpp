@@ -0,0 +1,40 @@
+/**
+ * \file register_loader_saver_mem_accelerator.cpp
+ * Defines IO for a MEMAccelerator from stream files.
+ */
+
+#include <vg/io/registry.hpp>
+#include "register_loader_saver_mem_accelerator.hpp"
+
+#include "../mem_accelerator.hpp"
+
+namespace vg {
+
+namespace io {
+
+using namespace std;
+using namespace vg::io;
+
+void register_loader_saver_mem_accelerator() {
+    std::uint32_t magic_number = MEMAccelerator::TAG;
+    std::string magic_string(reinterpret_cast<char*>(&magic_number), sizeof(magic_number));
+
+    Registry::register_bare_loader_saver_with_magic<MEMAccelerator>("MEMACCELERATOR", magic_string, [](istream& input) -> void* {
+        // Allocate a MEMAccelerator
+        MEMAccelerator* accelerator = new MEMAccelerator();
+
+        // Load it
+        accelerator->load(input);
+
+        // Return it so the caller owns it.
+        return (void*) accelerator;
+    }, [](const void* accelerator_void, ostream& output) {
+        // Cast to MEMAccelerator and serialize to the stream.
+        assert(accelerator_void != nullptr);
+        ((const MEMAccelerator*) accelerator_void)->serialize(output);
+    });
+}
+
+}
+
+}
@@ -0,0 +1,21 @@
+#ifndef VG_IO_REGISTER_LOADER_SAVER_MEM_ACCELERATOR_HPP_INCLUDED
+#define VG_IO_REGISTER_LOADER_SAVER_MEM_ACCELERATOR_HPP_INCLUDED
+
+/**
+ * \file register_loader_saver_mem_accelerator.hpp
+ * Defines IO for a MEMAccelerator from stream files.
+ */
+
+namespace vg {
+
+namespace io {
+
+using namespace std;
+
+void register_loader_saver_mem_accelerator();
+
+}
+
+}
+
+#endif
@@ -5332,4 +5332,32 @@ multiset<double>::const_iterator FragmentLengthDistribution::measurements_begin(
 multiset<double>::const_iterator FragmentLengthDistribution::measurements_end() const {
     return lengths.end();
 }
+
+void FragmentLengthDistribution::save(ostream& out) const {
+    // Write enough digits that the parameters come back exactly
+    auto old_precision = out.precision(std::numeric_limits<double>::max_digits10);
+    out << "#mean\tstdev\tsamples" << endl;
+    out << mu << "\t" << sigma << "\t" << lengths.size() << endl;
+    out.precision(old_precision);
+}
+
+void FragmentLengthDistribution::load(istream& in) {
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            // Skip the header
+            continue;
+        }
+        stringstream fields(line);
+        double loaded_mean;
+        double loaded_stddev;
+        size_t loaded_samples;
+        if (!(fields >> loaded_mean >> loaded_stddev >> loaded_samples) || !(loaded_stddev > 0.0)) {
+            throw std::runtime_error("Invalid fragment length distribution: " + line);
+        }
+        force_parameters(loaded_mean, loaded_stddev);
+        return;
+    }
+    throw std::runtime_error("No fragment length distribution found in input");
+}
 }
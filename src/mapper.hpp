@@ -127,6 +127,15 @@ public:
     /// parameters
     multiset<double>::const_iterator measurements_end() const;
     
+    /// Write the current parameters, and the number of samples they were
+    /// estimated from, as a small TSV that can be loaded by a later run
+    void save(ostream& out) const;
+    
+    /// Read parameters written by save() and use them instead of estimating
+    /// anything, as in force_parameters(). Throws a std::runtime_error if the
+    /// input is not a valid saved distribution.
+    void load(istream& in);
+    
 private:
     multiset<double> lengths;
     bool is_fixed = false;
@@ -7,29 +7,44 @@
 #include "mem_accelerator.hpp"
 #include <sdsl/util.hpp>
 #include <cmath>
+#include <stdexcept>
+#include <omp.h>
 
 namespace vg {
 
-MEMAccelerator::MEMAccelerator(const gcsa::GCSA& gcsa_index, size_t k) : k(k)
-{
-    // compute the minimum width required to express the integers.
-    range_table.width(max<uint8_t>(sdsl::bits::length(gcsa_index.size()), 1));
-    // range table is initialized to size 2^(2k + 1) = 2 * 4^k
-    range_table.resize(1 << (2 * k + 1));
-    
-    const char alphabet[5] = "ACGT";
+const uint32_t MEMAccelerator::TAG = 0x4D454D41; // "AMEM" on disk
+const uint32_t MEMAccelerator::VERSION = 2;
+
+static const char alphabet[5] = "ACGT";
+
+// query LF with one character, normalizing empty ranges to an empty range
+// that will fit within any bit width
+static gcsa::range_type normalized_LF(const gcsa::GCSA& gcsa_index, const gcsa::range_type& range, int64_t next) {
+    if (gcsa::Range::empty(range)) {
+        return range;
+    }
+    gcsa::range_type extended = gcsa_index.LF(range, gcsa_index.alpha.char2comp[alphabet[next]]);
+    if (gcsa::Range::empty(extended)) {
+        extended.first = 1;
+        extended.second = 0;
+    }
+    return extended;
+}
+
+// fill in the ranges of all extensions of a range by length more characters,
+// indexed by their integer encoding with the first character queried in the
+// lowest bits
+static void memoize_extensions(const gcsa::GCSA& gcsa_index, const gcsa::range_type& start, size_t length,
+                               vector<gcsa::range_type>& ranges) {
     
     // records of (next char to query, k-mer integer encoding, range)
     vector<tuple<int64_t, int64_t, gcsa::range_type>> stack;
-    stack.emplace_back(0, 0, gcsa::range_type(0, gcsa_index.size() - 1));
+    stack.emplace_back(0, 0, start);
     
-    // TODO: multithread this? probably would do it single threaded
-    // to init 128 stacks or something similar
     while (!stack.empty()) {
-        if (stack.size() == k + 1) {
+        if (stack.size() == length + 1) {
             // we've walked the full k-mers
-            range_table[2 * get<1>(stack.back())] = get<2>(stack.back()).first;
-            range_table[2 * get<1>(stack.back()) + 1] = get<2>(stack.back()).second;
+            ranges[get<1>(stack.back())] = get<2>(stack.back());
             stack.pop_back();
         }
         else if (get<0>(stack.back()) == 4) {
@@ -41,22 +56,46 @@ MEMAccelerator::MEMAccelerator(const gcsa::GCSA& gcsa_index, size_t k) : k(k)
             auto next = get<0>(stack.back())++;
             auto enc = (next << (2 * (stack.size() - 1))) | get<1>(stack.back());
             
-            gcsa::range_type range;
-            if (!gcsa::Range::empty(get<2>(stack.back()))) {
-                range = gcsa_index.LF(get<2>(stack.back()),
-                                      gcsa_index.alpha.char2comp[alphabet[next]]);
-                if (gcsa::Range::empty(range)) {
-                    // we normalize empty ranges to an empty range that will
-                    // fit within any bit width
-                    range.first = 1;
-                    range.second = 0;
-                }
-            }
-            else {
-                range = get<2>(stack.back());
+            stack.emplace_back(0, enc, normalized_LF(gcsa_index, get<2>(stack.back()), next));
+        }
+    }
+}
+
+MEMAccelerator::MEMAccelerator(const gcsa::GCSA& gcsa_index, size_t k, size_t threads) : k(k),
+    gcsa_size(gcsa_index.size()), gcsa_order(gcsa_index.order())
+{
+    // compute the minimum width required to express the integers.
+    range_table.width(max<uint8_t>(sdsl::bits::length(gcsa_index.size()), 1));
+    // range table is initialized to size 2^(2k + 1) = 2 * 4^k
+    range_table.resize((size_t) 1 << (2 * k + 1));
+    
+    // split the k-mers into jobs by the first characters we query (which are
+    // the last characters of the k-mer), leaving the rest small enough that
+    // each thread's buffer of ranges stays modest
+    size_t prefix_length = k <= 4 ? k : max<size_t>(4, k - 10);
+    size_t suffix_length = k - prefix_length;
+    int64_t num_prefixes = (int64_t) 1 << (2 * prefix_length);
+    
+#pragma omp parallel for schedule(dynamic, 1) num_threads(max<size_t>(threads, 1))
+    for (int64_t prefix = 0; prefix < num_prefixes; ++prefix) {
+        
+        gcsa::range_type range(0, gcsa_index.size() - 1);
+        for (size_t i = 0; i < prefix_length; ++i) {
+            range = normalized_LF(gcsa_index, range, (prefix >> (2 * i)) & 3);
+        }
+        
+        vector<gcsa::range_type> ranges((size_t) 1 << (2 * suffix_length), range);
+        memoize_extensions(gcsa_index, range, suffix_length, ranges);
+        
+        // the k-mers for a prefix are interleaved with the other prefixes'
+        // in the packed table, so threads can't write to it at the same time
+#pragma omp critical (range_table)
+        {
+            for (size_t suffix = 0; suffix < ranges.size(); ++suffix) {
+                int64_t enc = ((int64_t) suffix << (2 * prefix_length)) | prefix;
+                range_table[2 * enc] = ranges[suffix].first;
+                range_table[2 * enc + 1] = ranges[suffix].second;
             }
-            
-            stack.emplace_back(0, enc, range);
         }
     }
 }
@@ -70,4 +109,33 @@ gcsa::range_type MEMAccelerator::memoized_LF(string::const_iterator last) const
     return gcsa::range_type(range_table[enc << 1], range_table[(enc << 1) | 1]);
 }
 
+void MEMAccelerator::serialize(ostream& out) const {
+    out.write((const char*) &TAG, sizeof(TAG));
+    out.write((const char*) &VERSION, sizeof(VERSION));
+    out.write((const char*) &k, sizeof(k));
+    out.write((const char*) &gcsa_size, sizeof(gcsa_size));
+    out.write((const char*) &gcsa_order, sizeof(gcsa_order));
+    range_table.serialize(out);
+}
+
+void MEMAccelerator::load(istream& in) {
+    uint32_t tag = 0;
+    uint32_t version = 0;
+    in.read((char*) &tag, sizeof(tag));
+    in.read((char*) &version, sizeof(version));
+    if (!in || tag != TAG) {
+        throw runtime_error("error:[MEMAccelerator] input is not a MEMAccelerator");
+    }
+    if (version != VERSION) {
+        throw runtime_error("error:[MEMAccelerator] cannot load MEMAccelerator version " + to_string(version));
+    }
+    in.read((char*) &k, sizeof(k));
+    in.read((char*) &gcsa_size, sizeof(gcsa_size));
+    in.read((char*) &gcsa_order, sizeof(gcsa_order));
+    range_table.load(in);
+    if (!in || range_table.size() != ((size_t) 1 << (2 * k + 1))) {
+        throw runtime_error("error:[MEMAccelerator] MEMAccelerator table is truncated");
+    }
+}
+
 }
@@ -8,6 +8,7 @@
 #define VG_MEM_ACCELERATOR_HPP_INCLUDED
 
 #include <cstdint>
+#include <iostream>
 #include <string>
 #include <gcsa/gcsa.h>
 #include <sdsl/int_vector.hpp>
@@ -24,11 +25,16 @@ class MEMAccelerator {
 public:
     
     MEMAccelerator() = default;
-    MEMAccelerator(const gcsa::GCSA& gcsa_index, size_t k);
+    // memoize all k-mers, splitting the work among the given number of threads
+    MEMAccelerator(const gcsa::GCSA& gcsa_index, size_t k, size_t threads = 1);
     
     // return the length of k-mers that are memoized
     inline int64_t length() const;
     
+    // check whether the table was memoized from this GCSA, as far as we can
+    // tell from its size and order
+    inline bool built_from(const gcsa::GCSA& gcsa_index) const;
+    
     // look up the GCSA range that corresponds to a k-length
     // string ending at the indicated position. client code
     // is responsible for ensuring that the string being
@@ -36,14 +42,29 @@ public:
     // characters
     gcsa::range_type memoized_LF(string::const_iterator last) const;
     
+    // write the table to a stream, starting with TAG
+    void serialize(ostream& out) const;
+    
+    // replace the contents with a table from a stream written by serialize,
+    // throwing a runtime_error if it isn't one
+    void load(istream& in);
+    
+    // identifies a serialized MEMAccelerator
+    static const uint32_t TAG;
+    // the serialization format version we write
+    static const uint32_t VERSION;
+    
 private:
     
     inline int64_t encode(char c) const;
     
     // the size k-mer we'll index
-    const int64_t k = 1;
+    int64_t k = 1;
     // the actual table
     sdsl::int_vector<> range_table;
+    // the size and order of the GCSA the table was memoized from
+    uint64_t gcsa_size = 0;
+    uint64_t gcsa_order = 0;
     
 };
 
@@ -51,6 +72,10 @@ inline int64_t MEMAccelerator::length() const {
     return k;
 }
 
+inline bool MEMAccelerator::built_from(const gcsa::GCSA& gcsa_index) const {
+    return gcsa_size == gcsa_index.size() && gcsa_order == gcsa_index.order();
+}
+
 inline int64_t MEMAccelerator::encode(char c) const {
     switch (c) {
         case 'A':
@@ -53,7 +53,8 @@ MinimizerMapper::MinimizerMapper(const gbwtgraph::GBWTGraph& graph,
     clusterer(distance_index, &graph),
     gbwt_graph(graph),
     extender(new GaplessExtender(gbwt_graph, *(get_regular_aligner()))),
-    fragment_length_distr(1000,1000,0.95) {
+    fragment_length_distr(1000,1000,0.95),
+    rescue_subgraph_caches(omp_get_max_threads()) {
     
     // The GBWTGraph needs a GBWT
     crash_unless(graph.index != nullptr);
@@ -588,6 +589,9 @@ vector<Alignment> MinimizerMapper::map_from_extensions(Alignment& aln) {
     LazyRNG rng([&]() {
         return aln.sequence();
     });
+    
+    // Remember snarl tree distances we look up for this read while clustering
+    DistanceCache distance_cache;
 
     // Minimizers sorted by position
     std::vector<Minimizer> minimizers_in_read = this->find_minimizers(aln.sequence(), funnel);
@@ -605,7 +609,7 @@ vector<Alignment> MinimizerMapper::map_from_extensions(Alignment& aln) {
     }
 
     // Find the clusters
-    std::vector<Cluster> clusters = clusterer.cluster_seeds(seeds, get_distance_limit(aln.sequence().size()));
+    std::vector<Cluster> clusters = clusterer.cluster_seeds(seeds, get_distance_limit(aln.sequence().size()), &distance_cache);
     
 #ifdef debug_validate_clusters
     vector<vector<Cluster>> all_clusters;
@@ -1101,8 +1105,17 @@ vector<Alignment> MinimizerMapper::map_from_extensions(Alignment& aln) {
         out.set_is_secondary(i > 0);
     }
     
+    if (track_provenance) {
+        // Report how well remembering distances worked
+        funnel.count("distance_cache_hits", distance_cache.hits());
+        funnel.count("distance_cache_misses", distance_cache.misses());
+    }
+    
     // Stop this alignment
     funnel.stop();
+    if (stage_profile) {
+        stage_profile->add(funnel);
+    }
     
     // Annotate with whatever's in the funnel
     funnel.annotate_mapped_alignment(mappings[0], track_correctness);
@@ -2128,6 +2141,9 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
 
                     // Stop this alignment
                     funnels[r].stop();
+                    if (stage_profile) {
+                        stage_profile->add(funnels[r]);
+                    }
                 
                     // Annotate with whatever's in the funnel
                     funnels[r].annotate_mapped_alignment(paired_mappings[r].back(), track_correctness);
@@ -2606,6 +2622,9 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
         }
         // Stop this alignment
         funnels[r].stop();
+        if (stage_profile) {
+            stage_profile->add(funnels[r]);
+        }
     }
     
     for (auto r : {0, 1}) {
@@ -3038,30 +3057,20 @@ void MinimizerMapper::attempt_rescue(const Alignment& aligned_read, Alignment& r
     }
 
     // Find all nodes within a reasonable range from aligned_read.
-    std::unordered_set<id_t> rescue_nodes;
     int64_t min_distance = max(0.0, fragment_length_distr.mean() - rescued_alignment.sequence().size() - rescue_subgraph_stdevs * fragment_length_distr.std_dev());
     int64_t max_distance = fragment_length_distr.mean() + rescue_subgraph_stdevs * fragment_length_distr.std_dev();
 
-    subgraph_in_distance_range(*distance_index, aligned_read.path(), &cached_graph, min_distance, max_distance, rescue_nodes, rescue_forward);
-
-    if (rescue_nodes.size() == 0) {
+    // Mates of nearby pairs rescue into the same regions, so the subgraph may
+    // be cached. If we need to change it, we work on our own copy.
+    RescueSubgraph uncached;
+    RescueSubgraph* subgraph = &this->get_rescue_subgraph(aligned_read, cached_graph, min_distance, max_distance, rescue_forward, uncached);
+    if (subgraph->nodes.empty()) {
         //If the rescue subgraph is empty
         return;
     }
-    
-    // Remove node ids that do not exist in the GBWTGraph from the subgraph.
-    // We may be using the distance index of the original graph, and nodes
-    // not visited by any thread are missing from the GBWTGraph.
-    for (auto iter = rescue_nodes.begin(); iter != rescue_nodes.end(); ) {
-        if (!cached_graph.has_node(*iter)) {
-            iter = rescue_nodes.erase(iter);
-        } else {
-            ++iter;
-        }
-    }
 
     // Find all seeds in the subgraph and try to get a full-length extension.
-    GaplessExtender::cluster_type seeds = this->seeds_in_subgraph(minimizers, rescue_nodes);
+    GaplessExtender::cluster_type seeds = this->seeds_in_subgraph(minimizers, subgraph->nodes);
     if (seeds.size() > this->rescue_seed_limit) {
         return;
     }
@@ -3087,7 +3096,15 @@ void MinimizerMapper::attempt_rescue(const Alignment& aligned_read, Alignment& r
     if (best < extensions.size()) {
         const GaplessExtension& extension = extensions[best];
         for (handle_t handle : extension.path) {
-            rescue_nodes.insert(cached_graph.get_id(handle));
+            nid_t node_id = cached_graph.get_id(handle);
+            if (!subgraph->nodes.count(node_id)) {
+                if (subgraph != &uncached) {
+                    uncached.nodes = subgraph->nodes;
+                    subgraph = &uncached;
+                }
+                uncached.nodes.insert(node_id);
+                uncached.has_order = false;
+            }
         }
         dozeu_seed.emplace_back();
         dozeu_seed.back().begin = rescued_alignment.sequence().begin() + extension.read_interval.first;
@@ -3099,7 +3116,13 @@ void MinimizerMapper::attempt_rescue(const Alignment& aligned_read, Alignment& r
     }
 
     // GSSW and dozeu assume that the graph is a DAG.
-    std::vector<handle_t> topological_order = gbwtgraph::topological_order(cached_graph, rescue_nodes);
+    // Handles in a CachedGBWTGraph are those of the underlying GBWTGraph, so
+    // an order we saved from an earlier rescue is still good.
+    if (!subgraph->has_order) {
+        subgraph->order = gbwtgraph::topological_order(cached_graph, subgraph->nodes);
+        subgraph->has_order = true;
+    }
+    const std::vector<handle_t>& topological_order = subgraph->order;
     if (!topological_order.empty()) {
         
         size_t rescue_subgraph_bases = 0;
@@ -3131,7 +3154,7 @@ void MinimizerMapper::attempt_rescue(const Alignment& aligned_read, Alignment& r
 
     // Build a subgraph overlay.
     SubHandleGraph sub_graph(&cached_graph);
-    for (id_t id : rescue_nodes) {
+    for (id_t id : subgraph->nodes) {
         sub_graph.add_handle(cached_graph.get_handle(id));
     }
 
@@ -3184,6 +3207,56 @@ void MinimizerMapper::attempt_rescue(const Alignment& aligned_read, Alignment& r
     }
 }
 
+MinimizerMapper::RescueSubgraph& MinimizerMapper::get_rescue_subgraph(const Alignment& aligned_read, const HandleGraph& graph,
+                                                                      int64_t min_distance, int64_t max_distance, bool rescue_forward,
+                                                                      RescueSubgraph& uncached) {
+
+    // The distance search starts from one end of the aligned read.
+    pos_t start_pos = rescue_forward ? initial_position(aligned_read.path()) : final_position(aligned_read.path());
+    rescue_subgraph_key_t key(id(start_pos), is_rev(start_pos), offset(start_pos), rescue_forward, min_distance, max_distance);
+
+    size_t thread_num = omp_get_thread_num();
+    RescueSubgraphCache* cache = nullptr;
+    if (this->rescue_subgraph_cache_size > 0 && thread_num < this->rescue_subgraph_caches.size()) {
+        cache = &this->rescue_subgraph_caches[thread_num];
+        auto found = cache->index.find(key);
+        if (found != cache->index.end()) {
+            // Move it to the front, as the most recently used.
+            cache->entries.splice(cache->entries.begin(), cache->entries, found->second);
+            this->rescue_subgraph_cache_hits++;
+            return found->second->second;
+        }
+    }
+    this->rescue_subgraph_cache_misses++;
+
+    RescueSubgraph* result = &uncached;
+    if (cache != nullptr) {
+        // Make room and put a new entry at the front.
+        while (cache->entries.size() >= this->rescue_subgraph_cache_size) {
+            cache->index.erase(cache->entries.back().first);
+            cache->entries.pop_back();
+        }
+        cache->entries.emplace_front(key, RescueSubgraph());
+        cache->index[key] = cache->entries.begin();
+        result = &cache->entries.front().second;
+    }
+
+    subgraph_in_distance_range(*distance_index, aligned_read.path(), &graph, min_distance, max_distance, result->nodes, rescue_forward);
+
+    // Remove node ids that do not exist in the GBWTGraph from the subgraph.
+    // We may be using the distance index of the original graph, and nodes
+    // not visited by any thread are missing from the GBWTGraph.
+    for (auto iter = result->nodes.begin(); iter != result->nodes.end(); ) {
+        if (!graph.has_node(*iter)) {
+            iter = result->nodes.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+
+    return *result;
+}
+
 GaplessExtender::cluster_type MinimizerMapper::seeds_in_subgraph(const VectorView<Minimizer>& minimizers,
                                                                  const std::unordered_set<id_t>& subgraph) const {
     std::vector<id_t> sorted_ids(subgraph.begin(), subgraph.end());
@@ -3308,6 +3381,21 @@ void MinimizerMapper::extension_to_alignment(const GaplessExtension& extension,
 
 //-----------------------------------------------------------------------------
 
+void MinimizerMapper::prefetch_occurrences(const Minimizer& minimizer) const {
+    if (minimizer.hits == 0 || minimizer.hits > this->hard_hit_cap) {
+        // We will never look at these occurrences.
+        return;
+    }
+    // Only fetch the start of long occurrence lists; the hardware prefetcher
+    // picks up sequential reads after that.
+    const char* start = reinterpret_cast<const char*>(minimizer.occs);
+    const char* end = reinterpret_cast<const char*>(minimizer.occs + minimizer.hits);
+    end = std::min(end, start + MAX_PREFETCH_CACHE_LINES * CACHE_LINE_SIZE);
+    for (const char* line = start; line < end; line += CACHE_LINE_SIZE) {
+        __builtin_prefetch(line, 0, 1);
+    }
+}
+
 std::vector<MinimizerMapper::Minimizer> MinimizerMapper::find_minimizers(const std::string& sequence, Funnel& funnel) const {
 
     if (this->track_provenance) {
@@ -3321,6 +3409,7 @@ std::vector<MinimizerMapper::Minimizer> MinimizerMapper::find_minimizers(const s
     // Starts and lengths are all 0 if we are using syncmers.
     vector<tuple<gbwtgraph::DefaultMinimizerIndex::minimizer_type, size_t, size_t>> minimizers =
         this->minimizer_index.minimizer_regions(sequence);
+    result.reserve(minimizers.size());
     for (auto& m : minimizers) {
         double score = 0.0;
         auto hits = this->minimizer_index.find(get<0>(m));
@@ -3350,6 +3439,10 @@ std::vector<MinimizerMapper::Minimizer> MinimizerMapper::find_minimizers(const s
         
         result.push_back({ value, agglomeration_start, agglomeration_length, hits.second, hits.first,
                             match_length, candidate_count, score });
+        
+        // Start bringing in the occurrences while we probe the index for the
+        // rest of the minimizers, so they are in cache when we make seeds.
+        prefetch_occurrences(result.back());
     }
     
     if (this->track_provenance) {
@@ -3484,6 +3577,13 @@ std::vector<MinimizerMapper::Seed> MinimizerMapper::find_seeds(const VectorView<
     );
      
     
+    // Prefetch the occurrences of the first few minimizers in score order.
+    // For short reads find_minimizers() already did this, but long reads have
+    // too many minimizers for those to still be in cache.
+    for (size_t i = 0; i < minimizers.size() && i < SEED_PREFETCH_DISTANCE; i++) {
+        prefetch_occurrences(minimizers[i]);
+    }
+
     // Flag whether each minimizer in the read was located or not, for MAPQ capping.
     // We ignore minimizers with no hits (count them as not located), because
     // they would have to be created in the read no matter where we say it came
@@ -3495,6 +3595,11 @@ std::vector<MinimizerMapper::Seed> MinimizerMapper::find_seeds(const VectorView<
             // Say we're working on it
             funnel.processing_input(i);
         }
+        
+        if (i + SEED_PREFETCH_DISTANCE < minimizers.size()) {
+            // Keep the prefetches running ahead of where we decode hits
+            prefetch_occurrences(minimizers[i + SEED_PREFETCH_DISTANCE]);
+        }
 
         // Find the next run of identical minimizers.
         if (i >= limit) {
@@ -21,6 +21,7 @@
 #include <structures/immutable_list.hpp>
 
 #include <atomic>
+#include <list>
 
 namespace vg {
 
@@ -334,6 +335,11 @@ public:
     /// For paired end mapping, how many times should we attempt rescue (per read)?
     static constexpr size_t default_max_rescue_attempts = 15;
     size_t max_rescue_attempts = default_max_rescue_attempts;
+
+    /// How many rescue subgraphs should each thread remember for reuse by
+    /// later rescues into the same region? 0 disables the cache.
+    static constexpr size_t default_rescue_subgraph_cache_size = 256;
+    size_t rescue_subgraph_cache_size = default_rescue_subgraph_cache_size;
     
     /// How big of an alignment in POA cells should we ever try to do with Dozeu?
     /// TODO: Lift this when Dozeu's allocator is able to work with >4 MB of memory.
@@ -353,6 +359,10 @@ public:
     /// The algorithm used for rescue.
     RescueAlgorithm rescue_algorithm = rescue_dozeu;
     
+    /// If set, add the stage profile of each read's funnel to this summary.
+    /// Only has stages to add when tracking provenance.
+    FunnelProfileSummary* stage_profile = nullptr;
+    
     /// Apply this sample name
     string sample_name;
     /// Apply this read group name
@@ -361,6 +371,11 @@ public:
     /// Have we complained about hitting the size limit for rescue?
     atomic_flag warned_about_rescue_size = ATOMIC_FLAG_INIT;
     
+    /// How many rescues found their subgraph in the cache?
+    atomic<size_t> rescue_subgraph_cache_hits{0};
+    /// How many rescues had to extract their subgraph?
+    atomic<size_t> rescue_subgraph_cache_misses{0};
+    
     /// Have we complained about hitting the size limit for tails?
     mutable atomic_flag warned_about_tail_size = ATOMIC_FLAG_INIT;
 
@@ -376,6 +391,11 @@ public:
     double get_fragment_length_mean() const { return fragment_length_distr.mean(); }
     double get_fragment_length_stdev() const {return fragment_length_distr.std_dev(); }
     size_t get_fragment_length_sample_size() const { return fragment_length_distr.curr_sample_size(); }
+    const FragmentLengthDistribution& get_fragment_length_distr() const { return fragment_length_distr; }
+    /// Use the distribution saved by FragmentLengthDistribution::save() instead of estimating it
+    void load_fragment_length_distr(istream& in) {
+        fragment_length_distr.load(in);
+    }
 
     /**
      * Get the distance limit for the given read length
@@ -493,9 +513,27 @@ protected:
 
     // Stages of mapping.
 
+    /// How many minimizers ahead of the one being located should find_seeds()
+    /// prefetch occurrences for?
+    static constexpr size_t SEED_PREFETCH_DISTANCE = 8;
+    /// How big do we assume a cache line is?
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    /// How many cache lines of a minimizer's occurrences should we prefetch at most?
+    static constexpr size_t MAX_PREFETCH_CACHE_LINES = 4;
+
+    /**
+     * Issue software prefetches for the occurrences of the given minimizer in
+     * the minimizer index, if we might locate them. Does not change any
+     * results.
+     */
+    void prefetch_occurrences(const Minimizer& minimizer) const;
+
     /**
      * Find the minimizers in the sequence using the minimizer index, and
      * return them sorted in read order.
+     *
+     * All the minimizers in the read are looked up in one batch, and the
+     * occurrences of each are prefetched as soon as we know where they are.
      */
     std::vector<Minimizer> find_minimizers(const std::string& sequence, Funnel& funnel) const;
     
@@ -602,8 +640,12 @@ protected:
      * Operating on the given input alignment, align the tails and intervening
      * sequences along the given chain of perfect-match seeds, and return an
      * optimal Alignment.
+     *
+     * If a DistanceCache is given, graph distances between chain items are
+     * looked up in it.
      */
-    Alignment find_chain_alignment(const Alignment& aln, const VectorView<algorithms::Anchor>& to_chain, const std::vector<size_t>& chain) const;
+    Alignment find_chain_alignment(const Alignment& aln, const VectorView<algorithms::Anchor>& to_chain, const std::vector<size_t>& chain,
+                                   DistanceCache* distance_cache = nullptr) const;
      
      /**
      * Operating on the given input alignment, align the tails dangling off the
@@ -629,6 +671,42 @@ protected:
      */
     void attempt_rescue(const Alignment& aligned_read, Alignment& rescued_alignment, const VectorView<Minimizer>& minimizers, bool rescue_forward);
 
+    /**
+     * A subgraph extracted for rescue. Holds the nodes within the distance
+     * range that exist in the GBWTGraph, and their topological order once it
+     * has been computed (empty if they do not form a DAG).
+     */
+    struct RescueSubgraph {
+        std::unordered_set<nid_t> nodes;
+        bool has_order = false;
+        std::vector<handle_t> order;
+    };
+
+    /// Rescue subgraphs are determined by the position the distance search
+    /// starts from (node, orientation, offset), the search direction, and the
+    /// distance range.
+    typedef std::tuple<nid_t, bool, size_t, bool, int64_t, int64_t> rescue_subgraph_key_t;
+
+    /// Least-recently-used cache of rescue subgraphs, used by a single thread.
+    struct RescueSubgraphCache {
+        std::list<std::pair<rescue_subgraph_key_t, RescueSubgraph>> entries;
+        std::unordered_map<rescue_subgraph_key_t, std::list<std::pair<rescue_subgraph_key_t, RescueSubgraph>>::iterator> index;
+    };
+
+    /// Rescue subgraph caches, one per OpenMP thread.
+    std::vector<RescueSubgraphCache> rescue_subgraph_caches;
+
+    /**
+     * Get the subgraph to rescue into from the given aligned read, from the
+     * calling thread's cache if possible. Otherwise extract it, and store it
+     * in the cache or, if there is no cache for this thread, in the given
+     * uncached subgraph. The result is valid until the next call on the same
+     * thread.
+     */
+    RescueSubgraph& get_rescue_subgraph(const Alignment& aligned_read, const HandleGraph& graph,
+                                        int64_t min_distance, int64_t max_distance, bool rescue_forward,
+                                        RescueSubgraph& uncached);
+
     /**
      * Return the all non-redundant seeds in the subgraph, including those from
      * minimizers not used for mapping.
@@ -277,6 +277,11 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
     LazyRNG rng([&]() {
         return aln.sequence();
     });
+    
+    // Remember graph distances we look up for this read, since clustering,
+    // chaining and then aligning the chains ask about a lot of the same pairs
+    // of positions and snarl tree nodes.
+    DistanceCache distance_cache;
 
 
     // Minimizers sorted by position
@@ -299,7 +304,7 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
     }
 
     // Find the clusters up to a flat distance limit
-    std::vector<Cluster> preclusters = clusterer.cluster_seeds(seeds, chaining_cluster_distance);
+    std::vector<Cluster> preclusters = clusterer.cluster_seeds(seeds, chaining_cluster_distance, &distance_cache);
     
     if (track_provenance) {
         funnel.substage("score-preclusters");
@@ -592,7 +597,7 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
         funnel.stage("cluster");
     }
     
-    std::vector<Cluster> clusters = clusterer.cluster_seeds(seeds, chaining_cluster_distance);
+    std::vector<Cluster> clusters = clusterer.cluster_seeds(seeds, chaining_cluster_distance, &distance_cache);
     
     // Determine the scores and read coverages for each cluster.
     // Also find the best and second-best cluster scores.
@@ -790,7 +795,8 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
                                                                lookback_scale_factor,
                                                                min_good_transition_score_per_base,
                                                                item_bonus,
-                                                               max_indel_bases);
+                                                               max_indel_bases,
+                                                               &distance_cache);
             if (show_work && !candidate_chain.second.empty()) {
                 #pragma omp critical (cerr)
                 {
@@ -986,7 +992,7 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
                 vector<size_t>& chain = score_and_chain.second;
                 
                 // Do the DP between the items in the cluster as specified by the chain we got for it. 
-                best_alignments[0] = find_chain_alignment(aln, {seed_anchors, eligible_seeds}, chain);
+                best_alignments[0] = find_chain_alignment(aln, {seed_anchors, eligible_seeds}, chain, &distance_cache);
                     
                 // TODO: Come up with a good secondary for the cluster somehow.
             } else {
@@ -1184,8 +1190,17 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
         out.set_is_secondary(i > 0);
     }
     
+    if (track_provenance) {
+        // Report how well remembering distances worked
+        funnel.count("distance_cache_hits", distance_cache.hits());
+        funnel.count("distance_cache_misses", distance_cache.misses());
+    }
+    
     // Stop this alignment
     funnel.stop();
+    if (stage_profile) {
+        stage_profile->add(funnel);
+    }
     
     // Annotate with whatever's in the funnel
     funnel.annotate_mapped_alignment(mappings[0], track_correctness);
@@ -1283,7 +1298,8 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
 Alignment MinimizerMapper::find_chain_alignment(
     const Alignment& aln,
     const VectorView<algorithms::Anchor>& to_chain,
-    const std::vector<size_t>& chain) const {
+    const std::vector<size_t>& chain,
+    DistanceCache* distance_cache) const {
     
     if (chain.empty()) {
         throw std::logic_error("Cannot find an alignment for an empty chain!");
@@ -1500,7 +1516,7 @@ Alignment MinimizerMapper::find_chain_alignment(
         size_t link_start = (*here).read_end();
         size_t link_length = (*next).read_start() - link_start;
         string linking_bases = aln.sequence().substr(link_start, link_length);
-        size_t graph_length = algorithms::get_graph_distance(*here, *next, *distance_index, gbwt_graph);
+        size_t graph_length = algorithms::get_graph_distance(*here, *next, *distance_index, gbwt_graph, distance_cache);
         
 #ifdef debug_chaining
         if (show_work) {
@@ -13,12 +13,13 @@ namespace vg {
 using namespace std;
 
 MultipathAlignmentEmitter::MultipathAlignmentEmitter(const string& filename, size_t num_threads, const string out_format,
-                                                     const PathPositionHandleGraph* graph, const vector<pair<string, int64_t>>* path_order_and_length) :
+                                                     const PathPositionHandleGraph* graph, const vector<pair<string, int64_t>>* path_order_and_length,
+                                                     const HTSOutputOptions& options) :
     HTSWriter(filename,
               out_format == "SAM" || out_format == "BAM" || out_format == "CRAM" ? out_format : "SAM", // just so the assert passes
               path_order_and_length ? *path_order_and_length : vector<pair<string, int64_t>>(),
               {},
-              num_threads),
+              num_threads, options),
     graph(graph)
 {
 
@@ -128,6 +128,9 @@ void Packer::clear() {
     node_quality_locks = nullptr;
     delete [] tmpfstream_locks;
     tmpfstream_locks = nullptr;
+    thread_buffer_size = 0;
+    base_buffers.clear();
+    edge_buffers.clear();
     close_edit_tmpfiles();
     remove_edit_tmpfiles();
     for (auto& lru_cache : quality_cache) {
@@ -253,6 +256,9 @@ void Packer::write_edits(ostream& out, size_t bin) const {
 void Packer::collect_coverage(const vector<Packer*>& packers) {
     // assume the same basis vector
     assert(!is_compacted);
+    for (Packer* packer : packers) {
+        packer->flush_thread_buffers();
+    }
     if (record_bases) {
 #pragma omp parallel for
         for (size_t i = 0; i < coverage_dynamic.size(); ++i) {
@@ -327,6 +333,8 @@ void Packer::make_compact(void) {
         cerr << "Need to make packer compact" << endl;
 #endif
     }
+    // apply anything still sitting in the thread buffers
+    flush_thread_buffers();
     // sync edit file
     close_edit_tmpfiles();
     
@@ -738,7 +746,90 @@ void Packer::init_node_quality_bin(size_t i) {
     }
 }
 
+void Packer::set_thread_buffer_size(size_t buffer_size) {
+    flush_thread_buffers();
+    thread_buffer_size = buffer_size;
+    base_buffers.clear();
+    edge_buffers.clear();
+    if (thread_buffer_size > 0) {
+        base_buffers.resize(get_thread_count());
+        edge_buffers.resize(get_thread_count());
+        for (size_t i = 0; i < base_buffers.size(); ++i) {
+            base_buffers[i].reserve(thread_buffer_size);
+            edge_buffers[i].reserve(thread_buffer_size);
+        }
+    }
+}
+
+void Packer::flush_thread_buffers() {
+#pragma omp parallel for
+    for (size_t i = 0; i < base_buffers.size(); ++i) {
+        flush_coverage_buffer(base_buffers[i]);
+        flush_edge_coverage_buffer(edge_buffers[i]);
+    }
+}
+
+void Packer::flush_coverage_buffer(vector<size_t>& buffer) {
+    // sort so that we take each bin's lock once and add up repeated positions
+    std::sort(buffer.begin(), buffer.end());
+    size_t j = 0;
+    while (j < buffer.size()) {
+        size_t bin = coverage_bin_offset(buffer[j]).first;
+        std::lock_guard<std::mutex> guard(base_locks[bin]);
+        init_coverage_bin(bin);
+        gcsa::CounterArray& counter = *coverage_dynamic[bin];
+        while (j < buffer.size()) {
+            pair<size_t, size_t> bin_offset = coverage_bin_offset(buffer[j]);
+            if (bin_offset.first != bin) {
+                break;
+            }
+            size_t k = j + 1;
+            while (k < buffer.size() && buffer[k] == buffer[j]) {
+                ++k;
+            }
+            counter.increment(bin_offset.second, k - j);
+            j = k;
+        }
+    }
+    buffer.clear();
+}
+
+void Packer::flush_edge_coverage_buffer(vector<size_t>& buffer) {
+    std::sort(buffer.begin(), buffer.end());
+    size_t j = 0;
+    while (j < buffer.size()) {
+        size_t bin = edge_coverage_bin_offset(buffer[j]).first;
+        std::lock_guard<std::mutex> guard(edge_locks[bin]);
+        init_edge_coverage_bin(bin);
+        gcsa::CounterArray& counter = *edge_coverage_dynamic[bin];
+        while (j < buffer.size()) {
+            pair<size_t, size_t> bin_offset = edge_coverage_bin_offset(buffer[j]);
+            if (bin_offset.first != bin) {
+                break;
+            }
+            size_t k = j + 1;
+            while (k < buffer.size() && buffer[k] == buffer[j]) {
+                ++k;
+            }
+            counter.increment(bin_offset.second, k - j);
+            j = k;
+        }
+    }
+    buffer.clear();
+}
+
 void Packer::increment_coverage(size_t i) {
+    if (thread_buffer_size > 0) {
+        size_t thread_num = omp_get_thread_num();
+        if (thread_num < base_buffers.size()) {
+            vector<size_t>& buffer = base_buffers[thread_num];
+            buffer.push_back(i);
+            if (buffer.size() >= thread_buffer_size) {
+                flush_coverage_buffer(buffer);
+            }
+            return;
+        }
+    }
     pair<size_t, size_t> bin_offset = coverage_bin_offset(i);
     std::lock_guard<std::mutex> guard(base_locks[bin_offset.first]);
     init_coverage_bin(bin_offset.first);
@@ -755,6 +846,17 @@ void Packer::increment_coverage(size_t i, size_t v) {
 }
 
 void Packer::increment_edge_coverage(size_t i) {
+    if (thread_buffer_size > 0) {
+        size_t thread_num = omp_get_thread_num();
+        if (thread_num < edge_buffers.size()) {
+            vector<size_t>& buffer = edge_buffers[thread_num];
+            buffer.push_back(i);
+            if (buffer.size() >= thread_buffer_size) {
+                flush_edge_coverage_buffer(buffer);
+            }
+            return;
+        }
+    }
     pair<size_t, size_t> bin_offset = edge_coverage_bin_offset(i);
     std::lock_guard<std::mutex> guard(edge_locks[bin_offset.first]);
     init_edge_coverage_bin(bin_offset.first);
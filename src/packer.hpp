@@ -112,6 +112,15 @@ public:
     void increment_node_quality(size_t i, size_t v);
     /// return true if there's at least one nonzero quality in the structure
     bool has_qualities() const;
+
+    /// Buffer up to this many single base and edge increments per thread before
+    /// applying them, sorted and coalesced, under the bin locks.  This keeps
+    /// threads from fighting over the locks of high-depth bins.  0 (the default)
+    /// applies every increment immediately.
+    void set_thread_buffer_size(size_t buffer_size);
+    /// Apply all buffered increments.  Buffered coverage is not visible to the
+    /// dynamic accessors until this (or make_compact()) is called.
+    void flush_thread_buffers();
     
 private:
     /// map from absolute postion to positions in the binned arrays
@@ -126,6 +135,9 @@ private:
     void init_coverage_bin(size_t i);
     void init_edge_coverage_bin(size_t i);
     void init_node_quality_bin(size_t i);
+    /// apply and empty a thread's buffer of pending increments
+    void flush_coverage_buffer(vector<size_t>& buffer);
+    void flush_edge_coverage_buffer(vector<size_t>& buffer);
     
     void ensure_edit_tmpfiles_open(void);
     void close_edit_tmpfiles(void);
@@ -164,6 +176,11 @@ private:
     size_t num_nodes_dynamic;
     // one mutex per element of node_quality_dynamic
     std::mutex* node_quality_locks;
+
+    // pending single increments of base and edge coverage (one buffer per thread)
+    size_t thread_buffer_size = 0;
+    vector<vector<size_t>> base_buffers;
+    vector<vector<size_t>> edge_buffers;
     
     vector<string> edit_tmpfile_names;
     vector<ofstream*> tmpfstreams;
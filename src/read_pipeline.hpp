@@ -0,0 +1,309 @@
+#ifndef VG_READ_PIPELINE_HPP_INCLUDED
+#define VG_READ_PIPELINE_HPP_INCLUDED
+
+/**
+ * \file read_pipeline.hpp
+ * Defines a pipeline that parses, maps, and emits batches of reads in
+ * separate stages connected by lock-free queues.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <omp.h>
+#include <atomic_queue.h>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * Runs batches through three stages. One thread parses batches from the
+ * input, OpenMP threads map them, and OpenMP thread 0 emits the results.
+ * The stages are connected by bounded lock-free queues, so mapping threads
+ * don't stop to parse input or wait on output. A stage that runs out of work,
+ * or room to put its results, sleeps until another stage wakes it.
+ *
+ * Emitting happens on OpenMP thread 0 because alignment emitters keep
+ * per-thread state by OpenMP thread number. If there is only one thread, or
+ * emit_separately is false, each mapping thread emits its own batches
+ * instead.
+ *
+ * Each stage counts the batches it handled, the time it spent working, and
+ * the time it spent stalled waiting on the other stages.
+ */
+template<typename Batch>
+class ReadPipeline {
+public:
+
+    /// Counters for the work done by a stage
+    struct StageStats {
+        atomic<size_t> batches{0};
+        atomic<size_t> busy_nanoseconds{0};
+        atomic<size_t> stalled_nanoseconds{0};
+
+        double busy_seconds() const { return busy_nanoseconds / 1E9; }
+        double stalled_seconds() const { return stalled_nanoseconds / 1E9; }
+    };
+
+    /**
+     * Make a pipeline that maps with the given number of OpenMP threads, and
+     * holds up to queue_batches batches between each pair of stages.
+     */
+    ReadPipeline(size_t thread_count, size_t queue_batches);
+
+    /// Fill the given empty batch from the input. Return false if there is
+    /// no more input. Only ever called from one thread.
+    function<bool(Batch&)> parse;
+
+    /// Map the reads in the given batch. Called from many OpenMP threads.
+    function<void(Batch&)> map;
+
+    /// Emit the mapped reads in the given batch.
+    function<void(Batch&)> emit;
+
+    /// Until this returns true, map only one batch at a time. Called before
+    /// each batch is mapped, and never from two threads at once.
+    function<bool(void)> single_threaded_until_true;
+
+    /// Should batches be emitted by a dedicated thread instead of by the
+    /// threads that mapped them?
+    bool emit_separately = true;
+
+    /**
+     * Run all the input through the pipeline. Rethrows any exception thrown
+     * while parsing.
+     */
+    void run();
+
+    StageStats parse_stats;
+    StageStats map_stats;
+    StageStats emit_stats;
+
+protected:
+
+    using clock = chrono::steady_clock;
+
+    /// A bounded lock-free queue of batches between two stages, that threads
+    /// can sleep on when it is empty or full.
+    struct BatchQueue {
+        BatchQueue(size_t capacity) : batches(capacity) {}
+
+        atomic_queue::AtomicQueueB2<Batch*> batches;
+        /// Set once nothing more will be pushed.
+        atomic<bool> closed{false};
+
+        /// Only held to sleep and to wake sleepers, never to use the queue.
+        mutex wait_mutex;
+        condition_variable has_batches;
+        condition_variable has_room;
+
+        /// Wake a thread sleeping on the given condition. Takes the lock so
+        /// a thread can't miss the wakeup between checking and sleeping.
+        void wake(condition_variable& condition, bool all = false);
+
+        /// Note that nothing more will be pushed, and wake all the poppers.
+        void close();
+    };
+
+    /// Add the time since the given start to the given counter, and restart.
+    static void add_time(atomic<size_t>& counter, clock::time_point& start);
+
+    /// Push a batch onto a queue, sleeping while it is full.
+    void push(BatchQueue& queue, Batch* batch, StageStats& stats);
+
+    /// Pop a batch from a queue, sleeping while it is empty. Returns null
+    /// when the queue is empty and closed.
+    Batch* pop(BatchQueue& queue, StageStats& stats);
+
+    /// Map batches until the input runs out.
+    void map_batches();
+
+    /// Emit batches until the mapping threads are done.
+    void emit_batches();
+
+    size_t thread_count;
+
+    BatchQueue parsed;
+    BatchQueue mapped;
+
+    atomic<size_t> mappers_running{0};
+    /// Set if OpenMP thread 0 is emitting while the others map.
+    bool emit_thread = false;
+
+    /// Set once single_threaded_until_true has returned true.
+    atomic<bool> multithreaded{false};
+    mutex single_threaded_mutex;
+};
+
+template<typename Batch>
+ReadPipeline<Batch>::ReadPipeline(size_t thread_count, size_t queue_batches) :
+    thread_count(max<size_t>(thread_count, 1)), parsed(max<size_t>(queue_batches, 2)), mapped(max<size_t>(queue_batches, 2)) {
+    // Nothing to do
+}
+
+template<typename Batch>
+void ReadPipeline<Batch>::BatchQueue::wake(condition_variable& condition, bool all) {
+    {
+        lock_guard<mutex> lock(wait_mutex);
+    }
+    if (all) {
+        condition.notify_all();
+    } else {
+        condition.notify_one();
+    }
+}
+
+template<typename Batch>
+void ReadPipeline<Batch>::BatchQueue::close() {
+    closed = true;
+    wake(has_batches, true);
+}
+
+template<typename Batch>
+void ReadPipeline<Batch>::add_time(atomic<size_t>& counter, clock::time_point& start) {
+    clock::time_point now = clock::now();
+    counter += chrono::duration_cast<chrono::nanoseconds>(now - start).count();
+    start = now;
+}
+
+template<typename Batch>
+void ReadPipeline<Batch>::push(BatchQueue& queue, Batch* batch, StageStats& stats) {
+    if (!queue.batches.try_push(batch)) {
+        clock::time_point start = clock::now();
+        {
+            unique_lock<mutex> lock(queue.wait_mutex);
+            while (!queue.batches.try_push(batch)) {
+                queue.has_room.wait(lock);
+            }
+        }
+        add_time(stats.stalled_nanoseconds, start);
+    }
+    queue.wake(queue.has_batches);
+}
+
+template<typename Batch>
+Batch* ReadPipeline<Batch>::pop(BatchQueue& queue, StageStats& stats) {
+    Batch* batch = nullptr;
+    if (!queue.batches.try_pop(batch)) {
+        clock::time_point start = clock::now();
+        {
+            unique_lock<mutex> lock(queue.wait_mutex);
+            while (!queue.batches.try_pop(batch)) {
+                if (queue.closed) {
+                    // Anything pushed before the queue was closed is visible now.
+                    if (!queue.batches.try_pop(batch)) {
+                        batch = nullptr;
+                    }
+                    break;
+                }
+                queue.has_batches.wait(lock);
+            }
+        }
+        add_time(stats.stalled_nanoseconds, start);
+        if (batch == nullptr) {
+            return nullptr;
+        }
+    }
+    queue.wake(queue.has_room);
+    return batch;
+}
+
+template<typename Batch>
+void ReadPipeline<Batch>::map_batches() {
+    while (Batch* batch = pop(parsed, map_stats)) {
+        clock::time_point start = clock::now();
+        bool mapped_alone = false;
+        if (!multithreaded) {
+            lock_guard<mutex> lock(single_threaded_mutex);
+            if (!multithreaded && single_threaded_until_true && !single_threaded_until_true()) {
+                // Other threads wait for us to finish.
+                map(*batch);
+                mapped_alone = true;
+            } else {
+                multithreaded = true;
+            }
+        }
+        if (!mapped_alone) {
+            map(*batch);
+        }
+        map_stats.batches++;
+        add_time(map_stats.busy_nanoseconds, start);
+
+        if (!emit_thread) {
+            emit(*batch);
+            emit_stats.batches++;
+            add_time(emit_stats.busy_nanoseconds, start);
+            delete batch;
+        } else {
+            push(mapped, batch, map_stats);
+        }
+    }
+    if (--mappers_running == 0) {
+        mapped.close();
+    }
+}
+
+template<typename Batch>
+void ReadPipeline<Batch>::emit_batches() {
+    while (Batch* batch = pop(mapped, emit_stats)) {
+        clock::time_point start = clock::now();
+        emit(*batch);
+        emit_stats.batches++;
+        add_time(emit_stats.busy_nanoseconds, start);
+        delete batch;
+    }
+}
+
+template<typename Batch>
+void ReadPipeline<Batch>::run() {
+
+    exception_ptr parse_exception;
+    thread parser([&]() {
+        try {
+            while (true) {
+                clock::time_point start = clock::now();
+                unique_ptr<Batch> batch(new Batch());
+                if (!parse(*batch)) {
+                    break;
+                }
+                parse_stats.batches++;
+                add_time(parse_stats.busy_nanoseconds, start);
+                push(parsed, batch.release(), parse_stats);
+            }
+        } catch (...) {
+            parse_exception = current_exception();
+        }
+        parsed.close();
+    });
+
+    #pragma omp parallel num_threads(thread_count)
+    {
+        // We might not get all the threads we asked for.
+        #pragma omp single
+        {
+            emit_thread = emit_separately && omp_get_num_threads() > 1;
+            mappers_running = emit_thread ? omp_get_num_threads() - 1 : omp_get_num_threads();
+        }
+        if (emit_thread && omp_get_thread_num() == 0) {
+            emit_batches();
+        } else {
+            map_batches();
+        }
+    }
+
+    parser.join();
+    if (parse_exception) {
+        rethrow_exception(parse_exception);
+    }
+}
+
+}
+
+#endif
@@ -1,11 +1,16 @@
 #include "recombinator.hpp"
 
 #include "kff.hpp"
+#include "alignment.hpp"
 #include "statistics.hpp"
+#include "utility.hpp"
 #include "algorithms/component.hpp"
 
+#include <vg/io/stream.hpp>
+
 #include <algorithm>
 #include <cmath>
+#include <fstream>
 #include <map>
 
 namespace vg {
@@ -48,14 +53,106 @@ find_kmer(hash_map<Haplotypes::Subchain::kmer_type, size_t>& counts, Haplotypes:
     return (forward != counts.end() ? forward : reverse);
 }
 
-hash_map<Haplotypes::Subchain::kmer_type, size_t> Haplotypes::kmer_counts(const std::string& kff_file, Verbosity verbosity) const {
+// Returns true if the file starts like a KFF file.
+bool is_kff_file(const std::string& filename) {
+    std::ifstream in(filename, std::ios_base::binary);
+    char magic[3];
+    return (in.read(magic, 3) && magic[0] == 'K' && magic[1] == 'F' && magic[2] == 'F');
+}
+
+// Adds the counts from the KFF file to the mapping using multiple threads.
+// Returns the number of kmers read from the file.
+size_t add_kff_counts(hash_map<Haplotypes::Subchain::kmer_type, size_t>& counts, const std::string& kff_file, size_t k) {
+    // Open and validate the kmer count file.
+    ParallelKFFReader reader(kff_file);
+
+    size_t kmer_count = 0;
+    #pragma omp parallel
+    {
+        #pragma omp task
+        {
+            while (true) {
+                std::vector<std::pair<ParallelKFFReader::kmer_type, size_t>> block = reader.read(Recombinator::KFF_BLOCK_SIZE);
+                if (block.empty()) {
+                    break;
+                }
+                // The set of kmers is fixed, so we can look them up concurrently
+                // and only need to make the updates atomic.
+                for (auto kmer : block) {
+                    auto iter = find_kmer(counts, kmer.first, k);
+                    if (iter != counts.end()) {
+                        #pragma omp atomic
+                        iter->second += kmer.second;
+                    }
+                }
+                #pragma omp atomic
+                kmer_count += block.size();
+            }
+        }
+    }
+    return kmer_count;
+}
+
+// Adds the kmers in the reads (FASTQ / FASTA, possibly compressed, or GAM if
+// the file name ends with .gam) to the mapping using multiple threads.
+// Returns the number of kmers in the reads.
+size_t add_read_counts(hash_map<Haplotypes::Subchain::kmer_type, size_t>& counts, const std::string& read_file, size_t k) {
+    typedef Haplotypes::Subchain::kmer_type kmer_type;
+    const kmer_type mask = (k < 32 ? (kmer_type(1) << (2 * k)) - 1 : ~kmer_type(0));
+
+    size_t kmer_count = 0;
+    auto count_kmers = [&](const Alignment& aln) {
+        const std::string& sequence = aln.sequence();
+        kmer_type forward = 0;
+        size_t valid_chars = 0, found = 0;
+        for (char c : sequence) {
+            auto packed = gbwtgraph::KmerEncoding::CHAR_TO_PACK[static_cast<uint8_t>(c)];
+            if (packed > 3) {
+                forward = 0; valid_chars = 0;
+                continue;
+            }
+            forward = ((forward << 2) | packed) & mask;
+            valid_chars++;
+            if (valid_chars >= k) {
+                // The set of kmers is fixed, so we can look them up concurrently
+                // and only need to make the updates atomic.
+                auto iter = find_kmer(counts, forward, k);
+                if (iter != counts.end()) {
+                    #pragma omp atomic
+                    iter->second++;
+                }
+                found++;
+            }
+        }
+        #pragma omp atomic
+        kmer_count += found;
+    };
+
+    if (read_file.length() >= 4 && read_file.substr(read_file.length() - 4) == ".gam") {
+        get_input_file(read_file, [&](std::istream& in) {
+            vg::io::for_each_parallel<Alignment>(in, [&](Alignment& aln) {
+                count_kmers(aln);
+            });
+        });
+    } else {
+        fastq_unpaired_for_each_parallel(read_file, [&](Alignment& aln) {
+            count_kmers(aln);
+        });
+    }
+    return kmer_count;
+}
+
+hash_map<Haplotypes::Subchain::kmer_type, size_t> Haplotypes::kmer_counts(const std::string& kmer_file, Verbosity verbosity) const {
     double start = gbwt::readTimer();
     if (verbosity >= verbosity_basic) {
         std::cerr << "Reading kmer counts" << std::endl;
     }
 
-    // Open and validate the kmer count file.
-    ParallelKFFReader reader(kff_file);
+    // Check the input before doing anything expensive.
+    bool kff_input = is_kff_file(kmer_file);
+    if (!kff_input && !file_exists(kmer_file)) {
+        throw std::runtime_error("Haplotypes::kmer_counts(): cannot open " + kmer_file);
+    }
 
     // Populate the map with the kmers we are interested in.
     double checkpoint = gbwt::readTimer();
@@ -75,38 +172,17 @@ hash_map<Haplotypes::Subchain::kmer_type, size_t> Haplotypes::kmer_counts(const
         std::cerr << "Initialized the hash map with " << result.size() << " kmers in " << seconds << " seconds" << std::endl;
     }
 
-    // Read the KFF file and add the counts using multiple threads.
+    // Read the KFF file or count the kmers in the reads using multiple threads.
     checkpoint = gbwt::readTimer();
     size_t kmer_count = 0;
-    #pragma omp parallel
-    {
-        #pragma omp task
-        {
-            while (true) {
-                std::vector<std::pair<ParallelKFFReader::kmer_type, size_t>> block = reader.read(Recombinator::KFF_BLOCK_SIZE);
-                if (block.empty()) {
-                    break;
-                }
-                std::vector<std::pair<hash_map<Subchain::kmer_type, size_t>::iterator, size_t>> buffer;
-                for (auto kmer : block) {
-                    auto iter = find_kmer(result, kmer.first, this->k());
-                    if (iter != result.end()) {
-                        buffer.push_back({ iter, kmer.second });
-                    }
-                }
-                #pragma omp critical
-                {
-                    for (auto to_update : buffer) {
-                        to_update.first->second += to_update.second;
-                    }
-                    kmer_count += block.size();
-                }
-            }
-        }
+    if (kff_input) {
+        kmer_count = add_kff_counts(result, kmer_file, this->k());
+    } else {
+        kmer_count = add_read_counts(result, kmer_file, this->k());
     }
     if (verbosity >= verbosity_detailed) {
         double seconds = gbwt::readTimer() - checkpoint;
-        std::cerr << "Read " << kmer_count << " kmers in " << seconds << " seconds" << std::endl;
+        std::cerr << (kff_input ? "Read " : "Counted ") << kmer_count << " kmers in " << seconds << " seconds" << std::endl;
     }
 
     if (verbosity >= verbosity_basic) {
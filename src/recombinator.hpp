@@ -199,14 +199,18 @@ public:
     std::vector<TopLevelChain> chains;
 
     /**
-      * Returns a mapping from kmers to their counts in the given KFF file.
+      * Returns a mapping from kmers to their counts in the given file.
       * The counts include both the kmer and the reverse complement.
       *
-      * Reads the KFF file using OpenMP threads. Exits with `std::exit()` if
-      * the file cannot be opened and throws `std::runtime_error` if the kmer
-      * counts cannot be used.
+      * The file can be a KFF file or a file of reads, which can be FASTQ or
+      * FASTA (possibly gzipped) or GAM (if the name ends with `.gam`). Only
+      * the kmers in the subchains are counted from the reads, so there is no
+      * need to run an external kmer counter.
+      *
+      * Reads the file using OpenMP threads. Throws `std::runtime_error` if
+      * the file cannot be opened or the kmer counts cannot be used.
      */
-    hash_map<Subchain::kmer_type, size_t> kmer_counts(const std::string& kff_file, Verbosity verbosity) const;
+    hash_map<Subchain::kmer_type, size_t> kmer_counts(const std::string& kmer_file, Verbosity verbosity) const;
 
     /// Serializes the object to a stream in the simple-sds format.
     void simple_sds_serialize(std::ostream& out) const;
@@ -511,7 +515,8 @@ public:
     };
 
     /**
-     * Generates haplotypes based on the kmer counts in the given KFF file.
+     * Generates haplotypes based on the kmer counts in the given KFF file or
+     * reads (see `Haplotypes::kmer_counts()`).
      *
      * Runs multiple GBWT construction jobs in parallel using OpenMP threads and
      * generates the specified number of haplotypes in each top-level chain
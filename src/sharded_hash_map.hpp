@@ -0,0 +1,90 @@
+#ifndef VG_SHARDED_HASH_MAP_HPP_INCLUDED
+#define VG_SHARDED_HASH_MAP_HPP_INCLUDED
+
+/**
+ * \file sharded_hash_map.hpp
+ * Defines a string-keyed hash map that many threads can fill at once.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "hash_map.hpp"
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * A string-keyed hash map split into shards by key hash, each with its own
+ * lock, so threads inserting different keys rarely wait on each other.
+ *
+ * Inserting is thread safe. Looking up is not synchronized with inserting,
+ * so lookups are only safe once all the inserting is done, but then any
+ * number of threads can look things up at once.
+ */
+template<typename V>
+class sharded_string_hash_map {
+public:
+    /// Make a map with the given number of shards, rounded up to a power of 2.
+    sharded_string_hash_map(size_t shard_count = 256) {
+        while (((size_t) 1 << shard_bits) < shard_count && shard_bits < 16) {
+            shard_bits++;
+        }
+        shards = vector<Shard>((size_t) 1 << shard_bits);
+    }
+
+    /// Set the value for the given key, replacing any value it already has.
+    /// Thread safe.
+    void set(const string& key, V value) {
+        Shard& shard = shards[shard_of(key)];
+        lock_guard<mutex> lock(shard.lock);
+        shard.map[key] = std::move(value);
+    }
+
+    /// Get the value for the given key, or null if it has none. Not safe to
+    /// call while anything is being set.
+    const V* find(const string& key) const {
+        const Shard& shard = shards[shard_of(key)];
+        auto found = shard.map.find(key);
+        return found == shard.map.end() ? nullptr : &found->second;
+    }
+
+    /// Get the total number of keys. Not safe to call while anything is
+    /// being set.
+    size_t size() const {
+        size_t total = 0;
+        for (auto& shard : shards) {
+            total += shard.map.size();
+        }
+        return total;
+    }
+
+protected:
+
+    struct Shard {
+        mutex lock;
+        string_hash_map<string, V> map;
+    };
+
+    /// Pick the shard for a key. We use the high bits of a remixed hash, so
+    /// the keys in a shard don't all share the low bits the shard's own hash
+    /// table will bucket them by.
+    size_t shard_of(const string& key) const {
+        if (shard_bits == 0) {
+            return 0;
+        }
+        uint64_t mixed = (uint64_t) std::hash<string>()(key) * 0x9E3779B97F4A7C15ull;
+        return mixed >> (64 - shard_bits);
+    }
+
+    size_t shard_bits = 0;
+    vector<Shard> shards;
+};
+
+}
+
+#endif
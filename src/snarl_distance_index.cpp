@@ -5,10 +5,42 @@
 
 #include "snarl_distance_index.hpp"
 
+#include <omp.h>
+
 using namespace std;
 using namespace handlegraph;
 namespace vg {
 
+/*
+ * Values that filling in chains and snarls accumulates into the temporary index as a whole.
+ * These get collected separately for each thread so that independent top-level structures can be
+ * filled in concurrently, and are added to the temporary index afterward. Since they are only sums,
+ * maxima, and flags, the result doesn't depend on the order that the structures were filled in.
+ */
+struct TemporaryIndexTotals {
+    size_t max_index_size = 0;
+    size_t max_distance = 0;
+    bool use_oversized_snarls = false;
+
+    void add_to(SnarlDistanceIndex::TemporaryDistanceIndex& temp_index) const {
+        temp_index.max_index_size += max_index_size;
+        if (max_distance > temp_index.max_distance) {
+            temp_index.max_distance = max_distance;
+        }
+        temp_index.use_oversized_snarls = temp_index.use_oversized_snarls || use_oversized_snarls;
+    }
+};
+
+//Fill in the distances in a snarl, adding index-wide values to totals instead of to temp_index
+static void populate_snarl_index(SnarlDistanceIndex::TemporaryDistanceIndex& temp_index,
+    pair<SnarlDistanceIndex::temp_record_t, size_t> snarl_index, size_t size_limit, bool only_top_level_chain_distances,
+    const HandleGraph* graph, TemporaryIndexTotals& totals);
+
+//Fill in the distances in a chain and in all of the snarls that are its children. The chain's
+//descendant chains must already be filled in
+static void populate_chain_index(SnarlDistanceIndex::TemporaryDistanceIndex& temp_index, size_t chain_i,
+    size_t size_limit, bool only_top_level_chain_distances, const HandleGraph* graph, TemporaryIndexTotals& totals);
+
 size_t minimum_distance(const SnarlDistanceIndex& distance_index, pos_t pos1, pos_t pos2,
                         bool unoriented_distance, const HandleGraph* graph) {
     return distance_index.minimum_distance( get_id(pos1), get_is_rev(pos1), get_offset(pos1),
@@ -20,12 +52,12 @@ size_t maximum_distance(const SnarlDistanceIndex& distance_index, pos_t pos1, po
                                             get_id(pos2), get_is_rev(pos2), get_offset(pos2)); 
 }
 
-void fill_in_distance_index(SnarlDistanceIndex* distance_index, const HandleGraph* graph, const HandleGraphSnarlFinder* snarl_finder, size_t size_limit, bool only_top_level_chain_distances, bool silence_warnings) {
+void fill_in_distance_index(SnarlDistanceIndex* distance_index, const HandleGraph* graph, const HandleGraphSnarlFinder* snarl_finder, size_t size_limit, bool only_top_level_chain_distances, bool silence_warnings, size_t thread_count) {
     distance_index->set_snarl_size_limit(size_limit);
     distance_index->set_only_top_level_chain_distances(only_top_level_chain_distances);
 
     //Build the temporary distance index from the graph
-    SnarlDistanceIndex::TemporaryDistanceIndex temp_index = make_temporary_distance_index(graph, snarl_finder, size_limit, only_top_level_chain_distances);
+    SnarlDistanceIndex::TemporaryDistanceIndex temp_index = make_temporary_distance_index(graph, snarl_finder, size_limit, only_top_level_chain_distances, thread_count);
 
     if (!silence_warnings && temp_index.use_oversized_snarls) {
         cerr << "warning: distance index uses oversized snarls, which may make mapping slow" << endl;
@@ -38,7 +70,8 @@ void fill_in_distance_index(SnarlDistanceIndex* distance_index, const HandleGrap
     distance_index->get_snarl_tree_records(indexes, graph);
 }
 SnarlDistanceIndex::TemporaryDistanceIndex make_temporary_distance_index(
-    const HandleGraph* graph, const HandleGraphSnarlFinder* snarl_finder, size_t size_limit, bool only_top_level_chain_distances)  {
+    const HandleGraph* graph, const HandleGraphSnarlFinder* snarl_finder, size_t size_limit, bool only_top_level_chain_distances,
+    size_t thread_count)  {
 
 #ifdef debug_distance_indexing
     cerr << "Creating new distance index for nodes between " << graph->min_node_id() << " and " << graph->max_node_id() << endl;
@@ -451,305 +484,343 @@ SnarlDistanceIndex::TemporaryDistanceIndex make_temporary_distance_index(
 #ifdef debug_distance_indexing
     cerr << "Filling in the distances in snarls" << endl;
 #endif
-    for (int i = temp_index.temp_chain_records.size()-1 ; i >= 0 ; i--) {
 
-        SnarlDistanceIndex::TemporaryDistanceIndex::TemporaryChainRecord& temp_chain_record = temp_index.temp_chain_records[i];
+    /* Each top-level chain was found in one piece by the traversal, so it and all of its descendant
+     * chains make up a contiguous run of chain records, starting with the top-level chain itself.
+     * Descendants always come after their ancestors, so each run gets filled in backwards, and
+     * different runs don't depend on each other so they can be filled in on different threads
+     */
+    vector<size_t> top_level_chain_runs;
+    for (size_t chain_i = 0 ; chain_i < temp_index.temp_chain_records.size() ; chain_i++) {
+        const pair<SnarlDistanceIndex::temp_record_t, size_t>& parent = temp_index.temp_chain_records[chain_i].parent;
+        if (parent.first == SnarlDistanceIndex::TEMP_ROOT || 
+            (parent.first == SnarlDistanceIndex::TEMP_SNARL && temp_index.temp_snarl_records[parent.second].is_root_snarl)) {
+            top_level_chain_runs.emplace_back(chain_i);
+        }
+    }
+    top_level_chain_runs.emplace_back(temp_index.temp_chain_records.size());
+
+    thread_count = std::max(thread_count, (size_t) 1);
+    vector<TemporaryIndexTotals> thread_totals (thread_count);
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(thread_count)
+    for (size_t run_i = 0 ; run_i < top_level_chain_runs.size() - 1 ; run_i++) {
+        //Go through the runs from the last one, so that a single thread sees the chains in reverse order
+        size_t run_start = top_level_chain_runs[top_level_chain_runs.size() - 2 - run_i];
+        size_t run_end = top_level_chain_runs[top_level_chain_runs.size() - 1 - run_i];
+        TemporaryIndexTotals& totals = thread_totals[omp_get_thread_num()];
+        for (size_t chain_i = run_end ; chain_i > run_start ; chain_i--) {
+            populate_chain_index(temp_index, chain_i-1, size_limit, only_top_level_chain_distances, graph, totals);
+        }
+    }
+
+#ifdef debug_distance_indexing
+    cerr << "Filling in the distances in root snarls and distances along chains" << endl;
+#endif
+    //The root snarls are only connected to their own children, so they are independent of each other too
+#pragma omp parallel for schedule(dynamic, 1) num_threads(thread_count)
+    for (size_t component_i = 0 ; component_i < temp_index.components.size() ; component_i++) {
+        const pair<SnarlDistanceIndex::temp_record_t, size_t>& component_index = temp_index.components[component_i];
+        if (component_index.first == SnarlDistanceIndex::TEMP_SNARL) {
+            SnarlDistanceIndex::TemporaryDistanceIndex::TemporarySnarlRecord& temp_snarl_record = temp_index.temp_snarl_records.at(component_index.second);
+            populate_snarl_index(temp_index, component_index, size_limit, only_top_level_chain_distances, graph, 
+                                 thread_totals[omp_get_thread_num()]);
+            temp_snarl_record.min_length = std::numeric_limits<size_t>::max();
+        }
+    }
+    for (const TemporaryIndexTotals& totals : thread_totals) {
+        totals.add_to(temp_index);
+    }
+    temp_index.root_structure_count = temp_index.components.size();
+#ifdef debug_distance_indexing
+    assert(temp_index.components.size() == temp_index.root_structure_count);
+    cerr << "Finished temp index with " << temp_index.root_structure_count << " connected components" << endl;
+#endif
+    return temp_index;
+}
+
+
+
+static void populate_chain_index(SnarlDistanceIndex::TemporaryDistanceIndex& temp_index, size_t chain_i,
+    size_t size_limit, bool only_top_level_chain_distances, const HandleGraph* graph, TemporaryIndexTotals& totals) {
+
+    SnarlDistanceIndex::TemporaryDistanceIndex::TemporaryChainRecord& temp_chain_record = temp_index.temp_chain_records[chain_i];
 #ifdef debug_distance_indexing
-        assert(!temp_chain_record.is_trivial);
-        cerr << "  At "  << (temp_chain_record.is_trivial ? " trivial " : "") << " chain " << temp_index.structure_start_end_as_string(make_pair(SnarlDistanceIndex::TEMP_CHAIN, i)) << endl;
+    assert(!temp_chain_record.is_trivial);
+    cerr << "  At "  << (temp_chain_record.is_trivial ? " trivial " : "") << " chain " << temp_index.structure_start_end_as_string(make_pair(SnarlDistanceIndex::TEMP_CHAIN, chain_i)) << endl;
 #endif
 
-        //Add the first values for the prefix sum and backwards loop vectors
-        temp_chain_record.prefix_sum.emplace_back(0);
-        temp_chain_record.max_prefix_sum.emplace_back(0);
-        temp_chain_record.backward_loops.emplace_back(std::numeric_limits<size_t>::max());
-        temp_chain_record.chain_components.emplace_back(0);
+    //Add the first values for the prefix sum and backwards loop vectors
+    temp_chain_record.prefix_sum.emplace_back(0);
+    temp_chain_record.max_prefix_sum.emplace_back(0);
+    temp_chain_record.backward_loops.emplace_back(std::numeric_limits<size_t>::max());
+    temp_chain_record.chain_components.emplace_back(0);
 
 
-        /*First, go through each of the snarls in the chain in the forward direction and
-         * fill in the distances in the snarl. Also fill in the prefix sum and backwards
-         * loop vectors here
-         */
-        size_t curr_component = 0; //which component of the chain are we in
-        size_t last_node_length = 0;
-        for (size_t chain_child_i = 0 ; chain_child_i < temp_chain_record.children.size() ; chain_child_i++ ){
-            const pair<SnarlDistanceIndex::temp_record_t, size_t>& chain_child_index = temp_chain_record.children[chain_child_i];
-            //Go through each of the children in the chain, skipping nodes
-            //The snarl may be trivial, in which case don't fill in the distances
+    /*First, go through each of the snarls in the chain in the forward direction and
+     * fill in the distances in the snarl. Also fill in the prefix sum and backwards
+     * loop vectors here
+     */
+    size_t curr_component = 0; //which component of the chain are we in
+    size_t last_node_length = 0;
+    for (size_t chain_child_i = 0 ; chain_child_i < temp_chain_record.children.size() ; chain_child_i++ ){
+        const pair<SnarlDistanceIndex::temp_record_t, size_t>& chain_child_index = temp_chain_record.children[chain_child_i];
+        //Go through each of the children in the chain, skipping nodes
+        //The snarl may be trivial, in which case don't fill in the distances
 #ifdef debug_distance_indexing
-            cerr << "    Looking at child " << temp_index.structure_start_end_as_string(chain_child_index) << " current max prefi xum " << temp_chain_record.max_prefix_sum.back() << endl;
+        cerr << "    Looking at child " << temp_index.structure_start_end_as_string(chain_child_index) << " current max prefi xum " << temp_chain_record.max_prefix_sum.back() << endl;
 #endif
 
-            if (chain_child_index.first == SnarlDistanceIndex::TEMP_SNARL){
-                //This is where all the work gets done. Need to go through the snarl and add
-                //all distances, then add distances to the chain that this is in
-                //The parent chain will be the last thing in the stack
-                SnarlDistanceIndex::TemporaryDistanceIndex::TemporarySnarlRecord& temp_snarl_record = 
-                        temp_index.temp_snarl_records.at(chain_child_index.second);
+        if (chain_child_index.first == SnarlDistanceIndex::TEMP_SNARL){
+            //This is where all the work gets done. Need to go through the snarl and add
+            //all distances, then add distances to the chain that this is in
+            //The parent chain will be the last thing in the stack
+            SnarlDistanceIndex::TemporaryDistanceIndex::TemporarySnarlRecord& temp_snarl_record = 
+                    temp_index.temp_snarl_records.at(chain_child_index.second);
 
-                //Fill in this snarl's distances
-                populate_snarl_index(temp_index, chain_child_index, size_limit, only_top_level_chain_distances, graph);
+            //Fill in this snarl's distances
+            populate_snarl_index(temp_index, chain_child_index, size_limit, only_top_level_chain_distances, graph, totals);
 
-                bool new_component = temp_snarl_record.min_length == std::numeric_limits<size_t>::max();
-                if (new_component){
-                    curr_component++;
-                }
+            bool new_component = temp_snarl_record.min_length == std::numeric_limits<size_t>::max();
+            if (new_component){
+                curr_component++;
+            }
 
-                //And get the distance values for the end node of the snarl in the chain
-                if (new_component) {
-                    //If this snarl wasn't start-end connected, then we start 
-                    //tracking the distance vectors here
+            //And get the distance values for the end node of the snarl in the chain
+            if (new_component) {
+                //If this snarl wasn't start-end connected, then we start 
+                //tracking the distance vectors here
 
-                    //Update the maximum distance
-                    temp_index.max_distance = std::max(temp_index.max_distance, temp_chain_record.max_prefix_sum.back());
+                //Update the maximum distance
+                totals.max_distance = std::max(totals.max_distance, temp_chain_record.max_prefix_sum.back());
 
-                    temp_chain_record.prefix_sum.emplace_back(0);
-                    temp_chain_record.max_prefix_sum.emplace_back(0);
-                    temp_chain_record.backward_loops.emplace_back(temp_snarl_record.distance_end_end);
-                    //If the chain is disconnected, the max length is infinite
-                    temp_chain_record.max_length =  std::numeric_limits<size_t>::max();
-                } else {
-                    temp_chain_record.prefix_sum.emplace_back(SnarlDistanceIndex::sum(SnarlDistanceIndex::sum(
-                                                              temp_chain_record.prefix_sum.back(),
-                                                              temp_snarl_record.min_length), 
-                                                              temp_snarl_record.start_node_length));
-                    temp_chain_record.max_prefix_sum.emplace_back(SnarlDistanceIndex::sum(SnarlDistanceIndex::sum(
-                                                                   temp_chain_record.max_prefix_sum.back(),
-                                                                   temp_snarl_record.max_length), 
-                                                                   temp_snarl_record.start_node_length));
-                    temp_chain_record.backward_loops.emplace_back(std::min(temp_snarl_record.distance_end_end,
-                        SnarlDistanceIndex::sum(temp_chain_record.backward_loops.back()
-                        , 2 * (temp_snarl_record.start_node_length + temp_snarl_record.min_length))));
-                    temp_chain_record.max_length = SnarlDistanceIndex::sum(temp_chain_record.max_length,
-                                                                           temp_snarl_record.max_length);
-                }
-                temp_chain_record.chain_components.emplace_back(curr_component);
-                if (chain_child_i == temp_chain_record.children.size() - 2 && temp_snarl_record.min_length == std::numeric_limits<size_t>::max()) {
-                    temp_chain_record.loopable = false;
-                }
-                last_node_length = 0;
+                temp_chain_record.prefix_sum.emplace_back(0);
+                temp_chain_record.max_prefix_sum.emplace_back(0);
+                temp_chain_record.backward_loops.emplace_back(temp_snarl_record.distance_end_end);
+                //If the chain is disconnected, the max length is infinite
+                temp_chain_record.max_length =  std::numeric_limits<size_t>::max();
             } else {
-                if (last_node_length != 0) {
-                    //If this is a node and the last thing was also a node,
-                    //then there was a trivial snarl 
-                    SnarlDistanceIndex::TemporaryDistanceIndex::TemporaryNodeRecord& temp_node_record = 
-                            temp_index.temp_node_records.at(chain_child_index.second-temp_index.min_node_id);
-
-                    //Check if there is a loop in this node
-                    //Snarls get counted as trivial if they contain no nodes but they might still have edges
-                    size_t backward_loop = std::numeric_limits<size_t>::max();
-
-                    graph->follow_edges(graph->get_handle(temp_node_record.node_id, !temp_node_record.reversed_in_parent), false, [&](const handle_t next_handle) {
-                        if (graph->get_id(next_handle) == temp_node_record.node_id) {
-                            //If there is a loop going backwards (relative to the chain) back to the same node
-                            backward_loop = 0;
-                        }
-                    });
+                temp_chain_record.prefix_sum.emplace_back(SnarlDistanceIndex::sum(SnarlDistanceIndex::sum(
+                                                          temp_chain_record.prefix_sum.back(),
+                                                          temp_snarl_record.min_length), 
+                                                          temp_snarl_record.start_node_length));
+                temp_chain_record.max_prefix_sum.emplace_back(SnarlDistanceIndex::sum(SnarlDistanceIndex::sum(
+                                                               temp_chain_record.max_prefix_sum.back(),
+                                                               temp_snarl_record.max_length), 
+                                                               temp_snarl_record.start_node_length));
+                temp_chain_record.backward_loops.emplace_back(std::min(temp_snarl_record.distance_end_end,
+                    SnarlDistanceIndex::sum(temp_chain_record.backward_loops.back()
+                    , 2 * (temp_snarl_record.start_node_length + temp_snarl_record.min_length))));
+                temp_chain_record.max_length = SnarlDistanceIndex::sum(temp_chain_record.max_length,
+                                                                       temp_snarl_record.max_length);
+            }
+            temp_chain_record.chain_components.emplace_back(curr_component);
+            if (chain_child_i == temp_chain_record.children.size() - 2 && temp_snarl_record.min_length == std::numeric_limits<size_t>::max()) {
+                temp_chain_record.loopable = false;
+            }
+            last_node_length = 0;
+        } else {
+            if (last_node_length != 0) {
+                //If this is a node and the last thing was also a node,
+                //then there was a trivial snarl 
+                SnarlDistanceIndex::TemporaryDistanceIndex::TemporaryNodeRecord& temp_node_record = 
+                        temp_index.temp_node_records.at(chain_child_index.second-temp_index.min_node_id);
+
+                //Check if there is a loop in this node
+                //Snarls get counted as trivial if they contain no nodes but they might still have edges
+                size_t backward_loop = std::numeric_limits<size_t>::max();
+
+                graph->follow_edges(graph->get_handle(temp_node_record.node_id, !temp_node_record.reversed_in_parent), false, [&](const handle_t next_handle) {
+                    if (graph->get_id(next_handle) == temp_node_record.node_id) {
+                        //If there is a loop going backwards (relative to the chain) back to the same node
+                        backward_loop = 0;
+                    }
+                });
 
-                    temp_chain_record.prefix_sum.emplace_back(SnarlDistanceIndex::sum(temp_chain_record.prefix_sum.back(), last_node_length));
-                    temp_chain_record.max_prefix_sum.emplace_back(SnarlDistanceIndex::sum(temp_chain_record.max_prefix_sum.back(), last_node_length));
-                    temp_chain_record.backward_loops.emplace_back(std::min(backward_loop,
-                        SnarlDistanceIndex::sum(temp_chain_record.backward_loops.back(), 2 * last_node_length)));
+                temp_chain_record.prefix_sum.emplace_back(SnarlDistanceIndex::sum(temp_chain_record.prefix_sum.back(), last_node_length));
+                temp_chain_record.max_prefix_sum.emplace_back(SnarlDistanceIndex::sum(temp_chain_record.max_prefix_sum.back(), last_node_length));
+                temp_chain_record.backward_loops.emplace_back(std::min(backward_loop,
+                    SnarlDistanceIndex::sum(temp_chain_record.backward_loops.back(), 2 * last_node_length)));
 
-                    if (chain_child_i == temp_chain_record.children.size()-1) {
-                        //If this is the last node
-                        temp_chain_record.loopable=false;
-                    }
-                    temp_chain_record.chain_components.emplace_back(curr_component);
+                if (chain_child_i == temp_chain_record.children.size()-1) {
+                    //If this is the last node
+                    temp_chain_record.loopable=false;
                 }
-                last_node_length = temp_index.temp_node_records.at(chain_child_index.second - temp_index.min_node_id).node_length;
-                //And update the chains max length
-                temp_chain_record.max_length = SnarlDistanceIndex::sum(temp_chain_record.max_length,
-                                                                       last_node_length);
+                temp_chain_record.chain_components.emplace_back(curr_component);
             }
-        } //Finished walking through chain
-        if (temp_chain_record.start_node_id == temp_chain_record.end_node_id && temp_chain_record.chain_components.back() != 0) {
-            //If this is a looping, multicomponent chain, the start/end node could end up in separate chain components
-            //despite being the same node.
-            //Since the first component will always be 0, set the first node's component to be whatever the last
-            //component was
-            temp_chain_record.chain_components[0] = temp_chain_record.chain_components.back();
-
+            last_node_length = temp_index.temp_node_records.at(chain_child_index.second - temp_index.min_node_id).node_length;
+            //And update the chains max length
+            temp_chain_record.max_length = SnarlDistanceIndex::sum(temp_chain_record.max_length,
+                                                                   last_node_length);
         }
+    } //Finished walking through chain
+    if (temp_chain_record.start_node_id == temp_chain_record.end_node_id && temp_chain_record.chain_components.back() != 0) {
+        //If this is a looping, multicomponent chain, the start/end node could end up in separate chain components
+        //despite being the same node.
+        //Since the first component will always be 0, set the first node's component to be whatever the last
+        //component was
+        temp_chain_record.chain_components[0] = temp_chain_record.chain_components.back();
+
+    }
 
-        //For a multicomponent chain, the actual minimum length will always be infinite, but since we sometimes need
-        //the length of the last component, save that here
-        temp_chain_record.min_length = !temp_chain_record.is_trivial && temp_chain_record.start_node_id == temp_chain_record.end_node_id
-                        ? temp_chain_record.prefix_sum.back()
-                        : SnarlDistanceIndex::sum(temp_chain_record.prefix_sum.back() , temp_chain_record.end_node_length);
+    //For a multicomponent chain, the actual minimum length will always be infinite, but since we sometimes need
+    //the length of the last component, save that here
+    temp_chain_record.min_length = !temp_chain_record.is_trivial && temp_chain_record.start_node_id == temp_chain_record.end_node_id
+                    ? temp_chain_record.prefix_sum.back()
+                    : SnarlDistanceIndex::sum(temp_chain_record.prefix_sum.back() , temp_chain_record.end_node_length);
 
 #ifdef debug_distance_indexing
-        assert(temp_chain_record.prefix_sum.size() == temp_chain_record.backward_loops.size());
-        assert(temp_chain_record.prefix_sum.size() == temp_chain_record.chain_components.size());
+    assert(temp_chain_record.prefix_sum.size() == temp_chain_record.backward_loops.size());
+    assert(temp_chain_record.prefix_sum.size() == temp_chain_record.chain_components.size());
 #endif
 
 
-        /*Now that we've gone through all the snarls in the chain, fill in the forward loop vector
-         * by going through the chain in the backwards direction
-         */
-        temp_chain_record.forward_loops.resize(temp_chain_record.prefix_sum.size(),
-                                               std::numeric_limits<size_t>::max());
-        if (temp_chain_record.start_node_id == temp_chain_record.end_node_id && temp_chain_record.children.size() > 1) {
-
-            //If this is a looping chain, then check the first snarl for a loop
-            if (temp_chain_record.children.at(1).first == SnarlDistanceIndex::TEMP_SNARL) {
-                SnarlDistanceIndex::TemporaryDistanceIndex::TemporarySnarlRecord& temp_snarl_record = temp_index.temp_snarl_records.at(temp_chain_record.children.at(1).second);
-                temp_chain_record.forward_loops[temp_chain_record.forward_loops.size()-1] = temp_snarl_record.distance_start_start;
-            } 
-        }
+    /*Now that we've gone through all the snarls in the chain, fill in the forward loop vector
+     * by going through the chain in the backwards direction
+     */
+    temp_chain_record.forward_loops.resize(temp_chain_record.prefix_sum.size(),
+                                           std::numeric_limits<size_t>::max());
+    if (temp_chain_record.start_node_id == temp_chain_record.end_node_id && temp_chain_record.children.size() > 1) {
+
+        //If this is a looping chain, then check the first snarl for a loop
+        if (temp_chain_record.children.at(1).first == SnarlDistanceIndex::TEMP_SNARL) {
+            SnarlDistanceIndex::TemporaryDistanceIndex::TemporarySnarlRecord& temp_snarl_record = temp_index.temp_snarl_records.at(temp_chain_record.children.at(1).second);
+            temp_chain_record.forward_loops[temp_chain_record.forward_loops.size()-1] = temp_snarl_record.distance_start_start;
+        } 
+    }
 
-        size_t node_i = temp_chain_record.prefix_sum.size() - 2;
-        // We start at the next to last node because we need to look at this record and the next one.
-        last_node_length = 0;
-        for (int j = (int)temp_chain_record.children.size() - 1 ; j >= 0 ; j--) {
-            auto& child = temp_chain_record.children.at(j);
-            if (child.first == SnarlDistanceIndex::TEMP_SNARL){
-                SnarlDistanceIndex::TemporaryDistanceIndex::TemporarySnarlRecord& temp_snarl_record = temp_index.temp_snarl_records.at(child.second);
-                if (temp_chain_record.chain_components.at(node_i) != temp_chain_record.chain_components.at(node_i+1) &&
-                    temp_chain_record.chain_components.at(node_i+1) != 0){
-                    //If this is a new chain component, then add the loop distance from the snarl
-                    //If the component of the next node is 0, then we're still in the same component since we're going backwards
-                    temp_chain_record.forward_loops.at(node_i) = temp_snarl_record.distance_start_start;
-                } else {
-                    temp_chain_record.forward_loops.at(node_i) =
-                        std::min(SnarlDistanceIndex::sum(SnarlDistanceIndex::sum(
-                                    temp_chain_record.forward_loops.at(node_i+1), 
-                                    2* temp_snarl_record.min_length),
-                                    2*temp_snarl_record.end_node_length), 
-                                temp_snarl_record.distance_start_start);
-                }
-                node_i --;
-                last_node_length = 0;
+    size_t node_i = temp_chain_record.prefix_sum.size() - 2;
+    // We start at the next to last node because we need to look at this record and the next one.
+    last_node_length = 0;
+    for (int j = (int)temp_chain_record.children.size() - 1 ; j >= 0 ; j--) {
+        auto& child = temp_chain_record.children.at(j);
+        if (child.first == SnarlDistanceIndex::TEMP_SNARL){
+            SnarlDistanceIndex::TemporaryDistanceIndex::TemporarySnarlRecord& temp_snarl_record = temp_index.temp_snarl_records.at(child.second);
+            if (temp_chain_record.chain_components.at(node_i) != temp_chain_record.chain_components.at(node_i+1) &&
+                temp_chain_record.chain_components.at(node_i+1) != 0){
+                //If this is a new chain component, then add the loop distance from the snarl
+                //If the component of the next node is 0, then we're still in the same component since we're going backwards
+                temp_chain_record.forward_loops.at(node_i) = temp_snarl_record.distance_start_start;
             } else {
-                if (last_node_length != 0) {
-                    SnarlDistanceIndex::TemporaryDistanceIndex::TemporaryNodeRecord& temp_node_record = 
-                            temp_index.temp_node_records.at(child.second-temp_index.min_node_id);
-
-
-                    //Check if there is a loop in this node
-                    //Snarls get counted as trivial if they contain no nodes but they might still have edges
-                    size_t forward_loop = std::numeric_limits<size_t>::max();
-                    graph->follow_edges(graph->get_handle(temp_node_record.node_id, temp_node_record.reversed_in_parent), false, [&](const handle_t next_handle) {
-                        if (graph->get_id(next_handle) == temp_node_record.node_id) {
-                            //If there is a loop going forward (relative to the chain) back to the same node
-                            forward_loop = 0;
-                        }
-                    });
-                    temp_chain_record.forward_loops.at(node_i) = std::min( forward_loop,
-                        SnarlDistanceIndex::sum(temp_chain_record.forward_loops.at(node_i+1) , 
-                                                 2*last_node_length));
-                    node_i--;
-                }
-                last_node_length = temp_index.temp_node_records.at(child.second - temp_index.min_node_id).node_length;
+                temp_chain_record.forward_loops.at(node_i) =
+                    std::min(SnarlDistanceIndex::sum(SnarlDistanceIndex::sum(
+                                temp_chain_record.forward_loops.at(node_i+1), 
+                                2* temp_snarl_record.min_length),
+                                2*temp_snarl_record.end_node_length), 
+                            temp_snarl_record.distance_start_start);
+            }
+            node_i --;
+            last_node_length = 0;
+        } else {
+            if (last_node_length != 0) {
+                SnarlDistanceIndex::TemporaryDistanceIndex::TemporaryNodeRecord& temp_node_record = 
+                        temp_index.temp_node_records.at(child.second-temp_index.min_node_id);
+
+
+                //Check if there is a loop in this node
+                //Snarls get counted as trivial if they contain no nodes but they might still have edges
+                size_t forward_loop = std::numeric_limits<size_t>::max();
+                graph->follow_edges(graph->get_handle(temp_node_record.node_id, temp_node_record.reversed_in_parent), false, [&](const handle_t next_handle) {
+                    if (graph->get_id(next_handle) == temp_node_record.node_id) {
+                        //If there is a loop going forward (relative to the chain) back to the same node
+                        forward_loop = 0;
+                    }
+                });
+                temp_chain_record.forward_loops.at(node_i) = std::min( forward_loop,
+                    SnarlDistanceIndex::sum(temp_chain_record.forward_loops.at(node_i+1) , 
+                                             2*last_node_length));
+                node_i--;
             }
+            last_node_length = temp_index.temp_node_records.at(child.second - temp_index.min_node_id).node_length;
         }
+    }
 
 
-        //If this is a looping chain, check if the loop distances can be improved by going around the chain
+    //If this is a looping chain, check if the loop distances can be improved by going around the chain
 
-        if (temp_chain_record.start_node_id == temp_chain_record.end_node_id && temp_chain_record.children.size() > 1) {
+    if (temp_chain_record.start_node_id == temp_chain_record.end_node_id && temp_chain_record.children.size() > 1) {
 
 
-            //Also check if the reverse loop values would be improved if we went around again
+        //Also check if the reverse loop values would be improved if we went around again
 
-            if (temp_chain_record.backward_loops.back() < temp_chain_record.backward_loops.front()) {
-                temp_chain_record.backward_loops[0] = temp_chain_record.backward_loops.back();
-                size_t node_i = 1;
-                size_t last_node_length = 0;
-                for (size_t i = 1 ; i < temp_chain_record.children.size()-1 ; i++ ) {
-                    auto& child = temp_chain_record.children.at(i);
-                    if (child.first == SnarlDistanceIndex::TEMP_SNARL) {
-                        SnarlDistanceIndex::TemporaryDistanceIndex::TemporarySnarlRecord& temp_snarl_record = temp_index.temp_snarl_records.at(child.second);
-                        size_t new_loop_distance = SnarlDistanceIndex::sum(SnarlDistanceIndex::sum(
-                                                      temp_chain_record.backward_loops.at(node_i-1), 
-                                                      2*temp_snarl_record.min_length), 
-                                                      2*temp_snarl_record.start_node_length); 
-                        if (temp_chain_record.chain_components.at(node_i)!= 0 || new_loop_distance >= temp_chain_record.backward_loops.at(node_i)) {
-                            //If this is a new chain component or it doesn't improve, stop
-                            break;
-                        } else {
-                            //otherwise record the better distance
-                            temp_chain_record.backward_loops.at(node_i) = new_loop_distance;
+        if (temp_chain_record.backward_loops.back() < temp_chain_record.backward_loops.front()) {
+            temp_chain_record.backward_loops[0] = temp_chain_record.backward_loops.back();
+            size_t node_i = 1;
+            size_t last_node_length = 0;
+            for (size_t i = 1 ; i < temp_chain_record.children.size()-1 ; i++ ) {
+                auto& child = temp_chain_record.children.at(i);
+                if (child.first == SnarlDistanceIndex::TEMP_SNARL) {
+                    SnarlDistanceIndex::TemporaryDistanceIndex::TemporarySnarlRecord& temp_snarl_record = temp_index.temp_snarl_records.at(child.second);
+                    size_t new_loop_distance = SnarlDistanceIndex::sum(SnarlDistanceIndex::sum(
+                                                  temp_chain_record.backward_loops.at(node_i-1), 
+                                                  2*temp_snarl_record.min_length), 
+                                                  2*temp_snarl_record.start_node_length); 
+                    if (temp_chain_record.chain_components.at(node_i)!= 0 || new_loop_distance >= temp_chain_record.backward_loops.at(node_i)) {
+                        //If this is a new chain component or it doesn't improve, stop
+                        break;
+                    } else {
+                        //otherwise record the better distance
+                        temp_chain_record.backward_loops.at(node_i) = new_loop_distance;
 
-                        }
+                    }
+                    node_i++;
+                    last_node_length = 0;
+                } else {
+                    if (last_node_length != 0) {
+                        size_t new_loop_distance = SnarlDistanceIndex::sum(temp_chain_record.backward_loops.at(node_i-1), 
+                                2*last_node_length); 
+                        size_t old_loop_distance = temp_chain_record.backward_loops.at(node_i);
+                        temp_chain_record.backward_loops.at(node_i) = std::min(old_loop_distance,new_loop_distance);
                         node_i++;
-                        last_node_length = 0;
-                    } else {
-                        if (last_node_length != 0) {
-                            size_t new_loop_distance = SnarlDistanceIndex::sum(temp_chain_record.backward_loops.at(node_i-1), 
-                                    2*last_node_length); 
-                            size_t old_loop_distance = temp_chain_record.backward_loops.at(node_i);
-                            temp_chain_record.backward_loops.at(node_i) = std::min(old_loop_distance,new_loop_distance);
-                            node_i++;
-                        }
-                        last_node_length = temp_index.temp_node_records.at(child.second - temp_index.min_node_id).node_length;
                     }
+                    last_node_length = temp_index.temp_node_records.at(child.second - temp_index.min_node_id).node_length;
                 }
             }
-            if (temp_chain_record.forward_loops.front() < temp_chain_record.forward_loops.back()) {
-                //If this is a looping chain and looping improves the forward loops, 
-                //then we have to keep going around to update distance
-
-                temp_chain_record.forward_loops.back() = temp_chain_record.forward_loops.front();
-                size_t last_node_length = 0;
-                node_i = temp_chain_record.prefix_sum.size() - 2;
-                for (int j = (int)temp_chain_record.children.size() - 1 ; j >= 0 ; j--) {
-                    auto& child = temp_chain_record.children.at(j);
-                    if (child.first == SnarlDistanceIndex::TEMP_SNARL){
-                        SnarlDistanceIndex::TemporaryDistanceIndex::TemporarySnarlRecord& temp_snarl_record = temp_index.temp_snarl_records.at(child.second);
-                        size_t new_distance = SnarlDistanceIndex::sum(SnarlDistanceIndex::sum(
-                                                temp_chain_record.forward_loops.at(node_i+1), 
-                                                2* temp_snarl_record.min_length),
-                                                2*temp_snarl_record.end_node_length);
-                        if (temp_chain_record.chain_components.at(node_i) != temp_chain_record.chain_components.at(node_i+1) ||
-                            new_distance >= temp_chain_record.forward_loops.at(node_i)){
-                            //If this is a new component or the distance doesn't improve, stop looking
-                            break;
-                        } else {
-                            //otherwise, update the distance
-                            temp_chain_record.forward_loops.at(node_i) = new_distance;
-                        }
-                        node_i --;
-                        last_node_length =0;
+        }
+        if (temp_chain_record.forward_loops.front() < temp_chain_record.forward_loops.back()) {
+            //If this is a looping chain and looping improves the forward loops, 
+            //then we have to keep going around to update distance
+
+            temp_chain_record.forward_loops.back() = temp_chain_record.forward_loops.front();
+            size_t last_node_length = 0;
+            node_i = temp_chain_record.prefix_sum.size() - 2;
+            for (int j = (int)temp_chain_record.children.size() - 1 ; j >= 0 ; j--) {
+                auto& child = temp_chain_record.children.at(j);
+                if (child.first == SnarlDistanceIndex::TEMP_SNARL){
+                    SnarlDistanceIndex::TemporaryDistanceIndex::TemporarySnarlRecord& temp_snarl_record = temp_index.temp_snarl_records.at(child.second);
+                    size_t new_distance = SnarlDistanceIndex::sum(SnarlDistanceIndex::sum(
+                                            temp_chain_record.forward_loops.at(node_i+1), 
+                                            2* temp_snarl_record.min_length),
+                                            2*temp_snarl_record.end_node_length);
+                    if (temp_chain_record.chain_components.at(node_i) != temp_chain_record.chain_components.at(node_i+1) ||
+                        new_distance >= temp_chain_record.forward_loops.at(node_i)){
+                        //If this is a new component or the distance doesn't improve, stop looking
+                        break;
                     } else {
-                        if (last_node_length != 0) {
-                            size_t new_distance = SnarlDistanceIndex::sum(temp_chain_record.forward_loops.at(node_i+1) , 2* last_node_length);
-                            size_t old_distance = temp_chain_record.forward_loops.at(node_i);
-                            temp_chain_record.forward_loops.at(node_i) = std::min(old_distance, new_distance);
-                            node_i--;
-                        }
-                        last_node_length = temp_index.temp_node_records.at(child.second - temp_index.min_node_id).node_length;
+                        //otherwise, update the distance
+                        temp_chain_record.forward_loops.at(node_i) = new_distance;
                     }
-                } 
-            }
-        }
-
-        temp_index.max_distance = std::max(temp_index.max_distance, temp_chain_record.max_prefix_sum.back());
-        temp_index.max_distance = temp_chain_record.forward_loops.back() == std::numeric_limits<size_t>::max() ? temp_index.max_distance : std::max(temp_index.max_distance, temp_chain_record.forward_loops.back());
-        temp_index.max_distance = temp_chain_record.backward_loops.front() == std::numeric_limits<size_t>::max() ? temp_index.max_distance : std::max(temp_index.max_distance, temp_chain_record.backward_loops.front());
-        assert(temp_index.max_distance <= 2742664019);
-
-    }
-
-#ifdef debug_distance_indexing
-    cerr << "Filling in the distances in root snarls and distances along chains" << endl;
-#endif
-    for (pair<SnarlDistanceIndex::temp_record_t, size_t>& component_index : temp_index.components) {
-        if (component_index.first == SnarlDistanceIndex::TEMP_SNARL) {
-            SnarlDistanceIndex::TemporaryDistanceIndex::TemporarySnarlRecord& temp_snarl_record = temp_index.temp_snarl_records.at(component_index.second);
-            populate_snarl_index(temp_index, component_index, size_limit, only_top_level_chain_distances, graph);
-            temp_snarl_record.min_length = std::numeric_limits<size_t>::max();
+                    node_i --;
+                    last_node_length =0;
+                } else {
+                    if (last_node_length != 0) {
+                        size_t new_distance = SnarlDistanceIndex::sum(temp_chain_record.forward_loops.at(node_i+1) , 2* last_node_length);
+                        size_t old_distance = temp_chain_record.forward_loops.at(node_i);
+                        temp_chain_record.forward_loops.at(node_i) = std::min(old_distance, new_distance);
+                        node_i--;
+                    }
+                    last_node_length = temp_index.temp_node_records.at(child.second - temp_index.min_node_id).node_length;
+                }
+            } 
         }
     }
-    temp_index.root_structure_count = temp_index.components.size();
-#ifdef debug_distance_indexing
-    assert(temp_index.components.size() == temp_index.root_structure_count);
-    cerr << "Finished temp index with " << temp_index.root_structure_count << " connected components" << endl;
-#endif
-    return temp_index;
-}
 
+    totals.max_distance = std::max(totals.max_distance, temp_chain_record.max_prefix_sum.back());
+    totals.max_distance = temp_chain_record.forward_loops.back() == std::numeric_limits<size_t>::max() ? totals.max_distance : std::max(totals.max_distance, temp_chain_record.forward_loops.back());
+    totals.max_distance = temp_chain_record.backward_loops.front() == std::numeric_limits<size_t>::max() ? totals.max_distance : std::max(totals.max_distance, temp_chain_record.backward_loops.front());
+    assert(totals.max_distance <= 2742664019);
 
+}
 
 /*Fill in the snarl index.
  * The index will already know its boundaries and everything knows their relationships in the
@@ -761,6 +832,15 @@ void populate_snarl_index(
                 SnarlDistanceIndex::TemporaryDistanceIndex& temp_index,
                 pair<SnarlDistanceIndex::temp_record_t, size_t> snarl_index, size_t size_limit,
                 bool only_top_level_chain_distances, const HandleGraph* graph) {
+    TemporaryIndexTotals totals;
+    populate_snarl_index(temp_index, snarl_index, size_limit, only_top_level_chain_distances, graph, totals);
+    totals.add_to(temp_index);
+}
+
+static void populate_snarl_index(
+                SnarlDistanceIndex::TemporaryDistanceIndex& temp_index,
+                pair<SnarlDistanceIndex::temp_record_t, size_t> snarl_index, size_t size_limit,
+                bool only_top_level_chain_distances, const HandleGraph* graph, TemporaryIndexTotals& totals) {
 #ifdef debug_distance_indexing
     cerr << "Getting the distances for snarl " << temp_index.structure_start_end_as_string(snarl_index) << endl;
     assert(snarl_index.first == SnarlDistanceIndex::TEMP_SNARL);
@@ -1078,7 +1158,7 @@ void populate_snarl_index(
     }
 
     if (size_limit != 0 && temp_snarl_record.node_count > size_limit) {
-        temp_index.use_oversized_snarls = true;
+        totals.use_oversized_snarls = true;
     }
 
     //Add the start and end nodes to the list of children so that we include them in the traversal 
@@ -1485,9 +1565,9 @@ void populate_snarl_index(
     }
 
     //Now that the distances are filled in, predict the size of the snarl in the index
-    temp_index.max_index_size += temp_snarl_record.get_max_record_length();
+    totals.max_index_size += temp_snarl_record.get_max_record_length();
     if (temp_snarl_record.is_simple) {
-        temp_index.max_index_size -= (temp_snarl_record.children.size() * SnarlDistanceIndex::TemporaryDistanceIndex::TemporaryNodeRecord::get_max_record_length());
+        totals.max_index_size -= (temp_snarl_record.children.size() * SnarlDistanceIndex::TemporaryDistanceIndex::TemporaryNodeRecord::get_max_record_length());
     }
 
 
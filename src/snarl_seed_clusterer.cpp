@@ -23,7 +23,8 @@ SnarlDistanceIndexClusterer::SnarlDistanceIndexClusterer( const SnarlDistanceInd
                                         graph(nullptr){
 };
 
-vector<SnarlDistanceIndexClusterer::Cluster> SnarlDistanceIndexClusterer::cluster_seeds (const vector<Seed>& seeds, size_t read_distance_limit) const {
+vector<SnarlDistanceIndexClusterer::Cluster> SnarlDistanceIndexClusterer::cluster_seeds (const vector<Seed>& seeds, size_t read_distance_limit,
+                                                                                DistanceCache* distance_cache) const {
     //Wrapper for single ended
 
     vector<SeedCache> seed_caches(seeds.size());
@@ -34,7 +35,7 @@ vector<SnarlDistanceIndexClusterer::Cluster> SnarlDistanceIndexClusterer::cluste
     vector<vector<SeedCache>*> all_seed_caches = {&seed_caches};
 
     std::vector<std::vector<size_t>> all_clusters =
-        std::get<0>(cluster_seeds_internal(all_seed_caches, read_distance_limit, 0))[0].all_groups();
+        std::get<0>(cluster_seeds_internal(all_seed_caches, read_distance_limit, 0, distance_cache))[0].all_groups();
 
     std::vector<Cluster> result;
     result.reserve(all_clusters.size());
@@ -52,7 +53,7 @@ vector<SnarlDistanceIndexClusterer::Cluster> SnarlDistanceIndexClusterer::cluste
 
 vector<vector<SnarlDistanceIndexClusterer::Cluster>> SnarlDistanceIndexClusterer::cluster_seeds (
               const vector<vector<Seed>>& all_seeds, 
-              size_t read_distance_limit, size_t fragment_distance_limit) const {
+              size_t read_distance_limit, size_t fragment_distance_limit, DistanceCache* distance_cache) const {
     //Wrapper for paired end
 
     if (all_seeds.size() > 2) {
@@ -77,7 +78,7 @@ vector<vector<SnarlDistanceIndexClusterer::Cluster>> SnarlDistanceIndexClusterer
     for (vector<SeedCache>& v : all_seed_caches) seed_cache_pointers.push_back(&v);
 
     //Actually cluster the seeds
-    auto union_finds = cluster_seeds_internal(seed_cache_pointers, read_distance_limit, fragment_distance_limit);
+    auto union_finds = cluster_seeds_internal(seed_cache_pointers, read_distance_limit, fragment_distance_limit, distance_cache);
 
     vector<structures::UnionFind>* read_union_finds = &std::get<0>(union_finds);
     structures::UnionFind* fragment_union_find = &std::get<1>(union_finds);
@@ -124,7 +125,7 @@ vector<vector<SnarlDistanceIndexClusterer::Cluster>> SnarlDistanceIndexClusterer
 
 tuple<vector<structures::UnionFind>, structures::UnionFind> SnarlDistanceIndexClusterer::cluster_seeds_internal (
               vector<vector<SeedCache>*>& all_seeds, 
-              size_t read_distance_limit, size_t fragment_distance_limit) const {
+              size_t read_distance_limit, size_t fragment_distance_limit, DistanceCache* distance_cache) const {
     /* Given a vector of seeds and a limit, find a clustering of seeds where
      * seeds that are closer than the limit cluster together.
      * Returns a vector of clusters
@@ -153,6 +154,7 @@ cerr << "\tread distance limit: " << read_distance_limit << " and fragment dista
     size_t seed_count = 0;
     for (auto v : all_seeds) seed_count+= v->size();
     ClusteringProblem clustering_problem (&all_seeds, read_distance_limit, fragment_distance_limit, seed_count);
+    clustering_problem.distance_cache = distance_cache;
 
 
     //Initialize chains_by_level with all the seeds on chains
@@ -995,18 +997,18 @@ void SnarlDistanceIndexClusterer::compare_and_combine_cluster_on_child_structure
 
 
     //Get the distances between the two sides of the children in the parent
-    size_t distance_left_left = distance_index.distance_in_parent(parent_handle, distance_index.flip(child_handle1), 
+    size_t distance_left_left = distance_in_parent(clustering_problem.distance_cache, parent_handle, distance_index.flip(child_handle1), 
                                             distance_index.flip(child_handle2), graph,
                                             (clustering_problem.fragment_distance_limit == 0 ? clustering_problem.read_distance_limit 
                                                                                      : clustering_problem.fragment_distance_limit));
-    size_t distance_left_right = distance_index.distance_in_parent(parent_handle, distance_index.flip(child_handle1), 
+    size_t distance_left_right = distance_in_parent(clustering_problem.distance_cache, parent_handle, distance_index.flip(child_handle1), 
                                             child_handle2, graph,
                                             (clustering_problem.fragment_distance_limit == 0 ? clustering_problem.read_distance_limit 
                                                                                      : clustering_problem.fragment_distance_limit));
-    size_t distance_right_right = distance_index.distance_in_parent(parent_handle, child_handle1, child_handle2, graph,
+    size_t distance_right_right = distance_in_parent(clustering_problem.distance_cache, parent_handle, child_handle1, child_handle2, graph,
                                             (clustering_problem.fragment_distance_limit == 0 ? clustering_problem.read_distance_limit 
                                                                                      : clustering_problem.fragment_distance_limit));
-    size_t distance_right_left = distance_index.distance_in_parent(parent_handle, child_handle1, 
+    size_t distance_right_left = distance_in_parent(clustering_problem.distance_cache, parent_handle, child_handle1, 
                                             distance_index.flip(child_handle2), graph,
                                             (clustering_problem.fragment_distance_limit == 0 ? clustering_problem.read_distance_limit 
                                                                                      : clustering_problem.fragment_distance_limit));
@@ -2703,8 +2705,8 @@ void SnarlDistanceIndexClusterer::add_snarl_to_chain_problem(ClusteringProblem&
         //TODO: I think I should be able to do this without the distance index but none of our graphs so far have loops 
         //      so I'm not going to bother
         //If it's a looping chain then use the distance index
-        distance_from_current_end_to_end_of_chain = distance_index.distance_in_parent(chain_handle, chain_problem->end_in, 
-                 current_child.net_handle);
+        distance_from_current_end_to_end_of_chain = distance_in_parent(clustering_problem.distance_cache, chain_handle,
+                 chain_problem->end_in, current_child.net_handle);
     } else if (child_problem.node_length == std::numeric_limits<size_t>::max() ) {
             //If the node length is infinite, then it is a snarl that isn't start-end connected, so the start
             //and end of the snarl are in different components of the chain. Since it reached here, the end
@@ -3314,7 +3316,17 @@ void SnarlDistanceIndexClusterer::cluster_seeds_on_linear_structure(ClusteringPr
     return;
 }
 
-size_t SnarlDistanceIndexClusterer::distance_between_seeds(const Seed& seed1, const Seed& seed2, bool stop_at_lowest_common_ancestor) const {
+size_t SnarlDistanceIndexClusterer::distance_in_parent(DistanceCache* distance_cache, const net_handle_t& parent,
+                                                       const net_handle_t& child1, const net_handle_t& child2,
+                                                       const HandleGraph* graph, size_t distance_limit) const {
+    if (distance_cache) {
+        return distance_cache->distance_in_parent(distance_index, parent, child1, child2, graph, distance_limit);
+    }
+    return distance_index.distance_in_parent(parent, child1, child2, graph, distance_limit);
+}
+
+size_t SnarlDistanceIndexClusterer::distance_between_seeds(const Seed& seed1, const Seed& seed2, bool stop_at_lowest_common_ancestor,
+                                                           DistanceCache* distance_cache) const {
 
     /*Helper function to walk up the snarl tree
      * Given a net handle, its parent,  and the distances to the start and end of the handle, 
@@ -3349,13 +3361,13 @@ size_t SnarlDistanceIndexClusterer::distance_between_seeds(const Seed& seed1, co
 
         //Get the distances from the bounds of the parent to the node we're looking at
         size_t distance_start_start = start_bound == net ? 0
-                : SnarlDistanceIndex::sum(start_length, distance_index.distance_in_parent(parent, start_bound, distance_index.flip(net), graph));
+                : SnarlDistanceIndex::sum(start_length, distance_in_parent(distance_cache, parent, start_bound, distance_index.flip(net), graph));
         size_t distance_start_end = start_bound == distance_index.flip(net) ? 0
-                : SnarlDistanceIndex::sum(start_length, distance_index.distance_in_parent(parent, start_bound, net, graph));
+                : SnarlDistanceIndex::sum(start_length, distance_in_parent(distance_cache, parent, start_bound, net, graph));
         size_t distance_end_start = end_bound == net ? 0
-                : SnarlDistanceIndex::sum(end_length, distance_index.distance_in_parent(parent, end_bound, distance_index.flip(net), graph));
+                : SnarlDistanceIndex::sum(end_length, distance_in_parent(distance_cache, parent, end_bound, distance_index.flip(net), graph));
         size_t distance_end_end = end_bound == distance_index.flip(net) ? 0
-                : SnarlDistanceIndex::sum(end_length, distance_index.distance_in_parent(parent, end_bound, net, graph));
+                : SnarlDistanceIndex::sum(end_length, distance_in_parent(distance_cache, parent, end_bound, net, graph));
 
         size_t distance_start = dist_start;
         size_t distance_end = dist_end;
@@ -3575,10 +3587,10 @@ size_t SnarlDistanceIndexClusterer::distance_between_seeds(const Seed& seed1, co
             }
         } else { 
             //Otherwise, the parent is a snarl and the distances are found with the index
-            size_t distance_start_start = distance_index.distance_in_parent(parent1, distance_index.flip(net1), distance_index.flip(net2), graph);
-            size_t distance_start_end = distance_index.distance_in_parent(parent1, distance_index.flip(net1), net2, graph);
-            size_t distance_end_start = distance_index.distance_in_parent(parent1, net1, distance_index.flip(net2), graph);
-            size_t distance_end_end = distance_index.distance_in_parent(parent1, net1, net2, graph);
+            size_t distance_start_start = distance_in_parent(distance_cache, parent1, distance_index.flip(net1), distance_index.flip(net2), graph);
+            size_t distance_start_end = distance_in_parent(distance_cache, parent1, distance_index.flip(net1), net2, graph);
+            size_t distance_end_start = distance_in_parent(distance_cache, parent1, net1, distance_index.flip(net2), graph);
+            size_t distance_end_end = distance_in_parent(distance_cache, parent1, net1, net2, graph);
 
             //And add those to the distances we've found to get the minimum distance between the positions
             minimum_distance = std::min(SnarlDistanceIndex::sum(SnarlDistanceIndex::sum(distance_start_start , distance_to_start1), distance_to_start2),
@@ -3727,10 +3739,10 @@ size_t SnarlDistanceIndexClusterer::distance_between_seeds(const Seed& seed1, co
 #endif
 
         //Find the minimum distance between the two children (net1 and net2)
-        size_t distance_start_start = distance_index.distance_in_parent(common_ancestor, distance_index.flip(net1), distance_index.flip(net2), graph);
-        size_t distance_start_end = distance_index.distance_in_parent(common_ancestor, distance_index.flip(net1), net2, graph);
-        size_t distance_end_start = distance_index.distance_in_parent(common_ancestor, net1, distance_index.flip(net2), graph);
-        size_t distance_end_end = distance_index.distance_in_parent(common_ancestor, net1, net2, graph);
+        size_t distance_start_start = distance_in_parent(distance_cache, common_ancestor, distance_index.flip(net1), distance_index.flip(net2), graph);
+        size_t distance_start_end = distance_in_parent(distance_cache, common_ancestor, distance_index.flip(net1), net2, graph);
+        size_t distance_end_start = distance_in_parent(distance_cache, common_ancestor, net1, distance_index.flip(net2), graph);
+        size_t distance_end_end = distance_in_parent(distance_cache, common_ancestor, net1, net2, graph);
 
         //And add those to the distances we've found to get the minimum distance between the positions
         minimum_distance = std::min(minimum_distance,
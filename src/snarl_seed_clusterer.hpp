@@ -3,6 +3,7 @@
 
 #include "snarls.hpp"
 #include "snarl_distance_index.hpp"
+#include "distance_cache.hpp"
 #include "hash_map.hpp"
 #include "small_bitset.hpp"
 #include <structures/union_find.hpp>
@@ -104,8 +105,10 @@ class SnarlDistanceIndexClusterer {
          *between them (including both of the positions) is less than
          *the distance limit are in the same cluster
          *This produces a vector of clusters
+         *If a DistanceCache is given, distances within the snarl tree are looked up in and saved to it
          */
-        vector<Cluster> cluster_seeds ( const vector<Seed>& seeds, size_t read_distance_limit) const;
+        vector<Cluster> cluster_seeds ( const vector<Seed>& seeds, size_t read_distance_limit,
+                DistanceCache* distance_cache = nullptr) const;
         
         /* The same thing, but for paired end reads.
          * Given seeds from multiple reads of a fragment, cluster each read
@@ -119,14 +122,16 @@ class SnarlDistanceIndexClusterer {
 
         vector<vector<Cluster>> cluster_seeds ( 
                 const vector<vector<Seed>>& all_seeds, 
-                size_t read_distance_limit, size_t fragment_distance_limit=0) const;
+                size_t read_distance_limit, size_t fragment_distance_limit=0,
+                DistanceCache* distance_cache = nullptr) const;
 
 
         /**
          * Find the minimum distance between two seeds. This will use the minimizer payload when possible
+         * If a DistanceCache is given, distances within the snarl tree are looked up in and saved to it.
          */
         size_t distance_between_seeds(const Seed& seed1, const Seed& seed2,
-            bool stop_at_lowest_common_ancestor) const;
+            bool stop_at_lowest_common_ancestor, DistanceCache* distance_cache = nullptr) const;
 
     private:
 
@@ -135,7 +140,13 @@ class SnarlDistanceIndexClusterer {
         //fragment_distance_limit defaults to 0, meaning that we don't cluster by fragment
         tuple<vector<structures::UnionFind>, structures::UnionFind> cluster_seeds_internal ( 
                 vector<vector<SeedCache>*>& all_seeds,
-                size_t read_distance_limit, size_t fragment_distance_limit=0) const;
+                size_t read_distance_limit, size_t fragment_distance_limit=0,
+                DistanceCache* distance_cache = nullptr) const;
+
+        //Get the distance between two children of parent from the distance index, or from the cache if there is one
+        size_t distance_in_parent(DistanceCache* distance_cache, const net_handle_t& parent,
+                const net_handle_t& child1, const net_handle_t& child2, const HandleGraph* graph = nullptr,
+                size_t distance_limit = std::numeric_limits<size_t>::max()) const;
 
         const SnarlDistanceIndex& distance_index;
         const HandleGraph* graph;
@@ -331,6 +342,9 @@ class SnarlDistanceIndexClusterer {
             size_t read_distance_limit;
             size_t fragment_distance_limit;
 
+            //Where to remember distances between children of snarl tree nodes, if anywhere
+            DistanceCache* distance_cache = nullptr;
+
 
             //////////Data structures to hold clustering information
 
@@ -20,6 +20,9 @@
 #include <vector>
 #include <unordered_map>
 #include <tuple>
+#include <list>
+#include <mutex>
+#include <thread>
 
 #include <sys/time.h>
 #include <sys/resource.h>
@@ -59,6 +62,9 @@ public:
     /// Sort a stream of VPKG-format Protobuf data, using temporary files,
     /// limiting the number of simultaneously open input files and the size of
     /// in-memory data. Optionally index the sorted file into the given index.
+    /// Sorted chunks are written out on background threads, and if file
+    /// descriptors allow, the final merge is split into node ID ranges that
+    /// are merged in parallel.
     void stream_sort(istream& stream_in, ostream& stream_out, StreamIndex<Message>* index_to = nullptr);
     
     /// Sort a stream of VPKG-format Protobuf data, loading it all into memory and
@@ -88,7 +94,7 @@ public:
     /// We can't sort by actual base on the forward strand, because we need to be able to sort without knowing the graph's node lengths.
     bool less_than(const Position& a, const Position& b) const;
     
-  private:
+  protected:
     /// What's the maximum size of messages in serialized, uncompressed bytes to
     /// load into memory for a single temp file chunk, during the streaming
     /// sort?
@@ -98,13 +104,32 @@ public:
     /// This will be computed based on the max file descriptor limit from the OS.
     size_t max_fan_in;
     
+    /// How many node ID ranges should each thread get in the parallel final
+    /// merge? More ranges balance better but make more temp files.
+    size_t ranges_per_merge_thread = 4;
+    
     using cursor_t = vg::io::ProtobufIterator<Message>;
     using emitter_t = vg::io::ProtobufEmitter<Message>;
     
+    /// The min node ID of the first message and the starting virtual offset
+    /// of each group in a sorted temp file, so merges can start partway in.
+    using group_starts_t = vector<pair<id_t, int64_t>>;
+    
     /// Open all the given input files, keeping the streams and cursors in the given lists.
     /// We use lists because none of these should be allowed to move after creation.
     void open_all(const vector<string>& filenames, list<ifstream>& streams, list<cursor_t>& cursors);
     
+    /// Set up the given emitter to record the starts of the groups it writes.
+    void record_group_starts(emitter_t& emitter, group_starts_t& group_starts) const;
+    
+    /// Merge messages from the given list of cursors into the given emitter,
+    /// until the cursors are depleted or stop_before returns true for the next
+    /// message. Calls on_emit with the running count after each message, if
+    /// set. Returns the number of messages merged.
+    size_t merge_cursors(list<cursor_t>& cursors, emitter_t& emitter,
+                         const function<bool(const Message&)>& stop_before,
+                         const function<void(size_t)>& on_emit) const;
+    
     /// Merge all the messages from the given list of cursors into the given emitter.
     /// The total expected number of messages can be passed for progress bar purposes.
     void streaming_merge(list<cursor_t>& cursors, emitter_t& emitter, size_t expected_messages = 0);
@@ -114,8 +139,18 @@ public:
     /// files, which must be from temp_file::create(), will be deleted.
     ///
     /// If messages_per_file is specified, it will be used to show progress bars,
-    /// and will be updated for newly-created files.
-    vector<string> streaming_merge(const vector<string>& temp_names_in, unordered_map<string, size_t>* messages_per_file = nullptr);
+    /// and will be updated for newly-created files. If group_starts_per_file
+    /// is specified, it will be updated for newly-created files.
+    vector<string> streaming_merge(const vector<string>& temp_names_in, unordered_map<string, size_t>* messages_per_file = nullptr,
+                                   unordered_map<string, group_starts_t>* group_starts_per_file = nullptr);
+    
+    /// Merge all the given temp files into the given output stream, using the
+    /// given number of threads on separate node ID ranges. Each range is
+    /// merged into its own temp file, and the files are then concatenated.
+    /// Every file must have its group starts recorded. Optionally index the
+    /// output into the given index. The input files are not deleted.
+    void parallel_merge(const vector<string>& temp_files, const unordered_map<string, group_starts_t>& group_starts_per_file,
+                        size_t thread_count, ostream& stream_out, StreamIndex<Message>* index_to, size_t expected_messages = 0);
 };
 
 using GAMSorter = StreamSorter<Alignment>;
@@ -251,14 +286,22 @@ void StreamSorter<Message>::stream_sort(istream& stream_in, ostream& stream_out,
     
     // This tracks the number of messages in each file, by file name
     unordered_map<string, size_t> messages_per_file;
+    // This tracks where the groups start in each file, by file name
+    unordered_map<string, group_starts_t> group_starts_per_file;
     // This tracks the total messages observed on input
     size_t total_messages_read = 0;
+    // This protects all of the above, which the writer threads fill in
+    std::mutex temp_files_mutex;
     
     // This cursor will read in the input file.
     cursor_t input_cursor(stream_in);
     
-    #pragma omp parallel shared(stream_in, input_cursor, outstanding_temp_files, messages_per_file, total_messages_read)
+    #pragma omp parallel shared(stream_in, input_cursor, outstanding_temp_files, messages_per_file, group_starts_per_file, total_messages_read, temp_files_mutex)
     {
+        // Each thread hands its sorted chunks off to a background writer, so
+        // it can read and sort its next chunk while the last one is being
+        // compressed. So each thread can hold up to two chunks at once.
+        std::thread writer;
     
         while(true) {
     
@@ -287,22 +330,39 @@ void StreamSorter<Message>::stream_sort(istream& stream_in, ostream& stream_out,
             // Do a sort of the data we grabbed
             this->sort(thread_buffer);
             
-            // Save it to a temp file.
-            string temp_name = temp_file::create();
-            ofstream temp_stream(temp_name);
-            // OK to save as one massive group here.
-            // TODO: This write could also be in a thread.
-            vg::io::write_buffered(temp_stream, thread_buffer, 0);
+            if (writer.joinable()) {
+                // Wait for our last chunk to be written
+                writer.join();
+            }
             
-            #pragma omp critical (outstanding_temp_files)
-            {
+            writer = std::thread([&](vector<Message> sorted) {
+                // Save it to a temp file.
+                string temp_name = temp_file::create();
+                group_starts_t group_starts;
+                {
+                    ofstream temp_stream(temp_name);
+                    // Write in normal-sized groups so the merge can seek to where it wants to start
+                    emitter_t emitter(temp_stream);
+                    record_group_starts(emitter, group_starts);
+                    for (auto& msg : sorted) {
+                        emitter.write(std::move(msg));
+                    }
+                }
+                
+                std::lock_guard<std::mutex> lock(temp_files_mutex);
                 // Remember the temp file name
                 outstanding_temp_files.push_back(temp_name);
                 // Remember the messages in the file, for progress purposes
-                messages_per_file[temp_name] = thread_buffer.size();
+                messages_per_file[temp_name] = sorted.size();
+                // Remember where it can be entered
+                group_starts_per_file[temp_name] = std::move(group_starts);
                 // Remember how many messages we found in the total
-                total_messages_read += thread_buffer.size();
-            }
+                total_messages_read += sorted.size();
+            }, std::move(thread_buffer));
+        }
+        
+        if (writer.joinable()) {
+            writer.join();
         }
     }
     
@@ -312,11 +372,23 @@ void StreamSorter<Message>::stream_sort(istream& stream_in, ostream& stream_out,
     
     while (outstanding_temp_files.size() > max_fan_in) {
         // We can't merge them all at once, so merge subsets of them.
-        outstanding_temp_files = streaming_merge(outstanding_temp_files, &messages_per_file);
+        outstanding_temp_files = streaming_merge(outstanding_temp_files, &messages_per_file, &group_starts_per_file);
     }
     
     // Now we can merge (and maybe index) the final layer of the tree.
     
+    // Every merge thread needs all the files open at once (plus its output).
+    // A single file is already in order, so splitting it up gains nothing.
+    size_t merge_threads = min((size_t) get_thread_count(), max_fan_in / (outstanding_temp_files.size() + 1));
+    if (merge_threads > 1 && outstanding_temp_files.size() > 1) {
+        // Split up the merge by node ID ranges
+        parallel_merge(outstanding_temp_files, group_starts_per_file, merge_threads, stream_out, index_to, total_messages_read);
+        for (auto& filename : outstanding_temp_files) {
+            temp_file::remove(filename);
+        }
+        return;
+    }
+    
     // Open up cursors into all the files.
     list<ifstream> temp_ifstreams;
     list<cursor_t> temp_cursors;
@@ -377,9 +449,26 @@ void StreamSorter<Message>::open_all(const vector<string>& filenames, list<ifstr
 }
 
 template<typename Message>
-void StreamSorter<Message>::streaming_merge(list<cursor_t>& cursors, emitter_t& emitter, size_t expected_messages) {
+void StreamSorter<Message>::record_group_starts(emitter_t& emitter, group_starts_t& group_starts) const {
+    // The emitter shows us all of a group's messages before it shows us the
+    // group, so we open an entry on the first message and fill in its virtual
+    // offset when the group comes.
+    emitter.on_message([this,&group_starts](const Message& m) {
+        if (group_starts.empty() || group_starts.back().second != -1) {
+            group_starts.emplace_back(get_min_position(m).node_id(), -1);
+        }
+    });
+    
+    emitter.on_group([&group_starts](int64_t start_vo, int64_t past_end_vo) {
+        group_starts.back().second = start_vo;
+    });
+}
+
+template<typename Message>
+size_t StreamSorter<Message>::merge_cursors(list<cursor_t>& cursors, emitter_t& emitter,
+                                            const function<bool(const Message&)>& stop_before,
+                                            const function<void(size_t)>& on_emit) const {
 
-    create_progress("merge " + to_string(cursors.size()) + " files", expected_messages == 0 ? 1 : expected_messages);
     // Count the messages we actually see
     size_t observed_messages = 0;
 
@@ -406,6 +495,11 @@ void StreamSorter<Message>::streaming_merge(list<cursor_t>& cursors, emitter_t&
     while(!cursor_queue.empty() && cursor_queue.top()->has_current()) {
         // Until we have run out of data in all the temp files
         
+        if (stop_before && stop_before(*(*cursor_queue.top()))) {
+            // Everything left belongs to someone else
+            break;
+        }
+        
         // Pop off the winning cursor
         cursor_t* winner = cursor_queue.top();
         cursor_queue.pop();
@@ -420,10 +514,24 @@ void StreamSorter<Message>::streaming_merge(list<cursor_t>& cursors, emitter_t&
         // TODO: Maybe keep it off the heap for the next loop somehow if it still wins
         
         observed_messages++;
+        if (on_emit) {
+            on_emit(observed_messages);
+        }
+    }
+    
+    return observed_messages;
+}
+
+template<typename Message>
+void StreamSorter<Message>::streaming_merge(list<cursor_t>& cursors, emitter_t& emitter, size_t expected_messages) {
+
+    create_progress("merge " + to_string(cursors.size()) + " files", expected_messages == 0 ? 1 : expected_messages);
+    
+    merge_cursors(cursors, emitter, nullptr, [&](size_t observed_messages) {
         if (expected_messages != 0) {
             update_progress(observed_messages);
         }
-    }
+    });
     
     // We finished the files, so say we're done.
     // TODO: Should we warn/fail if we expected the wrong number of messages?
@@ -433,7 +541,8 @@ void StreamSorter<Message>::streaming_merge(list<cursor_t>& cursors, emitter_t&
 }
 
 template<typename Message>
-vector<string> StreamSorter<Message>::streaming_merge(const vector<string>& temp_files_in, unordered_map<string, size_t>* messages_per_file) {
+vector<string> StreamSorter<Message>::streaming_merge(const vector<string>& temp_files_in, unordered_map<string, size_t>* messages_per_file,
+                                                      unordered_map<string, group_starts_t>* group_starts_per_file) {
     
     // What are the names of the merged files we create?
     vector<string> temp_files_out;
@@ -446,7 +555,7 @@ vector<string> StreamSorter<Message>::streaming_merge(const vector<string>& temp
         // Open up cursors into all the files.
         list<ifstream> temp_ifstreams;
         list<cursor_t> temp_cursors;
-        open_all(vector<string>(&temp_files_out[start_file], &temp_files_out[start_file + file_count]), temp_ifstreams, temp_cursors);
+        open_all(vector<string>(temp_files_in.begin() + start_file, temp_files_in.begin() + start_file + file_count), temp_ifstreams, temp_cursors);
         
         // Work out how many messages to expect
         size_t expected_messages = 0;
@@ -461,19 +570,27 @@ vector<string> StreamSorter<Message>::streaming_merge(const vector<string>& temp
         ofstream out_stream(out_file_name);
         temp_files_out.push_back(out_file_name);
         
-        // Make an output emitter
-        emitter_t emitter(out_stream);
-        
-        // Merge the cursors into the emitter
-        streaming_merge(temp_cursors, emitter, expected_messages);
-        
-        // The output file will be flushed and finished automatically when the emitter goes away.
+        {
+            // Make an output emitter
+            emitter_t emitter(out_stream);
+            if (group_starts_per_file != nullptr) {
+                record_group_starts(emitter, (*group_starts_per_file)[out_file_name]);
+            }
+            
+            // Merge the cursors into the emitter
+            streaming_merge(temp_cursors, emitter, expected_messages);
+            
+            // The output file will be flushed and finished automatically when the emitter goes away.
+        }
         
         // Clean up the input files we used
         temp_cursors.clear();
         temp_ifstreams.clear();
-        for (size_t i = start_file; i < file_count; i++) {
+        for (size_t i = start_file; i < start_file + file_count; i++) {
             temp_file::remove(temp_files_in.at(i));
+            if (group_starts_per_file != nullptr) {
+                group_starts_per_file->erase(temp_files_in.at(i));
+            }
         }
         
         if (messages_per_file != nullptr) {
@@ -486,6 +603,171 @@ vector<string> StreamSorter<Message>::streaming_merge(const vector<string>& temp
         
 }
 
+template<typename Message>
+void StreamSorter<Message>::parallel_merge(const vector<string>& temp_files, const unordered_map<string, group_starts_t>& group_starts_per_file,
+                                           size_t thread_count, ostream& stream_out, StreamIndex<Message>* index_to, size_t expected_messages) {
+    
+    // Groups all hold about the same number of messages, so we can split the
+    // work evenly at quantiles of their starting node IDs.
+    vector<id_t> group_start_ids;
+    for (auto& filename : temp_files) {
+        for (auto& group_start : group_starts_per_file.at(filename)) {
+            group_start_ids.push_back(group_start.first);
+        }
+    }
+    std::sort(group_start_ids.begin(), group_start_ids.end());
+    
+    // Each range runs from one splitter up to the next, with open ends on either side
+    vector<id_t> splitters;
+    size_t range_target = thread_count * ranges_per_merge_thread;
+    for (size_t i = 1; i < range_target && !group_start_ids.empty(); i++) {
+        id_t splitter = group_start_ids[i * group_start_ids.size() / range_target];
+        if (splitters.empty() || splitter > splitters.back()) {
+            splitters.push_back(splitter);
+        }
+    }
+    size_t range_count = splitters.size() + 1;
+    
+    // Each range gets merged into its own file
+    vector<string> range_files(range_count);
+    // And we remember the min and max node IDs and start and past-end
+    // virtual offsets of each group in each file, for the index.
+    vector<vector<tuple<id_t, id_t, int64_t, int64_t>>> range_groups(range_count);
+    
+    create_progress("merge " + to_string(temp_files.size()) + " files in " + to_string(range_count) + " ranges",
+                    expected_messages == 0 ? 1 : expected_messages);
+    size_t observed_messages = 0;
+    
+#pragma omp parallel for schedule(dynamic, 1) num_threads(thread_count)
+    for (size_t i = 0; i < range_count; i++) {
+        // Open up cursors into all the files.
+        list<ifstream> temp_ifstreams;
+        list<cursor_t> temp_cursors;
+        open_all(temp_files, temp_ifstreams, temp_cursors);
+        
+        if (i > 0) {
+            // Skip ahead to the start of the range in each file
+            id_t range_start = splitters[i - 1];
+            auto filename = temp_files.begin();
+            for (auto& cursor : temp_cursors) {
+                // The range can start in the last group that starts before it
+                auto& group_starts = group_starts_per_file.at(*filename);
+                auto next_group = std::lower_bound(group_starts.begin(), group_starts.end(), range_start,
+                                                   [](const pair<id_t, int64_t>& group_start, const id_t& id) {
+                    return group_start.first < id;
+                });
+                if (next_group != group_starts.begin() && !cursor.seek_group((next_group - 1)->second)) {
+                    throw runtime_error("Could not seek in sorted temp file " + *filename);
+                }
+                while (cursor.has_current() && get_min_position(*cursor).node_id() < range_start) {
+                    cursor.take();
+                }
+                ++filename;
+            }
+        }
+        
+        range_files[i] = temp_file::create();
+        ofstream out_stream(range_files[i]);
+        
+        // Track the IDs in each group we write
+        auto& groups = range_groups[i];
+        id_t group_min_id = numeric_limits<id_t>::max();
+        id_t group_max_id = numeric_limits<id_t>::min();
+        
+        size_t unreported_messages = 0;
+        {
+            emitter_t emitter(out_stream);
+            
+            if (index_to != nullptr) {
+                emitter.on_message([&](const Message& m) {
+                    IDScanner<Message>::scan(m, [&](const id_t& found) {
+                        group_min_id = min(group_min_id, found);
+                        group_max_id = max(group_max_id, found);
+                        return true;
+                    });
+                });
+                emitter.on_group([&](int64_t start_vo, int64_t past_end_vo) {
+                    groups.emplace_back(group_min_id, group_max_id, start_vo, past_end_vo);
+                    group_min_id = numeric_limits<id_t>::max();
+                    group_max_id = numeric_limits<id_t>::min();
+                });
+            }
+            
+            function<bool(const Message&)> past_range = nullptr;
+            if (i < splitters.size()) {
+                id_t range_past_end = splitters[i];
+                past_range = [&](const Message& m) {
+                    return get_min_position(m).node_id() >= range_past_end;
+                };
+            }
+            
+            merge_cursors(temp_cursors, emitter, past_range, [&](size_t merged) {
+                unreported_messages++;
+                if (unreported_messages == 10000) {
+#pragma omp critical (progress)
+                    {
+                        observed_messages += unreported_messages;
+                        update_progress(observed_messages);
+                    }
+                    unreported_messages = 0;
+                }
+            });
+        }
+        
+#pragma omp critical (progress)
+        {
+            observed_messages += unreported_messages;
+            update_progress(observed_messages);
+        }
+    }
+    
+    update_progress(expected_messages == 0 ? 1 : expected_messages);
+    destroy_progress();
+    
+    // Every BGZF file ends in the same empty block as an EOF marker. We drop
+    // them while we stick the range files together, and put one at the end.
+    static const string bgzf_eof = string("\037\213\010\004\000\000\000\000\000\377\006\000\102\103\002\000\033\000\003\000\000\000\000\000\000\000\000\000", 28);
+    
+    vector<char> copy_buffer(1 << 20);
+    int64_t bytes_written = 0;
+    for (size_t i = 0; i < range_count; i++) {
+        ifstream range_in(range_files[i], std::ios_base::binary);
+        range_in.seekg(0, range_in.end);
+        int64_t to_copy = range_in.tellg();
+        if (to_copy >= (int64_t) bgzf_eof.size()) {
+            string tail(bgzf_eof.size(), '\0');
+            range_in.seekg(to_copy - bgzf_eof.size());
+            range_in.read(&tail[0], tail.size());
+            if (tail == bgzf_eof) {
+                to_copy -= bgzf_eof.size();
+            }
+        }
+        range_in.seekg(0);
+        
+        if (index_to != nullptr) {
+            // Groups move over by the bytes that come before the file.
+            // Virtual offsets keep the compressed offset in the high 48 bits.
+            int64_t shift = bytes_written << 16;
+            for (auto& group : range_groups[i]) {
+                index_to->add_group(get<0>(group), get<1>(group), get<2>(group) + shift, get<3>(group) + shift);
+            }
+        }
+        
+        for (int64_t copied = 0; copied < to_copy; ) {
+            size_t chunk = min<int64_t>(copy_buffer.size(), to_copy - copied);
+            range_in.read(copy_buffer.data(), chunk);
+            stream_out.write(copy_buffer.data(), chunk);
+            copied += chunk;
+        }
+        bytes_written += to_copy;
+        
+        range_in.close();
+        temp_file::remove(range_files[i]);
+    }
+    stream_out.write(bgzf_eof.data(), bgzf_eof.size());
+    stream_out.flush();
+}
+
 template<typename Message>
 bool StreamSorter<Message>::less_than(const Message &a, const Message &b) const {
     return less_than(get_min_position(a), get_min_position(b));
@@ -14,6 +14,7 @@
 
 #include <unistd.h>
 #include <getopt.h>
+#include <sstream>
 
 using namespace vg;
 using namespace vg::subcommand;
@@ -232,6 +233,18 @@ int main_annotate(int argc, char** argv) {
             }
             
             cout << "name\tlength.bp\tunaligned.bp\tknown.nodes\tknown.bp\tnovel.nodes\tnovel.bp" << endl;
+            
+            // Make per-thread buffers for the table lines, so threads only
+            // take turns writing when a buffer fills up.
+            vector<stringstream> line_buffers(vg::get_thread_count());
+            vector<size_t> line_counts(vg::get_thread_count(), 0);
+            auto flush_lines = [&](size_t thread_num) {
+#pragma omp critical (novelty_output)
+                cout << line_buffers[thread_num].str();
+                line_buffers[thread_num].str("");
+                line_counts[thread_num] = 0;
+            };
+            
             function<void(Alignment&)> lambda = [&](Alignment& aln) {
                 // count the number of positions in the alignment that aren't in the graph
                 int total_bp = aln.sequence().size();
@@ -254,17 +267,25 @@ int main_annotate(int argc, char** argv) {
                         unaligned_bp += mapping_to_length(mapping);
                     }
                 }
-                cout << aln.name() << "\t"
+                size_t thread_num = omp_get_thread_num();
+                line_buffers[thread_num] << aln.name() << "\t"
                 << total_bp << "\t"
                 << unaligned_bp << "\t"
                 << known_nodes << "\t"
                 << known_bp << "\t"
                 << novel_nodes << "\t"
-                << novel_bp << endl;
+                << novel_bp << "\n";
+                if (++line_counts[thread_num] >= 1000) {
+                    flush_lines(thread_num);
+                }
             };
             get_input_file(gam_name, [&](istream& in) {
-                vg::io::for_each(in, lambda);
+                vg::io::for_each_parallel(in, lambda);
             });
+            for (size_t i = 0; i < line_buffers.size(); i++) {
+                // Finish each buffer
+                flush_lines(i);
+            }
         } else {
             // We are annotating the actual reads
             
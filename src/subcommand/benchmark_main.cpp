@@ -7,15 +7,34 @@
 #include <unistd.h>
 #include <getopt.h>
 
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <regex>
+#include <set>
+#include <sstream>
 
 #include "subcommand.hpp"
 
 #include "../benchmark.hpp"
 #include "../version.hpp"
 
+#include "../aligner.hpp"
+#include "../algorithms/chain_items.hpp"
 #include "../gbwt_extender.hpp"
 #include "../gbwt_helper.hpp"
+#include "../index_registry.hpp"
+#include "../integrated_snarl_finder.hpp"
+#include "../minimizer_mapper.hpp"
+#include "../snarl_distance_index.hpp"
+#include "../surjector.hpp"
+
+#include <bdsg/hash_graph.hpp>
+#include <bdsg/overlays/path_position_overlays.hpp>
+#include <gbwtgraph/index.h>
+#include <vg/io/alignment_io.hpp>
+#include <vg/io/protobuf_emitter.hpp>
+#include <vg/io/stream.hpp>
 
 
 
@@ -23,32 +42,324 @@ using namespace std;
 using namespace vg;
 using namespace vg::subcommand;
 
+/// Expose the seeding stages of the MinimizerMapper so we can benchmark them alone
+class SeedingBenchmarkMapper : public MinimizerMapper {
+public:
+    using MinimizerMapper::MinimizerMapper;
+    using MinimizerMapper::Minimizer;
+    using MinimizerMapper::find_minimizers;
+    using MinimizerMapper::sort_minimizers_by_score;
+    using MinimizerMapper::find_seeds;
+    using MinimizerMapper::to_anchors;
+};
+
+/// Deterministic pseudo-random numbers, so every run benchmarks the same inputs
+class BenchmarkRNG {
+public:
+    /// Get the next number
+    uint32_t next() {
+        // Try out <https://stackoverflow.com/a/69142783>
+        bits = (bits * 73 + 1375) % 477218579;
+        return bits;
+    }
+    
+    /// Get a base
+    char base() {
+        return "ACGT"[next() & 0x3];
+    }
+    
+    /// Get a base other than the given one
+    char other_base(char base) {
+        size_t index = string("ACGT").find(base);
+        return "ACGT"[(index + 1 + next() % 3) % 4];
+    }
+    
+    /// Get a sequence of bases
+    string sequence(size_t length) {
+        string seq(length, 'A');
+        for (auto& c : seq) {
+            c = base();
+        }
+        return seq;
+    }
+    
+protected:
+    uint32_t bits = 0xcafebebe;
+};
+
+/**
+ * A synthetic graph of SNP bubbles between 32 bp nodes, with two haplotypes
+ * through it, the first of which goes around the start of the graph again at
+ * the end so some minimizers have multiple hits. It is indexed the way Giraffe
+ * would index it, and reads cut out of the haplotypes are run through each
+ * mapping stage ahead of time, so each stage can be benchmarked alone.
+ */
+struct GiraffeBenchmarkFixture {
+    
+    /// The results of the mapping stages for one read
+    struct SeededRead {
+        Alignment read;
+        vector<SeedingBenchmarkMapper::Minimizer> minimizers;
+        vector<size_t> minimizer_score_order;
+        vector<SeedingBenchmarkMapper::Seed> seeds;
+        vector<SnarlDistanceIndexClusterer::Cluster> clusters;
+        vector<algorithms::Anchor> anchors;
+        /// For each cluster, its anchors sorted and shadowed for chaining
+        vector<vector<size_t>> cluster_anchors;
+        
+        /// View the minimizers the way the mapper does, in score order
+        VectorView<SeedingBenchmarkMapper::Minimizer> minimizer_view() const {
+            return {minimizers, minimizer_score_order};
+        }
+    };
+    
+    GiraffeBenchmarkFixture(size_t segment_count = 2000, size_t read_count = 1000);
+    
+    gbwt::GBWT index;
+    gbwtgraph::SequenceSource source;
+    gbwtgraph::GBWTGraph graph;
+    SnarlDistanceIndex distance_index;
+    gbwtgraph::DefaultMinimizerIndex minimizer_index;
+    unique_ptr<SeedingBenchmarkMapper> mapper;
+    Aligner aligner;
+    vector<SeededRead> reads;
+    
+    /// Read distance limit to cluster with, as in Giraffe
+    size_t distance_limit = 200;
+    
+    /// Count up all the seeds in all the reads
+    size_t seed_count() const;
+    /// Count up all the clusters in all the reads
+    size_t cluster_count() const;
+};
+
+GiraffeBenchmarkFixture::GiraffeBenchmarkFixture(size_t segment_count, size_t read_count) :
+    minimizer_index(IndexingParameters::minimizer_k, IndexingParameters::minimizer_w, false) {
+    
+    BenchmarkRNG rng;
+    size_t node_length = 32;
+    size_t read_length = 150;
+    
+    // Each segment is a shared node followed by the two nodes of a SNP, and a
+    // final shared node closes off the last SNP.
+    auto shared_node = [](size_t segment) {
+        return (nid_t) (3 * segment + 1);
+    };
+    for (size_t i = 0; i < segment_count; i++) {
+        source.add_node(shared_node(i), rng.sequence(node_length));
+        char ref = rng.base();
+        source.add_node(shared_node(i) + 1, string(1, ref));
+        source.add_node(shared_node(i) + 2, string(1, rng.other_base(ref)));
+    }
+    source.add_node(shared_node(segment_count), rng.sequence(node_length));
+    
+    // The first haplotype takes every reference allele, and the second takes
+    // about half the alts.
+    std::vector<gbwt::vector_type> paths(2);
+    for (size_t i = 0; i < segment_count; i++) {
+        for (size_t haplotype = 0; haplotype < paths.size(); haplotype++) {
+            bool take_alt = haplotype == 1 && (rng.next() & 0x1);
+            paths[haplotype].push_back(gbwt::Node::encode(shared_node(i), false));
+            paths[haplotype].push_back(gbwt::Node::encode(shared_node(i) + (take_alt ? 2 : 1), false));
+        }
+    }
+    for (auto& path : paths) {
+        path.push_back(gbwt::Node::encode(shared_node(segment_count), false));
+    }
+    size_t repeat_segments = segment_count / 10;
+    size_t repeat_count = 4;
+    for (size_t repeat = 0; repeat < repeat_count; repeat++) {
+        for (size_t i = 0; i < repeat_segments; i++) {
+            paths[0].push_back(gbwt::Node::encode(shared_node(i), false));
+            paths[0].push_back(gbwt::Node::encode(shared_node(i) + 1, false));
+        }
+    }
+    index = get_gbwt(paths);
+    graph = gbwtgraph::GBWTGraph(index, source);
+    
+    // Index it the way Giraffe would
+    IntegratedSnarlFinder snarl_finder(graph);
+    fill_in_distance_index(&distance_index, &graph, &snarl_finder);
+    gbwtgraph::index_haplotypes(graph, minimizer_index, [&](const pos_t& pos) -> gbwtgraph::Payload {
+        return MIPayload::encode(get_minimizer_distances(distance_index, pos));
+    });
+    mapper.reset(new SeedingBenchmarkMapper(graph, minimizer_index, &distance_index));
+    SnarlDistanceIndexClusterer clusterer(distance_index, &graph);
+    
+    // Cut reads out of the haplotypes
+    std::vector<std::string> haplotype_sequences;
+    for (auto& path : paths) {
+        haplotype_sequences.emplace_back();
+        for (auto& visit : path) {
+            haplotype_sequences.back() += source.get_sequence(gbwt::Node::id(visit));
+        }
+    }
+    
+    // And run them through the mapping stages. The views we make refer to
+    // the reads' vectors, so the reads can't move once we start.
+    reads.resize(read_count);
+    for (size_t i = 0; i < reads.size(); i++) {
+        auto& seeded = reads[i];
+        auto& haplotype_sequence = haplotype_sequences[i % haplotype_sequences.size()];
+        size_t start = rng.next() % (haplotype_sequence.size() - read_length);
+        seeded.read.set_sequence(haplotype_sequence.substr(start, read_length));
+        
+        Funnel funnel;
+        seeded.minimizers = mapper->find_minimizers(seeded.read.sequence(), funnel);
+        seeded.minimizer_score_order = mapper->sort_minimizers_by_score(seeded.minimizers);
+        seeded.seeds = mapper->find_seeds(seeded.minimizer_view(), seeded.read, funnel);
+        seeded.clusters = clusterer.cluster_seeds(seeded.seeds, distance_limit);
+        seeded.anchors = mapper->to_anchors(seeded.read, seeded.minimizer_view(), seeded.seeds);
+        for (auto& cluster : seeded.clusters) {
+            seeded.cluster_anchors.push_back(cluster.seeds);
+            algorithms::sort_and_shadow(seeded.anchors, seeded.cluster_anchors.back());
+        }
+    }
+}
+
+size_t GiraffeBenchmarkFixture::seed_count() const {
+    size_t count = 0;
+    for (auto& seeded : reads) {
+        count += seeded.seeds.size();
+    }
+    return count;
+}
+
+size_t GiraffeBenchmarkFixture::cluster_count() const {
+    size_t count = 0;
+    for (auto& seeded : reads) {
+        count += seeded.clusters.size();
+    }
+    return count;
+}
+
+/**
+ * A small synthetic DAG of SNPs between 20 bp nodes, with edges to delete
+ * each SNP, and a reference path through it. Reads run through the whole
+ * graph, and are aligned ahead of time, for benchmarking aligners,
+ * surjection, and alignment serialization.
+ */
+struct AlignmentBenchmarkFixture {
+    AlignmentBenchmarkFixture(size_t segment_count = 30, size_t read_count = 20);
+    
+    bdsg::HashGraph graph;
+    path_handle_t reference;
+    Aligner aligner;
+    /// The reads, unaligned
+    vector<Alignment> reads;
+    /// The reads, aligned to the graph
+    vector<Alignment> aligned;
+};
+
+AlignmentBenchmarkFixture::AlignmentBenchmarkFixture(size_t segment_count, size_t read_count) {
+    
+    BenchmarkRNG rng;
+    size_t node_length = 20;
+    size_t errors_per_read = 3;
+    
+    reference = graph.create_path_handle("ref");
+    
+    // Remember the shared node before and the two alleles of each SNP
+    vector<tuple<handle_t, handle_t, handle_t>> snps;
+    handle_t shared = graph.create_handle(rng.sequence(node_length));
+    graph.append_step(reference, shared);
+    for (size_t i = 0; i < segment_count; i++) {
+        char ref_base = rng.base();
+        handle_t ref = graph.create_handle(string(1, ref_base));
+        handle_t alt = graph.create_handle(string(1, rng.other_base(ref_base)));
+        handle_t next = graph.create_handle(rng.sequence(node_length));
+        graph.create_edge(shared, ref);
+        graph.create_edge(shared, alt);
+        graph.create_edge(ref, next);
+        graph.create_edge(alt, next);
+        graph.create_edge(shared, next);
+        graph.append_step(reference, ref);
+        graph.append_step(reference, next);
+        snps.emplace_back(shared, ref, alt);
+        shared = next;
+    }
+    
+    // Walk reads through the graph, taking a mix of reference alleles, alt
+    // alleles, and deletions, and add some errors.
+    for (size_t i = 0; i < read_count; i++) {
+        string sequence;
+        for (auto& snp : snps) {
+            sequence += graph.get_sequence(get<0>(snp));
+            switch (rng.next() % 4) {
+            case 0:
+            case 1:
+                sequence += graph.get_sequence(get<1>(snp));
+                break;
+            case 2:
+                sequence += graph.get_sequence(get<2>(snp));
+                break;
+            default:
+                // Delete the SNP
+                break;
+            }
+        }
+        sequence += graph.get_sequence(shared);
+        for (size_t j = 0; j < errors_per_read; j++) {
+            size_t offset = rng.next() % sequence.size();
+            sequence[offset] = rng.other_base(sequence[offset]);
+        }
+        
+        reads.emplace_back();
+        reads.back().set_name("read" + std::to_string(i));
+        reads.back().set_sequence(sequence);
+        
+        aligned.push_back(reads.back());
+        aligner.align_global_banded(aligned.back(), graph, 0, true);
+    }
+}
+
+/// A group of benchmarks that share their setup
+struct BenchmarkCase {
+    /// Name to select the case by
+    string name;
+    /// Set up and run the benchmarks, adding their results. A case that adds
+    /// more than one result gives each a fixed label in its key.
+    function<void(vector<BenchmarkResult>&)> run;
+};
+
 void help_benchmark(char** argv) {
     cerr << "usage: " << argv[0] << " benchmark [options] >report.tsv" << endl
          << "options:" << endl
+         << "    -f, --filter REGEX     only run benchmark cases with names matching REGEX (may repeat)" << endl
+         << "    -l, --list             list the benchmark cases and exit" << endl
+         << "    -j, --json             report results as JSON instead of TSV" << endl
+         << "    -b, --baseline FILE    compare scores against a TSV report from a previous run, and exit" << endl
+         << "                           with an error if any benchmark has regressed or is missing" << endl
+         << "    -r, --max-regression F fraction of its baseline score a benchmark may lose before it has regressed [0.1]" << endl
          << "    -p, --progress         show progress" << endl;
 }
 
 int main_benchmark(int argc, char** argv) {
 
     bool show_progress = false;
-    
-    // Which experiments should we run?
-    bool sort_and_order_experiment = false;
-    bool get_sequence_experiment = true;
+    vector<regex> filters;
+    bool list_cases = false;
+    bool json_output = false;
+    string baseline_filename;
+    double max_regression = 0.1;
     
     int c;
     optind = 2; // force optind past command positional argument
     while (true) {
         static struct option long_options[] =
             {
+                {"filter", required_argument, 0, 'f'},
+                {"list", no_argument, 0, 'l'},
+                {"json", no_argument, 0, 'j'},
+                {"baseline", required_argument, 0, 'b'},
+                {"max-regression", required_argument, 0, 'r'},
                 {"progress",  no_argument, 0, 'p'},
                 {"help", no_argument, 0, 'h'},
                 {0, 0, 0, 0}
             };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "ph?",
+        c = getopt_long (argc, argv, "f:ljb:r:ph?",
                          long_options, &option_index);
 
         /* Detect the end of the options. */
@@ -58,6 +369,31 @@ int main_benchmark(int argc, char** argv) {
         switch (c)
         {
 
+        case 'f':
+            try {
+                filters.emplace_back(optarg);
+            } catch (const regex_error& e) {
+                cerr << "error:[vg benchmark] invalid filter regex " << optarg << ": " << e.what() << endl;
+                exit(1);
+            }
+            break;
+            
+        case 'l':
+            list_cases = true;
+            break;
+            
+        case 'j':
+            json_output = true;
+            break;
+            
+        case 'b':
+            baseline_filename = optarg;
+            break;
+            
+        case 'r':
+            max_regression = parse<double>(optarg);
+            break;
+
         case 'p':
             show_progress = true;
             break;
@@ -81,106 +417,355 @@ int main_benchmark(int argc, char** argv) {
         exit(1);
     }
     
+    // Load the baseline before spending time on benchmarks
+    map<string, BenchmarkResult> baseline;
+    if (!baseline_filename.empty()) {
+        ifstream baseline_stream(baseline_filename);
+        if (!baseline_stream) {
+            cerr << "error:[vg benchmark] could not open baseline " << baseline_filename << endl;
+            exit(1);
+        }
+        try {
+            for (auto& result : read_benchmark_tsv(baseline_stream)) {
+                baseline[result.key] = result;
+            }
+        } catch (const exception& e) {
+            cerr << "error:[vg benchmark] could not read baseline " << baseline_filename << ": " << e.what() << endl;
+            exit(1);
+        }
+    }
+    
     // Do all benchmarking on one thread
     omp_set_num_threads(1);
     
     // Turn on nested parallelism, so we can parallelize over VCFs and over alignment bands
     omp_set_nested(1);
     
-    vector<BenchmarkResult> results;
-    
-    // We're doing long alignments so we need to raise the WFA score caps
-    WFAExtender::ErrorModel error_model = WFAExtender::default_error_model;
-    error_model.mismatches.max = std::numeric_limits<int32_t>::max();
-    error_model.gaps.max = std::numeric_limits<int32_t>::max();
-    error_model.gap_length.max = std::numeric_limits<int32_t>::max();
-    
-    size_t node_length = 32;
+    // Build the synthetic inputs only if a selected case needs them
+    unique_ptr<GiraffeBenchmarkFixture> giraffe_fixture;
+    auto get_giraffe_fixture = [&]() -> GiraffeBenchmarkFixture& {
+        if (!giraffe_fixture) {
+            giraffe_fixture.reset(new GiraffeBenchmarkFixture());
+        }
+        return *giraffe_fixture;
+    };
+    unique_ptr<AlignmentBenchmarkFixture> alignment_fixture;
+    auto get_alignment_fixture = [&]() -> AlignmentBenchmarkFixture& {
+        if (!alignment_fixture) {
+            alignment_fixture.reset(new AlignmentBenchmarkFixture());
+        }
+        return *alignment_fixture;
+    };
     
-    for (size_t node_count = 10; node_count <= 320; node_count *= 2) {
+    vector<BenchmarkCase> cases;
     
-        // Prepare a GBWT of one long path
-        std::vector<gbwt::vector_type> paths;
-        paths.emplace_back();
-        for (size_t i = 0; i < node_count; i++) {
-            paths.back().push_back(gbwt::Node::encode(i + 1, false));
-        }
-        gbwt::GBWT index = get_gbwt(paths);
+    cases.push_back({"wfa_connect", [&](vector<BenchmarkResult>& results) {
+        // We're doing long alignments so we need to raise the WFA score caps
+        WFAExtender::ErrorModel error_model = WFAExtender::default_error_model;
+        error_model.mismatches.max = std::numeric_limits<int32_t>::max();
+        error_model.gaps.max = std::numeric_limits<int32_t>::max();
+        error_model.gap_length.max = std::numeric_limits<int32_t>::max();
         
-        // Turn it into a GBWTGraph.
-        // Make a SequenceSource we will consult later for getting sequence.
-        gbwtgraph::SequenceSource source;
-        uint32_t bits = 0xcafebebe;
-        auto step_rng = [&bits]() {
-            // Try out <https://stackoverflow.com/a/69142783>
-            bits = (bits * 73 + 1375) % 477218579;
-        };
-        for (size_t i = 0; i < node_count; i++) {
-            std::stringstream ss;
-            for (size_t j = 0; j < node_length; j++) {
-                // Pick a deterministic character
-                ss << "ACGT"[bits & 0x3];
-                step_rng();
-            }
-            source.add_node(i + 1, ss.str());
-        }
-        // And then make the graph
-        gbwtgraph::GBWTGraph graph(index, source);
+        size_t node_length = 32;
         
-        // Decide what we are going to align
-        pos_t from_pos = make_pos_t(1, false, 3);
-        pos_t to_pos = make_pos_t(node_count, false, 11);
+        for (size_t node_count = 10; node_count <= 320; node_count *= 2) {
         
-        // Synthesize a sequence
-        std::stringstream seq_stream;
-        seq_stream << source.get_sequence(get_id(from_pos)).substr(get_offset(from_pos) + 1);
-        for (nid_t i = get_id(from_pos) + 1; i < get_id(to_pos); i++) {
-            std::string seq = source.get_sequence(i);
-            // Add some errors
-            if (bits & 0x1) {
-                int offset = bits % seq.size();
-                step_rng();
-                char replacement = "ACGT"[bits & 0x3];
-                step_rng();
+            // Prepare a GBWT of one long path
+            std::vector<gbwt::vector_type> paths;
+            paths.emplace_back();
+            for (size_t i = 0; i < node_count; i++) {
+                paths.back().push_back(gbwt::Node::encode(i + 1, false));
+            }
+            gbwt::GBWT index = get_gbwt(paths);
+            
+            // Turn it into a GBWTGraph.
+            // Make a SequenceSource we will consult later for getting sequence.
+            gbwtgraph::SequenceSource source;
+            uint32_t bits = 0xcafebebe;
+            auto step_rng = [&bits]() {
+                // Try out <https://stackoverflow.com/a/69142783>
+                bits = (bits * 73 + 1375) % 477218579;
+            };
+            for (size_t i = 0; i < node_count; i++) {
+                std::stringstream ss;
+                for (size_t j = 0; j < node_length; j++) {
+                    // Pick a deterministic character
+                    ss << "ACGT"[bits & 0x3];
+                    step_rng();
+                }
+                source.add_node(i + 1, ss.str());
+            }
+            // And then make the graph
+            gbwtgraph::GBWTGraph graph(index, source);
+            
+            // Decide what we are going to align
+            pos_t from_pos = make_pos_t(1, false, 3);
+            pos_t to_pos = make_pos_t(node_count, false, 11);
+            
+            // Synthesize a sequence
+            std::stringstream seq_stream;
+            seq_stream << source.get_sequence(get_id(from_pos)).substr(get_offset(from_pos) + 1);
+            for (nid_t i = get_id(from_pos) + 1; i < get_id(to_pos); i++) {
+                std::string seq = source.get_sequence(i);
+                // Add some errors
                 if (bits & 0x1) {
-                    seq[offset] = replacement;
-                } else {
+                    int offset = bits % seq.size();
+                    step_rng();
+                    char replacement = "ACGT"[bits & 0x3];
                     step_rng();
                     if (bits & 0x1) {
-                        seq.insert(offset, 1, replacement);
+                        seq[offset] = replacement;
                     } else {
-                        seq.erase(offset);
+                        step_rng();
+                        if (bits & 0x1) {
+                            seq.insert(offset, 1, replacement);
+                        } else {
+                            seq.erase(offset);
+                        }
                     }
                 }
+                step_rng();
+                // And keep the sequence
+                seq_stream << seq;
             }
-            step_rng();
-            // And keep the sequence
-            seq_stream << seq;
+            seq_stream << source.get_sequence(get_id(to_pos)).substr(0, get_offset(to_pos)); 
+            
+            std::string to_connect = seq_stream.str();
+            
+            // Make the Aligner and Extender
+            Aligner aligner;
+            WFAExtender extender(graph, aligner, error_model);
+            
+            results.push_back(run_benchmark("connect() on " + std::to_string(node_count) + " node sequence", 1, [&]() {
+                // Do the alignment
+                WFAAlignment aligned = extender.connect(to_connect, from_pos, to_pos);
+                // Make sure it succeeded
+                assert(aligned);
+            }));
+            results.back().key = std::to_string(node_count) + "_nodes";
         }
-        seq_stream << source.get_sequence(get_id(to_pos)).substr(0, get_offset(to_pos)); 
+    }});
+    
+    cases.push_back({"find_minimizers", [&](vector<BenchmarkResult>& results) {
+        auto& fixture = get_giraffe_fixture();
+        results.push_back(run_benchmark("find_minimizers() for " + std::to_string(fixture.reads.size()) + " reads", 10, [&]() {
+            for (auto& seeded : fixture.reads) {
+                Funnel funnel;
+                auto minimizers = fixture.mapper->find_minimizers(seeded.read.sequence(), funnel);
+                fixture.mapper->sort_minimizers_by_score(minimizers);
+            }
+        }));
+    }});
+    
+    cases.push_back({"find_seeds", [&](vector<BenchmarkResult>& results) {
+        auto& fixture = get_giraffe_fixture();
+        // Name the benchmark with the seed count so seeds per second can be worked out
+        results.push_back(run_benchmark("find_seeds() for " + std::to_string(fixture.reads.size()) + " reads with "
+                                        + std::to_string(fixture.seed_count()) + " seeds", 10, [&]() {
+            for (auto& seeded : fixture.reads) {
+                Funnel funnel;
+                fixture.mapper->find_seeds(seeded.minimizer_view(), seeded.read, funnel);
+            }
+        }));
+    }});
+    
+    cases.push_back({"cluster_seeds", [&](vector<BenchmarkResult>& results) {
+        auto& fixture = get_giraffe_fixture();
+        SnarlDistanceIndexClusterer clusterer(fixture.distance_index, &fixture.graph);
+        results.push_back(run_benchmark("cluster_seeds() for " + std::to_string(fixture.reads.size()) + " reads with "
+                                        + std::to_string(fixture.seed_count()) + " seeds", 10, [&]() {
+            for (auto& seeded : fixture.reads) {
+                clusterer.cluster_seeds(seeded.seeds, fixture.distance_limit);
+            }
+        }));
+    }});
+    
+    cases.push_back({"gapless_extend", [&](vector<BenchmarkResult>& results) {
+        auto& fixture = get_giraffe_fixture();
+        GaplessExtender extender(fixture.graph, fixture.aligner);
+        results.push_back(run_benchmark("extend() for " + std::to_string(fixture.cluster_count()) + " clusters", 10, [&]() {
+            for (auto& seeded : fixture.reads) {
+                auto minimizers = seeded.minimizer_view();
+                for (auto& cluster : seeded.clusters) {
+                    // Pack the seeds the way the mapper does, since extending consumes them
+                    GaplessExtender::cluster_type seed_matchings;
+                    for (auto& seed_index : cluster.seeds) {
+                        auto& seed = seeded.seeds[seed_index];
+                        seed_matchings.insert(GaplessExtender::to_seed(seed.pos, minimizers[seed.source].value.offset));
+                    }
+                    extender.extend(seed_matchings, seeded.read.sequence());
+                }
+            }
+        }));
+    }});
+    
+    cases.push_back({"chain_items_dp", [&](vector<BenchmarkResult>& results) {
+        auto& fixture = get_giraffe_fixture();
+        results.push_back(run_benchmark("chain_items_dp() for " + std::to_string(fixture.cluster_count()) + " clusters", 10, [&]() {
+            std::vector<algorithms::TracedScore> chain_scores;
+            for (auto& seeded : fixture.reads) {
+                for (auto& anchor_indexes : seeded.cluster_anchors) {
+                    chain_scores.clear();
+                    VectorView<algorithms::Anchor> to_chain {seeded.anchors, anchor_indexes};
+                    algorithms::chain_items_dp(chain_scores, to_chain, fixture.distance_index, fixture.graph,
+                                               fixture.aligner.gap_open, fixture.aligner.gap_extension);
+                }
+            }
+        }));
+    }});
+    
+    cases.push_back({"xdrop_align", [&](vector<BenchmarkResult>& results) {
+        auto& fixture = get_alignment_fixture();
+        results.push_back(run_benchmark("align_pinned() with X-drop for " + std::to_string(fixture.reads.size()) + " reads", 10, [&]() {
+            for (auto& read : fixture.reads) {
+                Alignment aln = read;
+                fixture.aligner.align_pinned(aln, fixture.graph, true, true);
+            }
+        }));
+    }});
+    
+    cases.push_back({"banded_global_align", [&](vector<BenchmarkResult>& results) {
+        auto& fixture = get_alignment_fixture();
+        results.push_back(run_benchmark("align_global_banded() for " + std::to_string(fixture.reads.size()) + " reads", 10, [&]() {
+            for (auto& read : fixture.reads) {
+                Alignment aln = read;
+                fixture.aligner.align_global_banded(aln, fixture.graph, 0, true);
+            }
+        }));
+    }});
+    
+    cases.push_back({"surject", [&](vector<BenchmarkResult>& results) {
+        auto& fixture = get_alignment_fixture();
+        bdsg::PositionOverlay position_graph(&fixture.graph);
+        Surjector surjector(&position_graph);
+        unordered_set<path_handle_t> paths {fixture.reference};
+        results.push_back(run_benchmark("surject() for " + std::to_string(fixture.aligned.size()) + " reads", 10, [&]() {
+            for (auto& aln : fixture.aligned) {
+                surjector.surject(aln, paths);
+            }
+        }));
+    }});
+    
+    cases.push_back({"alignment_io", [&](vector<BenchmarkResult>& results) {
+        auto& fixture = get_alignment_fixture();
+        size_t record_count = 10000;
         
-        std::string to_connect = seq_stream.str();
+        auto write_gam = [&]() {
+            std::stringstream gam_stream;
+            {
+                vg::io::ProtobufEmitter<Alignment> emitter(gam_stream);
+                for (size_t i = 0; i < record_count; i++) {
+                    emitter.write_copy(fixture.aligned[i % fixture.aligned.size()]);
+                }
+            }
+            return gam_stream.str();
+        };
+        results.push_back(run_benchmark("write GAM for " + std::to_string(record_count) + " alignments", 10, [&]() {
+            write_gam();
+        }));
+        results.back().key = "write_gam";
         
-        // Make the Aligner and Extender
-        Aligner aligner;
-        WFAExtender extender(graph, aligner, error_model);
+        std::string gam_data = write_gam();
+        results.push_back(run_benchmark("read GAM for " + std::to_string(record_count) + " alignments", 10, [&]() {
+            std::stringstream gam_stream(gam_data);
+            size_t read_count = 0;
+            vg::io::for_each<Alignment>(gam_stream, [&](Alignment& aln) {
+                read_count++;
+            });
+            assert(read_count == record_count);
+        }));
+        results.back().key = "read_gam";
         
-        results.push_back(run_benchmark("connect() on " + std::to_string(node_count) + " node sequence", 1, [&]() {
-            // Do the alignment
-            WFAAlignment aligned = extender.connect(to_connect, from_pos, to_pos);
-            // Make sure it succeeded
-            assert(aligned);
+        results.push_back(run_benchmark("write GAF for " + std::to_string(record_count) + " alignments", 10, [&]() {
+            std::stringstream gaf_stream;
+            for (size_t i = 0; i < record_count; i++) {
+                gaf_stream << vg::io::alignment_to_gaf(fixture.graph, fixture.aligned[i % fixture.aligned.size()]) << "\n";
+            }
         }));
-    }
+        results.back().key = "write_gaf";
+    }});
         
-    // Do the control against itself
-    results.push_back(run_benchmark("control", 1000, benchmark_control));
+    cases.push_back({"control", [&](vector<BenchmarkResult>& results) {
+        // Do the control against itself
+        results.push_back(run_benchmark("control", 1000, benchmark_control));
+    }});
     
+    if (list_cases) {
+        for (auto& benchmark_case : cases) {
+            cout << benchmark_case.name << endl;
+        }
+        return 0;
+    }
+    
+    vector<BenchmarkResult> results;
+    set<string> selected_cases;
+    for (auto& benchmark_case : cases) {
+        bool selected = filters.empty();
+        for (auto& filter : filters) {
+            selected = selected || regex_search(benchmark_case.name, filter);
+        }
+        if (!selected) {
+            continue;
+        }
+        selected_cases.insert(benchmark_case.name);
+        if (show_progress) {
+            cerr << "Running " << benchmark_case.name << endl;
+        }
+        size_t first_result = results.size();
+        benchmark_case.run(results);
+        // Key the results by the case and their label, which don't depend on
+        // what the inputs turned out to be
+        for (size_t i = first_result; i < results.size(); i++) {
+            results[i].key = benchmark_case.name + (results[i].key.empty() ? "" : "/" + results[i].key);
+        }
+    }
 
-    cout << "# Benchmark results for vg " << Version::get_short() << endl;
-    cout << "# runs\ttest(us)\tstddev(us)\tcontrol(us)\tstddev(us)\tscore\terr\tname" << endl;
-    for (auto& result : results) {
-        cout << result << endl;
+    if (json_output) {
+        write_benchmark_json(cout, Version::get_short(), results);
+    } else {
+        cout << "# Benchmark results for vg " << Version::get_short() << endl;
+        cout << "# runs\ttest(us)\tstddev(us)\tcontrol(us)\tstddev(us)\tscore\terr\tkey\tname" << endl;
+        for (auto& result : results) {
+            cout << result << endl;
+        }
+    }
+    
+    if (!baseline.empty()) {
+        // Compare control-normalized scores, so baselines from other machines mean something
+        size_t regressions = 0;
+        set<string> compared;
+        cerr << "# baseline\tscore\tchange\tkey" << endl;
+        for (auto& result : results) {
+            auto found = baseline.find(result.key);
+            if (found == baseline.end()) {
+                cerr << "warning:[vg benchmark] no baseline for " << result.key << endl;
+                continue;
+            }
+            compared.insert(result.key);
+            bool regressed = is_regression(result, found->second, max_regression);
+            if (regressed) {
+                regressions++;
+            }
+            cerr << found->second.score() << "\t" << result.score() << "\t"
+                 << (result.score() / found->second.score() - 1) * 100 << "%\t" << result.key
+                 << (regressed ? "\tREGRESSED" : "") << endl;
+        }
+        // A baseline row for a case we ran that nothing matched means the
+        // benchmark went away or was renamed, and we can't vouch for it
+        size_t unmatched = 0;
+        for (auto& baseline_result : baseline) {
+            const string& key = baseline_result.first;
+            if (selected_cases.count(key.substr(0, key.find('/'))) && !compared.count(key)) {
+                cerr << "error:[vg benchmark] baseline benchmark " << key << " was not run" << endl;
+                unmatched++;
+            }
+        }
+        if (regressions > 0) {
+            cerr << "error:[vg benchmark] " << regressions << " benchmarks regressed from baseline " << baseline_filename << endl;
+        }
+        if (regressions > 0 || unmatched > 0) {
+            return 1;
+        }
     }
     
     return 0;
@@ -67,6 +67,8 @@ void help_call(char** argv) {
        << "                                from if no samples are used. Unmatched contigs get ploidy 2 (or that from -d)." << endl
        << "    -n, --nested            Activate nested calling mode (experimental)" << endl
        << "    -I, --chains            Call chains instead of snarls (experimental)" << endl
+       << "        --vcf-out FILE      Write bgzipped VCF to FILE and tabix index it, instead of writing to standard output" << endl
+       << "        --spill-mb N        Keep at most about N MB of variants in memory, spilling the rest to temporary files [unlimited]" << endl
        << "        --progress          Show progress" << endl
        << "    -t, --threads N         number of threads to use" << endl;
 }    
@@ -110,6 +112,8 @@ int main_call(int argc, char** argv) {
     size_t min_allele_len = 0;
     size_t max_allele_len = numeric_limits<size_t>::max();
     bool show_progress = false;
+    string vcf_out_filename;
+    double spill_mb = 0;
 
     // constants
     const size_t avg_trav_threshold = 50;
@@ -122,6 +126,8 @@ int main_call(int argc, char** argv) {
     const size_t max_chain_edges = 1000; 
     const size_t max_chain_trivial_travs = 5;
     const int OPT_PROGRESS = 1000;
+    const int OPT_VCF_OUT = 1001;
+    const int OPT_SPILL_MB = 1002;
     int c;
     optind = 2; // force optind past command positional argument
     while (true) {
@@ -158,6 +164,8 @@ int main_call(int argc, char** argv) {
             {"nested", no_argument, 0, 'n'},
             {"chains", no_argument, 0, 'I'},            
             {"threads", required_argument, 0, 't'},
+            {"vcf-out", required_argument, 0, OPT_VCF_OUT },
+            {"spill-mb", required_argument, 0, OPT_SPILL_MB },
             {"progress", no_argument, 0, OPT_PROGRESS },
             {"help", no_argument, 0, 'h'},
             {0, 0, 0, 0}
@@ -286,6 +294,16 @@ int main_call(int argc, char** argv) {
         case OPT_PROGRESS:
             show_progress = true;
             break;
+        case OPT_VCF_OUT:
+            vcf_out_filename = optarg;
+            break;
+        case OPT_SPILL_MB:
+            spill_mb = parse<double>(optarg);
+            if (spill_mb < 0) {
+                cerr << "error [vg call]: --spill-mb must not be negative" << endl;
+                exit(1);
+            }
+            break;
         case 't':
         {
             int num_threads = parse<int>(optarg);
@@ -312,6 +330,11 @@ int main_call(int argc, char** argv) {
         return 1;
     }
 
+    if ((gaf_output || traversals_only) && !vcf_out_filename.empty()) {
+        cerr << "error [vg call]: --vcf-out cannot be used with GAF output (-G or -T)" << endl;
+        return 1;
+    }
+
     // parse the supports (stick together to keep number of options down)
     vector<string> support_toks = split_delims(min_support_string, ",");
     double min_allele_support = -1;
@@ -822,6 +845,7 @@ int main_call(int argc, char** argv) {
         // Make sure we get the LV/PS tags with -A
         vcf_caller->set_nested(all_snarls);
         vcf_caller->set_translation(translation.get());
+        vcf_caller->set_spill_budget(spill_mb * 1024 * 1024);
         // Make sure the basepath information we inferred above goes directy to the VCF header
         // (and that it does *not* try to read it from the graph paths)
         vector<string> header_ref_paths;
@@ -858,9 +882,13 @@ int main_call(int argc, char** argv) {
         // Output VCF
         VCFOutputCaller* vcf_caller = dynamic_cast<VCFOutputCaller*>(graph_caller.get());
         assert(vcf_caller != nullptr);
-        cout << header << flush;
         if (show_progress) cerr << "[vg call]: Writing VCF Variants" << endl;
-        vcf_caller->write_variants(cout, snarl_manager.get());
+        if (vcf_out_filename.empty()) {
+            cout << header << flush;
+            vcf_caller->write_variants(cout, snarl_manager.get());
+        } else {
+            vcf_caller->write_variants(header, vcf_out_filename, snarl_manager.get());
+        }
         if (show_progress) cerr << "[vg call]: VCF complete" << endl;        
     }
     
@@ -240,6 +240,7 @@ int main_construct(int argc, char** argv) {
         // Copy shared parameters into the constructor
         constructor.max_node_size = max_node_size;
         constructor.show_progress = show_progress;
+        constructor.chunk_threads = omp_get_max_threads();
 
         unordered_set<string> used_region_contigs; 
         for (auto& region : regions) {
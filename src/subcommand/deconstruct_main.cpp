@@ -56,6 +56,7 @@ void help_deconstruct(char** argv){
          << "    -R, --star-allele        Use *-alleles to denote alleles that span but do not cross the site. Only works with -n" << endl
          << "    -t, --threads N          Use N threads" << endl
          << "    -v, --verbose            Print some status messages" << endl
+         << "        --spill-mb N         Keep at most about N MB of variants in memory, spilling the rest to temporary files [unlimited]" << endl
          << endl;
 }
 
@@ -83,7 +84,9 @@ int main_deconstruct(int argc, char** argv){
     double cluster_threshold = 1.0;
     bool nested = false;
     bool star_allele = false;
-    
+    double spill_mb = 0;
+
+    const int OPT_SPILL_MB = 1000;
     int c;
     optind = 2; // force optind past command positional argument
     while (true) {
@@ -109,6 +112,7 @@ int main_deconstruct(int argc, char** argv){
                 {"start-allele", no_argument, 0, 'R'},
                 {"threads", required_argument, 0, 't'},
                 {"verbose", no_argument, 0, 'v'},
+                {"spill-mb", required_argument, 0, OPT_SPILL_MB},
                 {0, 0, 0, 0}
             };
 
@@ -183,6 +187,13 @@ int main_deconstruct(int argc, char** argv){
         case 'v':
             show_progress = true;
             break;
+        case OPT_SPILL_MB:
+            spill_mb = parse<double>(optarg);
+            if (spill_mb < 0) {
+                cerr << "Error [vg deconstruct]: --spill-mb must not be negative" << endl;
+                exit(1);
+            }
+            break;
         case '?':
         case 'h':
             help_deconstruct(argv);
@@ -372,6 +383,7 @@ int main_deconstruct(int argc, char** argv){
     }
     dd.set_translation(translation.get());
     dd.set_nested(all_snarls || nested);
+    dd.set_spill_budget(spill_mb * 1024 * 1024);
     dd.deconstruct(refpaths, graph, snarl_manager.get(),
                    all_snarls,
                    context_jaccard_window,
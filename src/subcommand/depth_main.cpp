@@ -10,6 +10,10 @@
 
 #include <algorithm>
 #include <iostream>
+#include <sstream>
+
+#include <htslib/bgzf.h>
+#include <htslib/tbx.h>
 
 #include "subcommand.hpp"
 
@@ -45,6 +49,8 @@ void help_depth(char** argv) {
          << "    -P, --paths-by STR     select the paths with the given name prefix" << endl        
          << "    -b, --bin-size N       bin size (in bases) [1] (2 extra columns printed when N>1: bin-end-pos and stddev)" << endl
          << "    -m, --min-coverage N   ignore nodes with less than N coverage depth [1]" << endl
+         << "        --bgzip-out FILE   write bgzipped depths to FILE and tabix index it, instead of writing to standard output" << endl
+         << "        --range-size N     compute per-base depths for N bases of a path at a time on each thread [100000]" << endl
          << "    -t, --threads N        number of threads to use [all available]" << endl;
 }
 
@@ -69,6 +75,13 @@ int main_depth(int argc, char** argv) {
     bool count_cycles = false;
 
     size_t min_coverage = 1;
+    string bgzip_out_filename;
+
+    // How many bases of a path should a thread print per-base depths for at a time?
+    size_t range_size = 100000;
+
+    const int OPT_BGZIP_OUT = 1000;
+    const int OPT_RANGE_SIZE = 1001;
 
     int c;
     optind = 2; // force optind past command positional argument
@@ -88,6 +101,8 @@ int main_depth(int argc, char** argv) {
             {"min-coverage", required_argument, 0, 'm'},
             {"count-cycles", no_argument, 0, 'c'},
             {"threads", required_argument, 0, 't'},
+            {"bgzip-out", required_argument, 0, OPT_BGZIP_OUT},
+            {"range-size", required_argument, 0, OPT_RANGE_SIZE},
             {"help", no_argument, 0, 'h'},
             {0, 0, 0, 0}
         };
@@ -148,6 +163,16 @@ int main_depth(int argc, char** argv) {
             omp_set_num_threads(num_threads);
             break;
         }
+        case OPT_BGZIP_OUT:
+            bgzip_out_filename = optarg;
+            break;
+        case OPT_RANGE_SIZE:
+            range_size = parse<size_t>(optarg);
+            if (range_size == 0) {
+                cerr << "error:[vg depth] Range size (--range-size) must be a positive integer." << endl;
+                exit(1);
+            }
+            break;
         case 'h':
         case '?':
             /* getopt_long already printed an error message. */
@@ -171,6 +196,10 @@ int main_depth(int argc, char** argv) {
         cerr << "error:[vg depth] At most one of a pack file (-k), a GAM file (-g), or a GAF file (-a) must be given" << endl;
         exit(1);
     }
+    if (!bgzip_out_filename.empty() && input_count > 0 && pack_filename.empty()) {
+        cerr << "error:[vg depth] --bgzip-out can only be used for packed or path coverage depth" << endl;
+        exit(1);
+    }
 
     // Read the graph
     unique_ptr<PathHandleGraph> path_handle_graph;
@@ -230,32 +259,116 @@ int main_depth(int argc, char** argv) {
             }
         }
 
-        for (const auto& ref_coord_path : ref_paths) {
-            const string& ref_path = ref_coord_path.second;
-            const string& base_path = ref_coord_path.first.first;
-            const size_t subpath_offset = ref_coord_path.first.second;
+        // Depths go to standard output, or to a BGZF file that we index when we're done
+        BGZF* bgzip_out = nullptr;
+        if (!bgzip_out_filename.empty()) {
+            bgzip_out = bgzf_open(bgzip_out_filename.c_str(), "w");
+            if (bgzip_out == nullptr) {
+                cerr << "error:[vg depth] could not open " << bgzip_out_filename << " for writing" << endl;
+                exit(1);
+            }
+            if (omp_get_max_threads() > 1) {
+                // let htslib compress blocks in parallel
+                bgzf_mt(bgzip_out, omp_get_max_threads(), 256);
+            }
+        }
+        auto write_depths = [&](const string& text) {
+            if (bgzip_out == nullptr) {
+                cout << text;
+            } else if (bgzf_write(bgzip_out, text.data(), text.size()) != (ssize_t) text.size()) {
+                cerr << "error:[vg depth] could not write to " << bgzip_out_filename << endl;
+                exit(1);
+            }
+        };
+
+        if (bin_size > 1) {
+            for (const auto& ref_coord_path : ref_paths) {
+                const string& ref_path = ref_coord_path.second;
+                const string& base_path = ref_coord_path.first.first;
+                const size_t subpath_offset = ref_coord_path.first.second;
             
-            if (bin_size > 1) {
+                // the bins of each path are computed in parallel
                 vector<tuple<size_t, size_t, double, double>> binned_depth;
                 if (!pack_filename.empty()) {
                     binned_depth = algorithms::binned_packed_depth(*packer, ref_path, bin_size, min_coverage, count_dels);
                 } else {
                     binned_depth = algorithms::binned_path_depth(*graph, ref_path, bin_size, min_coverage, count_cycles);
                 }
+                stringstream bin_stream;
                 for (auto& bin_cov : binned_depth) {
                     // bins can ben nan if min_coverage filters everything out.  just skip
                     if (!isnan(get<3>(bin_cov))) {
-                        cout << base_path << "\t" << (get<0>(bin_cov) + 1 + subpath_offset)<< "\t" << (get<1>(bin_cov) + 1 + subpath_offset) << "\t" << get<2>(bin_cov)
-                             << "\t" << sqrt(get<3>(bin_cov)) << endl;
+                        bin_stream << base_path << "\t" << (get<0>(bin_cov) + 1 + subpath_offset)<< "\t" << (get<1>(bin_cov) + 1 + subpath_offset) << "\t" << get<2>(bin_cov)
+                                   << "\t" << sqrt(get<3>(bin_cov)) << "\n";
                     }
                 }
-            } else {
-                if (!pack_filename.empty()) {
-                    algorithms::packed_depths(*packer, ref_path, min_coverage, cout);
+                write_depths(bin_stream.str());
+            }
+        } else {
+            // split all the paths into ranges, so that short paths are done in parallel with each other
+            // and long paths are done in parallel with themselves
+            struct DepthRange {
+                const string* ref_path;
+                const string* base_path;
+                size_t path_offset;
+                step_handle_t start_step;
+                step_handle_t end_step;
+                // circular paths can't be split, so they get one range for the whole path
+                bool whole_path;
+            };
+            vector<DepthRange> depth_ranges;
+            for (const auto& ref_coord_path : ref_paths) {
+                const string& ref_path = ref_coord_path.second;
+                const string& base_path = ref_coord_path.first.first;
+                const size_t subpath_offset = ref_coord_path.first.second;
+                if (graph->get_is_circular(graph->get_path_handle(ref_path))) {
+                    depth_ranges.push_back({&ref_path, &base_path, 0, step_handle_t(), step_handle_t(), true});
                 } else {
-                    algorithms::path_depths(*graph, ref_path, min_coverage, count_cycles, cout);
+                    for (auto& range : algorithms::path_step_ranges(*graph, ref_path, range_size)) {
+                        depth_ranges.push_back({&ref_path, &base_path, get<0>(range) + 1 + subpath_offset,
+                                                get<1>(range), get<2>(range), false});
+                    }
                 }
             }
+
+            // each thread waits for the ranges before its own to be written, so only about one
+            // range per thread is ever held in memory
+#pragma omp parallel for ordered schedule(dynamic, 1)
+            for (size_t i = 0; i < depth_ranges.size(); ++i) {
+                const DepthRange& range = depth_ranges[i];
+                stringstream range_stream;
+                if (range.whole_path) {
+                    if (!pack_filename.empty()) {
+                        algorithms::packed_depths(*packer, *range.ref_path, min_coverage, range_stream);
+                    } else {
+                        algorithms::path_depths(*graph, *range.ref_path, min_coverage, count_cycles, range_stream);
+                    }
+                } else {
+                    if (!pack_filename.empty()) {
+                        algorithms::packed_depths(*packer, range.start_step, range.end_step, *range.base_path,
+                                                  range.path_offset, min_coverage, range_stream);
+                    } else {
+                        algorithms::path_depths(*graph, range.start_step, range.end_step, *range.base_path,
+                                                range.path_offset, min_coverage, count_cycles, range_stream);
+                    }
+                }
+#pragma omp ordered
+                write_depths(range_stream.str());
+            }
+        }
+
+        if (bgzip_out != nullptr) {
+            if (bgzf_close(bgzip_out) != 0) {
+                cerr << "error:[vg depth] could not finish writing " << bgzip_out_filename << endl;
+                exit(1);
+            }
+            // index on the path name and the 1-based start (and end, for bins) of each line
+            tbx_conf_t conf = {TBX_GENERIC, 1, 2, bin_size > 1 ? 3 : 2, '#', 0};
+            if (tbx_index_build(bgzip_out_filename.c_str(), 0, &conf) != 0) {
+                cerr << "warning:[vg depth] could not tabix index " << bgzip_out_filename << endl;
+            }
+        } else {
+            cout << flush;
         }
     }
 
@@ -7,11 +7,13 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <sstream>
 
 #include "subcommand.hpp"
 
 #include "../alignment.hpp"
 #include "../annotation.hpp"
+#include "../sharded_hash_map.hpp"
 #include "../snarl_distance_index.hpp"
 #include "../vg.hpp"
 #include <vg/io/stream.hpp>
@@ -186,20 +188,18 @@ int main_gamcompare(int argc, char** argv) {
     // True path positions. For each alignment name, store a mapping from reference path names
     // to sets of (sequence offset, is_reverse). There is usually either one position per
     // alignment or one position per node.
-    vg::string_hash_map<string, map<string, vector<pair<size_t, bool> > > > true_path_positions;
+    // The truth tables are sharded by read name so all the threads can fill them at once.
+    vg::sharded_string_hash_map<map<string, vector<pair<size_t, bool> > > > true_path_positions;
     function<void(Alignment&)> record_path_positions = [&true_path_positions](Alignment& aln) {
-        auto val = alignment_refpos_to_path_offsets(aln);
-#pragma omp critical (truth_table)
-        true_path_positions[aln.name()] = val;
+        true_path_positions.set(aln.name(), alignment_refpos_to_path_offsets(aln));
     };
 
     // True graph positions. For each alignment name, we find the maximal read intervals that correspond
     // to a gapless alignment between the read and a single node.
-    vg::string_hash_map<string, std::vector<MappingRun>> true_graph_positions;
+    vg::sharded_string_hash_map<std::vector<MappingRun>> true_graph_positions;
     function<void(Alignment&)> record_graph_positions = [&true_graph_positions](Alignment& aln) {
         if (aln.path().mapping_size() > 0) {
-#pragma omp critical (truth_table)
-            true_graph_positions[aln.name()] = base_mappings(aln);
+            true_graph_positions.set(aln.name(), base_mappings(aln));
         }
     };
 
@@ -248,29 +248,39 @@ int main_gamcompare(int argc, char** argv) {
         emitter = std::unique_ptr<vg::io::ProtobufEmitter<Alignment>>(new vg::io::ProtobufEmitter<Alignment>(cout));
     }
     
-    // We have an ordinary buffer we use for text output
-    vector<Alignment> text_buffer;
+    // Each thread buffers its annotated reads, so threads only need to take
+    // turns when a whole buffer is ready to go out.
+    vector<vector<Alignment>> output_buffers(vg::get_thread_count());
+    // Or its TSV lines, if we're outputting text
+    vector<stringstream> text_buffers(vg::get_thread_count());
+    vector<size_t> buffered_counts(vg::get_thread_count(), 0);
     
-    // We have an output function to dump all the reads in the text buffer in TSV
-    auto flush_text_buffer = [&text_buffer,&output_tsv,&aligner_name]() {
-        // We print exactly one header line.
-        static bool header_printed = false;
+    if (output_tsv) {
         // Output TSV to standard out in the format plot-qq.R needs.
-        if (!header_printed) {
-            // It needs a header
-            cout << "correct\tmq\taligner\tread\teligible" << endl;
-            header_printed = true;
+        // It needs a header
+        cout << "correct\tmq\taligner\tread\teligible" << endl;
+    }
+    
+    // We have an output function to dump a thread's buffered reads and text,
+    // once there are enough of them, or when finishing.
+    auto flush_buffers = [&](size_t thread_num, bool finishing) {
+        auto& buffered_count = buffered_counts.at(thread_num);
+        if (buffered_count == 0 || (!finishing && buffered_count < 1000)) {
+            return;
         }
-        
-        for (auto& aln : text_buffer) {
-            // Dump each alignment
-            cout << (aln.correctly_mapped() ? "1" : "0") << "\t";
-            cout << aln.mapping_quality() << "\t";
-            cout << aligner_name << "\t";
-            cout << aln.name() << "\t";
-            cout << (has_annotation(aln, "no_truth") ? "0" : "1") << endl;
+        auto& buffer = output_buffers.at(thread_num);
+        auto& text_buffer = text_buffers.at(thread_num);
+#pragma omp critical (gamcompare_output)
+        {
+            if (emitter) {
+                emitter->write_many(std::move(buffer));
+            } else {
+                cout << text_buffer.str();
+            }
         }
-        text_buffer.clear();
+        buffer.clear();
+        text_buffer.str("");
+        buffered_count = 0;
     };
    
     // We want to count correct reads
@@ -290,24 +300,24 @@ int main_gamcompare(int argc, char** argv) {
         bool found = false;
         if (distance_name.empty()) {
             //If the distance index isn't used
-            auto iter = true_path_positions.find(aln.name());
-            if (iter != true_path_positions.end()) {
-                alignment_set_distance_to_correct(aln, iter->second, &renames);
+            auto true_positions = true_path_positions.find(aln.name());
+            if (true_positions) {
+                alignment_set_distance_to_correct(aln, *true_positions, &renames);
                 found = true;
             }
         } else {
             //If the distance index gets used
-            auto iter = true_graph_positions.find(aln.name());
-            if (iter != true_graph_positions.end() && aln.path().mapping_size() > 0) {
+            auto true_mappings = true_graph_positions.find(aln.name());
+            if (true_mappings && aln.path().mapping_size() > 0) {
                 std::vector<MappingRun> read_mappings = base_mappings(aln);
                 int64_t distance = std::numeric_limits<int64_t>::max();
                 auto read_iter = read_mappings.begin();
-                auto truth_iter = iter->second.begin();
+                auto truth_iter = true_mappings->begin();
                 // Break the read into maximal intervals such that each interval corresponds
                 // to a gapless alignment between the read and a single node both in the true
                 // alignment and the candidate alignment. Compute the distance for each
                 // interval and use the minimum distance over all intervals.
-                while (read_iter != read_mappings.end() && truth_iter != iter->second.end()) {
+                while (read_iter != read_mappings.end() && truth_iter != true_mappings->end()) {
                     size_t start = std::max(read_iter->read_offset, truth_iter->read_offset);
                     size_t limit = std::min(read_iter->limit(), truth_iter->limit());
                     if (start < limit) {
@@ -367,23 +377,19 @@ int main_gamcompare(int argc, char** argv) {
             // Remember that it was impossible to get.
             set_annotation(aln, "no_truth", true);
         }
-#pragma omp critical
-        {
-            if (output_tsv) {
-                if (emitter) {
-                    // Copy the alignment since we need it twice
-                    text_buffer.emplace_back(aln);
-                } else {
-                    text_buffer.emplace_back(std::move(aln));
-                }
-                if (text_buffer.size() > 1000) {
-                    flush_text_buffer();
-                }
-            }
-            if (emitter) {
-                emitter->write(std::move(aln));
-            }
+        size_t thread_num = omp_get_thread_num();
+        if (emitter) {
+            output_buffers.at(thread_num).emplace_back(std::move(aln));
+        } else {
+            // Dump the alignment as text
+            text_buffers.at(thread_num) << (aln.correctly_mapped() ? "1" : "0") << "\t"
+                << aln.mapping_quality() << "\t"
+                << aligner_name << "\t"
+                << aln.name() << "\t"
+                << (has_annotation(aln, "no_truth") ? "0" : "1") << "\n";
         }
+        buffered_counts.at(thread_num)++;
+        flush_buffers(thread_num, false);
     };
 
     if (test_file_name == "-") {
@@ -401,9 +407,9 @@ int main_gamcompare(int argc, char** argv) {
         vg::io::for_each_parallel(test_file_in, annotate_test);
     }
 
-    if (output_tsv) {
-        // Save whatever's in the buffer at the end.
-        flush_text_buffer();
+    for (size_t i = 0; i < output_buffers.size(); i++) {
+        // Save whatever's in the buffers at the end.
+        flush_buffers(i, true);
     }
 
     
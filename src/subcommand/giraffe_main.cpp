@@ -9,11 +9,13 @@
 #include <cassert>
 #include <cstring>
 #include <ctime>
+#include <fstream>
 #include <map>
 #include <vector>
 #include <unordered_set>
 #include <chrono>
 #include <mutex>
+#include <future>
 
 #include "subcommand.hpp"
 #include "options.hpp"
@@ -27,7 +29,10 @@
 #include "../minimizer_mapper.hpp"
 #include "../index_registry.hpp"
 #include "../watchdog.hpp"
+#include "../read_pipeline.hpp"
+#include "../fastq_reader.hpp"
 #include "../crash.hpp"
+#include "../config/allocator_config.hpp"
 #include <bdsg/overlays/overlay_helper.hpp>
 
 #include "../gbwtgraph_helper.hpp"
@@ -43,6 +48,7 @@
 #endif
 
 #include <sys/ioctl.h>
+#include <sys/stat.h>
 #ifdef __linux__
 #include <linux/perf_event.h>
 #include <asm/unistd.h>
@@ -73,6 +79,18 @@ struct ScoringOptions {
     int8_t full_length_bonus = default_full_length_bonus;
 };
 
+/// A batch of reads or read pairs moving through the mapping pipeline.
+struct MappingBatch {
+    /// The reads, with mates interleaved if paired
+    vector<Alignment> reads;
+    /// What each read, or each first mate, mapped to
+    vector<vector<Alignment>> mapped1;
+    /// What each second mate mapped to
+    vector<vector<Alignment>> mapped2;
+    /// The template length limit for each pair
+    vector<int64_t> tlen_limits;
+};
+
 static GroupedOptionGroup get_options() {
     GroupedOptionGroup parser;
     
@@ -255,6 +273,12 @@ static GroupedOptionGroup get_options() {
         MinimizerMapper::default_rescue_seed_limit,
         "attempt rescue with at most INT seeds"
     );
+    comp_opts.add_range(
+        "rescue-cache-size",
+        &MinimizerMapper::rescue_subgraph_cache_size,
+        MinimizerMapper::default_rescue_subgraph_cache_size,
+        "keep up to INT rescue subgraphs per thread for reuse"
+    );
     
     // Configure chaining
     auto& chaining_opts = parser.add_group<MinimizerMapper>("long-read/chaining parameters");
@@ -411,13 +435,17 @@ void help_giraffe(char** argv, const BaseOptionGroup& parser, bool full_help) {
     << "  -R, --read-group NAME         add this read group" << endl
     << "  -o, --output-format NAME      output the alignments in NAME format (gam / gaf / json / tsv / SAM / BAM / CRAM) [gam]" << endl
     << "  --ref-paths FILE              ordered list of paths in the graph, one per line or HTSlib .dict, for HTSLib @SQ headers" << endl
-    << "  --named-coordinates           produce GAM/GAF outputs in named-segment (GFA) space" << endl;
+    << "  --named-coordinates           produce GAM/GAF outputs in named-segment (GFA) space" << endl
+    << "  --compression-level N         compress BAM/CRAM output at level N, from 0 (fastest) to 9 (smallest) [9]" << endl
+    << "  --compression-threads N       use N additional threads to compress BAM output [0]" << endl
+    << "  --sorted                      write SAM/BAM/CRAM output sorted by coordinate" << endl
+    << "  --sort-memory N               hold up to N MB of records in memory while sorting [768]" << endl;
     if (full_help) {
         cerr
         << "  -P, --prune-low-cplx          prune short and low complexity anchors during linear format realignment" << endl
         << "  -n, --discard                 discard all output alignments (for profiling)" << endl
         << "  --output-basename NAME        write output to a GAM file beginning with the given prefix for each setting combination" << endl
-        << "  --report-name NAME            write a TSV of output file and mapping speed to the given file" << endl
+        << "  --report-name NAME            write a TSV of output file, mapping speed, and output speed to the given file" << endl
         << "  --show-work                   log how the mapper comes to its conclusions about mapping locations" << endl;
     }
 
@@ -427,9 +455,14 @@ void help_giraffe(char** argv, const BaseOptionGroup& parser, bool full_help) {
         << "  -A, --rescue-algorithm NAME   use algorithm NAME for rescue (none / dozeu / gssw) [dozeu]" << endl
         << "  --fragment-mean FLOAT         force the fragment length distribution to have this mean (requires --fragment-stdev)" << endl
         << "  --fragment-stdev FLOAT        force the fragment length distribution to have this standard deviation (requires --fragment-mean)" << endl
+        << "  --fragment-model FILE         use the fragment length distribution saved in FILE instead of estimating it" << endl
+        << "  --fragment-model-out FILE     save the fragment length distribution to FILE after mapping pairs" << endl
         << "  --track-provenance            track how internal intermediate alignment candidates were arrived at" << endl
         << "  --track-correctness           track if internal intermediate alignment candidates are correct (implies --track-provenance)" << endl
-        << "  -B, --batch-size INT          number of reads or pairs per batch to distribute to threads [" << vg::io::DEFAULT_PARALLEL_BATCHSIZE << "]" << endl;
+        << "  --stage-profile               report time, CPU instructions, and allocated bytes for each mapping stage (implies --track-provenance)" << endl
+        << "  --stage-profile-tsv FILE      also write each read's per-stage profile to FILE (implies --stage-profile)" << endl
+        << "  -B, --batch-size INT          number of reads or pairs per batch to distribute to threads [" << vg::io::DEFAULT_PARALLEL_BATCHSIZE << "]" << endl
+        << "  --pipeline                    parse, map, and emit batches in separate pipeline stages" << endl;
 
         auto helps = parser.get_help();
         print_table(helps, cerr);
@@ -459,6 +492,8 @@ int main_giraffe(int argc, char** argv) {
     #define OPT_TRACK_CORRECTNESS 1004
     #define OPT_FRAGMENT_MEAN 1005
     #define OPT_FRAGMENT_STDEV 1006
+    #define OPT_FRAGMENT_MODEL 1007
+    #define OPT_FRAGMENT_MODEL_OUT 1008
     #define OPT_REF_PATHS 1010
     #define OPT_SHOW_WORK 1011
     #define OPT_NAMED_COORDINATES 1012
@@ -466,6 +501,13 @@ int main_giraffe(int argc, char** argv) {
     constexpr int OPT_KFF_NAME = 1101;
     constexpr int OPT_INDEX_BASENAME = 1102;
     constexpr int OPT_COMMENTS_AS_TAGS = 1103;
+    constexpr int OPT_COMPRESSION_LEVEL = 1104;
+    constexpr int OPT_COMPRESSION_THREADS = 1105;
+    constexpr int OPT_SORTED = 1106;
+    constexpr int OPT_SORT_MEMORY = 1107;
+    constexpr int OPT_PIPELINE = 1108;
+    constexpr int OPT_STAGE_PROFILE = 1109;
+    constexpr int OPT_STAGE_PROFILE_TSV = 1110;
 
     // initialize parameters with their default options
     
@@ -482,6 +524,8 @@ int main_giraffe(int argc, char** argv) {
 
     string output_basename;
     string report_name;
+    // How should we compress HTSlib output?
+    HTSOutputOptions hts_options;
     bool show_progress = false;
     
     // Main Giraffe program options struct
@@ -512,6 +556,10 @@ int main_giraffe(int argc, char** argv) {
     double fragment_mean = 0.0;
     bool forced_stdev = false;
     double fragment_stdev = 0.0;
+    // Should we load the fragment length distribution from a previous run?
+    string fragment_model_name;
+    // Should we save the fragment length distribution for a later run?
+    string fragment_model_out_name;
     // How many pairs should we be willing to buffer before giving up on fragment length estimation?
     size_t MAX_BUFFERED_PAIRS = 100000;
     // What sample name if any should we apply?
@@ -529,6 +577,12 @@ int main_giraffe(int argc, char** argv) {
     bool discard_alignments = false;
     // How many reads per batch to run at a time?
     uint64_t batch_size = vg::io::DEFAULT_PARALLEL_BATCHSIZE;
+    // Should we parse, map, and emit reads in separate pipeline stages?
+    bool use_pipeline = false;
+    // Should we profile each stage of mapping?
+    bool stage_profile = false;
+    // Where should we write the per-read stage profiles, if anywhere?
+    string stage_profile_tsv_name;
     
     // Chain all the ranges and get a function that loops over all combinations.
     auto for_each_combo = parser.get_iterator();
@@ -604,6 +658,11 @@ int main_giraffe(int argc, char** argv) {
         {"ref-paths", required_argument, 0, OPT_REF_PATHS},
         {"prune-low-cplx", no_argument, 0, 'P'},
         {"named-coordinates", no_argument, 0, OPT_NAMED_COORDINATES},
+        {"compression-level", required_argument, 0, OPT_COMPRESSION_LEVEL},
+        {"compression-threads", required_argument, 0, OPT_COMPRESSION_THREADS},
+        {"sorted", no_argument, 0, OPT_SORTED},
+        {"sort-memory", required_argument, 0, OPT_SORT_MEMORY},
+        {"pipeline", no_argument, 0, OPT_PIPELINE},
         {"discard", no_argument, 0, 'n'},
         {"output-basename", required_argument, 0, OPT_OUTPUT_BASENAME},
         {"report-name", required_argument, 0, OPT_REPORT_NAME},
@@ -611,8 +670,12 @@ int main_giraffe(int argc, char** argv) {
         {"rescue-algorithm", required_argument, 0, 'A'},
         {"fragment-mean", required_argument, 0, OPT_FRAGMENT_MEAN },
         {"fragment-stdev", required_argument, 0, OPT_FRAGMENT_STDEV },
+        {"fragment-model", required_argument, 0, OPT_FRAGMENT_MODEL },
+        {"fragment-model-out", required_argument, 0, OPT_FRAGMENT_MODEL_OUT },
         {"track-provenance", no_argument, 0, OPT_TRACK_PROVENANCE},
         {"track-correctness", no_argument, 0, OPT_TRACK_CORRECTNESS},
+        {"stage-profile", no_argument, 0, OPT_STAGE_PROFILE},
+        {"stage-profile-tsv", required_argument, 0, OPT_STAGE_PROFILE_TSV},
         {"show-work", no_argument, 0, OPT_SHOW_WORK},
         {"batch-size", required_argument, 0, 'B'},
         {"threads", required_argument, 0, 't'},
@@ -828,6 +891,30 @@ int main_giraffe(int argc, char** argv) {
             case OPT_REPORT_NAME:
                 report_name = optarg;
                 break;
+
+            case OPT_COMPRESSION_LEVEL:
+                hts_options.level = parse<int>(optarg);
+                if (hts_options.level < 0 || hts_options.level > 9) {
+                    cerr << "error:[vg giraffe] Compression level (--compression-level) must be between 0 and 9" << endl;
+                    exit(1);
+                }
+                break;
+
+            case OPT_COMPRESSION_THREADS:
+                hts_options.threads = parse<size_t>(optarg);
+                break;
+
+            case OPT_SORTED:
+                hts_options.sorted = true;
+                break;
+
+            case OPT_SORT_MEMORY:
+                hts_options.sort_memory = parse<size_t>(optarg) * 1024 * 1024;
+                if (hts_options.sort_memory == 0) {
+                    cerr << "error:[vg giraffe] Sort memory (--sort-memory) must be at least 1 MB" << endl;
+                    exit(1);
+                }
+                break;
             case 'b':
                 param_preset = optarg;
                 {
@@ -868,6 +955,22 @@ int main_giraffe(int argc, char** argv) {
                 fragment_stdev = parse<double>(optarg);
                 break;
 
+            case OPT_FRAGMENT_MODEL:
+                fragment_model_name = optarg;
+                if (fragment_model_name.empty()) {
+                    cerr << "error:[vg giraffe] Must provide fragment length distribution file with --fragment-model." << endl;
+                    exit(1);
+                }
+                break;
+
+            case OPT_FRAGMENT_MODEL_OUT:
+                fragment_model_out_name = optarg;
+                if (fragment_model_out_name.empty()) {
+                    cerr << "error:[vg giraffe] Must provide fragment length distribution file with --fragment-model-out." << endl;
+                    exit(1);
+                }
+                break;
+
             case OPT_TRACK_PROVENANCE:
                 track_provenance = true;
                 break;
@@ -876,6 +979,22 @@ int main_giraffe(int argc, char** argv) {
                 track_provenance = true;
                 track_correctness = true;
                 break;
+
+            case OPT_STAGE_PROFILE:
+                // Stages are only recorded when tracking provenance
+                track_provenance = true;
+                stage_profile = true;
+                break;
+
+            case OPT_STAGE_PROFILE_TSV:
+                track_provenance = true;
+                stage_profile = true;
+                stage_profile_tsv_name = optarg;
+                if (stage_profile_tsv_name.empty()) {
+                    cerr << "error:[vg giraffe] Must provide a file name with --stage-profile-tsv." << endl;
+                    exit(1);
+                }
+                break;
                 
             case OPT_SHOW_WORK:
                 show_work = true;
@@ -886,6 +1005,10 @@ int main_giraffe(int argc, char** argv) {
             case 'B':
                 batch_size = parse<uint64_t>(optarg);
                 break;
+
+            case OPT_PIPELINE:
+                use_pipeline = true;
+                break;
                 
             case 't':
             {
@@ -967,6 +1090,11 @@ int main_giraffe(int argc, char** argv) {
         ref_paths_name = "";
     }
     
+    if (hts_options.sorted && !hts_output) {
+        cerr << "error:[vg giraffe] Sorted output (--sorted) requires output format (-o) SAM, BAM, or CRAM" << endl;
+        exit(1);
+    }
+    
     if (output_format != "GAM" && !output_basename.empty()) {
         cerr << "error:[vg giraffe] Using an output basename (--output-basename) only makes sense for GAM format (-o)" << endl;
         exit(1);
@@ -996,7 +1124,11 @@ int main_giraffe(int argc, char** argv) {
         fragment_mean = 0.0;
         fragment_stdev = 0.0;
     }
-    if ((forced_mean || forced_stdev || forced_rescue_attempts) && (!paired)) {
+    if (!fragment_model_name.empty() && (forced_mean || forced_stdev)) {
+        cerr << "error:[vg giraffe] Cannot both load a fragment length distribution (--fragment-model) and force its parameters (--fragment-mean/--fragment-stdev)" << endl;
+        exit(1);
+    }
+    if ((forced_mean || forced_stdev || forced_rescue_attempts || !fragment_model_name.empty() || !fragment_model_out_name.empty()) && (!paired)) {
         cerr << "warning:[vg giraffe] Attempting to set paired-end parameters but running in single-end mode" << endl;
     }
 
@@ -1088,33 +1220,76 @@ int main_giraffe(int argc, char** argv) {
     }
 #endif
     
+    // Load all the indexes at once, each on its own thread, since loading is
+    // mostly waiting on I/O and decoding that doesn't depend on the other
+    // indexes. Each load reports how long it took.
+    auto start_load = [&](const string& description, const function<void(void)>& load) {
+        if (show_progress) {
+            cerr << "Loading " << description << endl;
+        }
+        return std::async(std::launch::async, [load]() {
+            std::chrono::time_point<std::chrono::system_clock> load_start = std::chrono::system_clock::now();
+            load();
+            return std::chrono::duration<double>(std::chrono::system_clock::now() - load_start);
+        });
+    };
+    vector<pair<string, std::future<std::chrono::duration<double>>>> loads;
+    
     // Grab the minimizer index
-    if (show_progress) {
-        cerr << "Loading Minimizer Index" << endl;
-    }
-    auto minimizer_index = vg::io::VPKG::load_one<gbwtgraph::DefaultMinimizerIndex>(registry.require("Minimizers").at(0));
+    unique_ptr<gbwtgraph::DefaultMinimizerIndex> minimizer_index;
+    string minimizer_name = registry.require("Minimizers").at(0);
+    loads.emplace_back("Minimizer Index", start_load("Minimizer Index", [&]() {
+        minimizer_index = vg::io::VPKG::load_one<gbwtgraph::DefaultMinimizerIndex>(minimizer_name);
+    }));
 
     // Grab the GBZ
-    if (show_progress) {
-        cerr << "Loading GBZ" << endl;
-    }
-    auto gbz = vg::io::VPKG::load_one<gbwtgraph::GBZ>(registry.require("Giraffe GBZ").at(0));
+    unique_ptr<gbwtgraph::GBZ> gbz;
+    string gbz_name = registry.require("Giraffe GBZ").at(0);
+    loads.emplace_back("GBZ", start_load("GBZ", [&]() {
+        gbz = vg::io::VPKG::load_one<gbwtgraph::GBZ>(gbz_name);
+    }));
 
     // Grab the distance index
-    if (show_progress) {
-        cerr << "Loading Distance Index v2" << endl;
+    unique_ptr<SnarlDistanceIndex> distance_index;
+    string distance_name = registry.require("Giraffe Distance Index").at(0);
+    std::chrono::duration<double> di2_preload_seconds(0);
+    loads.emplace_back("Distance Index v2", start_load("Distance Index v2", [&]() {
+        distance_index = vg::io::VPKG::load_one<SnarlDistanceIndex>(distance_name);
+        
+        std::chrono::time_point<std::chrono::system_clock> preload_start = std::chrono::system_clock::now();
+        // Make sure the distance index is paged in from disk.
+        // This does a blocking load; a nonblocking hint to the kernel doesn't seem to help at all.
+        distance_index->preload(true);
+        di2_preload_seconds = std::chrono::system_clock::now() - preload_start;
+    }));
+    
+    // If we are tracking correctness or writing HTS output, we need paths, and
+    // an XG is the best place to get them if there is one. Otherwise, it's not
+    // possible to provide paths when using an old GBWT/GBZ that doesn't have them.
+    unique_ptr<PathHandleGraph> xg_graph;
+    if ((track_correctness || hts_output) && registry.available("XG")) {
+        string xg_name = registry.require("XG").at(0);
+        loads.emplace_back("XG Graph", start_load("XG Graph", [&, xg_name]() {
+            xg_graph = vg::io::VPKG::load_one<PathHandleGraph>(xg_name);
+        }));
     }
-    auto distance_index = vg::io::VPKG::load_one<SnarlDistanceIndex>(registry.require("Giraffe Distance Index").at(0));
     
-    if (show_progress) {
-        cerr << "Paging in Distance Index v2" << endl;
+    // Wait for everything, and only then complain about anything that failed.
+    bool load_failed = false;
+    for (auto& load : loads) {
+        try {
+            std::chrono::duration<double> load_seconds = load.second.get();
+            if (show_progress) {
+                cerr << "Loaded " << load.first << " in " << load_seconds.count() << " seconds" << endl;
+            }
+        } catch (const std::exception& ex) {
+            cerr << "error:[vg giraffe] Could not load " << load.first << ": " << ex.what() << endl;
+            load_failed = true;
+        }
+    }
+    if (load_failed) {
+        exit(1);
     }
-    std::chrono::time_point<std::chrono::system_clock> preload_start = std::chrono::system_clock::now();
-    // Make sure the distance index is paged in from disk.
-    // This does a blocking load; a nonblocking hint to the kernel doesn't seem to help at all.
-    distance_index->preload(true);
-    std::chrono::time_point<std::chrono::system_clock> preload_end = std::chrono::system_clock::now();
-    std::chrono::duration<double> di2_preload_seconds = preload_end - preload_start;
     
     // If we are tracking correctness, we will fill this in with a graph for
     // getting offsets along ref paths.
@@ -1122,19 +1297,9 @@ int main_giraffe(int argc, char** argv) {
     // If we need an overlay for position lookup, we might be pointing into
     // this overlay. We want one that's good for reference path queries.
     bdsg::ReferencePathOverlayHelper overlay_helper;
-    // And we might load an XG
-    unique_ptr<PathHandleGraph> xg_graph;
     if (track_correctness || hts_output) {
-        // Usually we will get our paths from the GBZ
-        PathHandleGraph* base_graph = &gbz->graph;
-        // But if an XG is around, we should use that instead. Otherwise, it's not possible to provide paths when using an old GBWT/GBZ that doesn't have them.
-        if (registry.available("XG")) {
-            if (show_progress) {
-                cerr << "Loading XG Graph" << endl;
-            }
-            xg_graph = vg::io::VPKG::load_one<PathHandleGraph>(registry.require("XG").at(0));
-            base_graph = xg_graph.get();
-        }
+        // Usually we will get our paths from the GBZ, but use the XG if we loaded one.
+        PathHandleGraph* base_graph = xg_graph ? xg_graph.get() : &gbz->graph;
     
         // Apply the overlay if needed.
         path_position_graph = overlay_helper.apply(base_graph);
@@ -1148,6 +1313,20 @@ int main_giraffe(int argc, char** argv) {
     if (forced_mean && forced_stdev) {
         minimizer_mapper.force_fragment_length_distr(fragment_mean, fragment_stdev);
     }
+    if (!fragment_model_name.empty()) {
+        // Start in fully parallel paired mode with a distribution from an earlier run
+        try {
+            get_input_file(fragment_model_name, [&](istream& in) {
+                minimizer_mapper.load_fragment_length_distr(in);
+            });
+        } catch (const std::runtime_error& ex) {
+            cerr << "error:[vg giraffe] Could not load fragment length distribution from " << fragment_model_name << ": " << ex.what() << endl;
+            exit(1);
+        }
+        if (show_progress) {
+            cerr << "Loaded fragment length distribution: " << minimizer_mapper.get_fragment_length_mean() << " +/- " << minimizer_mapper.get_fragment_length_stdev() << endl;
+        }
+    }
     
     std::chrono::time_point<std::chrono::system_clock> init = std::chrono::system_clock::now();
     std::chrono::duration<double> init_seconds = init - launch;
@@ -1168,7 +1347,7 @@ int main_giraffe(int argc, char** argv) {
         }
         
         // Add a header
-        report << "#file\treads/second/thread" << endl;
+        report << "#file\treads/second/thread\toutput_MB/second" << endl;
     }
 
     // We need to loop over all the ranges...
@@ -1225,6 +1404,26 @@ int main_giraffe(int argc, char** argv) {
             cerr << "--track-correctness " << endl;
         }
         minimizer_mapper.track_correctness = track_correctness;
+
+        // Set up to profile each mapping stage, if asked
+        unique_ptr<ofstream> stage_profile_tsv;
+        unique_ptr<FunnelProfileSummary> stage_profile_summary;
+        if (stage_profile) {
+            if (show_progress) {
+                cerr << "--stage-profile " << endl;
+            }
+            Funnel::profile_stages = true;
+            Funnel::thread_allocated_bytes = get_thread_allocated_bytes;
+            if (!stage_profile_tsv_name.empty()) {
+                stage_profile_tsv.reset(new ofstream(stage_profile_tsv_name));
+                if (!*stage_profile_tsv) {
+                    cerr << "error:[vg giraffe] Could not open " << stage_profile_tsv_name << " for writing." << endl;
+                    exit(1);
+                }
+            }
+            stage_profile_summary.reset(new FunnelProfileSummary(stage_profile_tsv.get()));
+            minimizer_mapper.stage_profile = stage_profile_summary.get();
+        }
         
         if (show_progress && show_work) {
             cerr << "--show-work " << endl;
@@ -1236,6 +1435,9 @@ int main_giraffe(int argc, char** argv) {
                 cerr << "--fragment-mean " << fragment_mean << endl; 
                 cerr << "--fragment-stdev " << fragment_stdev << endl;
             }
+            if (!fragment_model_name.empty()) {
+                cerr << "--fragment-model " << fragment_model_name << endl;
+            }
             cerr << "--rescue-algorithm " << algorithm_names[rescue_algorithm] << endl;
         }
         minimizer_mapper.rescue_algorithm = rescue_algorithm;
@@ -1344,7 +1546,7 @@ int main_giraffe(int argc, char** argv) {
                 
                 alignment_emitter = get_alignment_emitter(output_filename, output_format,
                                                           paths, thread_count,
-                                                          emitter_graph, flags);
+                                                          emitter_graph, flags, hts_options, watchdog.get());
             }
             
 #ifdef USE_CALLGRIND
@@ -1360,6 +1562,54 @@ int main_giraffe(int argc, char** argv) {
             reset_perf_for_thread();
 #endif
 
+            // Make a function that fills a pipeline batch with up to
+            // batch_size items, using a function that reads one item of the
+            // given number of reads.
+            auto parse_batches = [&](const function<bool(Alignment*)>& next_item, size_t item_size) {
+                return function<bool(MappingBatch&)>([&, next_item, item_size](MappingBatch& batch) {
+                    batch.reads.resize(batch_size * item_size);
+                    size_t used = 0;
+                    while (used < batch.reads.size() && next_item(&batch.reads[used])) {
+                        used += item_size;
+                    }
+                    batch.reads.resize(used);
+                    return used != 0;
+                });
+            };
+
+            // Run batches through separate parse, map, and emit stages.
+            auto run_pipeline = [&](const function<bool(MappingBatch&)>& parse_batch,
+                                    const function<void(MappingBatch&)>& map_batch,
+                                    const function<void(MappingBatch&)>& emit_batch,
+                                    const function<bool(void)>& single_threaded_until_true) {
+                ReadPipeline<MappingBatch> pipeline(thread_count, thread_count * 2);
+                pipeline.parse = parse_batch;
+                pipeline.map = map_batch;
+                pipeline.emit = emit_batch;
+                pipeline.single_threaded_until_true = single_threaded_until_true;
+                // Surjection makes emitting as much work as mapping, so let
+                // the mapping threads emit their own batches.
+                pipeline.emit_separately = !hts_output;
+                try {
+                    pipeline.run();
+                } catch (const runtime_error& e) {
+                    // Input problems come out of the parsing stage once it has stopped
+                    cerr << "error:[vg giraffe] " << e.what() << endl;
+                    exit(1);
+                }
+
+                if (show_progress) {
+                    auto report_stage = [&](const string& name, const ReadPipeline<MappingBatch>::StageStats& stats) {
+                        cerr << "Pipeline " << name << " stage: " << stats.batches << " batches, "
+                            << stats.busy_seconds() << " seconds busy, "
+                            << stats.stalled_seconds() << " seconds stalled" << endl;
+                    };
+                    report_stage("parse", pipeline.parse_stats);
+                    report_stage("map", pipeline.map_stats);
+                    report_stage("emit", pipeline.emit_stats);
+                }
+            };
+
             if (interleaved || !fastq_filename_2.empty()) {
                 //Map paired end from either one gam or fastq file or two fastq files
 
@@ -1405,8 +1655,9 @@ int main_giraffe(int argc, char** argv) {
                     }
                 };
                 
-                // Define how to align and output a read pair, in a thread.
-                auto map_read_pair = [&](Alignment& aln1, Alignment& aln2) {
+                // Define how to align a read pair, in a thread, and output it
+                // or, when using the pipeline, save it in the given batch.
+                auto map_read_pair_to = [&](Alignment& aln1, Alignment& aln2, MappingBatch* batch) {
                     try {
                         set_crash_context(aln1.name() + ", " + aln2.name());
                         
@@ -1438,8 +1689,15 @@ int main_giraffe(int argc, char** argv) {
                             if (hts_output && minimizer_mapper.fragment_distr_is_finalized()) {
                                  tlen_limit = minimizer_mapper.get_fragment_length_mean() + 6 * minimizer_mapper.get_fragment_length_stdev();
                             }
-                            // Emit it
-                            alignment_emitter->emit_mapped_pair(std::move(mapped_pairs.first), std::move(mapped_pairs.second), tlen_limit);
+                            if (batch) {
+                                // Save it for the emit stage
+                                batch->mapped1.emplace_back(std::move(mapped_pairs.first));
+                                batch->mapped2.emplace_back(std::move(mapped_pairs.second));
+                                batch->tlen_limits.push_back(tlen_limit);
+                            } else {
+                                // Emit it
+                                alignment_emitter->emit_mapped_pair(std::move(mapped_pairs.first), std::move(mapped_pairs.second), tlen_limit);
+                            }
                             // Record that we mapped a read.
                             reads_mapped_by_thread.at(thread_num) += 2;
                         }
@@ -1463,7 +1721,63 @@ int main_giraffe(int argc, char** argv) {
                     }
                 };
 
-                if (!gam_filename.empty()) {
+                auto map_read_pair = [&](Alignment& aln1, Alignment& aln2) {
+                    map_read_pair_to(aln1, aln2, nullptr);
+                };
+
+                if (use_pipeline) {
+                    auto map_batch = [&](MappingBatch& batch) {
+                        for (size_t i = 0; i + 1 < batch.reads.size(); i += 2) {
+                            map_read_pair_to(batch.reads[i], batch.reads[i + 1], &batch);
+                        }
+                    };
+                    auto emit_batch = [&](MappingBatch& batch) {
+                        alignment_emitter->emit_mapped_pairs(std::move(batch.mapped1), std::move(batch.mapped2), std::move(batch.tlen_limits));
+                    };
+
+                    if (!gam_filename.empty()) {
+                        // GAM file to remap
+                        get_input_file(gam_filename, [&](istream& in) {
+                            vg::io::ProtobufIterator<Alignment> cursor(in);
+                            auto next_pair = [&](Alignment* mates) {
+                                if (!cursor.has_current()) {
+                                    return false;
+                                }
+                                mates[0] = cursor.take();
+                                if (!cursor.has_current()) {
+                                    cerr << "error:[vg giraffe] Interleaved GAM " << gam_filename << " has an odd number of reads" << endl;
+                                    exit(1);
+                                }
+                                mates[1] = cursor.take();
+                                return true;
+                            };
+                            run_pipeline(parse_batches(next_pair, 2), map_batch, emit_batch, distribution_is_ready);
+                        });
+                    } else if (!fastq_filename_2.empty()) {
+                        // A pair of FASTQ files to map
+                        size_t decode_threads = max<size_t>(thread_count / 2, 1);
+                        FastqReader reader1(fastq_filename_1, decode_threads);
+                        FastqReader reader2(fastq_filename_2, decode_threads);
+                        auto next_pair = [&](Alignment* mates) {
+                            bool have_mate1 = reader1.get_next_alignment(mates[0], comments_as_tags);
+                            // Always read from both, so we notice if one file is longer
+                            bool have_mate2 = reader2.get_next_alignment(mates[1], comments_as_tags);
+                            if (have_mate1 != have_mate2) {
+                                throw runtime_error((have_mate1 ? fastq_filename_1 : fastq_filename_2) + " has more reads than "
+                                                    + (have_mate1 ? fastq_filename_2 : fastq_filename_1));
+                            }
+                            return have_mate1;
+                        };
+                        run_pipeline(parse_batches(next_pair, 2), map_batch, emit_batch, distribution_is_ready);
+                    } else if (!fastq_filename_1.empty()) {
+                        // An interleaved FASTQ file to map
+                        FastqReader reader(fastq_filename_1, thread_count);
+                        auto next_pair = [&](Alignment* mates) {
+                            return reader.get_next_interleaved_pair(mates[0], mates[1], comments_as_tags);
+                        };
+                        run_pipeline(parse_batches(next_pair, 2), map_batch, emit_batch, distribution_is_ready);
+                    }
+                } else if (!gam_filename.empty()) {
                     // GAM file to remap
                     get_input_file(gam_filename, [&](istream& in) {
                         // Map pairs of reads to the emitter
@@ -1500,14 +1814,25 @@ int main_giraffe(int argc, char** argv) {
                         report_exception(ex);
                     }
                 }
+                
+                if (!fragment_model_out_name.empty()) {
+                    // Save the distribution so later runs don't need to estimate it
+                    ofstream fragment_model_out(fragment_model_out_name);
+                    if (!fragment_model_out) {
+                        cerr << "error:[vg giraffe] Could not open fragment length distribution file " << fragment_model_out_name << " for writing" << endl;
+                        exit(1);
+                    }
+                    minimizer_mapper.get_fragment_length_distr().save(fragment_model_out);
+                }
             } else {
                 // Map single-ended
 
                 // All the threads start at once.
                 all_threads_start = first_thread_start;
             
-                // Define how to align and output a read, in a thread.
-                auto map_read = [&](Alignment& aln) {
+                // Define how to align a read, in a thread, and output it or,
+                // when using the pipeline, save it in the given batch.
+                auto map_read_to = [&](Alignment& aln, MappingBatch* batch) {
                     try {
                         set_crash_context(aln.name());
                         auto thread_num = omp_get_thread_num();
@@ -1521,7 +1846,11 @@ int main_giraffe(int argc, char** argv) {
                         toUppercaseInPlace(*aln.mutable_sequence());
                     
                         // Map the read with the MinimizerMapper.
-                        minimizer_mapper.map(aln, *alignment_emitter);
+                        if (batch) {
+                            batch->mapped1.emplace_back(minimizer_mapper.map(aln));
+                        } else {
+                            minimizer_mapper.map(aln, *alignment_emitter);
+                        }
                         // Record that we mapped a read.
                         reads_mapped_by_thread.at(thread_num)++;
                         
@@ -1534,17 +1863,56 @@ int main_giraffe(int argc, char** argv) {
                     }
                 };
                     
-                if (!gam_filename.empty()) {
-                    // GAM file to remap
-                    get_input_file(gam_filename, [&](istream& in) {
-                        // Open it and map all the reads in parallel.
-                        vg::io::for_each_parallel<Alignment>(in, map_read, batch_size);
-                    });
-                }
-                
-                if (!fastq_filename_1.empty()) {
-                    // FASTQ file to map, map all its reads in parallel.
-                    fastq_unpaired_for_each_parallel(fastq_filename_1, map_read, comments_as_tags, batch_size);
+                auto map_read = [&](Alignment& aln) {
+                    map_read_to(aln, nullptr);
+                };
+
+                if (use_pipeline) {
+                    auto map_batch = [&](MappingBatch& batch) {
+                        for (Alignment& aln : batch.reads) {
+                            map_read_to(aln, &batch);
+                        }
+                    };
+                    auto emit_batch = [&](MappingBatch& batch) {
+                        alignment_emitter->emit_mapped_singles(std::move(batch.mapped1));
+                    };
+
+                    if (!gam_filename.empty()) {
+                        // GAM file to remap
+                        get_input_file(gam_filename, [&](istream& in) {
+                            vg::io::ProtobufIterator<Alignment> cursor(in);
+                            auto next_read = [&](Alignment* read) {
+                                if (!cursor.has_current()) {
+                                    return false;
+                                }
+                                *read = cursor.take();
+                                return true;
+                            };
+                            run_pipeline(parse_batches(next_read, 1), map_batch, emit_batch, nullptr);
+                        });
+                    }
+
+                    if (!fastq_filename_1.empty()) {
+                        // FASTQ file to map
+                        FastqReader reader(fastq_filename_1, thread_count);
+                        auto next_read = [&](Alignment* read) {
+                            return reader.get_next_alignment(*read, comments_as_tags);
+                        };
+                        run_pipeline(parse_batches(next_read, 1), map_batch, emit_batch, nullptr);
+                    }
+                } else {
+                    if (!gam_filename.empty()) {
+                        // GAM file to remap
+                        get_input_file(gam_filename, [&](istream& in) {
+                            // Open it and map all the reads in parallel.
+                            vg::io::for_each_parallel<Alignment>(in, map_read, batch_size);
+                        });
+                    }
+                    
+                    if (!fastq_filename_1.empty()) {
+                        // FASTQ file to map, map all its reads in parallel.
+                        fastq_unpaired_for_each_parallel(fastq_filename_1, map_read, comments_as_tags, batch_size);
+                    }
                 }
             }
         
@@ -1615,13 +1983,35 @@ int main_giraffe(int argc, char** argv) {
                     << " M mapping instructions per inclusive CPU-second" << endl;
             }
 
+            size_t rescue_cache_hits = minimizer_mapper.rescue_subgraph_cache_hits;
+            size_t rescue_cache_lookups = rescue_cache_hits + minimizer_mapper.rescue_subgraph_cache_misses;
+            if (rescue_cache_lookups != 0) {
+                cerr << "Rescue subgraph cache: " << rescue_cache_hits << " hits in " << rescue_cache_lookups
+                    << " rescues (" << (100.0 * rescue_cache_hits / rescue_cache_lookups) << "%)" << endl;
+            }
+
             cerr << "Memory footprint: " << gbwt::inGigabytes(gbwt::memoryUsage()) << " GB" << endl;
         }
+
+        if (stage_profile_summary) {
+            // Say where the mapping time and memory went
+            cerr << "Mapping stage profile:" << endl;
+            stage_profile_summary->write_table(cerr);
+            minimizer_mapper.stage_profile = nullptr;
+        }
         
         
         if (report) {
-            // Log output filename and mapping speed in reads/second/thread to report TSV
-            report << output_filename << "\t" << reads_per_second_per_thread << endl;
+            // Log output filename and mapping speed in reads/second/thread to report TSV.
+            // Also log how fast we produced (and compressed) output, if it went to a file we can measure.
+            report << output_filename << "\t" << reads_per_second_per_thread << "\t";
+            struct stat output_stat;
+            if (output_filename != "-" && stat(output_filename.c_str(), &output_stat) == 0) {
+                report << output_stat.st_size / 1E6 / (all_threads_seconds.count() + first_thread_additional_seconds.count());
+            } else {
+                report << "NA";
+            }
+            report << endl;
         }
         
     });
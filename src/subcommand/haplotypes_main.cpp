@@ -8,6 +8,7 @@
 #include "../hash_map.hpp"
 #include "../recombinator.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <functional>
@@ -78,6 +79,7 @@ struct HaplotypesConfig {
         mode_map_variants,
         mode_extract,
         mode_classify,
+        mode_count_kmers,
     };
 
     OperatingMode mode = mode_invalid;
@@ -85,7 +87,7 @@ struct HaplotypesConfig {
 
     // File names.
     std::string graph_name;
-    std::string gbz_output, haplotype_output, score_output, kmer_output;
+    std::string gbz_output, haplotype_output, score_output, kmer_output, count_output;
     std::string distance_name, r_index_name;
     std::string haplotype_input, kmer_input, vcf_input;
 
@@ -118,6 +120,8 @@ void extract_haplotypes(const gbwtgraph::GBZ& gbz, const Haplotypes& haplotypes,
 
 void classify_kmers(const gbwtgraph::GBZ& gbz, const Haplotypes& haplotypes, const HaplotypesConfig& config);
 
+void count_kmers(const Haplotypes& haplotypes, const HaplotypesConfig& config);
+
 //----------------------------------------------------------------------------
 
 int main_haplotypes(int argc, char** argv) {
@@ -177,6 +181,11 @@ int main_haplotypes(int argc, char** argv) {
         classify_kmers(gbz, haplotypes, config);
     }
 
+    // Count kmers.
+    if (config.mode == HaplotypesConfig::mode_count_kmers) {
+        count_kmers(haplotypes, config);
+    }
+
     if (config.verbosity >= Haplotypes::verbosity_basic) {
         double seconds = gbwt::readTimer() - start;
         double gib = gbwt::inGigabytes(gbwt::memoryUsage());
@@ -211,7 +220,8 @@ void help_haplotypes(char** argv, bool developer_options) {
     std::cerr << "    -d, --distance-index X    use this distance index (default: <basename>.dist)" << std::endl;
     std::cerr << "    -r, --r-index X           use this r-index (default: <basename>.ri)" << std::endl;
     std::cerr << "    -i, --haplotype-input X   use this haplotype information (default: generate)" << std::endl;
-    std::cerr << "    -k, --kmer-input X        use kmer counts from this KFF file (required for --gbz-output)" << std::endl;
+    std::cerr << "    -k, --kmer-input X        use kmer counts from this KFF file, or count kmers in these" << std::endl;
+    std::cerr << "                              FASTQ / FASTA / GAM reads (required for --gbz-output)" << std::endl;
     std::cerr << std::endl;
     std::cerr << "Options for generating haplotype information:" << std::endl;
     std::cerr << "        --kmer-length N       kmer length for building the minimizer index (default: " << haplotypes_default_k() << ")" << std::endl;
@@ -221,7 +231,7 @@ void help_haplotypes(char** argv, bool developer_options) {
     std::cerr << std::endl;
     std::cerr << "Options for sampling haplotypes:" << std::endl;
     std::cerr << "        --preset X            use preset X (default, haploid, diploid)" << std::endl;
-    std::cerr << "        --coverage N          kmer coverage in the KFF file (default: estimate)" << std::endl;
+    std::cerr << "        --coverage N          kmer coverage in the kmer input (default: estimate)" << std::endl;
     std::cerr << "        --num-haplotypes N    generate N haplotypes (default: " << haplotypes_default_n() << ")" << std::endl;
     std::cerr << "                              sample from N candidates (with --diploid-sampling; default: " << haplotypes_default_candidates() << ")" << std::endl;
     std::cerr << "        --present-discount F  discount scores for present kmers by factor F (default: " << haplotypes_default_discount() << ")" << std::endl;
@@ -243,6 +253,7 @@ void help_haplotypes(char** argv, bool developer_options) {
         std::cerr << "        --extract M:N         extract haplotypes in chain M, subchain N in FASTA format" << std::endl;
         std::cerr << "        --score-output X      write haplotype scores to X" << std::endl;
         std::cerr << "        --classify X          classify kmers and write output to X" << std::endl;
+        std::cerr << "        --kmer-counts X       write the counts of the subchain kmers to X as TSV" << std::endl;
         std::cerr << std::endl;
     }
 }
@@ -269,6 +280,7 @@ HaplotypesConfig::HaplotypesConfig(int argc, char** argv, size_t max_threads) {
     constexpr int OPT_EXTRACT = 1600;
     constexpr int OPT_SCORE_OUTPUT = 1601;
     constexpr int OPT_CLASSIFY = 1602;
+    constexpr int OPT_KMER_COUNTS = 1603;
 
     static struct option long_options[] =
     {
@@ -299,6 +311,7 @@ HaplotypesConfig::HaplotypesConfig(int argc, char** argv, size_t max_threads) {
         { "extract", required_argument, 0, OPT_EXTRACT },
         { "score-output", required_argument, 0, OPT_SCORE_OUTPUT },
         { "classify", required_argument, 0, OPT_CLASSIFY },
+        { "kmer-counts", required_argument, 0, OPT_KMER_COUNTS },
         { 0, 0, 0, 0 }
     };
 
@@ -463,6 +476,9 @@ HaplotypesConfig::HaplotypesConfig(int argc, char** argv, size_t max_threads) {
         case OPT_CLASSIFY:
             this->kmer_output = optarg;
             break;
+        case OPT_KMER_COUNTS:
+            this->count_output = optarg;
+            break;
 
         case 'h':
         case '?':
@@ -492,6 +508,8 @@ HaplotypesConfig::HaplotypesConfig(int argc, char** argv, size_t max_threads) {
         this->mode = mode_extract;
     } else if (!this->haplotype_input.empty() && !this->kmer_input.empty() && !this->kmer_output.empty()) {
         this->mode = mode_classify;
+    } else if (!this->haplotype_input.empty() && !this->kmer_input.empty() && !this->count_output.empty()) {
+        this->mode = mode_count_kmers;
     }
     if (this->mode == mode_invalid) {
         help_haplotypes(argv, false);
@@ -990,6 +1008,34 @@ void classify_kmers(const gbwtgraph::GBZ& gbz, const Haplotypes& haplotypes, con
 
 //----------------------------------------------------------------------------
 
+void count_kmers(const Haplotypes& haplotypes, const HaplotypesConfig& config) {
+    hash_map<Haplotypes::Subchain::kmer_type, size_t> counts;
+    try {
+        counts = haplotypes.kmer_counts(config.kmer_input, config.verbosity);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "error: [vg haplotypes] " << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    // Sort the kmers so that counts from different sources can be compared.
+    std::vector<std::pair<Haplotypes::Subchain::kmer_type, size_t>> sorted(counts.begin(), counts.end());
+    std::sort(sorted.begin(), sorted.end());
+
+    if (config.verbosity >= Haplotypes::verbosity_basic) {
+        std::cerr << "Writing " << sorted.size() << " kmer counts to " << config.count_output << std::endl;
+    }
+    std::ofstream out(config.count_output);
+    if (!out) {
+        std::cerr << "error: [vg haplotypes] cannot open kmer count file " << config.count_output << " for writing" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    for (auto& kmer : sorted) {
+        out << kmer.first << "\t" << kmer.second << "\n";
+    }
+}
+
+//----------------------------------------------------------------------------
+
 void validate_error(const std::string& header, const std::string& message) {
     std::cerr << "error: [vg haplotypes] ";
     if (!header.empty()) {
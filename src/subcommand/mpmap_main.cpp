@@ -95,6 +95,7 @@ void help_mpmap(char** argv) {
     << "graph/index:" << endl
     << "  -x, --graph-name FILE     graph (required; XG format recommended but other formats are valid, see `vg convert`) " << endl
     << "  -g, --gcsa-name FILE      use this GCSA2/LCP index pair for MEMs (required; both FILE and FILE.lcp, see `vg index`)" << endl
+    << "                            (FILE.accel from `vg autoindex` is also used if present)" << endl
     //<< "  -H, --gbwt-name FILE         use this GBWT haplotype index for population-based MAPQs" << endl
     << "  -d, --dist-name FILE      use this snarl distance index for clustering (recommended, see `vg index`)" << endl
     //<< "      --linear-index FILE      use this sublinear Li and Stephens index file for population-based MAPQs" << endl
@@ -1788,25 +1789,49 @@ int main_mpmap(int argc, char** argv) {
     unique_ptr<MEMAccelerator> mem_accelerator;
     unique_ptr<gcsa::LCPArray> lcp_array;
     if (!use_stripped_match_alg) {
-        // don't make a huge table for a small graph
-        mem_accelerator_length = min<int>(mem_accelerator_length, round(log(total_seq_length) / log(4.0)));
-        // try to add an active thread
-        int curr_thread_active = threads_active++;
-        if (curr_thread_active >= thread_count) {
-            // take back the increment and don't let it go multithreaded
-            --threads_active;
-            log_progress("Memoizing GCSA2 queries");
-            mem_accelerator = unique_ptr<MEMAccelerator>(new MEMAccelerator(*gcsa_index, mem_accelerator_length));
-            log_progress("Completed memoizing GCSA2 queries");
+        // vg autoindex may have memoized the queries for us already
+        string mem_accelerator_name = gcsa_name + ".accel";
+        ifstream mem_accelerator_stream(mem_accelerator_name);
+        if (mem_accelerator_stream) {
+            log_progress("Loading GCSA2 query memo from " + mem_accelerator_name);
+            try {
+                mem_accelerator = vg::io::VPKG::load_one<MEMAccelerator>(mem_accelerator_stream);
+            }
+            catch (const runtime_error& e) {
+                cerr << "warning:[vg mpmap] Could not load GCSA2 query memo " << mem_accelerator_name
+                     << " (" << e.what() << "), memoizing queries again." << endl;
+            }
+            if (mem_accelerator && !mem_accelerator->built_from(*gcsa_index)) {
+                // a stale memo would silently give wrong ranges
+                cerr << "warning:[vg mpmap] GCSA2 query memo " << mem_accelerator_name
+                     << " was not built from " << gcsa_name << ", memoizing queries again." << endl;
+                mem_accelerator.reset();
+            }
+            if (mem_accelerator) {
+                log_progress("Completed loading GCSA2 query memo");
+            }
         }
-        else {
-            // do the process in a background thread
-            background_processes.emplace_back([&]() {
-                log_progress("Memoizing GCSA2 queries (in background)");
-                mem_accelerator = unique_ptr<MEMAccelerator>(new MEMAccelerator(*gcsa_index, mem_accelerator_length));
+        if (!mem_accelerator) {
+            // don't make a huge table for a small graph
+            mem_accelerator_length = min<int>(mem_accelerator_length, round(log(total_seq_length) / log(4.0)));
+            // try to add an active thread
+            int curr_thread_active = threads_active++;
+            if (curr_thread_active >= thread_count) {
+                // take back the increment and don't let it go multithreaded
                 --threads_active;
+                log_progress("Memoizing GCSA2 queries");
+                mem_accelerator = unique_ptr<MEMAccelerator>(new MEMAccelerator(*gcsa_index, mem_accelerator_length));
                 log_progress("Completed memoizing GCSA2 queries");
-            });
+            }
+            else {
+                // do the process in a background thread
+                background_processes.emplace_back([&]() {
+                    log_progress("Memoizing GCSA2 queries (in background)");
+                    mem_accelerator = unique_ptr<MEMAccelerator>(new MEMAccelerator(*gcsa_index, mem_accelerator_length));
+                    --threads_active;
+                    log_progress("Completed memoizing GCSA2 queries");
+                });
+            }
         }
         
         // The stripped algorithm doesn't use the LCP, but we aren't doing it
@@ -1856,6 +1881,7 @@ int main_mpmap(int argc, char** argv) {
         surjector = unique_ptr<Surjector>(new Surjector(path_position_handle_graph));
         surjector->min_splice_length = transcriptomic ? min_splice_length : numeric_limits<int64_t>::max();
         surjector->adjust_alignments_for_base_quality = qual_adjusted;
+        surjector->set_banded_workspace_reuse(true);
         if (transcriptomic) {
             // FIXME: replicating the behavior in surject_main
             surjector->max_subgraph_bases = 16 * 1024 * 1024;
@@ -1908,6 +1934,7 @@ int main_mpmap(int argc, char** argv) {
         multipath_mapper.set_alignment_scores(match_score, mismatch_score, gap_open_score, gap_extension_score, full_length_bonus);
     }
     multipath_mapper.adjust_alignments_for_base_quality = qual_adjusted;
+    multipath_mapper.set_banded_workspace_reuse(true);
     multipath_mapper.strip_bonuses = strip_full_length_bonus;
     multipath_mapper.choose_band_padding = vg::algorithms::pad_band_random_walk(band_padding_multiplier);
     
@@ -32,6 +32,7 @@ void help_pack(char** argv) {
          << "    -Q, --min-mapq N       ignore reads with MAPQ < N and positions with base quality < N [default: 0]" << endl
          << "    -c, --expected-cov N   expected coverage.  used only for memory tuning [default : 128]" << endl
          << "    -s, --trim-ends N      ignore the first and last N bases of each read" << endl 
+         << "    -B, --thread-buffer N  buffer N coverage increments per thread between bin locks (0 to disable) [default: 4096]" << endl
          << "    -t, --threads N        use N threads (defaults to numCPUs)" << endl;
 }
 
@@ -54,6 +55,7 @@ int main_pack(int argc, char** argv) {
     int min_baseq = 0;
     size_t expected_coverage = 128;
     int trim_ends = 0;
+    size_t thread_buffer_size = 4096;
 
     if (argc == 2) {
         help_pack(argv);
@@ -82,11 +84,12 @@ int main_pack(int argc, char** argv) {
             {"min-mapq", required_argument, 0, 'Q'},
             {"expected-cov", required_argument, 0, 'c'},
             {"trim-ends", required_argument, 0, 's'},
+            {"thread-buffer", required_argument, 0, 'B'},
             {0, 0, 0, 0}
 
         };
         int option_index = 0;
-        c = getopt_long (argc, argv, "hx:o:i:g:a:dDut:eb:n:N:Q:c:s:",
+        c = getopt_long (argc, argv, "hx:o:i:g:a:dDut:eb:n:N:Q:c:s:B:",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -156,6 +159,9 @@ int main_pack(int argc, char** argv) {
         case 's':
             trim_ends = parse<int>(optarg);
             break;
+        case 'B':
+            thread_buffer_size = parse<size_t>(optarg);
+            break;
         default:
             abort();
         }
@@ -224,6 +230,8 @@ int main_pack(int argc, char** argv) {
     } else if (packs_in.size() > 1) {
         packer.merge_from_files(packs_in);
     }
+    // batch up increments so threads don't contend for the locks of deep bins
+    packer.set_thread_buffer_size(thread_buffer_size);
 
     std::function<void(Alignment&)> lambda = [&packer,&min_mapq,&min_baseq,&trim_ends](Alignment& aln) {
         packer.add(aln, min_mapq, min_baseq, trim_ends);
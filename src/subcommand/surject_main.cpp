@@ -57,6 +57,10 @@ void help_surject(char** argv) {
          << "  -f, --max-frag-len N     reads with fragment lengths greater than N will not be marked properly paired in SAM/BAM/CRAM" << endl
          << "  -L, --list-all-paths     annotate SAM records with a list of all attempted re-alignments to paths in SS tag" << endl
          << "  -C, --compression N      level for compression [0-9]" << endl
+         << "      --compression-threads N  use N additional threads to compress BAM output [0]" << endl
+         << "      --sorted             write SAM/BAM/CRAM sorted by coordinate" << endl
+         << "      --sort-memory N      hold up to N MB of records in memory while sorting [768]" << endl
+         << "      --output FILE        write to FILE instead of stdout (sorted BAM files are also indexed)" << endl
          << "  -V, --no-validate        skip checking whether alignments plausibly are against the provided graph" << endl
          << "  -w, --watchdog-timeout N warn when reads take more than the given number of seconds to surject" << endl;
 }
@@ -115,6 +119,10 @@ int main_surject(int argc, char** argv) {
     string read_group;
     int32_t max_frag_len = 0;
     int compress_level = 9;
+    size_t compression_threads = 0;
+    bool sorted = false;
+    size_t sort_memory_mb = 768;
+    string output_filename = "-";
     int min_splice_length = 20;
     size_t watchdog_timeout = 10;
     bool subpath_global = true; // force full length alignments in mpmap resolution
@@ -126,6 +134,10 @@ int main_surject(int argc, char** argv) {
     bool multimap = false;
     bool validate = true;
 
+    constexpr int OPT_COMPRESSION_THREADS = 1000;
+    constexpr int OPT_SORTED = 1001;
+    constexpr int OPT_SORT_MEMORY = 1002;
+    constexpr int OPT_OUTPUT = 1003;
     int c;
     optind = 2; // force optind past command positional argument
     while (true) {
@@ -155,6 +167,10 @@ int main_surject(int argc, char** argv) {
             {"max-frag-len", required_argument, 0, 'f'},
             {"list-all-paths", no_argument, 0, 'L'},
             {"compress", required_argument, 0, 'C'},
+            {"compression-threads", required_argument, 0, OPT_COMPRESSION_THREADS},
+            {"sorted", no_argument, 0, OPT_SORTED},
+            {"sort-memory", required_argument, 0, OPT_SORT_MEMORY},
+            {"output", required_argument, 0, OPT_OUTPUT},
             {"no-validate", required_argument, 0, 'V'},
             {"watchdog-timeout", required_argument, 0, 'w'},
             {0, 0, 0, 0}
@@ -250,6 +266,30 @@ int main_surject(int argc, char** argv) {
 
         case 'C':
             compress_level = parse<int>(optarg);
+            if (compress_level < 0 || compress_level > 9) {
+                cerr << "error:[vg surject] Compression level (-C) must be between 0 and 9" << endl;
+                exit(1);
+            }
+            break;
+
+        case OPT_COMPRESSION_THREADS:
+            compression_threads = parse<size_t>(optarg);
+            break;
+            
+        case OPT_SORTED:
+            sorted = true;
+            break;
+            
+        case OPT_SORT_MEMORY:
+            sort_memory_mb = parse<size_t>(optarg);
+            if (sort_memory_mb == 0) {
+                cerr << "error:[vg surject] Sort memory (--sort-memory) must be at least 1 MB" << endl;
+                exit(1);
+            }
+            break;
+            
+        case OPT_OUTPUT:
+            output_filename = optarg;
             break;
             
         case 'V':
@@ -279,6 +319,11 @@ int main_surject(int argc, char** argv) {
         }
     }
 
+    if (sorted && output_format != "SAM" && output_format != "BAM" && output_format != "CRAM") {
+        cerr << "error:[vg surject] Sorted output (--sorted) requires SAM, BAM, or CRAM output" << endl;
+        exit(1);
+    }
+
     string file_name = get_input_file_name(optind, argc, argv);
 
     if (have_input_file(optind, argc, argv)) {
@@ -327,6 +372,7 @@ int main_surject(int argc, char** argv) {
     // Make a single thread-safe Surjector.
     Surjector surjector(xgidx);
     surjector.adjust_alignments_for_base_quality = qual_adj;
+    surjector.set_banded_workspace_reuse(true);
     surjector.prune_suspicious_anchors = prune_anchors;
     surjector.max_anchors = max_anchors;
     if (spliced) {
@@ -344,6 +390,13 @@ int main_surject(int argc, char** argv) {
     // Count our threads
     int thread_count = vg::get_thread_count();
     
+    // Work out how to compress and order HTSlib output
+    HTSOutputOptions hts_options;
+    hts_options.level = compress_level;
+    hts_options.threads = compression_threads;
+    hts_options.sorted = sorted;
+    hts_options.sort_memory = sort_memory_mb * 1024 * 1024;
+    
     // Prepare the watchdog
     unique_ptr<Watchdog> watchdog(new Watchdog(thread_count, chrono::seconds(watchdog_timeout)));
     
@@ -363,9 +416,10 @@ int main_surject(int argc, char** argv) {
         // Set up output to an emitter that will handle serialization.
         // It should process output raw, without any surjection, and it should
         // respect our parameter for whether to think with splicing.
-        unique_ptr<AlignmentEmitter> alignment_emitter = get_alignment_emitter("-", 
+        unique_ptr<AlignmentEmitter> alignment_emitter = get_alignment_emitter(output_filename, 
             output_format, sequence_dictionary, thread_count, xgidx,
-            ALIGNMENT_EMITTER_FLAG_HTS_RAW | (spliced * ALIGNMENT_EMITTER_FLAG_HTS_SPLICED));
+            ALIGNMENT_EMITTER_FLAG_HTS_RAW | (spliced * ALIGNMENT_EMITTER_FLAG_HTS_SPLICED),
+            hts_options);
 
         if (interleaved) {
             // GAM input is paired, and for HTS output reads need to know their pair partners' mapping locations.
@@ -535,7 +589,8 @@ int main_surject(int argc, char** argv) {
     } else if (input_format == "GAMP") {
         // Working on multipath alignments. We need to set the emitter up ourselves.
         auto path_order_and_length = extract_path_metadata(sequence_dictionary, *xgidx).first;
-        MultipathAlignmentEmitter mp_alignment_emitter("-", thread_count, output_format, xgidx, &path_order_and_length);
+        MultipathAlignmentEmitter mp_alignment_emitter(output_filename, thread_count, output_format, xgidx, &path_order_and_length,
+                                                       hts_options);
         mp_alignment_emitter.set_read_group(read_group);
         mp_alignment_emitter.set_sample_name(sample_name);
         mp_alignment_emitter.set_min_splice_length(spliced ? min_splice_length : numeric_limits<int64_t>::max());
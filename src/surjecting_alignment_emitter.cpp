@@ -8,6 +8,7 @@
 #include "hts_alignment_emitter.hpp"
 
 #include <map>
+#include <exception>
 
 namespace vg {
 
@@ -21,10 +22,42 @@ SurjectingAlignmentEmitter::SurjectingAlignmentEmitter(const PathPositionHandleG
     
 }
 
-void SurjectingAlignmentEmitter::surject_alignments_in_place(vector<Alignment>& alns) const {
-    for (auto& aln : alns) {
-        // Surject each alignment and annotate with surjected path position
-        aln = surjector.surject(aln, paths, surject_subpath_global);
+void SurjectingAlignmentEmitter::surject_in_place(Alignment& aln) const {
+    auto start = Watchdog::clock::now();
+    // Surject the alignment and annotate with surjected path position
+    aln = surjector.surject(aln, paths, surject_subpath_global);
+    if (watchdog) {
+        watchdog->report_time("surjecting", aln.name(), Watchdog::clock::now() - start);
+    }
+}
+
+void SurjectingAlignmentEmitter::surject_alignments_in_place(const vector<Alignment*>& alns) const {
+    if (alns.size() == 1) {
+        // Don't bother making a task
+        surject_in_place(*alns.front());
+        return;
+    }
+    
+    // Each alignment is a task that any waiting thread in the team can take.
+    // Exceptions can't escape a task, so we catch them and throw the first
+    // one once everything is done.
+    vector<exception_ptr> errors(alns.size());
+    for (size_t i = 0; i < alns.size(); i++) {
+        #pragma omp task firstprivate(i) shared(alns, errors)
+        {
+            try {
+                surject_in_place(*alns[i]);
+            } catch (...) {
+                errors[i] = current_exception();
+            }
+        }
+    }
+    #pragma omp taskwait
+    
+    for (auto& error : errors) {
+        if (error) {
+            rethrow_exception(error);
+        }
     }
 }
 
@@ -32,7 +65,11 @@ void SurjectingAlignmentEmitter::emit_singles(vector<Alignment>&& aln_batch) {
     // Intercept the batch on its way
     vector<Alignment> aln_batch_caught(aln_batch);
     // Surject it in place
-    surject_alignments_in_place(aln_batch_caught);
+    vector<Alignment*> to_surject;
+    for (auto& aln : aln_batch_caught) {
+        to_surject.push_back(&aln);
+    }
+    surject_alignments_in_place(to_surject);
     // Forward it along
     backing->emit_singles(std::move(aln_batch_caught));
 }
@@ -40,10 +77,14 @@ void SurjectingAlignmentEmitter::emit_singles(vector<Alignment>&& aln_batch) {
 void SurjectingAlignmentEmitter::emit_mapped_singles(vector<vector<Alignment>>&& alns_batch) {
     // Intercept the batch on its way
     vector<vector<Alignment>> alns_batch_caught(alns_batch);
+    // Surject all mappings in place, all at once
+    vector<Alignment*> to_surject;
     for (auto& mappings : alns_batch_caught) {
-        // Surject all mappings in place
-        surject_alignments_in_place(mappings);
+        for (auto& aln : mappings) {
+            to_surject.push_back(&aln);
+        }
     }
+    surject_alignments_in_place(to_surject);
     // Forward it along
     backing->emit_mapped_singles(std::move(alns_batch_caught));
 }
@@ -53,8 +94,13 @@ void SurjectingAlignmentEmitter::emit_pairs(vector<Alignment>&& aln1_batch, vect
     vector<Alignment> aln1_batch_caught(aln1_batch);
     vector<Alignment> aln2_batch_caught(aln2_batch);
     // Surject it in place
-    surject_alignments_in_place(aln1_batch_caught);
-    surject_alignments_in_place(aln2_batch_caught);
+    vector<Alignment*> to_surject;
+    for (auto* batch : {&aln1_batch_caught, &aln2_batch_caught}) {
+        for (auto& aln : *batch) {
+            to_surject.push_back(&aln);
+        }
+    }
+    surject_alignments_in_place(to_surject);
     // Forward it along
     backing->emit_pairs(std::move(aln1_batch_caught), std::move(aln2_batch_caught), std::move(tlen_limit_batch));
 }
@@ -63,14 +109,16 @@ void SurjectingAlignmentEmitter::emit_mapped_pairs(vector<vector<Alignment>>&& a
     // Intercept the batch on its way
     vector<vector<Alignment>> alns1_batch_caught(alns1_batch);
     vector<vector<Alignment>> alns2_batch_caught(alns2_batch);
-    for (auto& mappings : alns1_batch_caught) {
-        // Surject all mappings in place
-        surject_alignments_in_place(mappings);
-    }
-    for (auto& mappings : alns2_batch_caught) {
-        // Surject all mappings in place
-        surject_alignments_in_place(mappings);
+    // Surject all mappings of both ends in place, all at once
+    vector<Alignment*> to_surject;
+    for (auto* batch : {&alns1_batch_caught, &alns2_batch_caught}) {
+        for (auto& mappings : *batch) {
+            for (auto& aln : mappings) {
+                to_surject.push_back(&aln);
+            }
+        }
     }
+    surject_alignments_in_place(to_surject);
     // Forward it along
     backing->emit_mapped_pairs(std::move(alns1_batch_caught), std::move(alns2_batch_caught), std::move(tlen_limit_batch));
 }
@@ -8,6 +8,7 @@
 
 
 #include "surjector.hpp"
+#include "watchdog.hpp"
 #include "vg/io/alignment_emitter.hpp"
 #include "handle.hpp"
 
@@ -21,6 +22,10 @@ using namespace std;
                                                                            
 /**
  * An AlignmentEmitter implementation that surjects alignments before emitting them via a backing AlignmentEmitter, which it owns.
+ *
+ * The alignments in a batch are surjected as OpenMP tasks, so when called
+ * from inside a parallel region, other threads of the team that are waiting
+ * for work can take some of them. Batches are emitted in their original order.
  */
 class SurjectingAlignmentEmitter : public vg::io::AlignmentEmitter {
 public:
@@ -40,6 +45,10 @@ public:
     ///  Force full length alignment in surjection resolution 
     bool surject_subpath_global = true;
     
+    /// If set, report how long each alignment took to surject to this
+    /// Watchdog, so slow reads are identified.
+    Watchdog* watchdog = nullptr;
+    
     
     /// Emit a batch of Alignments
     virtual void emit_singles(vector<Alignment>&& aln_batch);
@@ -71,11 +80,11 @@ protected:
     /// AlignmentEmitter to emit to once done
     unique_ptr<AlignmentEmitter> backing;
     
-    /// Surject alignments in place.
-    void surject_alignments_in_place(vector<Alignment>& alns) const;
-    
-    
+    /// Surject one alignment in place, timing it.
+    void surject_in_place(Alignment& aln) const;
     
+    /// Surject alignments in place, in parallel if possible.
+    void surject_alignments_in_place(const vector<Alignment*>& alns) const;
     
 };
 
@@ -3562,6 +3562,107 @@ namespace vg {
             
             aligner.align_global_banded(aln, graph, 1, true);
         }
+        
+        TEST_CASE("Banded global aligner gives the same results when reusing its workspace", "[alignment][banded][mapping]") {
+            
+            bdsg::HashGraph graph;
+            
+            handle_t h1 = graph.create_handle("GATTACAGATTACA");
+            handle_t h2 = graph.create_handle("C");
+            handle_t h3 = graph.create_handle("T");
+            handle_t h4 = graph.create_handle("CCTGAGGTTTACCAGGATTTAGCGGAACCGTTTAA");
+            handle_t h5 = graph.create_handle("");
+            handle_t h6 = graph.create_handle("ACCGTAGGAT");
+            
+            graph.create_edge(h1, h2);
+            graph.create_edge(h1, h3);
+            graph.create_edge(h2, h4);
+            graph.create_edge(h3, h4);
+            graph.create_edge(h4, h5);
+            graph.create_edge(h4, h6);
+            graph.create_edge(h5, h6);
+            
+            vector<string> sequences{
+                "GATTACAGATTACACCCTGAGGTTTACCAGGATTTAGCGGAACCGTTTAAACCGTAGGAT",
+                "GATTACATATTACATCCTGAGGTTTACCAGGATTTAGCGGAACCGTAGGAT",
+                "GATTACAGATTACACCCTGAGGTTTACCAGTATTTAGCGGAACCGTTTAAACCGTTTTTTAGGAT",
+                "GATTACATTAGGAT",
+                "GATTACAGATTACACCCTGAGGTTTAACCAGGATTTAGCGGAACCGTTTAAACCGTAGGAT"
+            };
+            
+            TestAligner plain_source;
+            TestAligner reusing_source;
+            reusing_source.set_banded_workspace_reuse(true);
+            
+            SECTION("Single alignments match") {
+                // go through the reads more than once so that later alignments land in memory from earlier ones
+                for (size_t pass = 0; pass < 2; ++pass) {
+                    for (const string& sequence : sequences) {
+                        Alignment plain_aln;
+                        plain_aln.set_sequence(sequence);
+                        Alignment reusing_aln = plain_aln;
+                        
+                        plain_source.get_regular_aligner()->align_global_banded(plain_aln, graph, 1, true);
+                        reusing_source.get_regular_aligner()->align_global_banded(reusing_aln, graph, 1, true);
+                        
+                        REQUIRE(reusing_aln.score() == plain_aln.score());
+                        REQUIRE(pb2json(reusing_aln.path()) == pb2json(plain_aln.path()));
+                    }
+                }
+                
+                // the arena should have kept its memory for the next alignment
+                REQUIRE(BandedAlignmentArena::for_this_thread().capacity() > 0);
+            }
+            
+            SECTION("Multi-alignments match") {
+                for (size_t pass = 0; pass < 2; ++pass) {
+                    for (const string& sequence : sequences) {
+                        Alignment plain_aln;
+                        plain_aln.set_sequence(sequence);
+                        Alignment reusing_aln = plain_aln;
+                        vector<Alignment> plain_alts;
+                        vector<Alignment> reusing_alts;
+                        
+                        plain_source.get_regular_aligner()->align_global_banded_multi(plain_aln, plain_alts, graph, 4, 1, true);
+                        reusing_source.get_regular_aligner()->align_global_banded_multi(reusing_aln, reusing_alts, graph, 4, 1, true);
+                        
+                        REQUIRE(reusing_alts.size() == plain_alts.size());
+                        for (size_t i = 0; i < plain_alts.size(); ++i) {
+                            REQUIRE(reusing_alts[i].score() == plain_alts[i].score());
+                            REQUIRE(pb2json(reusing_alts[i].path()) == pb2json(plain_alts[i].path()));
+                        }
+                    }
+                }
+            }
+        }
+        
+        TEST_CASE("Banded alignment arena consolidates and caps the memory it keeps", "[alignment][banded]") {
+            
+            BandedAlignmentArena arena(1024);
+            
+            arena.acquire();
+            REQUIRE(arena.allocate(10) != nullptr);
+            // this one needs a new block
+            REQUIRE(arena.allocate(100) != nullptr);
+            arena.release();
+            
+            // everything from the last use is kept in one block, with the sizes
+            // rounded up to keep allocations aligned
+            REQUIRE(arena.capacity() == 128);
+            
+            arena.acquire();
+            char* first = (char*) arena.allocate(10);
+            char* second = (char*) arena.allocate(10);
+            REQUIRE(second - first == 16);
+            arena.release();
+            REQUIRE(arena.capacity() == 128);
+            
+            // more than the cap is given back after use
+            arena.acquire();
+            REQUIRE(arena.allocate(4096) != nullptr);
+            arena.release();
+            REQUIRE(arena.capacity() == 0);
+        }
     }
 }
 
@@ -152,6 +152,87 @@ TEST_CASE("find_best_chain is willing to leave the main diagonal if the items su
     REQUIRE(result.second == std::vector<size_t>{0, 1, 2, 3});
 }
 
+TEST_CASE("find_best_chain chains many items across several lookback windows", "[chain_items][find_best_chain]") {
+    // Set up graph fixture
+    HashGraph graph = make_long_graph(40, 10);
+    auto h = get_handles(graph);
+    
+    IntegratedSnarlFinder snarl_finder(graph);
+    SnarlDistanceIndex distance_index;
+    fill_in_distance_index(&distance_index, &graph, &snarl_finder);
+    
+    // Put an item on every node along the main diagonal, with some weak
+    // decoys off of it that shouldn't be taken.
+    vector<tuple<size_t, handle_t, size_t, size_t, int>> test_data;
+    for (size_t i = 0; i < 40; i++) {
+        test_data.emplace_back(i * 10, h[i + 1], 0, 10, 10);
+        if (i % 7 == 3) {
+            test_data.emplace_back(i * 10 + 2, h[40 - i], 5, 3, 1);
+        }
+    }
+    auto to_score = make_anchors(test_data, graph);
+    
+    vector<size_t> expected;
+    for (size_t i = 0; i < to_score.size(); i++) {
+        if (to_score[i].length() == 10) {
+            expected.push_back(i);
+        }
+    }
+    
+    // Actually run the chaining and test
+    auto result = algorithms::find_best_chain(to_score, distance_index, graph, 6, 1);
+    REQUIRE(result.first == 40 * 10);
+    REQUIRE(result.second == expected);
+}
+
+TEST_CASE("find_best_chain gives the same answer with a distance cache", "[chain_items][find_best_chain]") {
+    // Set up graph fixture
+    HashGraph graph = make_long_graph(10, 10);
+    auto h = get_handles(graph);
+    
+    IntegratedSnarlFinder snarl_finder(graph);
+    SnarlDistanceIndex distance_index;
+    fill_in_distance_index(&distance_index, &graph, &snarl_finder);
+
+    auto to_score = make_anchors({{10, h[1], 0, 10, 10},
+                                  {41, h[4], 0, 10, 10},
+                                  {61, h[6], 0, 10, 10},
+                                  {100, h[10], 0, 10, 10}}, graph);
+    
+    int gap_open = 6;
+    int gap_extension = 1;
+    size_t max_lookback_bases = 150;
+    size_t min_lookback_items = 0;
+    size_t lookback_item_hard_cap = 100;
+    size_t initial_lookback_threshold = 10;
+    double lookback_scale_factor = 2.0;
+    double min_good_transition_score_per_base = -0.1;
+    int item_bonus = 0;
+    size_t max_indel_bases = 100;
+    DistanceCache cache;
+    auto chain_with = [&](DistanceCache* distance_cache) {
+        return algorithms::find_best_chain(to_score, distance_index, graph, gap_open, gap_extension,
+                                           max_lookback_bases, min_lookback_items, lookback_item_hard_cap,
+                                           initial_lookback_threshold, lookback_scale_factor,
+                                           min_good_transition_score_per_base, item_bonus, max_indel_bases,
+                                           distance_cache);
+    };
+    
+    auto uncached = chain_with(nullptr);
+    
+    auto cached = chain_with(&cache);
+    REQUIRE(cached == uncached);
+    REQUIRE(cache.hits() == 0);
+    size_t queries = cache.misses();
+    REQUIRE(queries > 0);
+    
+    // Doing it again should be answered entirely from the cache
+    auto recached = chain_with(&cache);
+    REQUIRE(recached == uncached);
+    REQUIRE(cache.hits() == queries);
+    REQUIRE(cache.misses() == queries);
+}
+
 }
 
 }
@@ -236,7 +236,7 @@ static ConstructedChunk construct_test_chunk(string ref_sequence, string ref_nam
  * Testing wrapper to build a whole graph from a VCF string. Adds alt paths by default.
  */
 static Graph construct_test_graph(string fasta_data, string vcf_data, size_t max_node_size,
-    bool do_svs, bool use_flat_alts = false) {
+    bool do_svs, bool use_flat_alts = false, size_t vars_per_chunk = 1024, size_t chunk_threads = 1) {
     
     // Merge all the graphs we get into this graph
     Graph built;
@@ -280,6 +280,8 @@ static Graph construct_test_graph(string fasta_data, string vcf_data, size_t max
     constructor.flat = use_flat_alts;
     // Make sure we can test the node splitting behavior at reasonable sizes
     constructor.max_node_size = max_node_size;
+    constructor.vars_per_chunk = vars_per_chunk;
+    constructor.chunk_threads = chunk_threads;
 
     // Construct the graph    
     constructor.construct_graph(fasta_pointers, vcf_pointers, ins_pointers, callback);
@@ -2428,8 +2430,60 @@ CAAATAAGGCTTGGAAATTTTCTGGAGTTCTATTATATTCCAACTCTCTG
 
 }
 
+TEST_CASE( "Building chunks in parallel produces the same graph", "[constructor]" ) {
 
-
+    // Make a reference with a variant every 10 bases
+    string ref;
+    for (size_t i = 0; i < 400; i++) {
+        ref.push_back("GATTACACAT"[(i * 7) % 10]);
+    }
+    auto vcf_data = string(R"(##fileformat=VCFv4.0
+##FORMAT=<ID=GT,Number=1,Type=String,Description="Genotype">
+#CHROM	POS	ID	REF	ALT	QUAL	FILTER	INFO	FORMAT
+)");
+    for (size_t pos = 5; pos + 3 < ref.size(); pos += 10) {
+        string ref_allele;
+        string alt_allele;
+        switch ((pos / 10) % 3) {
+        case 0:
+            // SNP
+            ref_allele = ref.substr(pos - 1, 1);
+            alt_allele = (ref_allele == "A") ? "C" : "A";
+            break;
+        case 1:
+            // Deletion
+            ref_allele = ref.substr(pos - 1, 3);
+            alt_allele = ref.substr(pos - 1, 1);
+            break;
+        default:
+            // Insertion
+            ref_allele = ref.substr(pos - 1, 1);
+            alt_allele = ref_allele + "GG";
+            break;
+        }
+        vcf_data += "ref\t" + to_string(pos) + "\t.\t" + ref_allele + "\t" + alt_allele + "\t29\tPASS\t.\tGT\n";
+    }
+    string fasta_data = ">ref\n" + ref + "\n";
+
+    // Build it in one chunk, and in many small chunks with and without threads
+    Graph whole = construct_test_graph(fasta_data, vcf_data, 50, false, false, 1024, 1);
+    Graph sequential = construct_test_graph(fasta_data, vcf_data, 50, false, false, 2, 1);
+    Graph parallel = construct_test_graph(fasta_data, vcf_data, 50, false, false, 2, 4);
+
+    REQUIRE(sequential.node_size() > 0);
+    REQUIRE(pb2json(parallel) == pb2json(sequential));
+
+    // Chunking shouldn't change the sequence we have
+    size_t whole_bases = 0;
+    for (auto& node : whole.node()) {
+        whole_bases += node.sequence().size();
+    }
+    size_t parallel_bases = 0;
+    for (auto& node : parallel.node()) {
+        parallel_bases += node.sequence().size();
+    }
+    REQUIRE(parallel_bases == whole_bases);
+}
 
 }
 }
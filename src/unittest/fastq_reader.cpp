@@ -0,0 +1,115 @@
+/// \file fastq_reader.cpp
+///
+/// unit tests for reading FASTQ and FASTA with FastqReader
+///
+
+#include <iostream>
+#include <string>
+#include <zlib.h>
+#include <htslib/bgzf.h>
+#include "vg/io/json2pb.h"
+#include "../fastq_reader.hpp"
+#include "../alignment.hpp"
+#include "../utility.hpp"
+#include "catch.hpp"
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+/// Read everything from a file the old way, with gzgets
+static vector<Alignment> read_with_zlib(const string& filename, bool comment_as_tags) {
+    vector<Alignment> result;
+    gzFile fp = gzopen(filename.c_str(), "r");
+    size_t len = 1 << 18;
+    char* buf = new char[len];
+    Alignment aln;
+    while (get_next_alignment_from_fastq(fp, buf, len, aln, comment_as_tags)) {
+        result.push_back(aln);
+    }
+    delete[] buf;
+    gzclose(fp);
+    return result;
+}
+
+/// Read everything from a file with a FastqReader, using small pieces to
+/// exercise records spanning chunks and batches
+static vector<Alignment> read_with_reader(const string& filename, bool comment_as_tags) {
+    vector<Alignment> result;
+    FastqReader reader(filename, 3);
+    reader.blocks_per_batch = 2;
+    reader.gzip_chunk_size = 7;
+    Alignment aln;
+    while (reader.get_next_alignment(aln, comment_as_tags)) {
+        result.push_back(aln);
+    }
+    return result;
+}
+
+/// Write the given text plain, gzipped, and as small BGZF blocks, and make
+/// sure FastqReader reads all of them like the zlib-based parser does.
+static void check_all_formats(const string& contents, bool comment_as_tags, size_t expected_records) {
+    string plain_name = temp_file::create();
+    string gzip_name = temp_file::create();
+    string bgzf_name = temp_file::create();
+
+    {
+        ofstream out(plain_name);
+        out << contents;
+    }
+    {
+        gzFile out = gzopen(gzip_name.c_str(), "wb");
+        gzwrite(out, contents.data(), contents.size());
+        gzclose(out);
+    }
+    {
+        BGZF* out = bgzf_open(bgzf_name.c_str(), "w");
+        // Write in little pieces so we get many blocks
+        for (size_t i = 0; i < contents.size(); i += 13) {
+            bgzf_write(out, contents.data() + i, min<size_t>(13, contents.size() - i));
+            bgzf_flush(out);
+        }
+        bgzf_close(out);
+    }
+
+    vector<Alignment> truth = read_with_zlib(plain_name, comment_as_tags);
+    REQUIRE(truth.size() == expected_records);
+
+    for (auto& filename : {plain_name, gzip_name, bgzf_name}) {
+        vector<Alignment> got = read_with_reader(filename, comment_as_tags);
+        REQUIRE(got.size() == truth.size());
+        for (size_t i = 0; i < truth.size(); i++) {
+            REQUIRE(pb2json(got[i]) == pb2json(truth[i]));
+        }
+    }
+
+    temp_file::remove(plain_name);
+    temp_file::remove(gzip_name);
+    temp_file::remove(bgzf_name);
+}
+
+TEST_CASE("FastqReader reads FASTQ the same way from plain, gzip, and BGZF files", "[fastq][alignment]") {
+    string contents;
+    for (size_t i = 0; i < 50; i++) {
+        string sequence(20 + i % 17, "ACGT"[i % 4]);
+        contents += "@read" + to_string(i) + "/1 RG:Z:group" + to_string(i % 3) + "\n";
+        contents += sequence + "\n+\n";
+        contents += string(sequence.size(), (char) ('!' + i % 40)) + "\n";
+    }
+
+    SECTION("Without tags") {
+        check_all_formats(contents, false, 50);
+    }
+
+    SECTION("With comments as tags") {
+        check_all_formats(contents, true, 50);
+    }
+}
+
+TEST_CASE("FastqReader reads multi-line FASTA", "[fastq][alignment]") {
+    string contents = ">first some comment\nGATTACA\nGATTACA\nCAT\n>second\nA\n>third\nCCCCCCCCCCCCCCCCCCCCCCCCC\nGGGG\n";
+    check_all_formats(contents, false, 3);
+}
+
+}
+}
@@ -501,6 +501,54 @@ P	chr1	1+,3+	8M,1M
 	REQUIRE(graph.get_sense(graph.get_path_handle("chr1")) == PathSense::GENERIC);
 }
 
+TEST_CASE("GFA parsing gives the same results regardless of batch size", "[gfa]") {
+
+    const string graph_gfa = R"(H	VN:Z:1.0
+S	a	G
+L	e	+	f	+	0M
+L	a	+	b	+	0M
+P	path1	a+,d+,e+,b+	1M,1M,1M,1M
+L	a	+	d	+	0M
+L	b	+	c	+	0M
+S	c	G
+S	d	C
+Q	unknown	line
+L	d	+	e	+	*
+S	e	C
+L	e	+	b	+	0M
+S	f	T
+L	f	+	c	+	0M
+P	ref	a+,b+,c+	*
+S	b	T
+P	path2	a+,d+,e+,f+,c+	1M,1M,1M,1M,1M)";
+
+    // Record everything the parser tells its listeners, in order
+    auto parse_events = [&](size_t batch_lines) {
+        vector<string> events;
+        algorithms::GFAParser parser;
+        parser.parse_batch_lines = batch_lines;
+        parser.node_listeners.push_back([&](nid_t id, const algorithms::GFAParser::chars_t& sequence, const algorithms::GFAParser::tag_list_t& tags) {
+            events.push_back("S " + std::to_string(id) + " " + algorithms::GFAParser::extract(sequence));
+        });
+        parser.edge_listeners.push_back([&](nid_t from, bool from_is_reverse, nid_t to, bool to_is_reverse,
+                                            const algorithms::GFAParser::chars_t& overlap, const algorithms::GFAParser::tag_list_t& tags) {
+            events.push_back("L " + std::to_string(from) + (from_is_reverse ? "-" : "+") + " " + std::to_string(to) + (to_is_reverse ? "-" : "+"));
+        });
+        parser.path_listeners.push_back([&](const string& name, const algorithms::GFAParser::chars_t& visits,
+                                            const algorithms::GFAParser::chars_t& overlaps, const algorithms::GFAParser::tag_list_t& tags) {
+            events.push_back("P " + name + " " + algorithms::GFAParser::extract(visits));
+        });
+        stringstream in(graph_gfa);
+        parser.parse(in);
+        return events;
+    };
+    
+    vector<string> serial_events = parse_events(1);
+    REQUIRE(serial_events.size() == 6 + 7 + 3);
+    REQUIRE(parse_events(4) == serial_events);
+    REQUIRE(parse_events(65536) == serial_events);
+}
+
 
         
 }
@@ -92,6 +92,67 @@ TEST_CASE("MEMAccelerator returns same ranges as direct LF queries",
         delete lcpidx;
     }
 }
+
+TEST_CASE("MEMAccelerator is the same when built in parallel and when reloaded",
+          "[mem][mapping][memaccelerator]" ) {
+    
+    int memo_length = 6;
+    
+    bdsg::HashGraph graph;
+    random_graph(200, 3, 6, &graph);
+    
+    // Make GCSA quiet
+    gcsa::Verbosity::set(gcsa::Verbosity::SILENT);
+    
+    gcsa::GCSA* gcsaidx = nullptr;
+    gcsa::LCPArray* lcpidx = nullptr;
+    build_gcsa_lcp(graph, gcsaidx, lcpidx, 8, 2);
+    
+    MEMAccelerator serial(*gcsaidx, memo_length, 1);
+    MEMAccelerator parallel(*gcsaidx, memo_length, 4);
+    
+    stringstream ss;
+    serial.serialize(ss);
+    MEMAccelerator reloaded;
+    reloaded.load(ss);
+    
+    REQUIRE(parallel.length() == memo_length);
+    REQUIRE(reloaded.length() == memo_length);
+    
+    for (int k = 0; k < (1 << (2 * memo_length)); ++k) {
+        string seq(memo_length, 'N');
+        for (int i = 0; i < memo_length; ++i) {
+            seq[i] = "ACGT"[(k >> (2 * i)) & 3];
+        }
+        auto serial_range = serial.memoized_LF(seq.end() - 1);
+        REQUIRE(parallel.memoized_LF(seq.end() - 1) == serial_range);
+        REQUIRE(reloaded.memoized_LF(seq.end() - 1) == serial_range);
+    }
+    
+    SECTION("A reloaded MEMAccelerator knows which GCSA it came from") {
+        REQUIRE(reloaded.built_from(*gcsaidx));
+        
+        bdsg::HashGraph other_graph;
+        random_graph(300, 3, 6, &other_graph);
+        gcsa::GCSA* other_gcsaidx = nullptr;
+        gcsa::LCPArray* other_lcpidx = nullptr;
+        build_gcsa_lcp(other_graph, other_gcsaidx, other_lcpidx, 8, 2);
+        
+        REQUIRE(!reloaded.built_from(*other_gcsaidx));
+        
+        delete other_gcsaidx;
+        delete other_lcpidx;
+    }
+    
+    SECTION("Loading rejects things that are not MEMAccelerators") {
+        stringstream junk("this is not a MEMAccelerator");
+        MEMAccelerator bad;
+        REQUIRE_THROWS(bad.load(junk));
+    }
+    
+    delete gcsaidx;
+    delete lcpidx;
+}
    
 }
 }
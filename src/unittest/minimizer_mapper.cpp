@@ -31,6 +31,8 @@ public:
     using MinimizerMapper::with_dagified_local_graph;
     using MinimizerMapper::align_sequence_between;
     using MinimizerMapper::fix_dozeu_end_deletions;
+    using MinimizerMapper::RescueSubgraph;
+    using MinimizerMapper::get_rescue_subgraph;
 };
 
 TEST_CASE("Fragment length distribution gets reasonable value", "[giraffe][mapping]") {
@@ -101,6 +103,31 @@ TEST_CASE("Fragment length distribution gets reasonable value", "[giraffe][mappi
         }
 }
 
+TEST_CASE("Fragment length distribution can be saved and loaded", "[giraffe][mapping]") {
+    FragmentLengthDistribution distr(100, 10, 0.95);
+    for (int64_t length = 200; length < 300; length++) {
+        distr.register_fragment_length(length);
+    }
+    REQUIRE(distr.is_finalized());
+
+    stringstream saved;
+    distr.save(saved);
+
+    FragmentLengthDistribution loaded(100, 10, 0.95);
+    loaded.load(saved);
+
+    REQUIRE(loaded.is_finalized());
+    REQUIRE(loaded.mean() == distr.mean());
+    REQUIRE(loaded.std_dev() == distr.std_dev());
+
+    SECTION("Garbage is rejected") {
+        stringstream garbage("#mean\tstdev\tsamples\nnot a number\n");
+        FragmentLengthDistribution bad(100, 10, 0.95);
+        REQUIRE_THROWS_AS(bad.load(garbage), std::runtime_error);
+        REQUIRE(!bad.is_finalized());
+    }
+}
+
 /// Cover a sequence of all Gs in minimizers.
 static void cover_in_minimizers(const std::string sequence, int core_width, int flank_width, int stride, std::vector<TestMinimizerMapper::Minimizer>& minimizers, std::vector<size_t>& minimizers_explored) {
 
@@ -443,5 +470,73 @@ TEST_CASE("MinimizerMapper can fix up alignments with deletions on the ends", "[
 
 }
 
+TEST_CASE("MinimizerMapper reuses cached rescue subgraphs", "[giraffe][mapping][rescue]") {
+
+    // Make a linear graph of 10 bp nodes
+    bdsg::HashGraph graph;
+    vector<handle_t> handles;
+    for (size_t i = 0; i < 6; i++) {
+        handles.push_back(graph.create_handle("GATTACAGAT"));
+        if (i > 0) {
+            graph.create_edge(handles[i - 1], handles[i]);
+        }
+    }
+    IntegratedSnarlFinder snarl_finder(graph);
+    SnarlDistanceIndex distance_index;
+    fill_in_distance_index(&distance_index, &graph, &snarl_finder);
+
+    gbwtgraph::GBWTGraph gbwt_graph;
+    gbwt::GBWT gbwt;
+    gbwt_graph.set_gbwt(gbwt);
+    gbwtgraph::DefaultMinimizerIndex minimizer_index;
+    PathPositionHandleGraph* handle_graph;
+    TestMinimizerMapper test_mapper (gbwt_graph, minimizer_index, &distance_index, handle_graph);
+
+    // The read is aligned to the start of the first node
+    Alignment aligned_read;
+    Mapping* mapping = aligned_read.mutable_path()->add_mapping();
+    mapping->mutable_position()->set_node_id(graph.get_id(handles[0]));
+    Edit* edit = mapping->add_edit();
+    edit->set_from_length(10);
+    edit->set_to_length(10);
+
+    TestMinimizerMapper::RescueSubgraph uncached;
+    std::unordered_set<nid_t> first = test_mapper.get_rescue_subgraph(aligned_read, graph, 15, 35, true, uncached).nodes;
+    REQUIRE(!first.empty());
+    REQUIRE(test_mapper.rescue_subgraph_cache_hits == 0);
+    REQUIRE(test_mapper.rescue_subgraph_cache_misses == 1);
+    
+    SECTION("The same search is found in the cache") {
+        TestMinimizerMapper::RescueSubgraph& second = test_mapper.get_rescue_subgraph(aligned_read, graph, 15, 35, true, uncached);
+        REQUIRE(second.nodes == first);
+        REQUIRE(&second != &uncached);
+        REQUIRE(test_mapper.rescue_subgraph_cache_hits == 1);
+        REQUIRE(test_mapper.rescue_subgraph_cache_misses == 1);
+    }
+
+    SECTION("A different distance range is not found in the cache") {
+        test_mapper.get_rescue_subgraph(aligned_read, graph, 15, 55, true, uncached);
+        REQUIRE(test_mapper.rescue_subgraph_cache_hits == 0);
+        REQUIRE(test_mapper.rescue_subgraph_cache_misses == 2);
+    }
+
+    SECTION("Old subgraphs are evicted from a full cache") {
+        test_mapper.rescue_subgraph_cache_size = 1;
+        test_mapper.get_rescue_subgraph(aligned_read, graph, 15, 55, true, uncached);
+        test_mapper.get_rescue_subgraph(aligned_read, graph, 15, 35, true, uncached);
+        REQUIRE(test_mapper.rescue_subgraph_cache_hits == 0);
+        REQUIRE(test_mapper.rescue_subgraph_cache_misses == 3);
+    }
+
+    SECTION("Nothing is cached when the cache is disabled") {
+        test_mapper.rescue_subgraph_cache_size = 0;
+        TestMinimizerMapper::RescueSubgraph& second = test_mapper.get_rescue_subgraph(aligned_read, graph, 15, 35, true, uncached);
+        REQUIRE(&second == &uncached);
+        REQUIRE(second.nodes == first);
+        REQUIRE(test_mapper.rescue_subgraph_cache_hits == 0);
+        REQUIRE(test_mapper.rescue_subgraph_cache_misses == 2);
+    }
 }
 
+}
+}
@@ -0,0 +1,163 @@
+/// \file read_pipeline.cpp
+///
+/// unit tests for the parse/map/emit pipeline
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <omp.h>
+#include "../read_pipeline.hpp"
+#include "catch.hpp"
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+/// A batch of numbers to square
+struct NumberBatch {
+    vector<size_t> numbers;
+    vector<size_t> squares;
+};
+
+/// Make a pipeline that squares the numbers below the given limit, in
+/// batches of the given size, and collects the squares.
+static void set_up_pipeline(ReadPipeline<NumberBatch>& pipeline, size_t limit, size_t batch_size,
+                            size_t& next_number, mutex& emit_mutex, vector<size_t>& emitted) {
+    pipeline.parse = [&, limit, batch_size](NumberBatch& batch) {
+        while (next_number < limit && batch.numbers.size() < batch_size) {
+            batch.numbers.push_back(next_number++);
+        }
+        return !batch.numbers.empty();
+    };
+    pipeline.map = [](NumberBatch& batch) {
+        for (auto& number : batch.numbers) {
+            batch.squares.push_back(number * number);
+        }
+    };
+    pipeline.emit = [&](NumberBatch& batch) {
+        lock_guard<mutex> lock(emit_mutex);
+        emitted.insert(emitted.end(), batch.squares.begin(), batch.squares.end());
+    };
+}
+
+TEST_CASE("ReadPipeline runs every batch through every stage", "[pipeline]") {
+
+    for (size_t thread_count : {1, 2, 4}) {
+        for (bool emit_separately : {true, false}) {
+            ReadPipeline<NumberBatch> pipeline(thread_count, 2);
+            pipeline.emit_separately = emit_separately;
+            size_t next_number = 0;
+            mutex emit_mutex;
+            vector<size_t> emitted;
+            set_up_pipeline(pipeline, 1000, 7, next_number, emit_mutex, emitted);
+
+            pipeline.run();
+
+            REQUIRE(emitted.size() == 1000);
+            sort(emitted.begin(), emitted.end());
+            for (size_t i = 0; i < emitted.size(); i++) {
+                REQUIRE(emitted[i] == i * i);
+            }
+            // 1000 numbers in batches of 7
+            REQUIRE(pipeline.parse_stats.batches == 143);
+            REQUIRE(pipeline.map_stats.batches == 143);
+            REQUIRE(pipeline.emit_stats.batches == 143);
+        }
+    }
+}
+
+TEST_CASE("ReadPipeline finishes when stages have to sleep on each other", "[pipeline]") {
+
+    for (bool slow_parse : {true, false}) {
+        ReadPipeline<NumberBatch> pipeline(4, 2);
+        size_t next_number = 0;
+        mutex emit_mutex;
+        vector<size_t> emitted;
+        set_up_pipeline(pipeline, 200, 5, next_number, emit_mutex, emitted);
+
+        // Slow down one end so the mappers run out of input, or out of
+        // room for their output.
+        auto parse = pipeline.parse;
+        auto emit = pipeline.emit;
+        if (slow_parse) {
+            pipeline.parse = [parse](NumberBatch& batch) {
+                this_thread::sleep_for(chrono::milliseconds(1));
+                return parse(batch);
+            };
+        } else {
+            pipeline.emit = [emit](NumberBatch& batch) {
+                this_thread::sleep_for(chrono::milliseconds(1));
+                emit(batch);
+            };
+        }
+
+        pipeline.run();
+
+        REQUIRE(emitted.size() == 200);
+        sort(emitted.begin(), emitted.end());
+        for (size_t i = 0; i < emitted.size(); i++) {
+            REQUIRE(emitted[i] == i * i);
+        }
+        REQUIRE(pipeline.emit_stats.batches == 40);
+    }
+}
+
+TEST_CASE("ReadPipeline maps one batch at a time until told otherwise", "[pipeline]") {
+
+    ReadPipeline<NumberBatch> pipeline(4, 4);
+    size_t next_number = 0;
+    mutex emit_mutex;
+    vector<size_t> emitted;
+    set_up_pipeline(pipeline, 200, 5, next_number, emit_mutex, emitted);
+
+    // Watch how many threads map at once while we are single-threaded.
+    atomic<size_t> mapping{0};
+    atomic<bool> overlapped{false};
+    size_t checks = 0;
+    atomic<bool> ready{false};
+    auto square = pipeline.map;
+    pipeline.map = [&](NumberBatch& batch) {
+        if (++mapping > 1 && !ready) {
+            overlapped = true;
+        }
+        square(batch);
+        mapping--;
+    };
+    pipeline.single_threaded_until_true = [&]() {
+        ready = (++checks > 10);
+        return ready;
+    };
+
+    pipeline.run();
+
+    REQUIRE(emitted.size() == 200);
+    REQUIRE(!overlapped);
+    REQUIRE(ready);
+}
+
+TEST_CASE("ReadPipeline passes along parse errors", "[pipeline]") {
+
+    ReadPipeline<NumberBatch> pipeline(2, 2);
+    size_t next_number = 0;
+    mutex emit_mutex;
+    vector<size_t> emitted;
+    set_up_pipeline(pipeline, 100, 10, next_number, emit_mutex, emitted);
+    auto parse = pipeline.parse;
+    pipeline.parse = [&](NumberBatch& batch) {
+        if (next_number >= 50) {
+            throw runtime_error("bad input");
+        }
+        return parse(batch);
+    };
+
+    REQUIRE_THROWS_AS(pipeline.run(), runtime_error);
+    // Everything parsed before the error still gets through.
+    REQUIRE(emitted.size() == 50);
+}
+
+}
+}
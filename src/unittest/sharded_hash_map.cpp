@@ -0,0 +1,46 @@
+/// \file sharded_hash_map.cpp
+///
+/// unit tests for sharded_string_hash_map
+///
+
+#include <string>
+#include <omp.h>
+#include "../sharded_hash_map.hpp"
+#include "catch.hpp"
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("sharded_string_hash_map can be filled from many threads", "[hash_map]") {
+
+    for (size_t shard_count : {1, 3, 256}) {
+        sharded_string_hash_map<size_t> map(shard_count);
+
+        #pragma omp parallel for num_threads(4)
+        for (size_t i = 0; i < 10000; i++) {
+            map.set("read" + to_string(i), i);
+        }
+
+        REQUIRE(map.size() == 10000);
+        for (size_t i = 0; i < 10000; i++) {
+            auto found = map.find("read" + to_string(i));
+            REQUIRE(found != nullptr);
+            REQUIRE(*found == i);
+        }
+        REQUIRE(map.find("read10000") == nullptr);
+    }
+}
+
+TEST_CASE("sharded_string_hash_map replaces values that are set again", "[hash_map]") {
+
+    sharded_string_hash_map<string> map;
+    map.set("read", "first");
+    map.set("read", "second");
+
+    REQUIRE(map.size() == 1);
+    REQUIRE(*map.find("read") == "second");
+}
+
+}
+}
@@ -5706,6 +5706,50 @@ namespace vg {
             }
         }//end test case
 
+        TEST_CASE("Distance index is the same when built with multiple threads", "[snarl_distance]") {
+            VG graph;
+
+            //Make three separate components, each with nested snarls
+            for (size_t component = 0 ; component < 3 ; component++) {
+                Node* n1 = graph.create_node("GCA");
+                Node* n2 = graph.create_node("T");
+                Node* n3 = graph.create_node("G");
+                Node* n4 = graph.create_node("CTGA");
+                Node* n5 = graph.create_node("GCA");
+                Node* n6 = graph.create_node("T");
+                Node* n7 = graph.create_node("G");
+                Node* n8 = graph.create_node("CTGA");
+
+                graph.create_edge(n1, n2);
+                graph.create_edge(n1, n8);
+                graph.create_edge(n2, n3);
+                graph.create_edge(n2, n4);
+                graph.create_edge(n3, n4);
+                graph.create_edge(n4, n5);
+                graph.create_edge(n4, n6);
+                graph.create_edge(n5, n7);
+                graph.create_edge(n6, n7);
+                graph.create_edge(n7, n8);
+                graph.create_edge(n7, n7, false, true);
+            }
+
+            IntegratedSnarlFinder snarl_finder(graph); 
+
+            SnarlDistanceIndex serial_index;
+            fill_in_distance_index(&serial_index, &graph, &snarl_finder);
+            stringstream serial_out;
+            serial_index.serialize(serial_out);
+
+            SnarlDistanceIndex parallel_index;
+            fill_in_distance_index(&parallel_index, &graph, &snarl_finder, 50000, false, true, 4);
+            stringstream parallel_out;
+            parallel_index.serialize(parallel_out);
+
+            REQUIRE(serial_out.str() == parallel_out.str());
+            REQUIRE(parallel_index.minimum_distance(1, false, 0, 8, false, 0) == 3);
+            REQUIRE(parallel_index.minimum_distance(9, false, 0, 16, false, 0) == 3);
+        }
+
 
 
 
@@ -3309,6 +3309,50 @@ namespace unittest {
         REQUIRE(false);
     }
     */
+    TEST_CASE("Clustering gives the same answers with a distance cache", "[cluster]") {
+        HashGraph graph;
+        random_graph(500, 10, 40, &graph);
+
+        IntegratedSnarlFinder snarl_finder(graph);
+        SnarlDistanceIndex dist_index;
+        fill_in_distance_index(&dist_index, &graph, &snarl_finder);
+        SnarlDistanceIndexClusterer clusterer(dist_index, &graph);
+
+        // Put a seed at the start of every node
+        vector<SnarlDistanceIndexClusterer::Seed> seeds;
+        graph.for_each_handle([&](const handle_t& h) {
+            pos_t pos = make_pos_t(graph.get_id(h), false, 0);
+            seeds.push_back({ pos, 0, MIPayload::encode(get_minimizer_distances(dist_index, pos))});
+        });
+
+        auto seeds_of = [](const vector<SnarlDistanceIndexClusterer::Cluster>& clusters) {
+            vector<vector<size_t>> result;
+            for (auto& cluster : clusters) {
+                result.push_back(cluster.seeds);
+            }
+            return result;
+        };
+
+        DistanceCache cache;
+        auto uncached = seeds_of(clusterer.cluster_seeds(seeds, 20));
+        REQUIRE(seeds_of(clusterer.cluster_seeds(seeds, 20, &cache)) == uncached);
+        REQUIRE(cache.hits() + cache.misses() > 0);
+
+        // Doing it again should be answered entirely from the cache
+        size_t hits = cache.hits();
+        size_t misses = cache.misses();
+        REQUIRE(seeds_of(clusterer.cluster_seeds(seeds, 20, &cache)) == uncached);
+        REQUIRE(cache.misses() == misses);
+        REQUIRE(cache.hits() == hits + misses);
+
+        for (size_t i = 0; i + 1 < seeds.size(); i++) {
+            for (bool stop_at_lowest_common_ancestor : {false, true}) {
+                REQUIRE(clusterer.distance_between_seeds(seeds[i], seeds[i + 1], stop_at_lowest_common_ancestor, &cache) ==
+                        clusterer.distance_between_seeds(seeds[i], seeds[i + 1], stop_at_lowest_common_ancestor));
+            }
+        }
+    }
+
     TEST_CASE("Random graphs", "[cluster_random]"){
 
 
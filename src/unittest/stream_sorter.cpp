@@ -0,0 +1,148 @@
+///
+///  \file stream_sorter.cpp
+///
+///  Unit tests for the StreamSorter which sorts GAM files through temp files
+///
+
+#include <iostream>
+#include <algorithm>
+#include <random>
+#include <omp.h>
+#include "catch.hpp"
+#include "../stream_sorter.hpp"
+#include <vg/io/stream.hpp>
+#include "../utility.hpp"
+
+
+namespace vg {
+namespace unittest {
+
+using namespace std;
+
+/// A GAMSorter that lets us make it spill small chunks, so we get lots of
+/// temp files to merge.
+class TestGAMSorter : public GAMSorter {
+public:
+    using GAMSorter::max_buf_size;
+};
+
+/// Sort the given GAM data on the given number of threads, with the given
+/// chunk size, and index it.
+static string sort_gam(const string& unsorted, int thread_count, size_t max_buf_size, GAMIndex& index) {
+    int thread_count_pre = get_thread_count();
+    omp_set_num_threads(thread_count);
+    
+    TestGAMSorter sorter;
+    sorter.max_buf_size = max_buf_size;
+    stringstream in(unsorted);
+    stringstream out;
+    sorter.stream_sort(in, out, &index);
+    
+    omp_set_num_threads(thread_count_pre);
+    return out.str();
+}
+
+/// Get the node IDs of the alignments in the given GAM data, in order.
+static vector<id_t> ids_in(const string& gam) {
+    stringstream in(gam);
+    vector<id_t> ids;
+    vg::io::for_each<Alignment>(in, [&](Alignment& aln) {
+        ids.push_back(aln.path().mapping(0).position().node_id());
+    });
+    return ids;
+}
+
+/// Get the node IDs of the alignments the index finds for each node ID in
+/// the given GAM data.
+static vector<vector<id_t>> ids_found(const string& gam, const GAMIndex& index, id_t max_id) {
+    stringstream in(gam);
+    GAMIndex::cursor_t cursor(in);
+    vector<vector<id_t>> found(max_id + 1);
+    for (id_t id = 1; id <= max_id; id++) {
+        index.find(cursor, id, [&](const Alignment& aln) {
+            found[id].push_back(aln.path().mapping(0).position().node_id());
+        });
+    }
+    return found;
+}
+
+TEST_CASE("StreamSorter merges the same way in serial and in parallel", "[gam][gamsort]") {
+    
+    // Make a lot of one-node alignments, each to a different node, so there
+    // are no ties to break differently.
+    size_t count = 20000;
+    vector<id_t> ids;
+    for (id_t id = 1; id <= (id_t) count; id++) {
+        ids.push_back(id);
+    }
+    std::shuffle(ids.begin(), ids.end(), std::default_random_engine(12345));
+    
+    stringstream unsorted_stream;
+    {
+        vg::io::ProtobufEmitter<Alignment> emitter(unsorted_stream);
+        for (auto& id : ids) {
+            Alignment aln;
+            aln.set_name("read" + to_string(id));
+            // Give the alignment some data to make it big ish, so the ranges
+            // in the parallel merge span several BGZF blocks.
+            aln.set_sequence(random_sequence(150));
+            auto* mapping = aln.mutable_path()->add_mapping();
+            mapping->mutable_position()->set_node_id(id);
+            emitter.write(std::move(aln));
+        }
+    }
+    string unsorted = unsorted_stream.str();
+    
+    vector<id_t> sorted_ids(count);
+    for (size_t i = 0; i < count; i++) {
+        sorted_ids[i] = i + 1;
+    }
+    
+    // Every node's alignment should be found when looking up that node
+    auto check_index = [&](const vector<vector<id_t>>& found) {
+        for (id_t id = 1; id <= (id_t) count; id++) {
+            REQUIRE(std::count(found[id].begin(), found[id].end(), id) == 1);
+        }
+    };
+    
+    SECTION("Many temp files") {
+        // Spill about 100 KB at a time
+        GAMIndex serial_index;
+        string serial = sort_gam(unsorted, 1, 100 * 1024, serial_index);
+        GAMIndex parallel_index;
+        string parallel = sort_gam(unsorted, 4, 100 * 1024, parallel_index);
+        
+        // The output should be big enough to cross BGZF blocks in each range
+        REQUIRE(parallel.size() > 8 * 65536);
+        
+        REQUIRE(ids_in(serial) == sorted_ids);
+        REQUIRE(ids_in(parallel) == sorted_ids);
+        
+        // The range files are stuck together, so the groups from later
+        // ranges must have been moved over to where their data ended up.
+        auto serial_found = ids_found(serial, serial_index, count);
+        auto parallel_found = ids_found(parallel, parallel_index, count);
+        check_index(serial_found);
+        check_index(parallel_found);
+        REQUIRE(parallel_found == serial_found);
+        
+        // And there should be only one EOF block, at the end
+        REQUIRE(parallel.substr(parallel.size() - 28) == serial.substr(serial.size() - 28));
+        REQUIRE(parallel.find(parallel.substr(parallel.size() - 28)) == parallel.size() - 28);
+    }
+    
+    SECTION("One temp file") {
+        GAMIndex serial_index;
+        string serial = sort_gam(unsorted, 1, 1024 * 1024 * 1024, serial_index);
+        GAMIndex parallel_index;
+        string parallel = sort_gam(unsorted, 4, 1024 * 1024 * 1024, parallel_index);
+        
+        // With nothing to merge, the output doesn't depend on the threads
+        REQUIRE(parallel == serial);
+        REQUIRE(ids_in(parallel) == sorted_ids);
+        check_index(ids_found(parallel, parallel_index, count));
+    }
+}
+
+}
+}
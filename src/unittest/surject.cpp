@@ -6,6 +6,7 @@
 
 #include "catch.hpp"
 #include "surjector.hpp"
+#include "surjecting_alignment_emitter.hpp"
 #include "aligner.hpp"
 
 #include "bdsg/hash_graph.hpp"
@@ -797,5 +798,91 @@ TEST_CASE("Duplicate path chunks can be detected", "[surject][multipath]") {
     REQUIRE(path_chunks.size() == 2);
     
 }
+
+/// AlignmentEmitter that just remembers what it was sent
+class CapturingAlignmentEmitter : public vg::io::AlignmentEmitter {
+public:
+    vector<Alignment> emitted;
+    
+    void emit_singles(vector<Alignment>&& aln_batch) {
+        for (auto& aln : aln_batch) {
+            emitted.push_back(aln);
+        }
+    }
+    void emit_mapped_singles(vector<vector<Alignment>>&& alns_batch) {
+        for (auto& alns : alns_batch) {
+            emit_singles(std::move(alns));
+        }
+    }
+    void emit_pairs(vector<Alignment>&& aln1_batch, vector<Alignment>&& aln2_batch, vector<int64_t>&& tlen_limit_batch) {
+        for (size_t i = 0; i < aln1_batch.size(); i++) {
+            emitted.push_back(aln1_batch[i]);
+            emitted.push_back(aln2_batch[i]);
+        }
+    }
+    void emit_mapped_pairs(vector<vector<Alignment>>&& alns1_batch, vector<vector<Alignment>>&& alns2_batch, vector<int64_t>&& tlen_limit_batch) {
+        for (size_t i = 0; i < alns1_batch.size(); i++) {
+            emit_singles(std::move(alns1_batch[i]));
+            emit_singles(std::move(alns2_batch[i]));
+        }
+    }
+};
+
+TEST_CASE("SurjectingAlignmentEmitter keeps batches in order when surjecting in parallel", "[surject]") {
+    
+    bdsg::HashGraph graph;
+    handle_t h1 = graph.create_handle("GATTACA");
+    handle_t h2 = graph.create_handle("CAT");
+    handle_t h3 = graph.create_handle("TTAG");
+    handle_t h4 = graph.create_handle("GGCCA");
+    
+    graph.create_edge(h1, h2);
+    graph.create_edge(h1, h3);
+    graph.create_edge(h2, h4);
+    graph.create_edge(h3, h4);
+    
+    path_handle_t p = graph.create_path_handle("p");
+    graph.append_step(p, h1);
+    graph.append_step(p, h2);
+    graph.append_step(p, h4);
+    
+    bdsg::PositionOverlay pos_graph(&graph);
+    
+    // Make a bunch of reads on different nodes of the path
+    vector<handle_t> starts{h1, h2, h4, h1, h4, h2, h1, h2};
+    vector<Alignment> reads;
+    for (size_t i = 0; i < starts.size(); i++) {
+        Alignment read;
+        read.set_name("read" + to_string(i));
+        Mapping* m = read.mutable_path()->add_mapping();
+        m->set_rank(1);
+        m->mutable_position()->set_node_id(pos_graph.get_id(starts[i]));
+        Edit* e = m->add_edit();
+        e->set_from_length(pos_graph.get_length(starts[i]));
+        e->set_to_length(pos_graph.get_length(starts[i]));
+        read.set_sequence(pos_graph.get_sequence(starts[i]));
+        read.set_score(Aligner().score_contiguous_alignment(read));
+        reads.push_back(read);
+    }
+    
+    CapturingAlignmentEmitter* capture = new CapturingAlignmentEmitter();
+    SurjectingAlignmentEmitter emitter(&pos_graph, {p}, unique_ptr<vg::io::AlignmentEmitter>(capture));
+    
+    vector<vector<Alignment>> batch{reads};
+    #pragma omp parallel num_threads(4)
+    {
+        #pragma omp single
+        emitter.emit_mapped_singles(std::move(batch));
+    }
+    
+    REQUIRE(capture->emitted.size() == reads.size());
+    for (size_t i = 0; i < reads.size(); i++) {
+        REQUIRE(capture->emitted[i].name() == reads[i].name());
+        REQUIRE(capture->emitted[i].refpos_size() == 1);
+        REQUIRE(capture->emitted[i].refpos(0).name() == "p");
+        REQUIRE(capture->emitted[i].refpos(0).offset() == pos_graph.get_position_of_step(pos_graph.steps_of_handle(starts[i]).front()));
+    }
+}
+
 }
 }
@@ -81,6 +81,15 @@ void Watchdog::check_out(size_t thread) {
     t.is_checked_in = false;
 }
 
+void Watchdog::report_time(const string& task, const string& item, const duration& elapsed) const {
+    if (elapsed > timeout) {
+        auto elapsed_seconds = chrono::duration_cast<chrono::seconds>(elapsed);
+        
+        #pragma omp critical (cerr)
+        cerr << "warning[vg::Watchdog]: Spent " << elapsed_seconds.count() << " seconds on: " << task << " " << item << endl;
+    }
+}
+
 void Watchdog::watcher_loop() {
     while (!stop_watcher) {
         // Keep looping until we're asked to shut down
@@ -58,6 +58,15 @@ public:
      */
     void check_out(size_t thread);
     
+    /**
+     * Report that doing the given task to the named item (such as a read)
+     * took the given amount of time, on any thread, checked in or not.
+     * Complains if it took longer than the timeout. The task and item are
+     * separate so callers don't have to build a message for every item when
+     * almost none of them will be complained about.
+     */
+    void report_time(const string& task, const string& item, const duration& elapsed) const;
+    
 private:
     // Since we are accessed by the watcher thread, we can't be copied or moved
     
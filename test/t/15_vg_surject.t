@@ -6,7 +6,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 PATH=../bin:$PATH # for vg
 
 
-plan tests 52
+plan tests 59
 
 vg construct -r small/x.fa >j.vg
 vg index -x j.xg j.vg
@@ -93,6 +93,22 @@ rm -f fwd.fq rev.fq mapped.fwd.gam mapped.rev.gam
 is $(vg map -G <(vg sim -a -n 100 -x x.xg) -g x.gcsa -x x.xg | vg surject -p x -x x.xg -b - | samtools view - | wc -l) \
     100 "vg surject produces valid BAM output"
 
+vg map -G <(vg sim -a -n 1000 -s 1 -x x.xg) -g x.gcsa -x x.xg > mapped.gam
+vg surject -p x -x x.xg -t 4 -b mapped.gam | samtools view - | sort > plain.sam
+vg surject -p x -x x.xg -t 4 -b -C 1 --compression-threads 2 mapped.gam > pooled.bam
+samtools quickcheck pooled.bam
+is "$?" "0" "vg surject produces a complete BAM when compressing in a thread pool"
+is "$(samtools view pooled.bam | sort | md5sum)" "$(md5sum < plain.sam)" "compressing in a thread pool does not change the BAM records"
+
+vg surject -p x -x x.xg -t 4 -b --sorted --output sorted.bam mapped.gam
+is "$(samtools view -H sorted.bam | grep -c 'SO:coordinate')" "1" "vg surject marks sorted BAM output as sorted"
+is "$(samtools view sorted.bam | cut -f3,4 | md5sum)" "$(samtools sort pooled.bam | samtools view - | cut -f3,4 | md5sum)" "vg surject can sort BAM output by coordinate"
+is "$(samtools view sorted.bam | sort | md5sum)" "$(md5sum < plain.sam)" "sorting does not change the BAM records"
+is "$(samtools view -c sorted.bam x)" "$(samtools view -c -F 4 sorted.bam)" "vg surject indexes sorted BAM output"
+vg surject -p x -x x.xg -t 4 -b --sorted --sort-memory 1 mapped.gam > sorted_stdout.bam
+is "$(samtools view sorted_stdout.bam | cut -f3,4 | md5sum)" "$(samtools view sorted.bam | cut -f3,4 | md5sum)" "vg surject can write sorted BAM to standard output"
+rm -f mapped.gam plain.sam pooled.bam sorted.bam sorted.bam.bai sorted_stdout.bam
+
 #is $(vg map -G <(vg sim -a -n 100 x.vg) x.vg | vg surject -p x -g x.gcsa -x x.xg -c - | samtools view - | wc -l) \
 #    100 "vg surject produces valid CRAM output"
 
@@ -6,7 +6,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 PATH=../bin:$PATH # for vg
 
 
-plan tests 19
+plan tests 24
 
 # Toy example of hand-made pileup (and hand inspected truth) to make sure some
 # obvious (and only obvious) SNPs are detected by vg call
@@ -87,6 +87,20 @@ REF_COUNT_A=$(grep "0/0" HGSVC2.vcf | wc -l)
 # this probably doesn't need to be exact (coincidence?), but it works now
 is "${REF_COUNT_V}" "${REF_COUNT_A}" "Same number of reference calls with -a as with -v"
 
+vg call HGSVC_alts.xg -k HGSVC_alts.pack -s HG00514 -a --spill-mb 0.001 > HGSVC2_spill.vcf
+diff <(sort HGSVC2.vcf) <(sort HGSVC2_spill.vcf)
+is "$?" 0 "Spilling variants to temporary files does not change the calls"
+vg call HGSVC_alts.xg -k HGSVC_alts.pack -s HG00514 -a --spill-mb 0.000001 > HGSVC2_spill.vcf
+diff <(sort HGSVC2.vcf) <(sort HGSVC2_spill.vcf)
+is "$?" 0 "Spilling every variant to its own temporary file does not change the calls"
+vg call HGSVC_alts.xg -k HGSVC_alts.pack -s HG00514 -a --spill-mb -1 > /dev/null 2>&1
+is "$?" 1 "vg call rejects a negative spill budget"
+vg call HGSVC_alts.xg -k HGSVC_alts.pack -s HG00514 -a --vcf-out HGSVC2.vcf.gz
+diff <(sort HGSVC2.vcf) <(bgzip -dc HGSVC2.vcf.gz | sort)
+is "$?" 0 "vg call writes the same calls to a bgzipped VCF"
+is "$(tabix -l HGSVC2.vcf.gz)" "$(grep -v '^#' HGSVC2.vcf | cut -f1 | sort -u)" "vg call tabix indexes the bgzipped VCF"
+rm -f HGSVC2_spill.vcf HGSVC2.vcf.gz HGSVC2.vcf.gz.tbi
+
 # Output snarl traversals into a GBWT then genotype that
 vg call HGSVC_alts.xg -k HGSVC_alts.pack -s HG00514 -T | gzip > HGSVC_travs.gaf.gz
 vg gbwt -o HGSVC_travs.gbwt -x HGSVC_alts.xg -A HGSVC_travs.gaf.gz
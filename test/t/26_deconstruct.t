@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 37
+plan tests 38
 
 vg msga -f GRCh38_alts/FASTA/HLA/V-352962.fa -t 1 -k 16 | vg mod -U 10 - | vg mod -c - > hla.vg
 vg index hla.vg -x hla.xg
@@ -176,7 +176,11 @@ printf "T\tA\t1|.\n" >> nested_snp_in_del_truth.tsv
 diff nested_snp_in_del.tsv nested_snp_in_del_truth.tsv
 is "$?" 0 "nested deconstruction gets correct allele for snp inside deletion (without -R)"
 
-rm -f nested_snp_in_del.vcf nested_snp_in_del.tsv nested_snp_in_del_truth.tsv
+vg deconstruct nesting/nested_snp_in_del.gfa -p x -n --spill-mb 0.000001 > nested_snp_in_del_spill.vcf
+diff nested_snp_in_del.vcf nested_snp_in_del_spill.vcf
+is "$?" 0 "nested deconstruction gets the same nesting tags when spilling variants to temporary files"
+
+rm -f nested_snp_in_del.vcf nested_snp_in_del_spill.vcf nested_snp_in_del.tsv nested_snp_in_del_truth.tsv
 
 vg deconstruct nesting/nested_snp_in_ins.gfa -p x -n > nested_snp_in_ins.vcf
 grep -v ^# nested_snp_in_ins.vcf | awk '{print $4 "\t" $5 "\t" $10}' > nested_snp_in_ins.tsv
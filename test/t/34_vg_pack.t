@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 20
+plan tests 21
 
 vg construct -m 1000 -r tiny/tiny.fa >flat.vg
 vg view flat.vg| sed 's/CAAATAAGGCTTGGAAATTTTCTGGAGTTCTATTATATTCCAACTCTCTG/CAAATAAGGCTTGGAAATTTTCTGGAGATCTATTATACTCCAACTCTCTG/' | vg view -Fv - >2snp.vg
@@ -57,6 +57,10 @@ y=$(vg pack -x flat.xg -Di 2snp.gam.cx.3x | wc -c)
 
 is $x $y "pack index merging produces the expected result for edges"
 
+x=$(vg pack -x flat.xg -g 2snp.gam -t 4 -B 0 -d -D | md5sum | cut -f 1 -d\ )
+y=$(vg pack -x flat.xg -g 2snp.gam -t 4 -B 7 -d -D | md5sum | cut -f 1 -d\ )
+is $x $y "buffering coverage increments per thread does not affect the result"
+
 rm -f flat.vg 2snp.vg 2snp.xg 2snp.sim flat.gcsa flat.gcsa.lcp flat.xg 2snp.xg 2snp.gam 2snp.gam.cx 2snp.gam.cx.3x 2snp.gam.vgpu
 
 vg construct -r tiny/tiny.fa -v tiny/tiny.vcf.gz > tiny.vg
@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 9
+plan tests 11
 
 vg construct -r tiny/tiny.fa -v tiny/tiny.vcf.gz >t.vg
 
@@ -15,6 +15,12 @@ vg index -x t.ref.xg t.ref.vg
 
 is "$(vg annotate -n -x t.ref.xg -a tiny/tiny-s7331-n10-l50.gam | awk '{ if ($5 < 50) print }' | wc -l)" "10" "we can detect when reads contain non-reference variation"
 
+vg annotate -n -t 1 -x t.ref.xg -a tiny/tiny-s7331-n10-l50.gam > novelty.1.tsv
+vg annotate -n -t 4 -x t.ref.xg -a tiny/tiny-s7331-n10-l50.gam > novelty.4.tsv
+is "$(head -n 1 novelty.4.tsv)" "$(head -n 1 novelty.1.tsv)" "the novelty table header comes first when using multiple threads"
+diff <(tail -n +2 novelty.1.tsv | sort) <(tail -n +2 novelty.4.tsv | sort)
+is "${?}" "0" "the novelty table has the same rows, in some order, when using multiple threads"
+
 vg annotate -b tiny/tiny.bed -x t.ref.xg -a tiny/tiny-s543-n30-l10.gam > annotated.gam
 is "$(vg view -aj annotated.gam | jq -c '.annotation.features' | grep feat1 | wc -l)" 3 "vg annotate finds the right number of reads overlapping a feature"
 is "$(vg view -aj annotated.gam | grep feat1 | grep -e '"node_id": *"1"' | wc -l)" "$(vg view -aj annotated.gam | grep feat1 | wc -l)" "all reads overlapping a feature fall on its node"
@@ -22,7 +28,7 @@ is "$(vg view -aj annotated.gam | jq -c '.annotation.features' | grep feat1 | gr
 is "$(vg view -aj annotated.gam | jq -c '.annotation.features' | grep feat2 | grep feat3 | wc -l)" 2 "vg annotate shows reads having to go through one feature to get to another at the end"
 is "$(vg view -aj annotated.gam | jq -c '.annotation.features' | grep featAll | wc -l)" 30 "vg annotate shows all reads overlapping a whole-reference-covering feature"
 
-rm -f t.vg t.ref.vg t.xg t.ref.xg annotated.gam
+rm -f t.vg t.ref.vg t.xg t.ref.xg annotated.gam novelty.1.tsv novelty.4.tsv
 
 vg construct -r small/x.fa -v small/x.vcf.gz >x.vg
 vg index -x x.xg x.vg
@@ -5,10 +5,28 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 1
+plan tests 6
 
 vg benchmark >/dev/null
 
 is "${?}" "0" "vg benchmark completes succesfully"
 
+vg benchmark -f '^control$' > control.tsv
+is "$(grep -v '^#' control.tsv | cut -f8)" "control" "vg benchmark can select benchmark cases by name"
 
+vg benchmark -f '^control$' -j | grep '"name": "control"' >/dev/null
+is "${?}" "0" "vg benchmark can report results as JSON"
+
+vg benchmark -f '^control$' -b control.tsv -r 1 >/dev/null 2>&1
+is "${?}" "0" "vg benchmark can compare results against a baseline"
+
+# Keys don't change when the computed parts of the names do
+sed 's/\tcontrol$/\tcontrol with a different name/' control.tsv > renamed.tsv
+vg benchmark -f '^control$' -b renamed.tsv -r 1 >/dev/null 2>&1
+is "${?}" "0" "vg benchmark matches baseline results by key and not by name"
+
+sed 's/\tcontrol\t/\tcontrol\/gone\t/' control.tsv > doctored.tsv
+vg benchmark -f '^control$' -b doctored.tsv -r 1 >/dev/null 2>&1
+is "${?}" "1" "vg benchmark fails when baseline benchmarks were not run"
+
+rm -f control.tsv renamed.tsv doctored.tsv
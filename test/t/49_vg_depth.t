@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 6
+plan tests 10
 
 vg construct -m 10 -r tiny/tiny.fa >flat.vg
 vg view flat.vg| sed 's/CAAATAAGGCTTGGAAATTTTCTGGAGTTCTATTATATTCCAACTCTCTG/CAAATAAGGCTTGGAAATTTTCTGGAGATCTATTATACTCCAACTCTCTG/' | vg view -Fv - >2snp.vg
@@ -17,9 +17,21 @@ vg pack -x flat.xg -o 2snp.gam.cx -g 2snp.gam
 is $(vg depth flat.vg -g 2snp.gam | awk '{print $1}') 18 "vg depth gets correct depth from gam"
 is $(vg depth flat.xg -k 2snp.gam.cx -b 100000 | awk '{print int($4)}') 18 "vg depth gets correct depth from pack"
 is $(vg depth flat.xg -k 2snp.gam.cx -b 10 | wc -l) 5 "vg depth gets correct number of bins"
+vg depth flat.xg -k 2snp.gam.cx -t 1 > 2snp.depth
+vg depth flat.xg -k 2snp.gam.cx -t 4 --bgzip-out 2snp.depth.gz
+diff 2snp.depth <(bgzip -dc 2snp.depth.gz)
+is "$?" 0 "vg depth writes the same depths to a bgzipped file"
+is "$(tabix 2snp.depth.gz x:10-12 | cut -f2 | tr '\n' ' ')" "10 11 12 " "vg depth tabix indexes the bgzipped depths"
+vg depth flat.xg -k 2snp.gam.cx -t 4 --range-size 15 > 2snp.ranged.depth
+diff 2snp.depth 2snp.ranged.depth
+is "$?" 0 "vg depth gets the same packed depths when splitting paths into ranges"
 vg convert flat.vg -G 2snp.gam | gzip > 2snp.gaf.gz
 is $(vg depth flat.vg -a 2snp.gaf.gz | awk '{print $1}') 18 "vg depth gets correct depth from gaf"
 vg augment flat.vg 2snp.gam -i > flat-aug.vg
 is $(vg depth flat-aug.vg | awk '{print $1}' | uniq | wc -l) $(vg paths -Lv flat-aug.vg | wc -l) "vg depth of paths reports all paths"
 is $(vg depth flat-aug.vg -P x | awk '{print $1}' | uniq | wc -l) 1 "vg depth of paths reports just path with selected prefix"
-rm -f flat.vg flat.gcsa flat.xg 2snp.vg 2snp.sim 2snp.gam 2snp.gam.cx 2snp.gaf.gz flat-aug.vg
+vg depth flat-aug.vg -t 1 > aug.depth
+vg depth flat-aug.vg -t 4 --range-size 3 > aug.ranged.depth
+diff aug.depth aug.ranged.depth
+is "$?" 0 "vg depth gets the same path depths in the same order when splitting paths into ranges"
+rm -f flat.vg flat.gcsa flat.xg 2snp.vg 2snp.sim 2snp.gam 2snp.gam.cx 2snp.gaf.gz flat-aug.vg 2snp.depth 2snp.depth.gz 2snp.depth.gz.tbi 2snp.ranged.depth aug.depth aug.ranged.depth
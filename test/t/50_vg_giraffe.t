@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 55
+plan tests 61
 
 vg construct -a -r small/x.fa -v small/x.vcf.gz >x.vg
 vg index -x x.xg x.vg
@@ -124,6 +124,20 @@ is "$(vg view -aj single.gam | jq -c 'select((.fragment_next | not) and (.fragme
 vg giraffe x.fa x.vcf.gz -f small/x.fa_1.fastq -f small/x.fa_1.fastq --fragment-mean 300 --fragment-stdev 100 > paired.gam
 is "$(vg view -aj paired.gam | jq -c 'select((.fragment_next | not) and (.fragment_prev | not))' | wc -l | sed 's/^[[:space:]]*//')" "0" "paired reads have cross-references"
 
+vg giraffe x.fa x.vcf.gz -f small/x.fa_1.fastq --pipeline -t 4 > single.pipeline.gam
+is "$(vg view -aj single.pipeline.gam | jq -r '.name' | sort | md5sum)" "$(vg view -aj single.gam | jq -r '.name' | sort | md5sum)" "pipelined mapping of unpaired reads produces all the reads"
+
+vg giraffe x.fa x.vcf.gz -f small/x.fa_1.fastq -f small/x.fa_1.fastq --fragment-mean 300 --fragment-stdev 100 --pipeline -t 4 > paired.pipeline.gam
+is "$(vg view -aj paired.pipeline.gam | jq -c 'select(.fragment_next or .fragment_prev)' | wc -l | sed 's/^[[:space:]]*//')" "2000" "pipelined mapping of paired reads produces all the pairs"
+
+head -n 400 small/x.fa_1.fastq > short.fq
+vg giraffe x.fa x.vcf.gz -f small/x.fa_1.fastq -f short.fq --fragment-mean 300 --fragment-stdev 100 --pipeline -t 4 >/dev/null 2>&1
+is "${?}" "1" "pipelined mapping of paired reads fails when the second file is shorter"
+vg giraffe x.fa x.vcf.gz -f short.fq -f small/x.fa_1.fastq --fragment-mean 300 --fragment-stdev 100 --pipeline -t 4 >/dev/null 2>&1
+is "${?}" "1" "pipelined mapping of paired reads fails when the first file is shorter"
+
+rm -f single.pipeline.gam paired.pipeline.gam short.fq
+
 # Test paired surjected mapping
 vg giraffe x.fa x.vcf.gz -iG <(vg view -a small/x-s13241-n1-p500-v300.gam | sed 's%_1%/1%' | sed 's%_2%/2%' | vg view -JaG - ) --output-format SAM >surjected.sam
 is "$(cat surjected.sam | grep -v '^@' | sort -k4 | cut -f 4)" "$(printf '321\n762')" "surjection of paired reads to SAM yields correct positions"
@@ -187,6 +201,12 @@ is $? "0" "correctness tracking succeeds for unpaired reads"
 
 is "$(cat xy.json | grep "correct-minimizer-coverage" | wc -l)" "2000" "unpaired reads are annotated with minimizer coverage"
 
+vg giraffe xy.fa xy.vcf.gz -G x.gam --stage-profile-tsv stages.tsv --discard 2>stages.log
+is "$(grep -v '^#' stages.tsv | cut -f2 | sort -u | grep -c '^cluster$')" "1" "per-read stage profiles can be written"
+is "$(grep -c 'Mapping stage profile' stages.log)" "1" "stage profile summary is reported"
+
+rm -f stages.tsv stages.log
+
 vg giraffe xy.fa xy.vcf.gz -G x.gam -i --fragment-mean 200 --fragment-stdev 10 --distance-limit 50 --track-provenance --discard
 is $? "0" "provenance tracking succeeds for paired reads"
 
@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 49
+plan tests 50
 
 rm auto.*
 
@@ -35,7 +35,8 @@ rm auto.*
 
 vg autoindex -p auto -w mpmap -w rpvg -r tiny/tiny.fa -v tiny/tiny.vcf.gz -x tiny/tiny.gtf
 is $(echo $?) 0 "autoindexing successfully completes indexing for vg mpmap with unchunked input"
-is $(ls auto.* | wc -l) 6 "autoindexing creates 6 files for mpmap/rpvg"
+is $(ls auto.* | wc -l) 7 "autoindexing creates 7 files for mpmap/rpvg"
+is $(ls auto.spliced.gcsa.accel | wc -l) 1 "autoindexing memoizes GCSA2 queries for vg mpmap"
 vg sim -x auto.spliced.xg -n 20 -a -l 10 | vg mpmap -x auto.spliced.xg -g auto.spliced.gcsa -d auto.spliced.dist -B -t 1 -G - > /dev/null
 is $(echo $?) 0 "basic autoindexing results can be used by vg mpmap"
 is $(vg paths -g auto.haplotx.gbwt -L | wc -l) 6 "haplotype transcript GBWT made by autoindex is valid"
@@ -45,7 +46,7 @@ rm auto.*
 
 vg autoindex -p auto -w mpmap  -r tiny/tiny.fa -v tiny/tiny.vcf.gz -x tiny/tiny.gtf --force-unphased
 is $(echo $?) 0 "autoindexing successfully completes indexing for vg mpmap with unchunked, unphased input"
-is $(ls auto.* | wc -l) 4 "autoindexing creates 4 files for mpmap/rpvg"
+is $(ls auto.* | wc -l) 5 "autoindexing creates 5 files for mpmap/rpvg"
 vg sim -x auto.spliced.xg -n 20 -a -l 10 | vg mpmap -x auto.spliced.xg -g auto.spliced.gcsa -d auto.spliced.dist -B -t 1 -G - > /dev/null
 is $(echo $?) 0 "basic unphased autoindexing results can be used by vg mpmap"
 
@@ -53,7 +54,7 @@ rm auto.*
 
 vg autoindex -p auto -w mpmap -r tiny/tiny.fa -x tiny/tiny.gtf
 is $(echo $?) 0 "autoindexing successfully completes indexing for vg mpmap without variants"
-is $(ls auto.* | wc -l) 4 "autoindexing creates 4 files for mpmap without variants"
+is $(ls auto.* | wc -l) 5 "autoindexing creates 5 files for mpmap without variants"
 vg sim -x auto.spliced.xg -n 20 -a -l 10 | vg mpmap -x auto.spliced.xg -g auto.spliced.gcsa -d auto.spliced.dist -B -t 1 -G - > /dev/null
 is $(echo $?) 0 "autoindexing results with no variants can be used by vg mpmap"
 
@@ -61,13 +62,13 @@ rm auto.*
 
 vg autoindex -p auto -w mpmap -w rpvg -r small/x.fa -r small/y.fa -v small/x.vcf.gz -v small/y.vcf.gz -x small/x.gtf -x small/y.gtf
 is $(echo $?) 0 "autoindexing successfully completes indexing for vg mpmap with chunked input"
-is $(ls auto.* | wc -l) 6 "autoindexing creates 6 files for mpmap/rpvg with chunked input"
+is $(ls auto.* | wc -l) 7 "autoindexing creates 7 files for mpmap/rpvg with chunked input"
 
 rm auto.*
 
 vg autoindex -p auto -w mpmap -r small/x.fa -r small/y.fa -v small/x.vcf.gz -v small/y.vcf.gz -x small/x.gtf -x small/y.gtf --force-unphased
 is $(echo $?) 0 "autoindexing successfully completes indexing for vg mpmap with unphased chunked input"
-is $(ls auto.* | wc -l) 4 "autoindexing creates 4 files for mpmap/rpvg with chunked input"
+is $(ls auto.* | wc -l) 5 "autoindexing creates 5 files for mpmap/rpvg with chunked input"
 vg sim -x auto.spliced.xg -n 20 -a -l 10 | vg mpmap -x auto.spliced.xg -g auto.spliced.gcsa -d auto.spliced.dist -B -t 1 -G - > /dev/null
 is $(echo $?) 0 "autoindexing results with chunked unphased input can be used by vg mpmap"
 
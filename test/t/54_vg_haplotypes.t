@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 21
+plan tests 24
 
 # The test graph consists of two subgraphs of the HPRC Minigraph-Cactus v1.1 graph:
 # - GRCh38#chr6:31498145-31511124 (micb)
@@ -45,6 +45,15 @@ is $(vg gbwt -S -Z diploid.gbz) 3 "1 generated + 2 reference samples"
 is $(vg gbwt -C -Z diploid.gbz) 2 "2 contigs"
 is $(vg gbwt -H -Z diploid.gbz) 4 "2 generated + 2 reference haplotypes"
 
+# Count the kmers in the reads instead of using KMC
+vg haplotypes -i full.hapl -k haplotype-sampling/HG003.fq.gz --include-reference -g from_reads.gbz full.gbz
+is $? 0 "sampling the haplotypes with kmer counts from reads"
+is $(vg gbwt -H -Z from_reads.gbz) 6 "4 generated + 2 reference haplotypes"
+vg haplotypes -i full.hapl -k haplotype-sampling/HG003.kff --kmer-counts kff_counts.tsv full.gbz
+vg haplotypes -i full.hapl -k haplotype-sampling/HG003.fq.gz --kmer-counts read_counts.tsv full.gbz
+# KMC drops the kmers seen only once
+is "$(awk '$2 > 1' read_counts.tsv | md5sum)" "$(awk '$2 > 1' kff_counts.tsv | md5sum)" "kmer counts from reads match the KFF counts"
+
 # Diploid sampling using a preset
 vg haplotypes -i full.hapl -k haplotype-sampling/HG003.kff --preset diploid -g diploid2.gbz full.gbz
 is $? 0 "diploid sampling using a preset"
@@ -68,7 +77,7 @@ is $? 0 "the sampled graphs are identical"
 
 # Cleanup
 rm -r full.gbz full.ri full.dist full.hapl
-rm -f indirect.gbz direct.gbz no_ref.gbz
+rm -f indirect.gbz direct.gbz no_ref.gbz from_reads.gbz kff_counts.tsv read_counts.tsv
 rm -f diploid.gbz diploid2.gbz
 rm -f full.HG003.gbz full.HG003.dist full.HG003.min default.gam
 rm -f sampled.003HG.gbz sampled.003HG.dist sampled.003HG.min specified.gam